@@ -106,7 +106,7 @@ bool CAX25Demodulator::process(q15_t* samples, uint8_t length, CAX25Frame& frame
   bool result = false;
 
   q15_t fa[RX_BLOCK_SIZE];
-  m_twist.process(samples, fa, RX_BLOCK_SIZE);
+  m_twist.process(samples, fa, length);
 
   int16_t buffer[RX_BLOCK_SIZE];
   for (uint8_t i = 0; i < length; i++) {
@@ -116,7 +116,7 @@ bool CAX25Demodulator::process(q15_t* samples, uint8_t length, CAX25Frame& frame
   }
 
   q15_t fc[RX_BLOCK_SIZE];
-  ::arm_fir_fast_q15(&m_lpfFilter, buffer, fc, RX_BLOCK_SIZE);
+  ::arm_fir_fast_q15(&m_lpfFilter, buffer, fc, length);
 
   for (uint8_t i = 0; i < length; i++) {
     bool bit = fc[i] >= 0;
@@ -33,7 +33,7 @@ public:
 
 private:
   arm_fir_instance_q15 m_filter;
-  q15_t                m_state[40U];   // NoTaps + BlockSize - 1, 9 + 20 - 1 plus some spare
+  q15_t                m_state[9U + RX_BLOCK_SIZE - 1U];   // NoTaps + BlockSize - 1
 };
 
 #endif
@@ -111,6 +111,23 @@
 // To reduce CPU load, you can remove the DC blocker by commenting out the next line
 #define USE_DCBLOCKER
 
+// Skip the digital mode receivers in idle while the channel is silent or only noise
+// #define USE_ACTIVITY_GATE
+
+// The number of samples processed by the receivers at a time, 2 (the default), 8, 24 or 48
+// #define RX_BLOCK_SIZE 24U
+
+// Record the cycle counts of the ISR and the receive and transmit stages, read with MMDVM_GET_STATS
+// #define USE_PROFILER
+
+// Move the ADC and DAC samples by timer triggered DMA in blocks instead of with an interrupt per sample, STM32F4/F7 only,
+// not yet tried on hardware
+// #define USE_DMA_IO
+
+// Receive from and send to the host by DMA, reading the frames where they lie in the receive buffer, STM32F4/F7 only,
+// not yet tried on hardware
+// #define USE_DMA_SERIAL
+
 // Constant Service LED once repeater is running 
 // Do not use if employing an external hardware watchdog 
 // #define CONSTANT_SRV_LED
@@ -25,54 +25,49 @@
 #include "DMRSlotType.h"
 #include "Utils.h"
 
-const q15_t SCALING_FACTOR = 19505;      // Q15(0.60)
-
 const uint8_t MAX_SYNC_SYMBOLS_ERRS = 2U;
 const uint8_t MAX_SYNC_BYTES_ERRS   = 3U;
 
 const uint8_t MAX_SYNC_LOST_FRAMES  = 13U;
 
-const uint8_t BIT_MASK_TABLE[] = {0x80U, 0x40U, 0x20U, 0x10U, 0x08U, 0x04U, 0x02U, 0x01U};
-
-#define WRITE_BIT1(p,i,b) p[(i)>>3] = (b) ? (p[(i)>>3] | BIT_MASK_TABLE[(i)&7]) : (p[(i)>>3] & ~BIT_MASK_TABLE[(i)&7])
-
 const uint16_t NOENDPTR = 9999U;
 
 const uint8_t CONTROL_NONE  = 0x00U;
 const uint8_t CONTROL_VOICE = 0x20U;
 const uint8_t CONTROL_DATA  = 0x40U;
 
+// The samples are kept at the full rate only for as long as the sync correlation and the part of
+// the burst before the sync need them, and the symbols after the sync are taken from them at the
+// end of the burst by the symbol timing. See CDMRSlotRX.
+
 CDMRDMORX::CDMRDMORX() :
-m_bitBuffer(),
-m_buffer(),
-m_bitPtr(0U),
+m_demod(),
+m_rssiHistory(),
+m_symbols(),
+m_rssiAccum(0U),
+m_rssiStart(0U),
 m_dataPtr(0U),
 m_syncPtr(0U),
-m_startPtr(0U),
 m_endPtr(NOENDPTR),
-m_maxCorr(0),
-m_centre(),
-m_threshold(),
-m_averagePtr(0U),
 m_control(CONTROL_NONE),
 m_syncCount(0U),
 m_colorCode(0U),
 m_state(DMORXS_NONE),
 m_n(0U),
-m_type(0U),
-m_rssi()
+m_type(0U)
 {
 }
 
 void CDMRDMORX::reset()
 {
   m_syncPtr   = 0U;
-  m_maxCorr   = 0;
   m_control   = CONTROL_NONE;
   m_syncCount = 0U;
   m_state     = DMORXS_NONE;
-  m_startPtr  = 0U;
   m_endPtr    = NOENDPTR;
+
+  m_demod.restart();
+  m_demod.nextSync();
 }
 
 void CDMRDMORX::samples(const q15_t* samples, const uint16_t* rssi, uint8_t length)
@@ -87,12 +82,13 @@ void CDMRDMORX::samples(const q15_t* samples, const uint16_t* rssi, uint8_t leng
 
 bool CDMRDMORX::processSample(q15_t sample, uint16_t rssi)
 {
-  m_buffer[m_dataPtr] = sample;
-  m_rssi[m_dataPtr] = rssi;
+  m_demod.add(sample);
+
+  uint16_t historyPtr = m_demod.ptr();
+  if ((historyPtr % DMR_RADIO_SYMBOL_LENGTH) == 0U)
+    m_rssiHistory[historyPtr / DMR_RADIO_SYMBOL_LENGTH] = m_rssiAccum;
 
-  m_bitBuffer[m_bitPtr] <<= 1;
-  if (sample < 0)
-    m_bitBuffer[m_bitPtr] |= 0x01U;
+  m_rssiAccum += rssi;
 
   if (m_state == DMORXS_NONE) {
     correlateSync(true);
@@ -113,21 +109,37 @@ bool CDMRDMORX::processSample(q15_t sample, uint16_t rssi)
       if (m_dataPtr >= min || m_dataPtr <= max)
         correlateSync(false);
     }
+
+    // No sync this time, so use the position of the last one
+    if (m_dataPtr == max && m_control == CONTROL_NONE) {
+      storeSymbols(1U);
+
+      m_endPtr = m_syncPtr + DMR_FRAME_LENGTH_SAMPLES - DMR_SYNC_END_SAMPLES;
+      if (m_endPtr >= DMO_BUFFER_LENGTH_SAMPLES)
+        m_endPtr -= DMO_BUFFER_LENGTH_SAMPLES;
+    }
   }
 
   if (m_dataPtr == m_endPtr) {
-    // Find the average centre and threshold values
-    q15_t centre    = (m_centre[0U]    + m_centre[1U]    + m_centre[2U]    + m_centre[3U])    >> 2;
-    q15_t threshold = (m_threshold[0U] + m_threshold[1U] + m_threshold[2U] + m_threshold[3U]) >> 2;
+    // The symbols after the sync, from its last one, are the newest in the history
+    uint16_t ptr = m_demod.ptr() + DMR_SYNC_END_SAMPLES - (DMR_FRAME_LENGTH_SAMPLES - DMR_SYNC_END_SAMPLES);
+    if (ptr >= DMR_SYNC_END_SAMPLES)
+      ptr -= DMR_SYNC_END_SAMPLES;
+
+    m_demod.extract(ptr, DMR_FRAME_LENGTH_SAMPLES - DMR_SYNC_END_SAMPLES + 1U, m_symbols + DMR_SYNC_END_SYMBOLS - 1U, DMR_FRAME_LENGTH_SYMBOLS - DMR_SYNC_END_SYMBOLS + 1U);
+
+    // The next burst's sync is expected where the transmitter's clock has taken this one
+    int16_t syncPtr = int16_t(m_syncPtr) + m_demod.slip();
+    if (syncPtr < 0)
+      syncPtr += DMO_BUFFER_LENGTH_SAMPLES;
+    else if (syncPtr >= int16_t(DMO_BUFFER_LENGTH_SAMPLES))
+      syncPtr -= DMO_BUFFER_LENGTH_SAMPLES;
+    m_syncPtr = uint16_t(syncPtr);
 
     uint8_t frame[DMR_FRAME_LENGTH_BYTES + 3U];
     frame[0U] = m_control;
 
-    uint16_t ptr = m_endPtr + DMO_BUFFER_LENGTH_SAMPLES - DMR_FRAME_LENGTH_SAMPLES + DMR_RADIO_SYMBOL_LENGTH + 1U;
-    if (ptr >= DMO_BUFFER_LENGTH_SAMPLES)
-      ptr -= DMO_BUFFER_LENGTH_SAMPLES;
-
-    samplesToBits(ptr, DMR_FRAME_LENGTH_SYMBOLS, frame, 8U, centre, threshold);
+    m_demod.samplesToBits(m_symbols, DMR_FRAME_LENGTH_SYMBOLS, frame, 8U);
 
     if (m_control == CONTROL_DATA) {
       // Data sync
@@ -144,7 +156,7 @@ bool CDMRDMORX::processSample(q15_t sample, uint16_t rssi)
 
         switch (dataType) {
           case DT_DATA_HEADER:
-            DEBUG4("DMRDMORX: data header found pos/centre/threshold", m_syncPtr, centre, threshold);
+            DEBUG4("DMRDMORX: data header found pos/centre/threshold", m_syncPtr, m_demod.centre(), m_demod.threshold());
             writeRSSIData(frame);
             m_state = DMORXS_DATA;
             m_type  = 0x00U;
@@ -153,32 +165,32 @@ bool CDMRDMORX::processSample(q15_t sample, uint16_t rssi)
           case DT_RATE_34_DATA:
           case DT_RATE_1_DATA:
             if (m_state == DMORXS_DATA) {
-              DEBUG4("DMRDMORX: data payload found pos/centre/threshold", m_syncPtr, centre, threshold);
+              DEBUG4("DMRDMORX: data payload found pos/centre/threshold", m_syncPtr, m_demod.centre(), m_demod.threshold());
               writeRSSIData(frame);
               m_type = dataType;
             }
             break;
           case DT_VOICE_LC_HEADER:
-            DEBUG4("DMRDMORX: voice header found pos/centre/threshold", m_syncPtr, centre, threshold);
+            DEBUG4("DMRDMORX: voice header found pos/centre/threshold", m_syncPtr, m_demod.centre(), m_demod.threshold());
             writeRSSIData(frame);
             m_state = DMORXS_VOICE;
             break;
           case DT_VOICE_PI_HEADER:
             if (m_state == DMORXS_VOICE) {
-              DEBUG4("DMRDMORX: voice pi header found pos/centre/threshold", m_syncPtr, centre, threshold);
+              DEBUG4("DMRDMORX: voice pi header found pos/centre/threshold", m_syncPtr, m_demod.centre(), m_demod.threshold());
               writeRSSIData(frame);
             }
             m_state = DMORXS_VOICE;
             break;
           case DT_TERMINATOR_WITH_LC:
             if (m_state == DMORXS_VOICE) {
-              DEBUG4("DMRDMORX: voice terminator found pos/centre/threshold", m_syncPtr, centre, threshold);
+              DEBUG4("DMRDMORX: voice terminator found pos/centre/threshold", m_syncPtr, m_demod.centre(), m_demod.threshold());
               writeRSSIData(frame);
               reset();
             }
             break;
           default:    // DT_CSBK
-            DEBUG4("DMRDMORX: csbk found pos/centre/threshold", m_syncPtr, centre, threshold);
+            DEBUG4("DMRDMORX: csbk found pos/centre/threshold", m_syncPtr, m_demod.centre(), m_demod.threshold());
             writeRSSIData(frame);
             reset();
             break;
@@ -186,7 +198,7 @@ bool CDMRDMORX::processSample(q15_t sample, uint16_t rssi)
       }
     } else if (m_control == CONTROL_VOICE) {
       // Voice sync
-      DEBUG4("DMRDMORX: voice sync found pos/centre/threshold", m_syncPtr, centre, threshold);
+      DEBUG4("DMRDMORX: voice sync found pos/centre/threshold", m_syncPtr, m_demod.centre(), m_demod.threshold());
 	    writeRSSIData(frame);
       m_state     = DMORXS_VOICE;
       m_syncCount = 0U;
@@ -208,7 +220,7 @@ bool CDMRDMORX::processSample(q15_t sample, uint16_t rssi)
           frame[0U] = ++m_n;
         }
 
-        serial.writeDMRData(true, frame, DMR_FRAME_LENGTH_BYTES + 1U);
+        writeData(frame, DMR_FRAME_LENGTH_BYTES + 1U);
       } else if (m_state == DMORXS_DATA) {
         if (m_type != 0x00U) {
           frame[0U] = CONTROL_DATA | m_type;
@@ -218,7 +230,7 @@ bool CDMRDMORX::processSample(q15_t sample, uint16_t rssi)
     }
 
     // End of this slot, reset some items for the next slot.
-    m_maxCorr = 0;
+    m_demod.nextSync();
     m_control = CONTROL_NONE;
   }
 
@@ -226,175 +238,75 @@ bool CDMRDMORX::processSample(q15_t sample, uint16_t rssi)
   if (m_dataPtr >= DMO_BUFFER_LENGTH_SAMPLES)
     m_dataPtr = 0U;
 
-  m_bitPtr++;
-  if (m_bitPtr >= DMR_RADIO_SYMBOL_LENGTH)
-    m_bitPtr = 0U;
-
   return m_state != DMORXS_NONE;
 }
 
 void CDMRDMORX::correlateSync(bool first)
 {
-  uint8_t errs = countBits32((m_bitBuffer[m_bitPtr] & DMR_SYNC_SYMBOLS_MASK) ^ DMR_MS_DATA_SYNC_SYMBOLS);
+  uint8_t errs = m_demod.searchErrors(DMR_MS_DATA_SYNC_SYMBOLS, DMR_SYNC_SYMBOLS_MASK);
 
   // The voice sync is the complement of the data sync
   bool data  = (errs <= MAX_SYNC_SYMBOLS_ERRS);
   bool voice = (errs >= (DMR_SYNC_LENGTH_SYMBOLS - MAX_SYNC_SYMBOLS_ERRS));
 
-  if (data || voice) {
-    uint16_t ptr = m_dataPtr + DMO_BUFFER_LENGTH_SAMPLES - DMR_SYNC_LENGTH_SAMPLES + DMR_RADIO_SYMBOL_LENGTH;
-    if (ptr >= DMO_BUFFER_LENGTH_SAMPLES)
-      ptr -= DMO_BUFFER_LENGTH_SAMPLES;
-
-    q31_t corr = 0;
-    q15_t min =  16000;
-    q15_t max = -16000;
-
-    for (uint8_t i = 0U; i < DMR_SYNC_LENGTH_SYMBOLS; i++) {
-      q15_t val = m_buffer[ptr];
-
-      if (val > max)
-        max = val;
-      if (val < min)
-        min = val;
-
-      int8_t corrVal;
-      if (data)
-        corrVal = DMR_MS_DATA_SYNC_SYMBOLS_VALUES[i];
-      else
-        corrVal = DMR_MS_VOICE_SYNC_SYMBOLS_VALUES[i];
-
-      switch (corrVal) {
-      case +3:
-        corr -= (val + val + val);
-        break;
-      case +1:
-        corr -= val;
-        break;
-      case -1:
-        corr += val;
-        break;
-      default:  // -3
-        corr += (val + val + val);
-        break;
-      }
+  if (data) {
+    if (!m_demod.correlateSync(DMR_MS_DATA_SYNC_SYMBOLS_VALUES, DMR_MS_DATA_SYNC_BYTES, DMR_SYNC_BYTES_MASK, 4U, MAX_SYNC_BYTES_ERRS))
+      return;
 
-      ptr += DMR_RADIO_SYMBOL_LENGTH;
-      if (ptr >= DMO_BUFFER_LENGTH_SAMPLES)
-        ptr -= DMO_BUFFER_LENGTH_SAMPLES;
-    }
+    m_control = CONTROL_DATA;
+  } else if (voice) {
+    if (!m_demod.correlateSync(DMR_MS_VOICE_SYNC_SYMBOLS_VALUES, DMR_MS_VOICE_SYNC_BYTES, DMR_SYNC_BYTES_MASK, 4U, MAX_SYNC_BYTES_ERRS))
+      return;
 
-    if (corr > m_maxCorr) {
-      q15_t centre = (max + min) >> 1;
-
-      q31_t v1 = (max - centre) * SCALING_FACTOR;
-      q15_t threshold = q15_t(v1 >> 15);
-
-      uint8_t sync[DMR_SYNC_BYTES_LENGTH];
-      uint16_t ptr = m_dataPtr + DMO_BUFFER_LENGTH_SAMPLES - DMR_SYNC_LENGTH_SAMPLES + DMR_RADIO_SYMBOL_LENGTH;
-      if (ptr >= DMO_BUFFER_LENGTH_SAMPLES)
-        ptr -= DMO_BUFFER_LENGTH_SAMPLES;
-
-      samplesToBits(ptr, DMR_SYNC_LENGTH_SYMBOLS, sync, 4U, centre, threshold);
-
-      if (data) {
-        uint8_t errs = 0U;
-        for (uint8_t i = 0U; i < DMR_SYNC_BYTES_LENGTH; i++)
-          errs += countBits8((sync[i] & DMR_SYNC_BYTES_MASK[i]) ^ DMR_MS_DATA_SYNC_BYTES[i]);
- 
-        if (errs <= MAX_SYNC_BYTES_ERRS) {
-          if (first) {
-            m_threshold[0U] = m_threshold[1U] = m_threshold[2U] = m_threshold[3U] = threshold;
-            m_centre[0U]    = m_centre[1U]    = m_centre[2U]    = m_centre[3U]    = centre;
-            m_averagePtr    = 0U;
-          } else {
-            m_threshold[m_averagePtr] = threshold;
-            m_centre[m_averagePtr]    = centre;
-
-            m_averagePtr++;
-            if (m_averagePtr >= 4U)
-              m_averagePtr = 0U;
-          }
-
-          m_maxCorr  = corr;
-          m_control  = CONTROL_DATA;
-          m_syncPtr  = m_dataPtr;
-
-          m_startPtr = m_dataPtr + DMO_BUFFER_LENGTH_SAMPLES - DMR_SLOT_TYPE_LENGTH_SAMPLES / 2U - DMR_INFO_LENGTH_SAMPLES / 2U - DMR_SYNC_LENGTH_SAMPLES;
-          if (m_startPtr >= DMO_BUFFER_LENGTH_SAMPLES)
-            m_startPtr -= DMO_BUFFER_LENGTH_SAMPLES;
-
-          m_endPtr = m_dataPtr + DMR_SLOT_TYPE_LENGTH_SAMPLES / 2U + DMR_INFO_LENGTH_SAMPLES / 2U - 1U;
-          if (m_endPtr >= DMO_BUFFER_LENGTH_SAMPLES)
-            m_endPtr -= DMO_BUFFER_LENGTH_SAMPLES;
-        }
-      } else {  // if (voice1 || voice2)
-        uint8_t errs = 0U;
-        for (uint8_t i = 0U; i < DMR_SYNC_BYTES_LENGTH; i++)
-          errs += countBits8((sync[i] & DMR_SYNC_BYTES_MASK[i]) ^ DMR_MS_VOICE_SYNC_BYTES[i]);
-
-        if (errs <= MAX_SYNC_BYTES_ERRS) {
-          if (first) {
-            m_threshold[0U] = m_threshold[1U] = m_threshold[2U] = m_threshold[3U] = threshold;
-            m_centre[0U]    = m_centre[1U]    = m_centre[2U]    = m_centre[3U]    = centre;
-            m_averagePtr    = 0U;
-          } else {
-            m_threshold[m_averagePtr] = threshold;
-            m_centre[m_averagePtr]    = centre;
-
-            m_averagePtr++;
-            if (m_averagePtr >= 4U)
-              m_averagePtr = 0U;
-          }
-
-          m_maxCorr  = corr;
-          m_control  = CONTROL_VOICE;
-          m_syncPtr  = m_dataPtr;
-
-          m_startPtr = m_dataPtr + DMO_BUFFER_LENGTH_SAMPLES - DMR_SLOT_TYPE_LENGTH_SAMPLES / 2U - DMR_INFO_LENGTH_SAMPLES / 2U - DMR_SYNC_LENGTH_SAMPLES;
-          if (m_startPtr >= DMO_BUFFER_LENGTH_SAMPLES)
-            m_startPtr -= DMO_BUFFER_LENGTH_SAMPLES;
-
-          m_endPtr   = m_dataPtr + DMR_SLOT_TYPE_LENGTH_SAMPLES / 2U + DMR_INFO_LENGTH_SAMPLES / 2U - 1U;
-          if (m_endPtr >= DMO_BUFFER_LENGTH_SAMPLES)
-            m_endPtr -= DMO_BUFFER_LENGTH_SAMPLES;
-        }
-      }
-    }
+    m_control = CONTROL_VOICE;
+  } else {
+    return;
   }
+
+  if (first)
+    m_demod.restart();
+
+  m_demod.addSyncLevels();
+
+  m_syncPtr = m_dataPtr;
+
+  m_endPtr = m_dataPtr + DMR_FRAME_LENGTH_SAMPLES - DMR_SYNC_END_SAMPLES;
+  if (m_endPtr >= DMO_BUFFER_LENGTH_SAMPLES)
+    m_endPtr -= DMO_BUFFER_LENGTH_SAMPLES;
+
+  storeSymbols(0U);
+  m_demod.resync();
 }
 
-void CDMRDMORX::samplesToBits(uint16_t start, uint8_t count, uint8_t* buffer, uint16_t offset, q15_t centre, q15_t threshold)
+// Copy the symbols from the start of the burst to the end of a sync that was found back samples ago
+void CDMRDMORX::storeSymbols(uint16_t back)
 {
-  for (uint8_t i = 0U; i < count; i++) {
-    q15_t sample = m_buffer[start] - centre;
-
-    if (sample < -threshold) {
-      WRITE_BIT1(buffer, offset, false);
-      offset++;
-      WRITE_BIT1(buffer, offset, true);
-      offset++;
-    } else if (sample < 0) {
-      WRITE_BIT1(buffer, offset, false);
-      offset++;
-      WRITE_BIT1(buffer, offset, false);
-      offset++;
-    } else if (sample < threshold) {
-      WRITE_BIT1(buffer, offset, true);
-      offset++;
-      WRITE_BIT1(buffer, offset, false);
-      offset++;
-    } else {
-      WRITE_BIT1(buffer, offset, true);
-      offset++;
-      WRITE_BIT1(buffer, offset, true);
-      offset++;
-    }
+  const q15_t* history = m_demod.buffer();
+
+  uint16_t ptr = m_demod.ptr() + DMR_RADIO_SYMBOL_LENGTH - back;
+  if (ptr >= DMR_SYNC_END_SAMPLES)
+    ptr -= DMR_SYNC_END_SAMPLES;
 
-    start += DMR_RADIO_SYMBOL_LENGTH;
-    if (start >= DMO_BUFFER_LENGTH_SAMPLES)
-      start -= DMO_BUFFER_LENGTH_SAMPLES;
+  for (uint8_t i = 0U; i < DMR_SYNC_END_SYMBOLS; i++) {
+    m_symbols[i] = history[ptr];
+
+    ptr += DMR_RADIO_SYMBOL_LENGTH;
+    if (ptr >= DMR_SYNC_END_SAMPLES)
+      ptr -= DMR_SYNC_END_SAMPLES;
   }
+
+  // The RSSI average leaves out the first 2.5 ms of the burst
+  m_rssiStart = rssiAccum(back + DMR_SYNC_END_SAMPLES - DMR_SYNC_LENGTH_SAMPLES / 2U);
+}
+
+// The RSSI total from before the sample back samples ago, to the nearest symbol
+uint32_t CDMRDMORX::rssiAccum(uint16_t back) const
+{
+  uint16_t ptr = m_demod.ptr() + DMR_SYNC_END_SAMPLES - back + DMR_RADIO_SYMBOL_LENGTH / 2U;
+  if (ptr >= DMR_SYNC_END_SAMPLES)
+    ptr -= DMR_SYNC_END_SAMPLES;
+
+  return m_rssiHistory[ptr / DMR_RADIO_SYMBOL_LENGTH];
 }
 
 void CDMRDMORX::setColorCode(uint8_t colorCode)
@@ -406,26 +318,37 @@ void CDMRDMORX::writeRSSIData(uint8_t* frame)
 {
 #if defined(SEND_RSSI_DATA)
   // Calculate RSSI average over a burst period. We don't take into account 2.5 ms at the beginning and 2.5 ms at the end
-  uint16_t start = m_startPtr + DMR_SYNC_LENGTH_SAMPLES / 2U;
-
-  uint32_t accum = 0U;
-  for (uint16_t i = 0U; i < (DMR_FRAME_LENGTH_SAMPLES - DMR_SYNC_LENGTH_SAMPLES); i++) {
-    accum += m_rssi[start];
-	
-	start++;
-    if (start >= DMO_BUFFER_LENGTH_SAMPLES)
-      start -= DMO_BUFFER_LENGTH_SAMPLES;
-  }
+  uint32_t accum = rssiAccum(DMR_SYNC_LENGTH_SAMPLES / 2U) - m_rssiStart;
 
   uint16_t avg = accum / (DMR_FRAME_LENGTH_SAMPLES - DMR_SYNC_LENGTH_SAMPLES);
   frame[34U] = (avg >> 8) & 0xFFU;
   frame[35U] = (avg >> 0) & 0xFFU;
 
-  serial.writeDMRData(true, frame, DMR_FRAME_LENGTH_BYTES + 3U);
+  writeData(frame, DMR_FRAME_LENGTH_BYTES + 3U);
 #else
-  serial.writeDMRData(true, frame, DMR_FRAME_LENGTH_BYTES + 1U);
+  writeData(frame, DMR_FRAME_LENGTH_BYTES + 1U);
 #endif
 }
 
+// Send the hard bits, or the soft symbols with the same control byte and RSSI if the host wants them
+void CDMRDMORX::writeData(const uint8_t* frame, uint8_t length)
+{
+  if (!serial.getSoftSymbols()) {
+    serial.writeDMRData(true, frame, length);
+    return;
+  }
+
+  uint8_t data[DMR_FRAME_LENGTH_SYMBOLS / 2U + 3U];
+  data[0U] = frame[0U];
+
+  m_demod.samplesToSoft(m_symbols, DMR_FRAME_LENGTH_SYMBOLS, data + 1U);
+
+  uint8_t count = DMR_FRAME_LENGTH_SYMBOLS / 2U + 1U;
+  for (uint8_t i = DMR_FRAME_LENGTH_BYTES + 1U; i < length; i++, count++)
+    data[count] = frame[i];
+
+  serial.writeDMRSoft(true, data, count);
+}
+
 #endif
 
@@ -24,9 +24,13 @@
 #define  DMRDMORX_H
 
 #include "DMRDefines.h"
+#include "FSKDemod.h"
 
 const uint16_t DMO_BUFFER_LENGTH_SAMPLES = 1440U;   // 60ms at 24 kHz
 
+// The levels of each sync with its threshold at Q15(0.60) of its peak, each moving them by a quarter
+typedef CFSKDemod<uint32_t, DMR_SYNC_END_SAMPLES, DMR_RADIO_SYMBOL_LENGTH, DMR_SYNC_LENGTH_SYMBOLS, 19505, 2U, true> CDMODemod;
+
 enum DMORX_STATE {
   DMORXS_NONE,
   DMORXS_VOICE,
@@ -44,29 +48,27 @@ public:
   void reset();
 
 private:
-  uint32_t    m_bitBuffer[DMR_RADIO_SYMBOL_LENGTH];
-  q15_t       m_buffer[DMO_BUFFER_LENGTH_SAMPLES];
-  uint16_t    m_bitPtr;
+  CDMODemod   m_demod;
+  uint32_t    m_rssiHistory[DMR_SYNC_END_SYMBOLS];
+  q15_t       m_symbols[DMR_FRAME_LENGTH_SYMBOLS];
+  uint32_t    m_rssiAccum;
+  uint32_t    m_rssiStart;
   uint16_t    m_dataPtr;
   uint16_t    m_syncPtr;
-  uint16_t    m_startPtr;
   uint16_t    m_endPtr;
-  q31_t       m_maxCorr;
-  q15_t       m_centre[4U];
-  q15_t       m_threshold[4U];
-  uint8_t     m_averagePtr;
   uint8_t     m_control;
   uint8_t     m_syncCount;
   uint8_t     m_colorCode;
   DMORX_STATE m_state;
   uint8_t     m_n;
   uint8_t     m_type;
-  uint16_t    m_rssi[DMO_BUFFER_LENGTH_SAMPLES];
   
   bool processSample(q15_t sample, uint16_t rssi);
   void correlateSync(bool first);
-  void samplesToBits(uint16_t start, uint8_t count, uint8_t* buffer, uint16_t offset, q15_t centre, q15_t threshold);
+  void storeSymbols(uint16_t back);
+  uint32_t rssiAccum(uint16_t back) const;
   void writeRSSIData(uint8_t* frame);
+  void writeData(const uint8_t* frame, uint8_t length);
 };
 
 #endif
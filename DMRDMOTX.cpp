@@ -29,12 +29,10 @@
 static q15_t RRC_0_2_FILTER[] = {0, 0, 0, 0, 850, 219, -720, -1548, -1795, -1172, 237, 1927, 3120, 3073, 1447, -1431, -4544, -6442,
                                  -5735, -1633, 5651, 14822, 23810, 30367, 32767, 30367, 23810, 14822, 5651, -1633, -5735, -6442,
                                  -4544, -1431, 1447, 3073, 3120, 1927, 237, -1172, -1795, -1548, -720, 219, 850}; // numTaps = 45, L = 5
-const uint16_t RRC_0_2_FILTER_PHASE_LEN = 9U; // phaseLength = numTaps/L
+const uint16_t RRC_0_2_FILTER_LEN = 45U;
 
 const q15_t DMR_LEVELA =  1362;
 const q15_t DMR_LEVELB =  454;
-const q15_t DMR_LEVELC = -454;
-const q15_t DMR_LEVELD = -1362;
 
 const uint8_t BIT_MASK_TABLE[] = {0x80U, 0x40U, 0x20U, 0x10U, 0x08U, 0x04U, 0x02U, 0x01U};
 
@@ -52,19 +50,14 @@ const uint8_t DMR_SYNC = 0x5FU;
 
 CDMRDMOTX::CDMRDMOTX() :
 m_fifo(),
-m_modFilter(),
-m_modState(),
+m_mod(),
 m_poBuffer(),
 m_poLen(0U),
 m_poPtr(0U),
 m_txDelay(240U)       // 200ms
 {
-  ::memset(m_modState, 0x00U, 16U * sizeof(q15_t));
-
-  m_modFilter.L           = DMR_RADIO_SYMBOL_LENGTH;
-  m_modFilter.phaseLength = RRC_0_2_FILTER_PHASE_LEN;
-  m_modFilter.pCoeffs     = RRC_0_2_FILTER;
-  m_modFilter.pState      = m_modState;
+  m_mod.setFilter(RRC_0_2_FILTER, RRC_0_2_FILTER_LEN);
+  m_mod.setLevels(DMR_LEVELA, DMR_LEVELB);
 }
 
 void CDMRDMOTX::process()
@@ -76,8 +69,7 @@ void CDMRDMOTX::process()
 
       m_poLen = m_txDelay;
     } else {
-      for (unsigned int i = 0U; i < DMR_FRAME_LENGTH_BYTES; i++)
-        m_fifo.get(m_poBuffer[i]);
+      m_fifo.read(m_poBuffer, DMR_FRAME_LENGTH_BYTES);
 
       for (unsigned int i = 0U; i < 39U; i++)
         m_poBuffer[i + DMR_FRAME_LENGTH_BYTES] = PR_FILL[i];
@@ -112,43 +104,19 @@ uint8_t CDMRDMOTX::writeData(const uint8_t* data, uint16_t length)
   if (length != (DMR_FRAME_LENGTH_BYTES + 1U))
     return 4U;
 
-  uint16_t space = m_fifo.getSpace();
-  if (space < DMR_FRAME_LENGTH_BYTES)
+  if (!m_fifo.hasSpace(DMR_FRAME_LENGTH_BYTES))
     return 5U;
 
-  for (uint8_t i = 0U; i < DMR_FRAME_LENGTH_BYTES; i++)
-    m_fifo.put(data[i + 1U]);
+  m_fifo.write(data + 1U, DMR_FRAME_LENGTH_BYTES);
 
   return 0U;
 }
 
 void CDMRDMOTX::writeByte(uint8_t c)
 {
-  q15_t inBuffer[4U];
-  q15_t outBuffer[DMR_RADIO_SYMBOL_LENGTH * 4U];
-
-  const uint8_t MASK = 0xC0U;
-
-  for (uint8_t i = 0U; i < 4U; i++, c <<= 2) {
-    switch (c & MASK) {
-      case 0xC0U:
-        inBuffer[i] = DMR_LEVELA;
-        break;
-      case 0x80U:
-        inBuffer[i] = DMR_LEVELB;
-        break;
-      case 0x00U:
-        inBuffer[i] = DMR_LEVELC;
-        break;
-      default:
-        inBuffer[i] = DMR_LEVELD;
-        break;
-    }
-  }
-
-  ::arm_fir_interpolate_q15(&m_modFilter, inBuffer, outBuffer, 4U);
+  m_mod.addByte(c);
 
-  io.write(STATE_DMR, outBuffer, DMR_RADIO_SYMBOL_LENGTH * 4U);
+  io.write(STATE_DMR, m_mod);
 }
 
 uint8_t CDMRDMOTX::getSpace() const
@@ -156,6 +124,11 @@ uint8_t CDMRDMOTX::getSpace() const
   return m_fifo.getSpace() / (DMR_FRAME_LENGTH_BYTES + 2U);
 }
 
+void CDMRDMOTX::getBufferStats(TRingStats& stats)
+{
+  m_fifo.getStats(stats);
+}
+
 void CDMRDMOTX::setTXDelay(uint8_t delay)
 {
   m_txDelay = 600U + uint16_t(delay) * 12U;        // 500ms + tx delay
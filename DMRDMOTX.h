@@ -26,8 +26,12 @@
 
 #include "DMRDefines.h"
 
+#include "FSKMod.h"
 #include "RingBuffer.h"
 
+// The RRC filter spans 9 symbols
+typedef CFSKMod<DMR_RADIO_SYMBOL_LENGTH, 9U> CDMOMod;
+
 class CDMRDMOTX {
 public:
   CDMRDMOTX();
@@ -40,10 +44,11 @@ public:
 
   uint8_t getSpace() const;
 
+  void getBufferStats(TRingStats& stats);
+
 private:
   CRingBuffer<uint8_t>                        m_fifo;
-  arm_fir_interpolate_instance_q15 m_modFilter;
-  q15_t                            m_modState[16U];    // blockSize + phaseLength - 1, 4 + 9 - 1 plus some spare
+  CDMOMod                          m_mod;
   uint8_t                          m_poBuffer[1200U];
   uint16_t                         m_poLen;
   uint16_t                         m_poPtr;
@@ -56,6 +56,10 @@ const unsigned int DMR_CACH_LENGTH_BITS    = DMR_CACH_LENGTH_BYTES * 8U;
 const unsigned int DMR_CACH_LENGTH_SYMBOLS = DMR_CACH_LENGTH_BYTES * 4U;
 const unsigned int DMR_CACH_LENGTH_SAMPLES = DMR_CACH_LENGTH_SYMBOLS * DMR_RADIO_SYMBOL_LENGTH;
 
+// From the start of a burst to the end of its sync
+const unsigned int DMR_SYNC_END_SYMBOLS = DMR_INFO_LENGTH_SYMBOLS / 2U + DMR_SLOT_TYPE_LENGTH_SYMBOLS / 2U + DMR_SYNC_LENGTH_SYMBOLS;
+const unsigned int DMR_SYNC_END_SAMPLES = DMR_SYNC_END_SYMBOLS * DMR_RADIO_SYMBOL_LENGTH;
+
 const uint8_t  DMR_SYNC_BYTES_LENGTH     = 7U;
 const uint8_t  DMR_MS_DATA_SYNC_BYTES[]  = {0x0DU, 0x5DU, 0x7FU, 0x77U, 0xFDU, 0x75U, 0x70U};
 const uint8_t  DMR_MS_VOICE_SYNC_BYTES[] = {0x07U, 0xF7U, 0xD5U, 0xDDU, 0x57U, 0xDFU, 0xD0U};
@@ -40,9 +40,8 @@ const uint8_t CONTROL_IDLE = 0x80U;
 const uint8_t CONTROL_DATA = 0x40U;
 
 CDMRIdleRX::CDMRIdleRX() :
-m_bitBuffer(),
+m_syncSearch(),
 m_buffer(),
-m_bitPtr(0U),
 m_dataPtr(0U),
 m_endPtr(NOENDPTR),
 m_maxCorr(0),
@@ -55,7 +54,7 @@ m_colorCode(0U)
 void CDMRIdleRX::reset()
 {
   m_dataPtr   = 0U;
-  m_bitPtr    = 0U;
+  m_syncSearch.reset();
   m_maxCorr   = 0;
   m_threshold = 0;
   m_centre    = 0;
@@ -70,13 +69,11 @@ void CDMRIdleRX::samples(const q15_t* samples, uint8_t length)
 
 void CDMRIdleRX::processSample(q15_t sample)
 {
-  m_bitBuffer[m_bitPtr] <<= 1;
-  if (sample < 0)
-    m_bitBuffer[m_bitPtr] |= 0x01U;
+  m_syncSearch.add(sample);
 
   m_buffer[m_dataPtr] = sample;
 
-  if (countBits32((m_bitBuffer[m_bitPtr] & DMR_SYNC_SYMBOLS_MASK) ^ DMR_MS_DATA_SYNC_SYMBOLS) <= MAX_SYNC_SYMBOLS_ERRS) {
+  if (m_syncSearch.errors(DMR_MS_DATA_SYNC_SYMBOLS, DMR_SYNC_SYMBOLS_MASK) <= MAX_SYNC_SYMBOLS_ERRS) {
     uint16_t ptr = m_dataPtr + DMR_FRAME_LENGTH_SAMPLES - DMR_SYNC_LENGTH_SAMPLES + DMR_RADIO_SYMBOL_LENGTH;
     if (ptr >= DMR_FRAME_LENGTH_SAMPLES)
       ptr -= DMR_FRAME_LENGTH_SAMPLES;
@@ -159,7 +156,15 @@ void CDMRIdleRX::processSample(q15_t sample)
 
     if (colorCode == m_colorCode && dataType == DT_CSBK) {
       frame[0U] = CONTROL_IDLE | CONTROL_DATA | DT_CSBK;
-      serial.writeDMRData(false, frame, DMR_FRAME_LENGTH_BYTES + 1U);
+
+      if (serial.getSoftSymbols()) {
+        uint8_t data[DMR_FRAME_LENGTH_SYMBOLS / 2U + 1U];
+        data[0U] = frame[0U];
+        samplesToSoft(ptr, DMR_FRAME_LENGTH_SYMBOLS, data + 1U, m_centre, m_threshold);
+        serial.writeDMRSoft(false, data, DMR_FRAME_LENGTH_SYMBOLS / 2U + 1U);
+      } else {
+        serial.writeDMRData(false, frame, DMR_FRAME_LENGTH_BYTES + 1U);
+      }
     }
 
     m_endPtr  = NOENDPTR;
@@ -169,10 +174,6 @@ void CDMRIdleRX::processSample(q15_t sample)
   m_dataPtr++;
   if (m_dataPtr >= DMR_FRAME_LENGTH_SAMPLES)
     m_dataPtr = 0U;
-
-  m_bitPtr++;
-  if (m_bitPtr >= DMR_RADIO_SYMBOL_LENGTH)
-    m_bitPtr = 0U;
 }
 
 void CDMRIdleRX::samplesToBits(uint16_t start, uint8_t count, uint8_t* buffer, uint16_t offset, q15_t centre, q15_t threshold)
@@ -208,6 +209,24 @@ void CDMRIdleRX::samplesToBits(uint16_t start, uint8_t count, uint8_t* buffer, u
   }
 }
 
+// Two symbols to each byte, the first in the high nibble
+void CDMRIdleRX::samplesToSoft(uint16_t start, uint8_t count, uint8_t* buffer, q15_t centre, q15_t threshold)
+{
+  for (uint8_t i = 0U; i < count; i++) {
+    q15_t sample = m_buffer[start] - centre;
+
+    uint8_t soft = softSymbol(sample, threshold);
+    if ((i & 1U) == 0U)
+      buffer[i / 2U] = soft << 4;
+    else
+      buffer[i / 2U] |= soft;
+
+    start += DMR_RADIO_SYMBOL_LENGTH;
+    if (start >= DMR_FRAME_LENGTH_SAMPLES)
+      start -= DMR_FRAME_LENGTH_SAMPLES;
+  }
+}
+
 void CDMRIdleRX::setColorCode(uint8_t colorCode)
 {
   m_colorCode = colorCode;
@@ -24,6 +24,7 @@
 #define  DMRIDLERX_H
 
 #include "DMRDefines.h"
+#include "SyncSearch.h"
 
 class CDMRIdleRX {
 public:
@@ -36,9 +37,8 @@ public:
   void reset();
 
 private:
-  uint32_t m_bitBuffer[DMR_RADIO_SYMBOL_LENGTH];
+  CSyncSearch<uint32_t, DMR_RADIO_SYMBOL_LENGTH> m_syncSearch;
   q15_t    m_buffer[DMR_FRAME_LENGTH_SAMPLES];
-  uint16_t m_bitPtr;
   uint16_t m_dataPtr;
   uint16_t m_endPtr;
   q31_t    m_maxCorr;
@@ -48,6 +48,7 @@ private:
 
   void processSample(q15_t sample);
   void samplesToBits(uint16_t start, uint8_t count, uint8_t* buffer, uint16_t offset, q15_t centre, q15_t threshold);
+  void samplesToSoft(uint16_t start, uint8_t count, uint8_t* buffer, q15_t centre, q15_t threshold);
 };
 
 #endif
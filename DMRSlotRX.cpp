@@ -45,19 +45,33 @@ const uint8_t CONTROL_NONE  = 0x00U;
 const uint8_t CONTROL_VOICE = 0x20U;
 const uint8_t CONTROL_DATA  = 0x40U;
 
+// Only the end of a burst's sync fixes the sampling phase, so the receiver keeps the last
+// DMR_SYNC_END_SAMPLES at the full rate for the sync correlation. When a sync is found, or when
+// the window for tracking it closes, the symbols of the burst so far are copied out at the chosen
+// phase. The rest are taken from the same samples at the end of the burst by the symbol timing,
+// which also moves the expected sync of the next burst with the transmitter's clock. The RSSI is
+// kept as a running total, sampled once per symbol, so that the average over a burst is the
+// difference of two of them.
+
 CDMRSlotRX::CDMRSlotRX(bool slot) :
 m_slot(slot),
-m_bitBuffer(),
-m_buffer(),
-m_bitPtr(0U),
+m_syncSearch(),
+m_history(),
+m_rssiHistory(),
+m_historyPtr(0U),
+m_symbols(),
+m_timing(),
+m_rssiAccum(0U),
+m_rssiStart(0U),
 m_dataPtr(0U),
 m_syncPtr(0U),
-m_startPtr(0U),
 m_endPtr(NOENDPTR),
 m_delayPtr(0U),
 m_maxCorr(0),
 m_centre(),
 m_threshold(),
+m_centreVal(0),
+m_thresholdVal(0),
 m_averagePtr(0U),
 m_control(CONTROL_NONE),
 m_syncCount(0U),
@@ -65,8 +79,7 @@ m_colorCode(0U),
 m_delay(0U),
 m_state(DMRRXS_NONE),
 m_n(0U),
-m_type(0U),
-m_rssi()
+m_type(0U)
 {
 }
 
@@ -74,7 +87,7 @@ void CDMRSlotRX::start()
 {
   m_dataPtr  = 0U;
   m_delayPtr = 0U;
-  m_bitPtr   = 0U;
+  m_syncSearch.reset();
   m_maxCorr  = 0;
   m_control  = CONTROL_NONE;
 }
@@ -84,13 +97,14 @@ void CDMRSlotRX::reset()
   m_syncPtr   = 0U;
   m_dataPtr   = 0U;
   m_delayPtr  = 0U;
-  m_bitPtr    = 0U;
+  m_syncSearch.reset();
   m_maxCorr   = 0;
   m_control   = CONTROL_NONE;
   m_syncCount = 0U;
   m_state     = DMRRXS_NONE;
-  m_startPtr  = 0U;
   m_endPtr    = NOENDPTR;
+
+  m_timing.reset();
 }
 
 bool CDMRSlotRX::processSample(q15_t sample, uint16_t rssi)
@@ -99,16 +113,21 @@ bool CDMRSlotRX::processSample(q15_t sample, uint16_t rssi)
   if (m_delayPtr < m_delay)
     return m_state != DMRRXS_NONE;
 
-  // Ensure that the buffer doesn't overflow
+  // Nothing after the end of the burst is needed
   if (m_dataPtr > m_endPtr || m_dataPtr >= 900U)
     return m_state != DMRRXS_NONE;
 
-  m_buffer[m_dataPtr] = sample;
-  m_rssi[m_dataPtr] = rssi;
-  
-  m_bitBuffer[m_bitPtr] <<= 1;
-  if (sample < 0)
-    m_bitBuffer[m_bitPtr] |= 0x01U;
+  m_historyPtr++;
+  if (m_historyPtr >= DMR_SYNC_END_SAMPLES)
+    m_historyPtr = 0U;
+
+  if ((m_historyPtr % DMR_RADIO_SYMBOL_LENGTH) == 0U)
+    m_rssiHistory[m_historyPtr / DMR_RADIO_SYMBOL_LENGTH] = m_rssiAccum;
+
+  m_history[m_historyPtr] = sample;
+  m_rssiAccum += rssi;
+
+  m_syncSearch.add(sample);
 
   if (m_state == DMRRXS_NONE) {
     if (m_dataPtr >= SCAN_START && m_dataPtr <= SCAN_END)
@@ -119,18 +138,33 @@ bool CDMRSlotRX::processSample(q15_t sample, uint16_t rssi)
     uint16_t max = m_syncPtr + 1U;
     if (m_dataPtr >= min && m_dataPtr <= max)
       correlateSync(false);
+
+    // No sync this time, so use the position of the last one
+    if (m_dataPtr == max && m_control == CONTROL_NONE) {
+      storeSymbols(1U);
+      m_endPtr = m_syncPtr + DMR_FRAME_LENGTH_SAMPLES - DMR_SYNC_END_SAMPLES;
+    }
   }
 
   if (m_dataPtr == m_endPtr) {
     // Find the average centre and threshold values
-    q15_t centre    = (m_centre[0U]    + m_centre[1U]    + m_centre[2U]    + m_centre[3U])    >> 2;
-    q15_t threshold = (m_threshold[0U] + m_threshold[1U] + m_threshold[2U] + m_threshold[3U]) >> 2;
+    m_centreVal    = (m_centre[0U]    + m_centre[1U]    + m_centre[2U]    + m_centre[3U])    >> 2;
+    m_thresholdVal = (m_threshold[0U] + m_threshold[1U] + m_threshold[2U] + m_threshold[3U]) >> 2;
+
+    // The symbols after the sync, from its last one, are the newest in the history
+    uint16_t ptr = m_historyPtr + DMR_SYNC_END_SAMPLES - (DMR_FRAME_LENGTH_SAMPLES - DMR_SYNC_END_SAMPLES);
+    if (ptr >= DMR_SYNC_END_SAMPLES)
+      ptr -= DMR_SYNC_END_SAMPLES;
+
+    m_timing.extract(m_history, ptr, DMR_FRAME_LENGTH_SAMPLES - DMR_SYNC_END_SAMPLES + 1U, m_symbols + DMR_SYNC_END_SYMBOLS - 1U, DMR_FRAME_LENGTH_SYMBOLS - DMR_SYNC_END_SYMBOLS + 1U, m_centreVal, m_thresholdVal);
+
+    // The next burst's sync is expected where the transmitter's clock has taken this one
+    m_syncPtr += m_timing.slip();
 
     uint8_t frame[DMR_FRAME_LENGTH_BYTES + 3U];
     frame[0U] = m_control;
 
-    uint16_t ptr = m_endPtr - DMR_FRAME_LENGTH_SAMPLES + DMR_RADIO_SYMBOL_LENGTH + 1U;
-    samplesToBits(ptr, DMR_FRAME_LENGTH_SYMBOLS, frame, 8U, centre, threshold);
+    samplesToBits(m_symbols, DMR_FRAME_LENGTH_SYMBOLS, frame, 8U, m_centreVal, m_thresholdVal);
 
     if (m_control == CONTROL_DATA) {
       // Data sync
@@ -147,7 +181,7 @@ bool CDMRSlotRX::processSample(q15_t sample, uint16_t rssi)
 
         switch (dataType) {
           case DT_DATA_HEADER:
-            DEBUG5("DMRSlotRX: data header found slot/pos/centre/threshold", m_slot ? 2U : 1U, m_syncPtr, centre, threshold);
+            DEBUG5("DMRSlotRX: data header found slot/pos/centre/threshold", m_slot ? 2U : 1U, m_syncPtr, m_centreVal, m_thresholdVal);
             writeRSSIData(frame);
             m_state = DMRRXS_DATA;
             m_type  = 0x00U;
@@ -156,33 +190,33 @@ bool CDMRSlotRX::processSample(q15_t sample, uint16_t rssi)
           case DT_RATE_34_DATA:
           case DT_RATE_1_DATA:
             if (m_state == DMRRXS_DATA) {
-              DEBUG5("DMRSlotRX: data payload found slot/pos/centre/threshold", m_slot ? 2U : 1U, m_syncPtr, centre, threshold);
+              DEBUG5("DMRSlotRX: data payload found slot/pos/centre/threshold", m_slot ? 2U : 1U, m_syncPtr, m_centreVal, m_thresholdVal);
               writeRSSIData(frame);
               m_type = dataType;
             }
             break;
           case DT_VOICE_LC_HEADER:
-            DEBUG5("DMRSlotRX: voice header found slot/pos/centre/threshold", m_slot ? 2U : 1U, m_syncPtr, centre, threshold);
+            DEBUG5("DMRSlotRX: voice header found slot/pos/centre/threshold", m_slot ? 2U : 1U, m_syncPtr, m_centreVal, m_thresholdVal);
             writeRSSIData(frame);
             m_state = DMRRXS_VOICE;
             break;
           case DT_VOICE_PI_HEADER:
             if (m_state == DMRRXS_VOICE) {
-              DEBUG5("DMRSlotRX: voice pi header found slot/pos/centre/threshold", m_slot ? 2U : 1U, m_syncPtr, centre, threshold);
+              DEBUG5("DMRSlotRX: voice pi header found slot/pos/centre/threshold", m_slot ? 2U : 1U, m_syncPtr, m_centreVal, m_thresholdVal);
               writeRSSIData(frame);
             }
             m_state = DMRRXS_VOICE;
             break;
           case DT_TERMINATOR_WITH_LC:
             if (m_state == DMRRXS_VOICE) {
-              DEBUG5("DMRSlotRX: voice terminator found slot/pos/centre/threshold", m_slot ? 2U : 1U, m_syncPtr, centre, threshold);
+              DEBUG5("DMRSlotRX: voice terminator found slot/pos/centre/threshold", m_slot ? 2U : 1U, m_syncPtr, m_centreVal, m_thresholdVal);
               writeRSSIData(frame);
               m_state  = DMRRXS_NONE;
               m_endPtr = NOENDPTR;
             }
             break;
           default:    // DT_CSBK
-            DEBUG5("DMRSlotRX: csbk found slot/pos/centre/threshold", m_slot ? 2U : 1U, m_syncPtr, centre, threshold);
+            DEBUG5("DMRSlotRX: csbk found slot/pos/centre/threshold", m_slot ? 2U : 1U, m_syncPtr, m_centreVal, m_thresholdVal);
             writeRSSIData(frame);
             m_state  = DMRRXS_NONE;
             m_endPtr = NOENDPTR;
@@ -191,7 +225,7 @@ bool CDMRSlotRX::processSample(q15_t sample, uint16_t rssi)
       }
     } else if (m_control == CONTROL_VOICE) {
       // Voice sync
-      DEBUG5("DMRSlotRX: voice sync found slot/pos/centre/threshold", m_slot ? 2U : 1U, m_syncPtr, centre, threshold);
+      DEBUG5("DMRSlotRX: voice sync found slot/pos/centre/threshold", m_slot ? 2U : 1U, m_syncPtr, m_centreVal, m_thresholdVal);
       writeRSSIData(frame);
       m_state     = DMRRXS_VOICE;
       m_syncCount = 0U;
@@ -214,7 +248,7 @@ bool CDMRSlotRX::processSample(q15_t sample, uint16_t rssi)
           frame[0U] = ++m_n;
         }
 
-        serial.writeDMRData(m_slot, frame, DMR_FRAME_LENGTH_BYTES + 1U);
+        writeData(frame, DMR_FRAME_LENGTH_BYTES + 1U);
       } else if (m_state == DMRRXS_DATA) {
         if (m_type != 0x00U) {
           frame[0U] = CONTROL_DATA | m_type;
@@ -226,30 +260,31 @@ bool CDMRSlotRX::processSample(q15_t sample, uint16_t rssi)
 
   m_dataPtr++;
 
-  m_bitPtr++;
-  if (m_bitPtr >= DMR_RADIO_SYMBOL_LENGTH)
-    m_bitPtr = 0U;
-
   return m_state != DMRRXS_NONE;
 }
 
 void CDMRSlotRX::correlateSync(bool first)
 {
-  uint8_t errs = countBits32((m_bitBuffer[m_bitPtr] & DMR_SYNC_SYMBOLS_MASK) ^ DMR_MS_DATA_SYNC_SYMBOLS);
+  uint8_t errs = m_syncSearch.errors(DMR_MS_DATA_SYNC_SYMBOLS, DMR_SYNC_SYMBOLS_MASK);
 
   // The voice sync is the complement of the data sync
   bool data  = (errs <= MAX_SYNC_SYMBOLS_ERRS);
   bool voice = (errs >= (DMR_SYNC_LENGTH_SYMBOLS - MAX_SYNC_SYMBOLS_ERRS));
 
   if (data || voice) {
-    uint16_t ptr = m_dataPtr - DMR_SYNC_LENGTH_SAMPLES + DMR_RADIO_SYMBOL_LENGTH;
+    uint16_t ptr = m_historyPtr + DMR_SYNC_END_SAMPLES - DMR_SYNC_LENGTH_SAMPLES + DMR_RADIO_SYMBOL_LENGTH;
+    if (ptr >= DMR_SYNC_END_SAMPLES)
+      ptr -= DMR_SYNC_END_SAMPLES;
 
     q31_t corr = 0;
     q15_t min =  16000;
     q15_t max = -16000;
 
+    q15_t symbols[DMR_SYNC_LENGTH_SYMBOLS];
+
     for (uint8_t i = 0U; i < DMR_SYNC_LENGTH_SYMBOLS; i++) {
-      q15_t val = m_buffer[ptr];
+      q15_t val = m_history[ptr];
+      symbols[i] = val;
 
       if (val > max)
         max = val;
@@ -278,6 +313,8 @@ void CDMRSlotRX::correlateSync(bool first)
       }
 
       ptr += DMR_RADIO_SYMBOL_LENGTH;
+      if (ptr >= DMR_SYNC_END_SAMPLES)
+        ptr -= DMR_SYNC_END_SAMPLES;
     }
 
     if (corr > m_maxCorr) {
@@ -287,8 +324,7 @@ void CDMRSlotRX::correlateSync(bool first)
       q15_t threshold = q15_t(v1 >> 15);
 
       uint8_t sync[DMR_SYNC_BYTES_LENGTH];
-      uint16_t ptr = m_dataPtr - DMR_SYNC_LENGTH_SAMPLES + DMR_RADIO_SYMBOL_LENGTH;
-      samplesToBits(ptr, DMR_SYNC_LENGTH_SYMBOLS, sync, 4U, centre, threshold);
+      samplesToBits(symbols, DMR_SYNC_LENGTH_SYMBOLS, sync, 4U, centre, threshold);
 
       if (data) {
         uint8_t errs = 0U;
@@ -300,6 +336,7 @@ void CDMRSlotRX::correlateSync(bool first)
             m_threshold[0U] = m_threshold[1U] = m_threshold[2U] = m_threshold[3U] = threshold;
             m_centre[0U]    = m_centre[1U]    = m_centre[2U]    = m_centre[3U]    = centre;
             m_averagePtr    = 0U;
+            m_timing.reset();
           } else {
             m_threshold[m_averagePtr] = threshold;
             m_centre[m_averagePtr]    = centre;
@@ -312,8 +349,10 @@ void CDMRSlotRX::correlateSync(bool first)
           m_maxCorr  = corr;
           m_control  = CONTROL_DATA;
           m_syncPtr  = m_dataPtr;
-          m_startPtr = m_dataPtr - DMR_SLOT_TYPE_LENGTH_SAMPLES / 2U - DMR_INFO_LENGTH_SAMPLES / 2U - DMR_SYNC_LENGTH_SAMPLES;
-          m_endPtr   = m_dataPtr + DMR_SLOT_TYPE_LENGTH_SAMPLES / 2U + DMR_INFO_LENGTH_SAMPLES / 2U - 1U;
+          m_endPtr   = m_dataPtr + DMR_FRAME_LENGTH_SAMPLES - DMR_SYNC_END_SAMPLES;
+
+          storeSymbols(0U);
+          m_timing.resync();
         }
       } else {  // if (voice)
         uint8_t errs = 0U;
@@ -325,6 +364,7 @@ void CDMRSlotRX::correlateSync(bool first)
             m_threshold[0U] = m_threshold[1U] = m_threshold[2U] = m_threshold[3U] = threshold;
             m_centre[0U]    = m_centre[1U]    = m_centre[2U]    = m_centre[3U]    = centre;
             m_averagePtr    = 0U;
+            m_timing.reset();
           } else {
             m_threshold[m_averagePtr] = threshold;
             m_centre[m_averagePtr]    = centre;
@@ -337,18 +377,49 @@ void CDMRSlotRX::correlateSync(bool first)
           m_maxCorr  = corr;
           m_control  = CONTROL_VOICE;
           m_syncPtr  = m_dataPtr;
-          m_startPtr = m_dataPtr - DMR_SLOT_TYPE_LENGTH_SAMPLES / 2U - DMR_INFO_LENGTH_SAMPLES / 2U - DMR_SYNC_LENGTH_SAMPLES;
-          m_endPtr   = m_dataPtr + DMR_SLOT_TYPE_LENGTH_SAMPLES / 2U + DMR_INFO_LENGTH_SAMPLES / 2U - 1U;
+          m_endPtr   = m_dataPtr + DMR_FRAME_LENGTH_SAMPLES - DMR_SYNC_END_SAMPLES;
+
+          storeSymbols(0U);
+          m_timing.resync();
         }
       }
     }
   }
 }
 
-void CDMRSlotRX::samplesToBits(uint16_t start, uint8_t count, uint8_t* buffer, uint16_t offset, q15_t centre, q15_t threshold)
+// Copy the symbols from the start of the burst to the end of a sync that was found back samples ago
+void CDMRSlotRX::storeSymbols(uint16_t back)
 {
-  for (uint8_t i = 0U; i < count; i++, start += DMR_RADIO_SYMBOL_LENGTH) {
-    q15_t sample = m_buffer[start] - centre;
+  uint16_t ptr = m_historyPtr + DMR_RADIO_SYMBOL_LENGTH - back;
+  if (ptr >= DMR_SYNC_END_SAMPLES)
+    ptr -= DMR_SYNC_END_SAMPLES;
+
+  for (uint8_t i = 0U; i < DMR_SYNC_END_SYMBOLS; i++) {
+    m_symbols[i] = m_history[ptr];
+
+    ptr += DMR_RADIO_SYMBOL_LENGTH;
+    if (ptr >= DMR_SYNC_END_SAMPLES)
+      ptr -= DMR_SYNC_END_SAMPLES;
+  }
+
+  // The RSSI average leaves out the first 2.5 ms of the burst
+  m_rssiStart = rssiAccum(back + DMR_SYNC_END_SAMPLES - DMR_SYNC_LENGTH_SAMPLES / 2U);
+}
+
+// The RSSI total from before the sample back samples ago, to the nearest symbol
+uint32_t CDMRSlotRX::rssiAccum(uint16_t back) const
+{
+  uint16_t ptr = m_historyPtr + DMR_SYNC_END_SAMPLES - back + DMR_RADIO_SYMBOL_LENGTH / 2U;
+  if (ptr >= DMR_SYNC_END_SAMPLES)
+    ptr -= DMR_SYNC_END_SAMPLES;
+
+  return m_rssiHistory[ptr / DMR_RADIO_SYMBOL_LENGTH];
+}
+
+void CDMRSlotRX::samplesToBits(const q15_t* symbols, uint8_t count, uint8_t* buffer, uint16_t offset, q15_t centre, q15_t threshold)
+{
+  for (uint8_t i = 0U; i < count; i++) {
+    q15_t sample = symbols[i] - centre;
 
     if (sample < -threshold) {
       WRITE_BIT1(buffer, offset, false);
@@ -374,6 +445,17 @@ void CDMRSlotRX::samplesToBits(uint16_t start, uint8_t count, uint8_t* buffer, u
   }
 }
 
+// Two symbols to each byte, the first in the high nibble
+void CDMRSlotRX::samplesToSoft(const q15_t* symbols, uint8_t count, uint8_t* buffer, q15_t centre, q15_t threshold)
+{
+  for (uint8_t i = 0U; i < count; i += 2U) {
+    q15_t sample1 = symbols[i + 0U] - centre;
+    q15_t sample2 = symbols[i + 1U] - centre;
+
+    buffer[i / 2U] = (softSymbol(sample1, threshold) << 4) | softSymbol(sample2, threshold);
+  }
+}
+
 void CDMRSlotRX::setColorCode(uint8_t colorCode)
 {
   m_colorCode = colorCode;
@@ -388,21 +470,37 @@ void CDMRSlotRX::writeRSSIData(uint8_t* frame)
 {
 #if defined(SEND_RSSI_DATA)
   // Calculate RSSI average over a burst period. We don't take into account 2.5 ms at the beginning and 2.5 ms at the end
-  uint16_t start = m_startPtr + DMR_SYNC_LENGTH_SAMPLES / 2U;
-
-  uint32_t accum = 0U;
-  for (uint16_t i = 0U; i < (DMR_FRAME_LENGTH_SAMPLES - DMR_SYNC_LENGTH_SAMPLES); i++)
-    accum += m_rssi[start++];
+  uint32_t accum = rssiAccum(DMR_SYNC_LENGTH_SAMPLES / 2U) - m_rssiStart;
 
   uint16_t avg = accum / (DMR_FRAME_LENGTH_SAMPLES - DMR_SYNC_LENGTH_SAMPLES);
   frame[34U] = (avg >> 8) & 0xFFU;
   frame[35U] = (avg >> 0) & 0xFFU;
 
-  serial.writeDMRData(m_slot, frame, DMR_FRAME_LENGTH_BYTES + 3U);
+  writeData(frame, DMR_FRAME_LENGTH_BYTES + 3U);
 #else
-  serial.writeDMRData(m_slot, frame, DMR_FRAME_LENGTH_BYTES + 1U);
+  writeData(frame, DMR_FRAME_LENGTH_BYTES + 1U);
 #endif
 }
 
+// Send the hard bits, or the soft symbols with the same control byte and RSSI if the host wants them
+void CDMRSlotRX::writeData(const uint8_t* frame, uint8_t length)
+{
+  if (!serial.getSoftSymbols()) {
+    serial.writeDMRData(m_slot, frame, length);
+    return;
+  }
+
+  uint8_t data[DMR_FRAME_LENGTH_SYMBOLS / 2U + 3U];
+  data[0U] = frame[0U];
+
+  samplesToSoft(m_symbols, DMR_FRAME_LENGTH_SYMBOLS, data + 1U, m_centreVal, m_thresholdVal);
+
+  uint8_t count = DMR_FRAME_LENGTH_SYMBOLS / 2U + 1U;
+  for (uint8_t i = DMR_FRAME_LENGTH_BYTES + 1U; i < length; i++, count++)
+    data[count] = frame[i];
+
+  serial.writeDMRSoft(m_slot, data, count);
+}
+
 #endif
 
@@ -24,6 +24,8 @@
 #define  DMRSLOTRX_H
 
 #include "DMRDefines.h"
+#include "SyncSearch.h"
+#include "SymbolTiming.h"
 
 enum DMRRX_STATE {
   DMRRXS_NONE,
@@ -46,17 +48,23 @@ public:
 
 private:
   bool        m_slot;
-  uint32_t    m_bitBuffer[DMR_RADIO_SYMBOL_LENGTH];
-  q15_t       m_buffer[900U];
-  uint16_t    m_bitPtr;
+  CSyncSearch<uint32_t, DMR_RADIO_SYMBOL_LENGTH> m_syncSearch;
+  q15_t       m_history[DMR_SYNC_END_SAMPLES];
+  uint32_t    m_rssiHistory[DMR_SYNC_END_SYMBOLS];
+  uint16_t    m_historyPtr;
+  q15_t       m_symbols[DMR_FRAME_LENGTH_SYMBOLS];
+  CSymbolTiming<DMR_SYNC_END_SAMPLES, DMR_RADIO_SYMBOL_LENGTH> m_timing;
+  uint32_t    m_rssiAccum;
+  uint32_t    m_rssiStart;
   uint16_t    m_dataPtr;
   uint16_t    m_syncPtr;
-  uint16_t    m_startPtr;
   uint16_t    m_endPtr;
   uint16_t    m_delayPtr;
   q31_t       m_maxCorr;
   q15_t       m_centre[4U];
   q15_t       m_threshold[4U];
+  q15_t       m_centreVal;
+  q15_t       m_thresholdVal;
   uint8_t     m_averagePtr;
   uint8_t     m_control;
   uint8_t     m_syncCount;
@@ -65,11 +73,14 @@ private:
   DMRRX_STATE m_state;
   uint8_t     m_n;
   uint8_t     m_type;
-  uint16_t    m_rssi[900U];
 
   void correlateSync(bool first);
-  void samplesToBits(uint16_t start, uint8_t count, uint8_t* buffer, uint16_t offset, q15_t centre, q15_t threshold);
+  void storeSymbols(uint16_t back);
+  uint32_t rssiAccum(uint16_t back) const;
+  void samplesToBits(const q15_t* symbols, uint8_t count, uint8_t* buffer, uint16_t offset, q15_t centre, q15_t threshold);
+  void samplesToSoft(const q15_t* symbols, uint8_t count, uint8_t* buffer, q15_t centre, q15_t threshold);
   void writeRSSIData(uint8_t* frame);
+  void writeData(const uint8_t* frame, uint8_t length);
 };
 
 #endif
@@ -29,12 +29,10 @@
 static q15_t RRC_0_2_FILTER[] = {0, 0, 0, 0, 850, 219, -720, -1548, -1795, -1172, 237, 1927, 3120, 3073, 1447, -1431, -4544, -6442,
                                  -5735, -1633, 5651, 14822, 23810, 30367, 32767, 30367, 23810, 14822, 5651, -1633, -5735, -6442,
                                  -4544, -1431, 1447, 3073, 3120, 1927, 237, -1172, -1795, -1548, -720, 219, 850}; // numTaps = 45, L = 5
-const uint16_t RRC_0_2_FILTER_PHASE_LEN = 9U; // phaseLength = numTaps/L
+const uint16_t RRC_0_2_FILTER_LEN = 45U;
 
 const q15_t DMR_LEVELA =  1362;
 const q15_t DMR_LEVELB =  454;
-const q15_t DMR_LEVELC = -454;
-const q15_t DMR_LEVELD = -1362;
 
 // The PR FILL and BS Data Sync pattern.
 const uint8_t IDLE_DATA[] =
@@ -61,8 +59,7 @@ const uint32_t ABORT_COUNT = 6U;
 
 CDMRTX::CDMRTX() :
 m_fifo(),
-m_modFilter(),
-m_modState(),
+m_mod(),
 m_state(DMRTXSTATE_IDLE),
 m_idle(),
 m_cachPtr(0U),
@@ -76,12 +73,8 @@ m_frameCount(0U),
 m_abortCount(),
 m_abort()
 {
-  ::memset(m_modState, 0x00U, 16U * sizeof(q15_t));
-
-  m_modFilter.L           = DMR_RADIO_SYMBOL_LENGTH;
-  m_modFilter.phaseLength = RRC_0_2_FILTER_PHASE_LEN;
-  m_modFilter.pCoeffs     = RRC_0_2_FILTER;
-  m_modFilter.pState      = m_modState;
+  m_mod.setFilter(RRC_0_2_FILTER, RRC_0_2_FILTER_LEN);
+  m_mod.setLevels(DMR_LEVELA, DMR_LEVELB);
 
   ::memcpy(m_newShortLC, EMPTY_SHORT_LC, 12U);
   ::memcpy(m_shortLC,    EMPTY_SHORT_LC, 12U);
@@ -152,8 +145,7 @@ uint8_t CDMRTX::writeData1(const uint8_t* data, uint16_t length)
   if (length != (DMR_FRAME_LENGTH_BYTES + 1U))
     return 4U;
 
-  uint16_t space = m_fifo[0U].getSpace();
-  if (space < DMR_FRAME_LENGTH_BYTES)
+  if (!m_fifo[0U].hasSpace(DMR_FRAME_LENGTH_BYTES))
     return 5U;
 
   if (m_abort[0U]) {
@@ -161,8 +153,7 @@ uint8_t CDMRTX::writeData1(const uint8_t* data, uint16_t length)
     m_abort[0U] = false;
   }
 
-  for (uint8_t i = 0U; i < DMR_FRAME_LENGTH_BYTES; i++)
-    m_fifo[0U].put(data[i + 1U]);
+  m_fifo[0U].write(data + 1U, DMR_FRAME_LENGTH_BYTES);
 
   // Start the TX if it isn't already on
   if (!m_tx)
@@ -176,8 +167,7 @@ uint8_t CDMRTX::writeData2(const uint8_t* data, uint16_t length)
   if (length != (DMR_FRAME_LENGTH_BYTES + 1U))
     return 4U;
 
-  uint16_t space = m_fifo[1U].getSpace();
-  if (space < DMR_FRAME_LENGTH_BYTES)
+  if (!m_fifo[1U].hasSpace(DMR_FRAME_LENGTH_BYTES))
     return 5U;
 
   if (m_abort[1U]) {
@@ -185,8 +175,7 @@ uint8_t CDMRTX::writeData2(const uint8_t* data, uint16_t length)
     m_abort[1U] = false;
   }
 
-  for (uint8_t i = 0U; i < DMR_FRAME_LENGTH_BYTES; i++)
-    m_fifo[1U].put(data[i + 1U]);
+  m_fifo[1U].write(data + 1U, DMR_FRAME_LENGTH_BYTES);
 
   // Start the TX if it isn't already on
   if (!m_tx)
@@ -236,6 +225,10 @@ void CDMRTX::setStart(bool start)
 {
   m_state = start ? DMRTXSTATE_SLOT1 : DMRTXSTATE_IDLE;
 
+  // Drop what is left of a burst cut short, so that a transmission always starts with a CACH
+  m_poLen = 0U;
+  m_poPtr = 0U;
+
   m_frameCount = 0U;
   m_abortCount[0U] = 0U;
   m_abortCount[1U] = 0U;
@@ -251,35 +244,9 @@ void CDMRTX::setCal(bool start)
 
 void CDMRTX::writeByte(uint8_t c, uint8_t control)
 {
-  q15_t inBuffer[4U];
-  q15_t outBuffer[DMR_RADIO_SYMBOL_LENGTH * 4U];
-
-  const uint8_t MASK = 0xC0U;
-
-  for (uint8_t i = 0U; i < 4U; i++, c <<= 2) {
-    switch (c & MASK) {
-      case 0xC0U:
-        inBuffer[i] = DMR_LEVELA;
-        break;
-      case 0x80U:
-        inBuffer[i] = DMR_LEVELB;
-        break;
-      case 0x00U:
-        inBuffer[i] = DMR_LEVELC;
-        break;
-      default:
-        inBuffer[i] = DMR_LEVELD;
-        break;
-    }
-  }
-
-  uint8_t controlBuffer[DMR_RADIO_SYMBOL_LENGTH * 4U];
-  ::memset(controlBuffer, MARK_NONE, DMR_RADIO_SYMBOL_LENGTH * 4U * sizeof(uint8_t));
-  controlBuffer[DMR_RADIO_SYMBOL_LENGTH * 2U] = control;  
+  m_mod.addByte(c);
 
-  ::arm_fir_interpolate_q15(&m_modFilter, inBuffer, outBuffer, 4U);
-
-  io.write(STATE_DMR, outBuffer, DMR_RADIO_SYMBOL_LENGTH * 4U, controlBuffer);
+  io.write(STATE_DMR, m_mod, control);
 }
 
 uint8_t CDMRTX::getSpace1() const
@@ -292,13 +259,16 @@ uint8_t CDMRTX::getSpace2() const
   return m_fifo[1U].getSpace() / (DMR_FRAME_LENGTH_BYTES + 2U);
 }
 
+void CDMRTX::getBufferStats(uint8_t slot, TRingStats& stats)
+{
+  m_fifo[slot].getStats(stats);
+}
+
 void CDMRTX::createData(uint8_t slotIndex)
 {
   if (m_fifo[slotIndex].getData() >= DMR_FRAME_LENGTH_BYTES && m_frameCount >= STARTUP_COUNT && m_abortCount[slotIndex] >= ABORT_COUNT) {
-    for (unsigned int i = 0U; i < DMR_FRAME_LENGTH_BYTES; i++) {
-      m_fifo[slotIndex].get(m_poBuffer[i]);
-      m_markBuffer[i] = MARK_NONE;
-    }
+    m_fifo[slotIndex].read(m_poBuffer, DMR_FRAME_LENGTH_BYTES);
+    ::memset(m_markBuffer, MARK_NONE, DMR_FRAME_LENGTH_BYTES);
   } else {
     m_abort[slotIndex] = false;
     // Transmit an idle message
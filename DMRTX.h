@@ -26,8 +26,12 @@
 
 #include "DMRDefines.h"
 
+#include "FSKMod.h"
 #include "RingBuffer.h"
 
+// The RRC filter spans 9 symbols
+typedef CFSKMod<DMR_RADIO_SYMBOL_LENGTH, 9U> CDMRMod;
+
 enum DMRTXSTATE {
   DMRTXSTATE_IDLE,
   DMRTXSTATE_SLOT1,
@@ -59,12 +63,13 @@ public:
   uint8_t getSpace1() const;
   uint8_t getSpace2() const;
 
+  void getBufferStats(uint8_t slot, TRingStats& stats);
+
   void setColorCode(uint8_t colorCode);
 
 private:
   CRingBuffer<uint8_t>                        m_fifo[2U];
-  arm_fir_interpolate_instance_q15 m_modFilter;
-  q15_t                            m_modState[16U];    // blockSize + phaseLength - 1, 4 + 9 - 1 plus some spare
+  CDMRMod                          m_mod;
   DMRTXSTATE                       m_state;
   uint8_t                          m_idle[DMR_FRAME_LENGTH_BYTES];
   uint8_t                          m_cachPtr;
@@ -37,19 +37,18 @@ const uint64_t DATA_SYNC_DATA = 0x0000000000AAB468U;
 const uint64_t DATA_SYNC_MASK = 0x0000000000FFFFFFU;
 const uint8_t  DATA_SYNC_ERRS = 2U;
 
+// The header soft decisions are scaled so that the mean magnitude becomes SOFT_MEAN, and limited to SOFT_MAX
+const int     SOFT_MEAN = 8;
+const int     SOFT_MAX  = 15;
+
 // D-Star bit order version of 0x55 0x55 0xC8 0x7A
 const uint64_t END_SYNC_DATA = 0x0000AAAAAAAA135EU;
 const uint64_t END_SYNC_MASK = 0x0000FFFFFFFFFFFFU;
 const uint8_t  END_SYNC_ERRS = 1U;
 
-const uint8_t BIT_MASK_TABLE0[] = {0x7FU, 0xBFU, 0xDFU, 0xEFU, 0xF7U, 0xFBU, 0xFDU, 0xFEU};
-const uint8_t BIT_MASK_TABLE1[] = {0x80U, 0x40U, 0x20U, 0x10U, 0x08U, 0x04U, 0x02U, 0x01U};
 const uint8_t BIT_MASK_TABLE2[] = {0xFEU, 0xFDU, 0xFBU, 0xF7U, 0xEFU, 0xDFU, 0xBFU, 0x7FU};
 const uint8_t BIT_MASK_TABLE3[] = {0x01U, 0x02U, 0x04U, 0x08U, 0x10U, 0x20U, 0x40U, 0x80U};
 
-#define WRITE_BIT1(p,i,b) p[(i)>>3] = (b) ? (p[(i)>>3] | BIT_MASK_TABLE1[(i)&7]) : (p[(i)>>3] & BIT_MASK_TABLE0[(i)&7])
-#define READ_BIT1(p,i)    (p[(i)>>3] & BIT_MASK_TABLE1[(i)&7])
-
 #define WRITE_BIT2(p,i,b) p[(i)>>3] = (b) ? (p[(i)>>3] | BIT_MASK_TABLE3[(i)&7]) : (p[(i)>>3] & BIT_MASK_TABLE2[(i)&7])
 #define READ_BIT2(p,i)    (p[(i)>>3] & BIT_MASK_TABLE3[(i)&7])
 
@@ -238,10 +237,9 @@ const uint16_t NOENDPTR = 9999U;
 
 CDStarRX::CDStarRX() :
 m_rxState(DSRXS_NONE),
-m_bitBuffer(),
+m_syncSearch(),
 m_headerBuffer(),
 m_dataBuffer(),
-m_bitPtr(0U),
 m_headerPtr(0U),
 m_dataPtr(0U),
 m_startPtr(NOENDPTR),
@@ -252,13 +250,7 @@ m_maxFrameCorr(0),
 m_maxDataCorr(0),
 m_frameCount(0U),
 m_countdown(0U),
-m_mar(0U),
-m_pathMetric(),
-m_pathMemory0(),
-m_pathMemory1(),
-m_pathMemory2(),
-m_pathMemory3(),
-m_fecOutput(),
+m_viterbi(),
 m_rssiAccum(0U),
 m_rssiCount(0U)
 {
@@ -269,7 +261,7 @@ void CDStarRX::reset()
   m_rxState      = DSRXS_NONE;
   m_headerPtr    = 0U;
   m_dataPtr      = 0U;
-  m_bitPtr       = 0U;
+  m_syncSearch.reset();
   m_maxFrameCorr = 0;
   m_maxDataCorr  = 0;
   m_startPtr     = NOENDPTR;
@@ -290,9 +282,7 @@ void CDStarRX::samples(const q15_t* samples, const uint16_t* rssi, uint8_t lengt
 
     q15_t sample = samples[i];
 
-    m_bitBuffer[m_bitPtr] <<= 1;
-    if (sample < 0)
-      m_bitBuffer[m_bitPtr] |= 0x01U;
+    m_syncSearch.add(sample);
 
     m_dataBuffer[m_dataPtr] = sample;
 
@@ -311,10 +301,6 @@ void CDStarRX::samples(const q15_t* samples, const uint16_t* rssi, uint8_t lengt
     m_dataPtr++;
     if (m_dataPtr >= DSTAR_DATA_LENGTH_SAMPLES)
       m_dataPtr = 0U;
-
-    m_bitPtr++;
-    if (m_bitPtr >= DSTAR_RADIO_SYMBOL_LENGTH)
-      m_bitPtr = 0U;
   }
 }
 
@@ -360,12 +346,13 @@ void CDStarRX::processHeader(q15_t sample)
 
   // A full FEC header
   if (m_headerPtr == (DSTAR_FEC_SECTION_LENGTH_SAMPLES + DSTAR_RADIO_SYMBOL_LENGTH)) {
-    uint8_t buffer[DSTAR_FEC_SECTION_LENGTH_BYTES];
-    samplesToBits(m_headerBuffer, DSTAR_RADIO_SYMBOL_LENGTH, DSTAR_FEC_SECTION_LENGTH_SYMBOLS, buffer, DSTAR_FEC_SECTION_LENGTH_SAMPLES);
+    int8_t soft[DSTAR_FEC_SECTION_LENGTH_SYMBOLS];
+    samplesToSoft(m_headerBuffer + DSTAR_RADIO_SYMBOL_LENGTH, soft);
 
     // Process the scrambling, interleaving and FEC, then return true if the chcksum was correct
-    uint8_t header[DSTAR_HEADER_LENGTH_BYTES];
-    bool ok = rxHeader(buffer, header);
+    uint8_t header[DSTAR_HEADER_LENGTH_BYTES + 2U];
+    bool ok;
+    PROFILE(PROFILE_DSTAR_HEADER, ok = rxHeader(soft, header));
     if (!ok) {
       // The checksum failed, return to looking for syncs
       m_rxState = DSRXS_NONE;
@@ -398,7 +385,7 @@ void CDStarRX::processHeader(q15_t sample)
 void CDStarRX::processData()
 {
   // Fuzzy matching of the end frame sequences
-  if (countBits64((m_bitBuffer[m_bitPtr] & DSTAR_END_SYNC_MASK) ^ DSTAR_END_SYNC_DATA) <= END_SYNC_ERRS) {
+  if (m_syncSearch.errors(DSTAR_END_SYNC_DATA, DSTAR_END_SYNC_MASK) <= END_SYNC_ERRS) {
     DEBUG1("DStarRX: Found end sync in Data");
 
     io.setDecode(false);
@@ -507,7 +494,7 @@ void CDStarRX::writeRSSIData(unsigned char* data)
 
 bool CDStarRX::correlateFrameSync()
 {
-  if (countBits64((m_bitBuffer[m_bitPtr] & DSTAR_FRAME_SYNC_MASK) ^ DSTAR_FRAME_SYNC_DATA) <= FRAME_SYNC_ERRS) {
+  if (m_syncSearch.errors(DSTAR_FRAME_SYNC_DATA, DSTAR_FRAME_SYNC_MASK) <= FRAME_SYNC_ERRS) {
     uint16_t ptr = m_dataPtr + DSTAR_DATA_LENGTH_SAMPLES - DSTAR_FRAME_SYNC_LENGTH_SAMPLES + DSTAR_RADIO_SYMBOL_LENGTH;
     if (ptr >= DSTAR_DATA_LENGTH_SAMPLES)
       ptr -= DSTAR_DATA_LENGTH_SAMPLES;
@@ -543,7 +530,7 @@ bool CDStarRX::correlateDataSync()
   if (m_rxState == DSRXS_DATA)
     maxErrs = DATA_SYNC_ERRS;
 
-  if (countBits64((m_bitBuffer[m_bitPtr] & DSTAR_DATA_SYNC_MASK) ^ DSTAR_DATA_SYNC_DATA) <= maxErrs) {
+  if (m_syncSearch.errors(DSTAR_DATA_SYNC_DATA, DSTAR_DATA_SYNC_MASK) <= maxErrs) {
     uint16_t ptr = m_dataPtr + DSTAR_DATA_LENGTH_SAMPLES - DSTAR_DATA_SYNC_LENGTH_SAMPLES + DSTAR_RADIO_SYMBOL_LENGTH;
     if (ptr >= DSTAR_DATA_LENGTH_SAMPLES)
       ptr -= DSTAR_DATA_LENGTH_SAMPLES;
@@ -604,204 +591,48 @@ void CDStarRX::samplesToBits(const q15_t* inBuffer, uint16_t start, uint16_t cou
   }
 }
 
-bool CDStarRX::rxHeader(uint8_t* in, uint8_t* out)
+// One soft decision per symbol, positive for a one, taken from the centre of each symbol. Unlike
+// samplesToBits this does not wrap, so the last symbol is read from the end of the buffer rather
+// than from the sync sample at its start.
+void CDStarRX::samplesToSoft(const q15_t* inBuffer, int8_t* outBuffer) const
 {
-  int i;
-
-  // Descramble the header
-  for (i = 0; i < int(DSTAR_FEC_SECTION_LENGTH_BYTES); i++)
-    in[i] ^= SCRAMBLE_TABLE_RX[i];
-
-  unsigned char intermediate[84U];
-  for (i = 0; i < 84; i++)
-    intermediate[i] = 0x00U;
-
-  // Deinterleave the header
-  i = 0;
-  while (i < 660) {
-    unsigned char d = in[i / 8];
-
-    if (d & 0x01U)
-      intermediate[INTERLEAVE_TABLE_RX[i * 2U]] |= (0x80U >> INTERLEAVE_TABLE_RX[i * 2U + 1U]);
-    i++;
-
-    if (d & 0x02U)
-      intermediate[INTERLEAVE_TABLE_RX[i * 2U]] |= (0x80U >> INTERLEAVE_TABLE_RX[i * 2U + 1U]);
-    i++;
-
-    if (d & 0x04U)
-      intermediate[INTERLEAVE_TABLE_RX[i * 2U]] |= (0x80U >> INTERLEAVE_TABLE_RX[i * 2U + 1U]);
-    i++;
-
-    if (d & 0x08U)
-      intermediate[INTERLEAVE_TABLE_RX[i * 2U]] |= (0x80U >> INTERLEAVE_TABLE_RX[i * 2U + 1U]);
-    i++;
-
-    if (i < 660) {
-      if (d & 0x10U)
-        intermediate[INTERLEAVE_TABLE_RX[i * 2U]] |= (0x80U >> INTERLEAVE_TABLE_RX[i * 2U + 1U]);
-      i++;
-
-      if (d & 0x20U)
-        intermediate[INTERLEAVE_TABLE_RX[i * 2U]] |= (0x80U >> INTERLEAVE_TABLE_RX[i * 2U + 1U]);
-      i++;
-
-      if (d & 0x40U)
-        intermediate[INTERLEAVE_TABLE_RX[i * 2U]] |= (0x80U >> INTERLEAVE_TABLE_RX[i * 2U + 1U]);
-      i++;
-
-      if (d & 0x80U)
-        intermediate[INTERLEAVE_TABLE_RX[i * 2U]] |= (0x80U >> INTERLEAVE_TABLE_RX[i * 2U + 1U]);
-      i++;
-    }
+  q31_t total = 0;
+  for (uint16_t i = 0U; i < DSTAR_FEC_SECTION_LENGTH_SYMBOLS; i++) {
+    q15_t sample = inBuffer[i * DSTAR_RADIO_SYMBOL_LENGTH];
+    total += sample < 0 ? -sample : sample;
   }
 
-  for (i = 0; i < 4; i++)
-    m_pathMetric[i] = 0;
+  q31_t mean = total / q31_t(DSTAR_FEC_SECTION_LENGTH_SYMBOLS);
+  if (mean == 0)
+    mean = 1;
 
-  int decodeData[2U];
+  for (uint16_t i = 0U; i < DSTAR_FEC_SECTION_LENGTH_SYMBOLS; i++) {
+    q31_t soft = (-q31_t(inBuffer[i * DSTAR_RADIO_SYMBOL_LENGTH]) * SOFT_MEAN) / mean;
 
-  m_mar = 0U;
-  for (i = 0; i < 660; i += 2) {
-    if (intermediate[i >> 3] & (0x80U >> (i & 7)))
-      decodeData[1U] = 1U;
-    else
-      decodeData[1U] = 0U;
+    if (soft > SOFT_MAX)
+      soft = SOFT_MAX;
+    else if (soft < -SOFT_MAX)
+      soft = -SOFT_MAX;
 
-    if (intermediate[i >> 3] & (0x40U >> (i & 7)))
-      decodeData[0U] = 1U;
-    else
-      decodeData[0U] = 0U;
-
-    viterbiDecode(decodeData);
+    outBuffer[i] = int8_t(soft);
   }
-
-  traceBack();
-
-  for (i = 0; i < int(DSTAR_HEADER_LENGTH_BYTES); i++)
-    out[i] = 0x00U;
-
-  unsigned int j = 0;
-  for (i = 329; i >= 0; i--) {
-    if (READ_BIT1(m_fecOutput, i))
-      out[j >> 3] |= (0x01U << (j & 7));
-
-    j++;
-  }
-
-  return checksum(out);
-}
-
-void CDStarRX::acs(int* metric)
-{
-  int tempMetric[4U];
-
-  unsigned int j = m_mar >> 3;
-  unsigned int k = m_mar & 7;
-
-  // Pres. state = S0, Prev. state = S0 & S2
-  int m1 = metric[0U] + m_pathMetric[0U];
-  int m2 = metric[4U] + m_pathMetric[2U];
-  tempMetric[0U] = m1 < m2 ? m1 : m2;
-  if (m1 < m2)
-    m_pathMemory0[j] &= BIT_MASK_TABLE0[k];
-  else
-    m_pathMemory0[j] |= BIT_MASK_TABLE1[k];
-
-  // Pres. state = S1, Prev. state = S0 & S2
-  m1 = metric[1U] + m_pathMetric[0U];
-  m2 = metric[5U] + m_pathMetric[2U];
-  tempMetric[1U] = m1 < m2 ? m1 : m2;
-  if (m1 < m2)
-    m_pathMemory1[j] &= BIT_MASK_TABLE0[k];
-  else
-    m_pathMemory1[j] |= BIT_MASK_TABLE1[k];
-
-  // Pres. state = S2, Prev. state = S2 & S3
-  m1 = metric[2U] + m_pathMetric[1U];
-  m2 = metric[6U] + m_pathMetric[3U];
-  tempMetric[2U] = m1 < m2 ? m1 : m2;
-  if (m1 < m2)
-    m_pathMemory2[j] &= BIT_MASK_TABLE0[k];
-  else
-    m_pathMemory2[j] |= BIT_MASK_TABLE1[k];
-
-  // Pres. state = S3, Prev. state = S1 & S3
-  m1 = metric[3U] + m_pathMetric[1U];
-  m2 = metric[7U] + m_pathMetric[3U];
-  tempMetric[3U] = m1 < m2 ? m1 : m2;
-  if (m1 < m2)
-    m_pathMemory3[j] &= BIT_MASK_TABLE0[k];
-  else
-    m_pathMemory3[j] |= BIT_MASK_TABLE1[k];
-
-  for (unsigned int i = 0U; i < 4U; i++)
-    m_pathMetric[i] = tempMetric[i];
-
-  m_mar++;
-}
- 
-void CDStarRX::viterbiDecode(int* data)
-{
-  int metric[8U];
-  
-  metric[0] = (data[1] ^ 0) + (data[0] ^ 0);
-  metric[1] = (data[1] ^ 1) + (data[0] ^ 1);
-  metric[2] = (data[1] ^ 1) + (data[0] ^ 0);
-  metric[3] = (data[1] ^ 0) + (data[0] ^ 1);
-  metric[4] = (data[1] ^ 1) + (data[0] ^ 1);
-  metric[5] = (data[1] ^ 0) + (data[0] ^ 0);
-  metric[6] = (data[1] ^ 0) + (data[0] ^ 1);
-  metric[7] = (data[1] ^ 1) + (data[0] ^ 0);
-  
-  acs(metric);
 }
 
-void CDStarRX::traceBack()
+bool CDStarRX::rxHeader(const int8_t* in, uint8_t* out)
 {
-  // Start from the S0, t=31
-  unsigned int j = 0U;
-  unsigned int k = 0U;
-  for (int i = 329; i >= 0; i--) {
-    switch (j) {
-      case 0U: // if state = S0
-        if (!READ_BIT1(m_pathMemory0, i))
-          j = 0U;
-        else
-          j = 2U;
-        WRITE_BIT1(m_fecOutput, k, false);
-        k++;
-        break;
+  int i;
 
+  // Descramble and deinterleave the header, a scrambled one inverts the soft decision
+  int8_t intermediate[DSTAR_FEC_SECTION_LENGTH_SYMBOLS];
+  for (i = 0; i < int(DSTAR_FEC_SECTION_LENGTH_SYMBOLS); i++) {
+    int8_t soft = (SCRAMBLE_TABLE_RX[i >> 3] & BIT_MASK_TABLE3[i & 7]) ? -in[i] : in[i];
 
-      case 1U: // if state = S1
-        if (!READ_BIT1(m_pathMemory1, i))
-          j = 0U;
-        else
-          j = 2U;
-        WRITE_BIT1(m_fecOutput, k, true);
-        k++;
-        break;
+    intermediate[INTERLEAVE_TABLE_RX[i * 2U] * 8U + INTERLEAVE_TABLE_RX[i * 2U + 1U]] = soft;
+  }
 
-      case 2U: // if state = S1
-        if (!READ_BIT1(m_pathMemory2, i))
-          j = 1U;
-        else
-          j = 3U;
-        WRITE_BIT1(m_fecOutput, k, false);
-        k++;
-        break;
+  m_viterbi.decode(intermediate, out, DSTAR_HEADER_LENGTH_BYTES * 8U);
 
-      case 3U: // if state = S1
-        if (!READ_BIT1(m_pathMemory3, i))
-          j = 1U;
-        else
-          j = 3U;
-        WRITE_BIT1(m_fecOutput, k, true);
-        k++;
-        break;
-    }
-  }
+  return checksum(out);
 }
 
 bool CDStarRX::checksum(const uint8_t* header) const
@@ -24,6 +24,8 @@
 #define  DSTARRX_H
 
 #include "DStarDefines.h"
+#include "SyncSearch.h"
+#include "DStarViterbi.h"
 
 enum DSRX_STATE {
   DSRXS_NONE,
@@ -41,10 +43,9 @@ public:
 
 private:
   DSRX_STATE   m_rxState;
-  uint64_t     m_bitBuffer[DSTAR_RADIO_SYMBOL_LENGTH];
+  CSyncSearch<uint32_t, DSTAR_RADIO_SYMBOL_LENGTH> m_syncSearch;
   q15_t        m_headerBuffer[DSTAR_FEC_SECTION_LENGTH_SAMPLES + 2U * DSTAR_RADIO_SYMBOL_LENGTH];
   q15_t        m_dataBuffer[DSTAR_DATA_LENGTH_SAMPLES];
-  uint16_t     m_bitPtr;
   uint16_t     m_headerPtr;
   uint16_t     m_dataPtr;
   uint16_t     m_startPtr;
@@ -55,13 +56,7 @@ private:
   q31_t        m_maxDataCorr;
   uint16_t     m_frameCount;
   uint8_t      m_countdown;
-  unsigned int m_mar;
-  int          m_pathMetric[4U];
-  unsigned int m_pathMemory0[42U];
-  unsigned int m_pathMemory1[42U];
-  unsigned int m_pathMemory2[42U];
-  unsigned int m_pathMemory3[42U];
-  uint8_t      m_fecOutput[42U];
+  CDStarViterbi m_viterbi;
   uint32_t     m_rssiAccum;
   uint16_t     m_rssiCount;
   
@@ -71,12 +66,10 @@ private:
   bool    correlateFrameSync();
   bool    correlateDataSync();
   void    samplesToBits(const q15_t* inBuffer, uint16_t start, uint16_t count, uint8_t* outBuffer, uint16_t limit);
+  void    samplesToSoft(const q15_t* inBuffer, int8_t* outBuffer) const;
   void    writeRSSIHeader(unsigned char* header);
   void    writeRSSIData(unsigned char* data);
-  bool    rxHeader(uint8_t* in, uint8_t* out);
-  void    acs(int* metric);
-  void    viterbiDecode(int* data);
-  void    traceBack();
+  bool    rxHeader(const int8_t* in, uint8_t* out);
   bool    checksum(const uint8_t* header) const;
 };
 
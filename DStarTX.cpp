@@ -224,8 +224,7 @@ void CDStarTX::process()
       m_buffer.get(dummy);
 
       uint8_t header[DSTAR_HEADER_LENGTH_BYTES];
-      for (uint8_t i = 0U; i < DSTAR_HEADER_LENGTH_BYTES; i++)
-        m_buffer.get(header[i]);
+      m_buffer.read(header, DSTAR_HEADER_LENGTH_BYTES);
 
       uint8_t buffer[86U];
       txHeader(header, buffer + 2U);
@@ -246,8 +245,7 @@ void CDStarTX::process()
     uint8_t dummy;
     m_buffer.get(dummy);
 
-    for (uint8_t i = 0U; i < DSTAR_DATA_LENGTH_BYTES; i++)
-      m_buffer.get(m_poBuffer[m_poLen++]);
+    m_poLen = m_buffer.read(m_poBuffer, DSTAR_DATA_LENGTH_BYTES);
 
     m_poPtr = 0U;
   }
@@ -288,16 +286,13 @@ uint8_t CDStarTX::writeHeader(const uint8_t* header, uint16_t length)
   if (length != DSTAR_HEADER_LENGTH_BYTES)
     return 4U;
 
-  uint16_t space = m_buffer.getSpace();
-  if (space < (DSTAR_HEADER_LENGTH_BYTES + 1U)) {
-    DEBUG2("DStarTX: header space available", space);
+  if (!m_buffer.hasSpace(DSTAR_HEADER_LENGTH_BYTES + 1U)) {
+    DEBUG2("DStarTX: header space available", m_buffer.getSpace());
     return 5U;
   }
 
   m_buffer.put(DSTAR_HEADER);
-
-  for (uint8_t i = 0U; i < DSTAR_HEADER_LENGTH_BYTES; i++)
-    m_buffer.put(header[i]);
+  m_buffer.write(header, DSTAR_HEADER_LENGTH_BYTES);
     
   return 0U;
 }
@@ -307,25 +302,21 @@ uint8_t CDStarTX::writeData(const uint8_t* data, uint16_t length)
   if (length != DSTAR_DATA_LENGTH_BYTES)
     return 4U;
 
-  uint16_t space = m_buffer.getSpace();
-  if (space < (DSTAR_DATA_LENGTH_BYTES + 1U)) {
-    DEBUG2("DStarTX: data space available", space);
+  if (!m_buffer.hasSpace(DSTAR_DATA_LENGTH_BYTES + 1U)) {
+    DEBUG2("DStarTX: data space available", m_buffer.getSpace());
     return 5U;
   }
 
   m_buffer.put(DSTAR_DATA);
-
-  for (uint8_t i = 0U; i < DSTAR_DATA_LENGTH_BYTES; i++)
-    m_buffer.put(data[i]);
+  m_buffer.write(data, DSTAR_DATA_LENGTH_BYTES);
     
   return 0U;
 }
 
 uint8_t CDStarTX::writeEOT()
 {
-  uint16_t space = m_buffer.getSpace();
-  if (space < 1U) {
-    DEBUG2("DStarTX: EOT space available", space);
+  if (!m_buffer.hasSpace(1U)) {
+    DEBUG2("DStarTX: EOT space available", m_buffer.getSpace());
     return 5U;
   }
 
@@ -344,7 +335,7 @@ void CDStarTX::txHeader(const uint8_t* in, uint8_t* out) const
     out[i] = 0x00U;
   }
 
-  // Convolve the header
+  // Convolve the header, the bits after it are the zeros that return the encoder to its first state
   uint8_t d, d1 = 0U, d2 = 0U, g0, g1;
   uint32_t k = 0U;
   for (i = 0U; i < 42U; i++) {
@@ -352,7 +343,7 @@ void CDStarTX::txHeader(const uint8_t* in, uint8_t* out) const
       uint8_t mask = (0x01U << j);
       d = 0U;
 
-      if (in[i] & mask)
+      if (i < DSTAR_HEADER_LENGTH_BYTES && (in[i] & mask))
         d = 1U;
 
       g0 = (d + d2) & 1;
@@ -449,5 +440,10 @@ uint8_t CDStarTX::getSpace() const
   return m_buffer.getSpace() / (DSTAR_DATA_LENGTH_BYTES + 1U);
 }
 
+void CDStarTX::getBufferStats(TRingStats& stats)
+{
+  m_buffer.getStats(stats);
+}
+
 #endif
 
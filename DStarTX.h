@@ -39,6 +39,8 @@ public:
 
   uint8_t getSpace() const;
 
+  void getBufferStats(TRingStats& stats);
+
 private:
   CRingBuffer<uint8_t>             m_buffer;
   arm_fir_interpolate_instance_q15 m_modFilter;
@@ -0,0 +1,183 @@
+/*
+ *   Copyright (C) 2026 by the MMDVM developers
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "Config.h"
+
+#if defined(MODE_DSTAR)
+
+#include "Globals.h"
+#include "DStarViterbi.h"
+
+#if defined(HOST_BUILD) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// With each soft decision no larger than 15 the path metrics stay within +/-9900 over the
+// whole header, so they never need normalising. For the pair d1, d0 let a = d1 + d0 and
+// b = d1 - d0, the branch metrics are then:
+//
+//   S0 <- S0 + a or S2 - a        S2 <- S1 - b or S3 + b
+//   S1 <- S0 - a or S2 + a        S3 <- S1 + b or S3 - b
+//
+// and a decision bit is set when the second, from S2 or S3, is taken.
+
+CDStarViterbi::CDStarViterbi() :
+m_decisions()
+{
+}
+
+void CDStarViterbi::decode(const int8_t* in, uint8_t* out, uint16_t count)
+{
+  acs(in);
+
+  traceBack(out, count);
+}
+
+#if defined(ARM_MATH_CM4) || defined(ARM_MATH_CM7)
+
+// The metrics are held in pairs as (S0, S1) and (S2, S3). Each __SSUB16 of the candidates sets
+// the GE flags that the __SEL after it uses to pick the smaller of each pair, and the sign bits
+// of its result are the decisions. Nothing may be put between the two.
+void CDStarViterbi::acs(const int8_t* in)
+{
+  uint32_t metric01 = 0U;
+  uint32_t metric23 = 0U;
+
+  uint32_t word = 0U;
+  for (uint16_t i = 0U; i < DSTAR_VITERBI_STEPS; i++) {
+    int32_t d1 = in[i * 2U + 0U];
+    int32_t d0 = in[i * 2U + 1U];
+
+    uint32_t branch = __PKHBT(d1 + d0, d0 - d1, 16);
+
+    uint32_t from0 = __SADD16(metric01, branch);    // (S0, S2) from S0 and S1
+    uint32_t from1 = __SSUB16(metric01, branch);    // (S1, S3) from S0 and S1
+    uint32_t from2 = __SSUB16(metric23, branch);    // (S0, S2) from S2 and S3
+    uint32_t from3 = __SADD16(metric23, branch);    // (S1, S3) from S2 and S3
+
+    uint32_t diff02 = __SSUB16(from0, from2);
+    uint32_t new02  = __SEL(from2, from0);
+
+    uint32_t diff13 = __SSUB16(from1, from3);
+    uint32_t new13  = __SEL(from3, from1);
+
+    metric01 = __PKHBT(new02, new13, 16);
+    metric23 = __PKHTB(new13, new02, 16);
+
+    diff02 = ~diff02;
+    diff13 = ~diff13;
+
+    uint32_t decision = ((diff02 >> 15) & 0x01U) | ((diff13 >> 14) & 0x02U) | ((diff02 >> 29) & 0x04U) | ((diff13 >> 28) & 0x08U);
+
+    word |= decision << ((i & 7U) * 4U);
+    if ((i & 7U) == 7U || i == (DSTAR_VITERBI_STEPS - 1U)) {
+      m_decisions[i >> 3] = word;
+      word = 0U;
+    }
+  }
+}
+
+#elif defined(HOST_BUILD) && defined(__SSE2__)
+
+// The four metrics are the low four lanes, the upper four are ignored
+void CDStarViterbi::acs(const int8_t* in)
+{
+  __m128i metric = _mm_setzero_si128();
+
+  uint32_t word = 0U;
+  for (uint16_t i = 0U; i < DSTAR_VITERBI_STEPS; i++) {
+    int16_t a = in[i * 2U + 0U] + in[i * 2U + 1U];
+    int16_t b = in[i * 2U + 0U] - in[i * 2U + 1U];
+
+    __m128i branch = _mm_setr_epi16(a, -a, -b, b, 0, 0, 0, 0);
+
+    __m128i first  = _mm_add_epi16(_mm_shufflelo_epi16(metric, _MM_SHUFFLE(1, 1, 0, 0)), branch);
+    __m128i second = _mm_sub_epi16(_mm_shufflelo_epi16(metric, _MM_SHUFFLE(3, 3, 2, 2)), branch);
+
+    __m128i less = _mm_cmplt_epi16(first, second);
+    metric = _mm_min_epi16(first, second);
+
+    uint32_t decision = ~uint32_t(_mm_movemask_epi8(_mm_packs_epi16(less, less))) & 0x0FU;
+
+    word |= decision << ((i & 7U) * 4U);
+    if ((i & 7U) == 7U || i == (DSTAR_VITERBI_STEPS - 1U)) {
+      m_decisions[i >> 3] = word;
+      word = 0U;
+    }
+  }
+}
+
+#else
+
+void CDStarViterbi::acs(const int8_t* in)
+{
+  int16_t metric[4U] = {0, 0, 0, 0};
+
+  uint32_t word = 0U;
+  for (uint16_t i = 0U; i < DSTAR_VITERBI_STEPS; i++) {
+    int16_t a = in[i * 2U + 0U] + in[i * 2U + 1U];
+    int16_t b = in[i * 2U + 0U] - in[i * 2U + 1U];
+
+    int16_t first[4U], second[4U];
+    first[0U]  = metric[0U] + a;
+    first[1U]  = metric[0U] - a;
+    first[2U]  = metric[1U] - b;
+    first[3U]  = metric[1U] + b;
+    second[0U] = metric[2U] - a;
+    second[1U] = metric[2U] + a;
+    second[2U] = metric[3U] + b;
+    second[3U] = metric[3U] - b;
+
+    uint32_t decision = 0U;
+    for (uint8_t j = 0U; j < 4U; j++) {
+      if (first[j] < second[j]) {
+        metric[j] = first[j];
+      } else {
+        metric[j] = second[j];
+        decision |= 0x01U << j;
+      }
+    }
+
+    word |= decision << ((i & 7U) * 4U);
+    if ((i & 7U) == 7U || i == (DSTAR_VITERBI_STEPS - 1U)) {
+      m_decisions[i >> 3] = word;
+      word = 0U;
+    }
+  }
+}
+
+#endif
+
+// The low bit of each state is the bit that led to it, and its decision gives the high bit of
+// the state before it
+void CDStarViterbi::traceBack(uint8_t* out, uint16_t count) const
+{
+  for (uint16_t i = 0U; i < ((count + 7U) / 8U); i++)
+    out[i] = 0x00U;
+
+  uint32_t state = 0U;
+  for (int i = DSTAR_VITERBI_STEPS - 1U; i >= 0; i--) {
+    if ((state & 0x01U) && i < count)
+      out[i >> 3] |= 0x01U << (i & 7);
+
+    uint32_t decision = (m_decisions[i >> 3] >> ((i & 7) * 4 + state)) & 0x01U;
+    state = (state >> 1) | (decision << 1);
+  }
+}
+
+#endif
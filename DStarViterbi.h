@@ -0,0 +1,51 @@
+/*
+ *   Copyright (C) 2026 by the MMDVM developers
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "Config.h"
+
+#if defined(MODE_DSTAR)
+
+#if !defined(DSTARVITERBI_H)
+#define  DSTARVITERBI_H
+
+#include "DStarDefines.h"
+
+const uint16_t DSTAR_VITERBI_STEPS = DSTAR_FEC_SECTION_LENGTH_SYMBOLS / 2U;
+
+// The four state, rate 1/2, constraint length 3 decoder for the D-Star header. The survivor
+// decisions are packed four bits to a step, eight steps to a word. The path metrics are 16 bits,
+// so that the add-compare-select can use the packed DSP instructions on the Cortex-M4 and M7
+// and SSE2 on a PC, with a scalar version for the rest.
+class CDStarViterbi {
+public:
+  CDStarViterbi();
+
+  // Decode pairs of soft decisions, positive for a one and no larger than 15, then return the
+  // first count bits of the path that ends in the first state, in D-Star bit order
+  void decode(const int8_t* in, uint8_t* out, uint16_t count);
+
+private:
+  uint32_t m_decisions[(DSTAR_VITERBI_STEPS + 7U) / 8U];
+
+  void acs(const int8_t* in);
+  void traceBack(uint8_t* out, uint16_t count) const;
+};
+
+#endif
+
+#endif
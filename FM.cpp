@@ -61,11 +61,11 @@ m_cosInvert(false),
 m_noiseSquelch(false),
 m_rfAudioBoost(1U),
 m_extAudioBoost(1U),
-m_downSampler(400U),// 100 ms of audio
+m_downSampler(),
 m_extEnabled(false),
 m_rxLevel(1),
-m_inputRFRB(2401U),   // 100ms of audio + 1 sample
-m_outputRFRB(2400U),  // 100ms of audio
+m_inputRFRB(),
+m_outputRFRB(),
 m_inputExtRB(),
 m_rfSignal(false),
 m_extSignal(false)
@@ -340,12 +340,7 @@ void CFM::process()
       length = space;
 
     q15_t samples[FM_TX_BLOCK_SIZE];
-
-    for (uint16_t i = 0U; i < length; i++) {
-      q15_t sample = 0;
-      m_outputRFRB.get(sample);
-      samples[i] = sample;
-    }
+    m_outputRFRB.read(samples, length);
 
     io.write(STATE_FM, samples, length);
   }
@@ -1205,6 +1200,11 @@ uint8_t CFM::getSpace() const
   return m_inputExtRB.getSpace() / FM_SERIAL_BLOCK_SIZE_BYTES;
 }
 
+void CFM::getBufferStats(TRingStats& stats)
+{
+  m_inputExtRB.getBufferStats(stats);
+}
+
 uint8_t CFM::writeData(const uint8_t* data, uint8_t length)
 {
   //todo check if length is a multiple of 3
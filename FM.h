@@ -68,6 +68,8 @@ public:
 
   uint8_t getSpace() const;
 
+  void getBufferStats(TRingStats& stats);
+
   uint8_t writeData(const uint8_t* data, uint8_t length);
 
 private:
@@ -105,8 +107,8 @@ private:
   CFMDownSampler       m_downSampler;
   bool                 m_extEnabled;
   q15_t                m_rxLevel;
-  CRingBuffer<q15_t>   m_inputRFRB;
-  CRingBuffer<q15_t>   m_outputRFRB;
+  CRingBuffer<q15_t, 4096U> m_inputRFRB;     // Holds the 100ms delay + 1 sample
+  CRingBuffer<q15_t, 2048U> m_outputRFRB;    // 85ms of audio
   CFMUpSampler         m_inputExtRB;
   bool                 m_rfSignal;
   bool                 m_extSignal;
@@ -23,8 +23,8 @@
 
 #include "FMDownSampler.h"
 
-CFMDownSampler::CFMDownSampler(uint16_t length) :
-m_ringBuffer(length),
+CFMDownSampler::CFMDownSampler() :
+m_ringBuffer(),
 m_samplePack(0U),
 m_samplePackPointer(NULL),
 m_sampleIndex(0U)
@@ -29,7 +29,7 @@
 
 class CFMDownSampler {
 public:
-  CFMDownSampler(uint16_t length);
+  CFMDownSampler();
 
   void addSample(q15_t sample);
 
@@ -40,7 +40,7 @@ public:
   void reset();
 
 private:
-  CRingBuffer<TSamplePairPack> m_ringBuffer;
+  CRingBuffer<TSamplePairPack, 512U> m_ringBuffer;   // 128ms of audio
   uint32_t                     m_samplePack;
   uint8_t*                     m_samplePackPointer;
   uint8_t                      m_sampleIndex;
@@ -29,7 +29,7 @@ CFMUpSampler::CFMUpSampler() :
 m_upSampleIndex(0),
 m_pack(0U),
 m_packPointer(NULL),
-m_samples(3600U), //300ms of 12 bit 8kHz audio
+m_samples(),
 m_running(false)
 {
   m_packPointer = (uint8_t*)&m_pack;
@@ -100,5 +100,10 @@ uint16_t CFMUpSampler::getSpace() const
   return m_samples.getSpace() * sizeof(TSamplePairPack);
 }
 
+void CFMUpSampler::getBufferStats(TRingStats& stats)
+{
+  m_samples.getStats(stats);
+}
+
 #endif
 
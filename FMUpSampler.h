@@ -40,11 +40,13 @@ public:
 
   uint16_t getSpace() const;
 
+  void getBufferStats(TRingStats& stats);
+
 private:
   uint8_t m_upSampleIndex;
   uint32_t m_pack;
   uint8_t * m_packPointer;
-  CRingBuffer<TSamplePairPack> m_samples;
+  CRingBuffer<TSamplePairPack, 4096U> m_samples;    // 341ms of 12 bit 8kHz audio
   bool m_running;
 };
 
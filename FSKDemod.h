@@ -0,0 +1,484 @@
+/*
+ *   Copyright (C) 2026 by the MMDVM developers
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(FSKDEMOD_H)
+#define  FSKDEMOD_H
+
+#include "Config.h"
+#include "SyncSearch.h"
+#include "SymbolTiming.h"
+#include "Utils.h"
+
+// The part of the 4FSK receivers that works on samples and symbols, leaving each of them only its
+// frames. The newest LENGTH samples are kept for the sync correlation and the symbol timing, and
+// the sync search registers of type SYNC follow them. A sync of SYNC_SYMBOLS symbols is correlated
+// against the samples at the newest one's phase and its bits checked at the current levels, or at
+// those of the sync itself while there are none, the threshold being SCALING in Q15 of its peak.
+// The receiver follows the four symbol levels, each symbol moving the level that it is sliced to
+// by 1/2^TRACK_BITS of the difference, so that the slicer follows a fade within a frame at a
+// constant cost per symbol. With SYNC_LEVELS set only the syncs move the levels, by the same
+// fraction each, as DMR takes them. The sync search and correlation work on the samples less the
+// centre. Until there are levels that is zero, as the DC blocker has taken out the shift that a
+// carrier offset gives the discriminator, or without it the mean of the samples.
+template <typename SYNC, uint16_t LENGTH, uint8_t SPS, uint8_t SYNC_SYMBOLS, q15_t SCALING, uint8_t TRACK_BITS, bool SYNC_LEVELS>
+class CFSKDemod {
+public:
+  CFSKDemod() :
+  m_buffer(),
+  m_ptr(0U),
+  m_search(),
+  m_timing(),
+  m_maxCorr(0),
+  m_levels(),
+  m_frameLevels(),
+  m_centreVal(0),
+  m_thresholdVal(0),
+  m_tracking(false),
+  m_dc(0),
+  m_offsetCentre(0),
+  m_offsetThreshold(0),
+  m_offsetCount(0U),
+  m_syncCentre(0),
+  m_syncThreshold(0)
+  {
+  }
+
+  void reset()
+  {
+    m_search.reset();
+    restart();
+    nextSync();
+
+    m_centreVal    = 0;
+    m_thresholdVal = 0;
+  }
+
+  // Forget the levels and the clock of the last transmission
+  void restart()
+  {
+    m_tracking = false;
+    m_timing.reset();
+
+    m_offsetCentre    = 0;
+    m_offsetThreshold = 0;
+    m_offsetCount     = 0U;
+  }
+
+  // Look afresh for the best sync
+  void nextSync()
+  {
+    m_maxCorr = 0;
+  }
+
+  void add(q15_t sample)
+  {
+    m_ptr++;
+    if (m_ptr >= LENGTH)
+      m_ptr = 0U;
+
+    m_buffer[m_ptr] = sample;
+
+#if !defined(USE_DCBLOCKER)
+    m_dc += ((int32_t(sample) << 8) - m_dc) >> DC_BITS;
+#endif
+
+    m_search.add(sample - searchCentre());
+  }
+
+  // The position of the newest sample
+  uint16_t ptr() const
+  {
+    return m_ptr;
+  }
+
+  const q15_t* buffer() const
+  {
+    return m_buffer;
+  }
+
+  // The position of the first symbol of a sync that ends at the newest sample
+  uint16_t syncStart() const
+  {
+    uint16_t ptr = m_ptr + LENGTH - SYNC_SYMBOLS * SPS + SPS;
+    if (ptr >= LENGTH)
+      ptr -= LENGTH;
+
+    return ptr;
+  }
+
+  // The cheap test, at the newest sample's phase, for whether correlateSync() is worth running
+  uint8_t searchErrors(SYNC pattern, SYNC mask) const
+  {
+    return m_search.errors(pattern, mask);
+  }
+
+  // Whether the sync that ends at the newest sample correlates better with values than any since
+  // nextSync(), with no more than maxErrs of its bits different from bytes under mask, if there is
+  // one, when they are written from offset
+  bool correlateSync(const int8_t* values, const uint8_t* bytes, const uint8_t* mask, uint8_t offset, uint8_t maxErrs)
+  {
+    uint16_t ptr = syncStart();
+
+    q15_t dc = searchCentre();
+
+    q31_t corr = 0;
+    q15_t min =  16000;
+    q15_t max = -16000;
+
+    q15_t symbols[SYNC_SYMBOLS];
+
+    for (uint8_t i = 0U; i < SYNC_SYMBOLS; i++) {
+      q15_t val = m_buffer[ptr];
+      symbols[i] = val;
+
+      if (val > max)
+        max = val;
+      if (val < min)
+        min = val;
+
+      q15_t diff = val - dc;
+
+      switch (values[i]) {
+      case +3:
+        corr -= (diff + diff + diff);
+        break;
+      case +1:
+        corr -= diff;
+        break;
+      case -1:
+        corr += diff;
+        break;
+      default:  // -3
+        corr += (diff + diff + diff);
+        break;
+      }
+
+      ptr += SPS;
+      if (ptr >= LENGTH)
+        ptr -= LENGTH;
+    }
+
+    if (corr <= m_maxCorr)
+      return false;
+
+    q15_t centre = (max + min) >> 1;
+
+    q31_t v1 = (max - centre) * SCALING;
+    q15_t threshold = q15_t(v1 >> 15);
+
+    if (!SYNC_LEVELS) {
+      if (!m_tracking) {
+        m_centreVal    = centre;
+        m_thresholdVal = threshold;
+      }
+
+      centre    = m_centreVal;
+      threshold = m_thresholdVal;
+    }
+
+    uint8_t sync[MAX_SYNC_BYTES];
+    samplesToBits(symbols, SYNC_SYMBOLS, sync, offset, centre, threshold);
+
+    uint8_t length = (offset + SYNC_SYMBOLS * 2U + 7U) / 8U;
+
+    uint8_t errs = 0U;
+    for (uint8_t i = 0U; i < length; i++)
+      errs += countBits8((mask != NULL ? (sync[i] & mask[i]) : sync[i]) ^ bytes[i]);
+
+    if (errs > maxErrs)
+      return false;
+
+    m_maxCorr       = corr;
+    m_syncCentre    = centre;
+    m_syncThreshold = threshold;
+
+    return true;
+  }
+
+  // Slice the symbols into bits from offset, following the levels from one symbol to the next,
+  // starting from those of the sync if this is the first frame
+  void trackLevels(const q15_t* symbols, uint16_t count, uint8_t* buffer, uint16_t offset)
+  {
+    if (!m_tracking) {
+      setLevels(m_levels, m_centreVal, m_thresholdVal);
+      getLevels(m_levels, m_centreVal, m_thresholdVal);
+      m_tracking = true;
+    }
+
+    for (uint8_t i = 0U; i < 4U; i++)
+      m_frameLevels[i] = m_levels[i];
+
+    for (uint16_t i = 0U; i < count; i++, offset += 2U) {
+      uint8_t dibit = track(m_levels, symbols[i], m_centreVal, m_thresholdVal);
+
+      uint8_t shift = 6U - (offset & 7U);
+      buffer[offset >> 3] = (buffer[offset >> 3] & ~(0x03U << shift)) | (dibit << shift);
+    }
+  }
+
+  // Move the levels towards those of the last sync found
+  void addSyncLevels()
+  {
+    int32_t levels[4U];
+    setLevels(levels, m_syncCentre, m_syncThreshold);
+
+    if (!m_tracking) {
+      for (uint8_t i = 0U; i < 4U; i++)
+        m_levels[i] = levels[i];
+
+      m_tracking = true;
+    } else {
+      for (uint8_t i = 0U; i < 4U; i++)
+        m_levels[i] += (levels[i] - m_levels[i]) >> TRACK_BITS;
+    }
+
+    getLevels(m_levels, m_centreVal, m_thresholdVal);
+  }
+
+  // The tracked levels of the outer symbols, +3 and -3
+  q15_t posLevel() const
+  {
+    return q15_t(m_levels[3U] >> 8);
+  }
+
+  q15_t negLevel() const
+  {
+    return q15_t(m_levels[0U] >> 8);
+  }
+
+  q15_t centre() const
+  {
+    return m_centreVal;
+  }
+
+  q15_t threshold() const
+  {
+    return m_thresholdVal;
+  }
+
+  // Add the levels at a good sync to the carrier offset measurement, with the DC that was taken out
+  // before the receiver
+  void measureOffset(q15_t dc)
+  {
+    // Keep the sums in range, the older frames counting for less
+    if (m_offsetCount >= MAX_OFFSET_FRAMES) {
+      m_offsetCentre    >>= 1;
+      m_offsetThreshold >>= 1;
+      m_offsetCount     >>= 1;
+    }
+
+    m_offsetCentre    += int32_t(m_centreVal) + int32_t(dc);
+    m_offsetThreshold += m_thresholdVal;
+    m_offsetCount++;
+  }
+
+  // The carrier offset in Hz since restart(), from the centre against the threshold, which is two
+  // thirds of the deviation of the outer symbols, or NO_OFFSET if there weren't enough syncs to
+  // measure it
+  int16_t offset(uint16_t deviation) const
+  {
+    if (m_offsetCount < MIN_OFFSET_FRAMES || m_offsetThreshold <= 0)
+      return NO_OFFSET;
+
+    int64_t offset = (int64_t(m_offsetCentre) * int64_t(deviation) * 2) / (3 * int64_t(m_offsetThreshold));
+    if (offset > 32767)
+      return 32767;
+    else if (offset < -32767)
+      return -32767;
+    else
+      return int16_t(offset);
+  }
+
+  // Go back to the sampling phase of the sync
+  void resync()
+  {
+    m_timing.resync();
+  }
+
+  // Take count symbols from start, reading none of the samples after the first available
+  void extract(uint16_t start, uint16_t available, q15_t* symbols, uint16_t count)
+  {
+    m_timing.extract(m_buffer, start, available, symbols, count, m_centreVal, m_thresholdVal);
+  }
+
+  // The whole samples that the extracted symbols have moved by
+  int8_t slip()
+  {
+    return m_timing.slip();
+  }
+
+  // Look for the next sync from where the last was to where the transmitter's clock has taken it
+  void syncWindow(uint16_t syncPtr, uint16_t& minPtr, uint16_t& maxPtr)
+  {
+    int8_t slip = m_timing.slip();
+
+    minPtr = move(syncPtr, (slip < 0 ? slip : 0) - 1);
+    maxPtr = move(syncPtr, (slip > 0 ? slip : 0) + 1);
+  }
+
+  static bool inWindow(uint16_t ptr, uint16_t minPtr, uint16_t maxPtr)
+  {
+    if (minPtr < maxPtr)
+      return ptr >= minPtr && ptr <= maxPtr;
+    else
+      return ptr >= minPtr || ptr <= maxPtr;
+  }
+
+  static uint16_t move(uint16_t ptr, int8_t samples)
+  {
+    return CSymbolTiming<LENGTH, SPS>::move(ptr, samples);
+  }
+
+  void samplesToBits(const q15_t* symbols, uint16_t count, uint8_t* buffer, uint16_t offset) const
+  {
+    samplesToBits(symbols, count, buffer, offset, m_centreVal, m_thresholdVal);
+  }
+
+  // Two symbols to each byte, the first in the high nibble. Unless the levels come from the syncs,
+  // the symbols are those last given to trackLevels(), and its tracking is repeated so that they
+  // are at the same levels as their bits.
+  void samplesToSoft(const q15_t* symbols, uint16_t count, uint8_t* buffer) const
+  {
+    int32_t levels[4U];
+    for (uint8_t i = 0U; i < 4U; i++)
+      levels[i] = m_frameLevels[i];
+
+    q15_t centre    = m_centreVal;
+    q15_t threshold = m_thresholdVal;
+    if (!SYNC_LEVELS)
+      getLevels(levels, centre, threshold);
+
+    for (uint16_t i = 0U; i < count; i++) {
+      q15_t sample = symbols[i];
+
+      uint8_t soft = softSymbol(sample - centre, threshold);
+      if (!SYNC_LEVELS)
+        track(levels, sample, centre, threshold);
+
+      if ((i & 1U) == 0U)
+        buffer[i / 2U] = soft << 4;
+      else
+        buffer[i / 2U] |= soft;
+    }
+  }
+
+  // Outside of the range that offset() clips to
+  static const int16_t NO_OFFSET = -32768;
+
+private:
+  // The mean of the samples over about 2^DC_BITS of them
+  static const uint8_t  DC_BITS = 9U;
+  static const uint16_t MAX_OFFSET_FRAMES = 256U;
+  // A single sync may have been found in the noise, with levels that mean nothing
+  static const uint16_t MIN_OFFSET_FRAMES = 2U;
+  // With the sync's bits written from an offset of up to half a byte
+  static const uint8_t MAX_SYNC_BYTES = (SYNC_SYMBOLS * 2U + 4U + 7U) / 8U;
+
+  q15_t    m_buffer[LENGTH];
+  uint16_t m_ptr;
+  CSyncSearch<SYNC, SPS>    m_search;
+  CSymbolTiming<LENGTH, SPS> m_timing;
+  q31_t    m_maxCorr;
+  int32_t  m_levels[4U];         // -3, -1, +1 and +3, in 1/256 of a Q15 unit
+  int32_t  m_frameLevels[4U];    // As they were at the start of the last frame
+  q15_t    m_centreVal;
+  q15_t    m_thresholdVal;
+  bool     m_tracking;
+  int32_t  m_dc;                 // In 1/256 of a Q15 unit
+  int32_t  m_offsetCentre;
+  int32_t  m_offsetThreshold;
+  uint16_t m_offsetCount;
+  q15_t    m_syncCentre;
+  q15_t    m_syncThreshold;
+
+  q15_t searchCentre() const
+  {
+    if (m_tracking)
+      return m_centreVal;
+
+#if defined(USE_DCBLOCKER)
+    return 0;
+#else
+    return q15_t(m_dc >> 8);
+#endif
+  }
+
+  // The threshold is half way between the inner and outer levels
+  static void setLevels(int32_t* levels, q15_t centre, q15_t threshold)
+  {
+    int32_t c = int32_t(centre) << 8;
+    int32_t t = int32_t(threshold) << 7;
+
+    levels[0U] = c - 3 * t;
+    levels[1U] = c - t;
+    levels[2U] = c + t;
+    levels[3U] = c + 3 * t;
+  }
+
+  static void getLevels(const int32_t* levels, q15_t& centre, q15_t& threshold)
+  {
+    int32_t pos = (levels[2U] + levels[3U]) >> 1;
+    int32_t neg = (levels[0U] + levels[1U]) >> 1;
+
+    int32_t c = (pos + neg) >> 1;
+
+    centre    = q15_t(c >> 8);
+    threshold = q15_t((pos - c) >> 8);
+  }
+
+  // Slice a symbol, and move the level that it is sliced to towards it
+  static uint8_t track(int32_t* levels, q15_t sample, q15_t& centre, q15_t& threshold)
+  {
+    uint8_t dibit = slice(sample - centre, threshold);
+
+    // The levels in order from the dibits
+    static const uint8_t LEVEL[] = {1U, 0U, 2U, 3U};
+
+    int32_t& level = levels[LEVEL[dibit]];
+    level += ((int32_t(sample) << 8) - level) >> TRACK_BITS;
+
+    getLevels(levels, centre, threshold);
+
+    return dibit;
+  }
+
+  static uint8_t slice(q15_t sample, q15_t threshold)
+  {
+    if (sample < -threshold)
+      return 0x01U;
+    else if (sample < 0)
+      return 0x00U;
+    else if (sample < threshold)
+      return 0x02U;
+    else
+      return 0x03U;
+  }
+
+  // The offset is always even, so each symbol's two bits are in the same byte
+  static void samplesToBits(const q15_t* symbols, uint16_t count, uint8_t* buffer, uint16_t offset, q15_t centre, q15_t threshold)
+  {
+    for (uint16_t i = 0U; i < count; i++, offset += 2U) {
+      uint8_t dibit = slice(symbols[i] - centre, threshold);
+
+      uint8_t shift = 6U - (offset & 7U);
+      buffer[offset >> 3] = (buffer[offset >> 3] & ~(0x03U << shift)) | (dibit << shift);
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,226 @@
+/*
+ *   Copyright (C) 2026 by the MMDVM developers
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(FSKMOD_H)
+#define  FSKMOD_H
+
+#include "Config.h"
+
+// The pulse shaping of the 4FSK transmitters. The shaping filter spans SYMBOLS symbols, so the SPS
+// samples of a symbol depend only on it and the SYMBOLS - 1 symbols before it, and the waveform
+// that each pair of those symbols adds to them is worked out beforehand for the sixteen values of
+// the pair. A sample is then the sum of one table entry for each pair rather than a multiply for
+// each filter tap. The entries are kept before the final shift, so that with the interpolation
+// filter alone the samples are the same as those of arm_fir_interpolate_q15. A FIR filter after
+// it, as P25 and NXDN have, is folded into the waveforms, which are then within two of the two
+// filters run in turn, the difference being the truncation that the first does. Silence is a
+// zero level, which has no entries, and the few symbols with both silence and data in the
+// filter's span are summed one symbol at a time.
+//
+// The tables are in RAM, as they are worked out from the filter coefficients and levels when a
+// transmitter is set up, and YSF changes its levels with its deviation. The host and Arduino Due
+// builds are C++11, which can't build them at compile time, and a copy made beforehand would
+// have to be kept in step with the filters by hand. Since the levels of every
+// mode are symmetric about zero, a pair of symbols has the negative of the waveform of the pair
+// with both signs changed, so only the eight pairs with the older symbol negative are kept. That
+// is 6.4 KB for all of the modes.
+template <uint8_t SPS, uint8_t SYMBOLS>
+class CFSKMod {
+  // A window of symbols is taken from the bottom 32 bits of the dibits added
+  static_assert(SYMBOLS >= 1U && SYMBOLS <= 16U, "The filter can span at most sixteen symbols");
+
+public:
+  CFSKMod() :
+  m_coeffs(NULL),
+  m_taps(0U),
+  m_postCoeffs(NULL),
+  m_postTaps(0U),
+  m_levels(),
+  m_symbols(0U),
+  m_silent(WINDOW),
+  m_table()
+  {
+  }
+
+  // The coefficients of the interpolation filter in the order that arm_fir_interpolate_q15 takes
+  // them, and those of a FIR filter after it if there is one, in the order of arm_fir_fast_q15
+  void setFilter(const q15_t* coeffs, uint16_t taps, const q15_t* postCoeffs = NULL, uint16_t postTaps = 0U)
+  {
+    m_coeffs     = coeffs;
+    m_taps       = taps;
+    m_postCoeffs = postCoeffs;
+    m_postTaps   = postTaps;
+  }
+
+  // The levels of the +3 and +1 symbols, the -3 and -1 symbols being their negatives, after the
+  // filter has been set
+  void setLevels(q15_t a, q15_t b)
+  {
+    // By dibit, 00 being -1, 01 -3, 10 +1 and 11 +3
+    m_levels[0U] = -b;
+    m_levels[1U] = -a;
+    m_levels[2U] = b;
+    m_levels[3U] = a;
+
+    for (uint8_t i = 0U; i < PAIRS; i++) {
+      for (uint8_t pair = 0U; pair < HALF_PAIRS; pair++) {
+        for (uint8_t j = 0U; j < SPS; j++)
+          m_table[i][pair][j] = waveform(i * 2U, pair & 0x03U, j) + waveform(i * 2U + 1U, pair >> 2, j);
+      }
+    }
+  }
+
+  // The samples of the four symbols added last
+  static const uint16_t SAMPLES = 4U * SPS;
+
+  // The four symbols of a byte, the first in the top two bits
+  void addByte(uint8_t c)
+  {
+    for (uint8_t i = 0U; i < 4U; i++, c <<= 2) {
+      m_symbols = (m_symbols << 2) | ((c >> 6) & 0x03U);
+      m_silent <<= 1;
+    }
+  }
+
+  // Four symbols of silence
+  void addSilence()
+  {
+    m_symbols <<= 8;
+    m_silent = (m_silent << 4) | 0x0FU;
+  }
+
+  // The samples as they are before the TX level
+  void getSamples(q15_t* samples) const
+  {
+    int32_t sums[SPS];
+
+    for (uint8_t i = 0U; i < 4U; i++, samples += SPS) {
+      getSums(3U - i, sums);
+
+      for (uint8_t j = 0U; j < SPS; j++)
+        samples[j] = q15_t(__SSAT(sums[j] >> 15, 16));
+    }
+  }
+
+  // The samples as the DAC takes them, scaled by level and moved by offset as CIO::write() does,
+  // straight into the entries of the TX buffer with the control marker. Returns how many are out
+  // of the DAC's range.
+  template <typename ENTRY>
+  uint16_t getSamples(ENTRY* entries, q15_t level, uint16_t offset, uint8_t control) const
+  {
+    int32_t sums[SPS];
+    uint16_t overflows = 0U;
+
+    for (uint8_t i = 0U; i < 4U; i++, entries += SPS) {
+      getSums(3U - i, sums);
+
+      for (uint8_t j = 0U; j < SPS; j++) {
+        q15_t sample = q15_t(__SSAT(sums[j] >> 15, 16));
+        q31_t scaled = sample * level;
+        uint16_t dac = uint16_t(q15_t(__SSAT((scaled >> 15), 16)) + offset);
+
+        if (dac > 4095U)
+          overflows++;
+
+        entries[j].sample  = dac;
+        entries[j].control = control;
+      }
+    }
+
+    return overflows;
+  }
+
+private:
+  static const uint8_t  PAIRS  = (SYMBOLS + 1U) / 2U;
+  static const uint8_t  HALF_PAIRS = 8U;          // The pairs with the older symbol negative
+  static const uint8_t  NEGATE     = 0x0AU;       // Changes the sign of both symbols of a pair
+  static const uint32_t WINDOW = (1U << SYMBOLS) - 1U;
+
+  const q15_t* m_coeffs;
+  uint16_t     m_taps;
+  const q15_t* m_postCoeffs;
+  uint16_t     m_postTaps;
+  q15_t        m_levels[4U];
+  uint64_t     m_symbols;             // The dibits added, the newest in the bottom two bits
+  uint32_t     m_silent;              // The symbols of silence, the newest in the bottom bit
+  int32_t      m_table[PAIRS][HALF_PAIRS][SPS];
+
+  // The sums for the samples of the symbol added age symbols before the last, before the shift
+  void getSums(uint8_t age, int32_t* sums) const
+  {
+    uint32_t symbols = uint32_t(m_symbols >> (age * 2U));
+    uint32_t silent  = (m_silent >> age) & WINDOW;
+
+    for (uint8_t j = 0U; j < SPS; j++)
+      sums[j] = 0;
+
+    if (silent == 0U) {
+      for (uint8_t i = 0U; i < PAIRS; i++, symbols >>= 4) {
+        uint8_t pair = symbols & 0x0FU;
+        if (pair < HALF_PAIRS) {
+          const int32_t* wave = m_table[i][pair];
+          for (uint8_t j = 0U; j < SPS; j++)
+            sums[j] += wave[j];
+        } else {
+          const int32_t* wave = m_table[i][pair ^ NEGATE];
+          for (uint8_t j = 0U; j < SPS; j++)
+            sums[j] -= wave[j];
+        }
+      }
+    } else if (silent != WINDOW) {
+      for (uint8_t n = 0U; n < SYMBOLS; n++) {
+        if ((silent & (1U << n)) == 0U) {
+          for (uint8_t j = 0U; j < SPS; j++)
+            sums[j] += waveform(n, (symbols >> (n * 2U)) & 0x03U, j);
+        }
+      }
+    }
+  }
+
+  // What a symbol n symbols before the newest adds to the newest's sample j, before the shift
+  int32_t waveform(uint8_t n, uint8_t dibit, uint8_t j) const
+  {
+    if (n >= SYMBOLS)
+      return 0;
+
+    int64_t value = response(uint16_t(n) * SPS + j) * m_levels[dibit];
+
+    return int32_t((value + 16384) >> 15);
+  }
+
+  // The impulse response of the filters m samples after the symbol, in Q30
+  int64_t response(uint16_t m) const
+  {
+    if (m_postTaps == 0U)
+      return interpolation(m) * 32768;
+
+    int64_t value = 0;
+    for (uint16_t k = 0U; k < m_postTaps && k <= m; k++)
+      value += int64_t(m_postCoeffs[m_postTaps - 1U - k]) * interpolation(m - k);
+
+    return value;
+  }
+
+  // arm_fir_interpolate_q15 takes its coefficients reversed
+  int64_t interpolation(uint16_t m) const
+  {
+    return m < m_taps ? int64_t(m_coeffs[m_taps - 1U - m]) : 0;
+  }
+};
+
+#endif
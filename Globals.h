@@ -23,6 +23,10 @@
 #include "stm32f4xx.h"
 #elif defined(STM32F7XX)
 #include "stm32f7xx.h"
+#elif defined(HOST_BUILD)
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
 #elif defined(STM32F105xC)
 #include "stm32f1xx.h"
 #include "STM32Utils.h"
@@ -37,7 +41,7 @@
 #define  ARM_MATH_CM7
 #elif defined(STM32F4XX) || defined(__MK20DX256__) || defined(__MK64FX512__) || defined(__MK66FX1M0__)
 #define  ARM_MATH_CM4
-#else
+#elif !defined(HOST_BUILD)
 #error "Unknown processor type"
 #endif
 
@@ -76,6 +80,33 @@ enum MMDVM_STATE {
   STATE_M17CAL    = 108
 };
 
+const uint8_t  MARK_SLOT1 = 0x08U;
+const uint8_t  MARK_SLOT2 = 0x04U;
+const uint8_t  MARK_NONE  = 0x00U;
+
+// The number of samples passed through the receive filters and demodulators at a time,
+// set in Config.h. Larger blocks cost less per sample but add latency.
+#if !defined(RX_BLOCK_SIZE)
+#define RX_BLOCK_SIZE 2U
+#endif
+
+#if RX_BLOCK_SIZE > 255
+#error "RX_BLOCK_SIZE must fit in a uint8_t"
+#endif
+
+// The number of samples in each half of the ADC and DAC DMA buffers, 1ms
+const uint16_t IO_BLOCK_SIZE = 24U;
+
+// The ring buffer lengths must be powers of two
+const uint16_t TX_RINGBUFFER_SIZE = 512U;
+const uint16_t RX_RINGBUFFER_SIZE = 512U;
+
+#if defined(STM32F105xC) || defined(__MK20DX256__)
+const uint16_t TX_BUFFER_LEN = 2048U;
+#else
+const uint16_t TX_BUFFER_LEN = 4096U;
+#endif
+
 #include "SerialPort.h"
 #include "DMRIdleRX.h"
 #include "DMRDMORX.h"
@@ -106,24 +137,10 @@ enum MMDVM_STATE {
 #include "AX25TX.h"
 #include "CalM17.h"
 #include "Debug.h"
+#include "Profiler.h"
 #include "IO.h"
 #include "FM.h"
 
-const uint8_t  MARK_SLOT1 = 0x08U;
-const uint8_t  MARK_SLOT2 = 0x04U;
-const uint8_t  MARK_NONE  = 0x00U;
-
-const uint16_t RX_BLOCK_SIZE = 2U;
-
-const uint16_t TX_RINGBUFFER_SIZE = 500U;
-const uint16_t RX_RINGBUFFER_SIZE = 600U;
-
-#if defined(STM32F105xC) || defined(__MK20DX256__)
-const uint16_t TX_BUFFER_LEN = 2000U;
-#else
-const uint16_t TX_BUFFER_LEN = 4000U;
-#endif
-
 extern MMDVM_STATE m_modemState;
 
 extern bool m_dstarEnable;
@@ -144,6 +161,10 @@ extern bool m_dcd;
 extern CSerialPort serial;
 extern CIO io;
 
+#if defined(USE_PROFILER)
+extern CProfiler profiler;
+#endif
+
 #if defined(MODE_DSTAR)
 extern CDStarRX dstarRX;
 extern CDStarTX dstarTX;
@@ -26,6 +26,10 @@
 // Generated using [b, a] = butter(1, 0.001) in MATLAB
 static q31_t   DC_FILTER[] = {3367972, 0, 3367972, 0, 2140747704, 0}; // {b0, 0, b1, b2, -a1, -a2}
 const uint32_t DC_FILTER_STAGES = 1U; // One Biquad stage
+
+// The DC level given to the receivers for their carrier offsets is averaged over 256 samples, so that
+// it doesn't carry the swing of the sync that they take it at
+const uint8_t DC_MEAN_SHIFT = 8U;
 #endif
 
 #if defined(MODE_DMR) || defined(MODE_YSF)
@@ -78,11 +82,33 @@ const uint16_t BOXCAR5_FILTER_LEN = 6U;
 
 const uint16_t DC_OFFSET = 2048U;
 
+// Samples are scaled into a block on the stack and then added to the TX ring with one call
+const uint16_t TX_WRITE_BLOCK_SIZE = 40U;
+
+#if defined(USE_DCBLOCKER)
+// The gain of a filter at DC in Q15
+static q31_t filterGain(const q15_t* taps, uint16_t length)
+{
+  q31_t gain = 0;
+  for (uint16_t i = 0U; i < length; i++)
+    gain += taps[i];
+
+  return gain;
+}
+#endif
+
 CIO::CIO() :
 m_started(false),
-m_rxBuffer(RX_RINGBUFFER_SIZE),
-m_txBuffer(TX_RINGBUFFER_SIZE),
-m_rssiBuffer(RX_RINGBUFFER_SIZE),
+m_rxBuffer(),
+m_txBuffer(),
+#if defined(USE_ACTIVITY_GATE)
+m_activity(),
+m_holdSamples(),
+m_holdRSSI(),
+#if defined(USE_DCBLOCKER) && defined(MODE_DMR)
+m_holdRawSamples(),
+#endif
+#endif
 #if defined(USE_DCBLOCKER)
 m_dcFilter(),
 m_dcState(),
@@ -91,13 +117,13 @@ m_dcState(),
 m_gaussianFilter(),
 m_gaussianState(),
 #endif
-#if defined(MODE_DMR)
-m_rrc02Filter1(),
-m_rrc02State1(),
+#if defined(MODE_DMR) || defined(MODE_YSF)
+m_rrc02Filter(),
+m_rrc02State(),
 #endif
-#if defined(MODE_YSF)
-m_rrc02Filter2(),
-m_rrc02State2(),
+#if defined(RRC02_SPLIT)
+m_rrc02YSFFilter(),
+m_rrc02YSFState(),
 #endif
 #if defined(MODE_P25)
 m_boxcar5Filter(),
@@ -132,6 +158,7 @@ m_fmTXLevel(128 * 128),
 m_ax25TXLevel(128 * 128),
 m_rxDCOffset(DC_OFFSET),
 m_txDCOffset(DC_OFFSET),
+m_dcMean(0),
 m_useCOSAsLockout(false),
 m_ledCount(0U),
 m_ledValue(true),
@@ -139,6 +166,9 @@ m_detect(false),
 m_adcOverflow(0U),
 m_dacOverflow(0U),
 m_watchdog(0U),
+m_blockControl(),
+m_blockIndex(0U),
+m_blockTX(0U),
 m_lockout(false)
 {
 #if defined(USE_DCBLOCKER)
@@ -150,28 +180,28 @@ m_lockout(false)
 #endif
 
 #if defined(MODE_DSTAR)
-  ::memset(m_gaussianState, 0x00U, 40U * sizeof(q15_t));
+  ::memset(m_gaussianState, 0x00U, sizeof(m_gaussianState));
   m_gaussianFilter.numTaps = GAUSSIAN_0_5_FILTER_LEN;
   m_gaussianFilter.pState  = m_gaussianState;
   m_gaussianFilter.pCoeffs = GAUSSIAN_0_5_FILTER;
 #endif
 
-#if defined(MODE_DMR)
-  ::memset(m_rrc02State1, 0x00U, 70U * sizeof(q15_t));
-  m_rrc02Filter1.numTaps = RRC_0_2_FILTER_LEN;
-  m_rrc02Filter1.pState  = m_rrc02State1;
-  m_rrc02Filter1.pCoeffs = RRC_0_2_FILTER;
+#if defined(MODE_DMR) || defined(MODE_YSF)
+  ::memset(m_rrc02State, 0x00U, sizeof(m_rrc02State));
+  m_rrc02Filter.numTaps = RRC_0_2_FILTER_LEN;
+  m_rrc02Filter.pState  = m_rrc02State;
+  m_rrc02Filter.pCoeffs = RRC_0_2_FILTER;
 #endif
 
-#if defined(MODE_YSF)
-  ::memset(m_rrc02State2, 0x00U, 70U * sizeof(q15_t));
-  m_rrc02Filter2.numTaps = RRC_0_2_FILTER_LEN;
-  m_rrc02Filter2.pState  = m_rrc02State2;
-  m_rrc02Filter2.pCoeffs = RRC_0_2_FILTER;
+#if defined(RRC02_SPLIT)
+  ::memset(m_rrc02YSFState, 0x00U, sizeof(m_rrc02YSFState));
+  m_rrc02YSFFilter.numTaps = RRC_0_2_FILTER_LEN;
+  m_rrc02YSFFilter.pState  = m_rrc02YSFState;
+  m_rrc02YSFFilter.pCoeffs = RRC_0_2_FILTER;
 #endif
 
 #if defined(MODE_P25)
-  ::memset(m_boxcar5State, 0x00U, 30U * sizeof(q15_t));
+  ::memset(m_boxcar5State, 0x00U, sizeof(m_boxcar5State));
   m_boxcar5Filter.numTaps = BOXCAR5_FILTER_LEN;
   m_boxcar5Filter.pState  = m_boxcar5State;
   m_boxcar5Filter.pCoeffs = BOXCAR5_FILTER;
@@ -179,13 +209,13 @@ m_lockout(false)
 
 #if defined(MODE_NXDN)
 #if defined(USE_NXDN_BOXCAR)
-  ::memset(m_boxcar10State, 0x00U, 40U * sizeof(q15_t));
+  ::memset(m_boxcar10State, 0x00U, sizeof(m_boxcar10State));
   m_boxcar10Filter.numTaps = BOXCAR10_FILTER_LEN;
   m_boxcar10Filter.pState  = m_boxcar10State;
   m_boxcar10Filter.pCoeffs = BOXCAR10_FILTER;
 #else
-  ::memset(m_nxdnState,      0x00U, 110U * sizeof(q15_t));
-  ::memset(m_nxdnISincState, 0x00U, 60U * sizeof(q15_t));
+  ::memset(m_nxdnState,      0x00U, sizeof(m_nxdnState));
+  ::memset(m_nxdnISincState, 0x00U, sizeof(m_nxdnISincState));
 
   m_nxdnFilter.numTaps = NXDN_0_2_FILTER_LEN;
   m_nxdnFilter.pState  = m_nxdnState;
@@ -198,7 +228,7 @@ m_lockout(false)
 #endif
 
 #if defined(MODE_M17)
-  ::memset(m_rrc05State, 0x00U, 70U * sizeof(q15_t));
+  ::memset(m_rrc05State, 0x00U, sizeof(m_rrc05State));
   m_rrc05Filter.numTaps = RRC_0_5_FILTER_LEN;
   m_rrc05Filter.pState  = m_rrc05State;
   m_rrc05Filter.pCoeffs = RRC_0_5_FILTER;
@@ -371,28 +401,30 @@ void CIO::process()
     m_lockout = getCOSInt();
 
   // Switch off the transmitter if needed
-  if (m_txBuffer.getData() == 0U && m_tx) {
+  if (m_txBuffer.getData() == 0U && m_blockTX == 0U && m_tx) {
     m_tx = false;
     setPTTInt(m_pttInvert ? true : false);
     DEBUG1("TX OFF");
   }
 
   if (m_rxBuffer.getData() >= RX_BLOCK_SIZE) {
-    q15_t    samples[RX_BLOCK_SIZE];
-    uint8_t  control[RX_BLOCK_SIZE];
-    uint16_t rssi[RX_BLOCK_SIZE];
+    TRXSample block[RX_BLOCK_SIZE];
+    q15_t     samples[RX_BLOCK_SIZE];
+    uint8_t   control[RX_BLOCK_SIZE];
+    uint16_t  rssi[RX_BLOCK_SIZE];
+
+    m_rxBuffer.read(block, RX_BLOCK_SIZE);
 
     for (uint16_t i = 0U; i < RX_BLOCK_SIZE; i++) {
-      TSample sample;
-      m_rxBuffer.get(sample);
-      control[i] = sample.control;
-      m_rssiBuffer.get(rssi[i]);
+      uint16_t sample = block[i] & 0x0FFFU;
+      rssi[i]    = (block[i] >> 12) & 0x0FFFU;
+      control[i] = block[i] >> 24;
 
       // Detect ADC overflow
-      if (m_detect && (sample.sample == 0U || sample.sample == 4095U))
+      if (m_detect && (sample == 0U || sample == 4095U))
         m_adcOverflow++;
 
-      q15_t res1 = q15_t(sample.sample) - m_rxDCOffset;
+      q15_t res1 = q15_t(sample) - m_rxDCOffset;
       q31_t res2 = res1 * m_rxLevel;
       samples[i] = q15_t(__SSAT((res2 >> 15), 16));
     }
@@ -401,114 +433,89 @@ void CIO::process()
       return;
 
 #if defined(USE_DCBLOCKER)
+    PROFILE_START(dcStart);
+
     q31_t q31Samples[RX_BLOCK_SIZE];
     ::arm_q15_to_q31(samples, q31Samples, RX_BLOCK_SIZE);
 
     q31_t dcValues[RX_BLOCK_SIZE];
     ::arm_biquad_cascade_df1_q31(&m_dcFilter, q31Samples, dcValues, RX_BLOCK_SIZE);
 
-    q31_t dcLevel = 0;
-    for (uint8_t i = 0U; i < RX_BLOCK_SIZE; i++)
+    q63_t dcLevel = 0;
+    for (uint8_t i = 0U; i < RX_BLOCK_SIZE; i++) {
       dcLevel += dcValues[i];
+      m_dcMean += (dcValues[i] >> DC_MEAN_SHIFT) - (m_dcMean >> DC_MEAN_SHIFT);
+    }
     dcLevel /= RX_BLOCK_SIZE;
 
-    q15_t offset = q15_t(__SSAT((dcLevel >> 16), 16));;
+    q15_t offset = q15_t(__SSAT(q31_t(dcLevel >> 16), 16));
 
     q15_t dcSamples[RX_BLOCK_SIZE];
     for (uint8_t i = 0U; i < RX_BLOCK_SIZE; i++)
       dcSamples[i] = samples[i] - offset;
-#endif
-
-    if (m_modemState == STATE_IDLE) {
-#if defined(MODE_DSTAR)
-      if (m_dstarEnable) {
-        q15_t GMSKVals[RX_BLOCK_SIZE];
-#if defined(USE_DCBLOCKER)
-        ::arm_fir_fast_q15(&m_gaussianFilter, dcSamples, GMSKVals, RX_BLOCK_SIZE);
-#else
-        ::arm_fir_fast_q15(&m_gaussianFilter, samples, GMSKVals, RX_BLOCK_SIZE);
-#endif
-        dstarRX.samples(GMSKVals, rssi, RX_BLOCK_SIZE);
-      }
-#endif
 
-#if defined(MODE_P25)
-      if (m_p25Enable) {
-        q15_t P25Vals[RX_BLOCK_SIZE];
-#if defined(USE_DCBLOCKER)
-        ::arm_fir_fast_q15(&m_boxcar5Filter, dcSamples, P25Vals, RX_BLOCK_SIZE);
-#else
-        ::arm_fir_fast_q15(&m_boxcar5Filter, samples, P25Vals, RX_BLOCK_SIZE);
-#endif
-        p25RX.samples(P25Vals, rssi, RX_BLOCK_SIZE);
-      }
+    PROFILE_STOP(PROFILE_DC_BLOCKER, dcStart);
 #endif
 
-#if defined(MODE_NXDN)
-      if (m_nxdnEnable) {
-        q15_t NXDNVals[RX_BLOCK_SIZE];
-#if defined(USE_NXDN_BOXCAR)
+    if (m_modemState == STATE_IDLE) {
 #if defined(USE_DCBLOCKER)
-        ::arm_fir_fast_q15(&m_boxcar10Filter, dcSamples, NXDNVals, RX_BLOCK_SIZE);
-#else
-        ::arm_fir_fast_q15(&m_boxcar10Filter, samples, NXDNVals, RX_BLOCK_SIZE);
-#endif
+      q15_t* input = dcSamples;
 #else
-        q15_t NXDNValsTmp[RX_BLOCK_SIZE];
-#if defined(USE_DCBLOCKER)
-        ::arm_fir_fast_q15(&m_nxdnFilter, dcSamples, NXDNValsTmp, RX_BLOCK_SIZE);
+      q15_t* input = samples;
+#endif
+
+#if defined(USE_ACTIVITY_GATE)
+      bool wasActive = m_activity.isActive();
+
+      bool active;
+      PROFILE(PROFILE_ACTIVITY, active = m_activity.process(input, RX_BLOCK_SIZE, m_dcd));
+
+      if (active) {
+        // Catch up on what was held back while the channel was empty, so that no preamble is lost
+        if (!wasActive) {
+          while (m_holdSamples.getData() >= RX_BLOCK_SIZE) {
+            q15_t    heldSamples[RX_BLOCK_SIZE];
+            uint16_t heldRSSI[RX_BLOCK_SIZE];
+            m_holdSamples.read(heldSamples, RX_BLOCK_SIZE);
+            m_holdRSSI.read(heldRSSI, RX_BLOCK_SIZE);
+#if defined(USE_DCBLOCKER) && defined(MODE_DMR)
+            q15_t    heldRawSamples[RX_BLOCK_SIZE];
+            m_holdRawSamples.read(heldRawSamples, RX_BLOCK_SIZE);
+            idleSamples(heldSamples, heldRawSamples, heldRSSI);
 #else
-        ::arm_fir_fast_q15(&m_nxdnFilter, samples, NXDNValsTmp, RX_BLOCK_SIZE);
-#endif
-        ::arm_fir_fast_q15(&m_nxdnISincFilter, NXDNValsTmp, NXDNVals, RX_BLOCK_SIZE);
+            idleSamples(heldSamples, heldSamples, heldRSSI);
 #endif
-        nxdnRX.samples(NXDNVals, rssi, RX_BLOCK_SIZE);
-      }
-#endif
-
-#if defined(MODE_DMR)
-      if (m_dmrEnable) {
-        q15_t DMRVals[RX_BLOCK_SIZE];
-        ::arm_fir_fast_q15(&m_rrc02Filter1, samples, DMRVals, RX_BLOCK_SIZE);
+          }
+        }
 
-        if (m_duplex)
-          dmrIdleRX.samples(DMRVals, RX_BLOCK_SIZE);
-        else
-          dmrDMORX.samples(DMRVals, rssi, RX_BLOCK_SIZE);
-      }
+        idleSamples(input, samples, rssi);
+      } else {
+        // Keep the most recent samples
+        if (m_holdSamples.getSpace() < RX_BLOCK_SIZE) {
+          m_holdSamples.consume(RX_BLOCK_SIZE);
+          m_holdRSSI.consume(RX_BLOCK_SIZE);
+#if defined(USE_DCBLOCKER) && defined(MODE_DMR)
+          m_holdRawSamples.consume(RX_BLOCK_SIZE);
 #endif
+        }
 
-#if defined(MODE_YSF)
-      if (m_ysfEnable) {
-        q15_t YSFVals[RX_BLOCK_SIZE];
-#if defined(USE_DCBLOCKER)
-        ::arm_fir_fast_q15(&m_rrc02Filter2, dcSamples, YSFVals, RX_BLOCK_SIZE);
-#else
-        ::arm_fir_fast_q15(&m_rrc02Filter2, samples, YSFVals, RX_BLOCK_SIZE);
+        m_holdSamples.write(input, RX_BLOCK_SIZE);
+        m_holdRSSI.write(rssi, RX_BLOCK_SIZE);
+#if defined(USE_DCBLOCKER) && defined(MODE_DMR)
+        m_holdRawSamples.write(samples, RX_BLOCK_SIZE);
 #endif
-        ysfRX.samples(YSFVals, rssi, RX_BLOCK_SIZE);
       }
-#endif
-
-#if defined(MODE_M17)
-      if (m_m17Enable) {
-        q15_t RRCVals[RX_BLOCK_SIZE];
-#if defined(USE_DCBLOCKER)
-        ::arm_fir_fast_q15(&m_rrc05Filter, dcSamples, RRCVals, RX_BLOCK_SIZE);
 #else
-        ::arm_fir_fast_q15(&m_rrc05Filter, samples, RRCVals, RX_BLOCK_SIZE);
-#endif
-        m17RX.samples(RRCVals, rssi, RX_BLOCK_SIZE);
-      }
+      idleSamples(input, samples, rssi);
 #endif
 
 #if defined(MODE_FM)
       if (m_fmEnable) {
         bool cos = getCOSInt();
 #if defined(USE_DCBLOCKER)
-        fm.samples(cos, dcSamples, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_FM_RX, fm.samples(cos, dcSamples, RX_BLOCK_SIZE));
 #else
-        fm.samples(cos, samples, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_FM_RX, fm.samples(cos, samples, RX_BLOCK_SIZE));
 #endif
       }
 #endif
@@ -516,9 +523,9 @@ void CIO::process()
 #if defined(MODE_FM) && defined(MODE_AX25)
       if (m_ax25Enable) {
 #if defined(USE_DCBLOCKER)
-        ax25RX.samples(dcSamples, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_AX25_RX, ax25RX.samples(dcSamples, RX_BLOCK_SIZE));
 #else
-        ax25RX.samples(samples, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_AX25_RX, ax25RX.samples(samples, RX_BLOCK_SIZE));
 #endif
       }
 #endif
@@ -529,11 +536,11 @@ void CIO::process()
       if (m_dstarEnable) {
         q15_t GMSKVals[RX_BLOCK_SIZE];
 #if defined(USE_DCBLOCKER)
-        ::arm_fir_fast_q15(&m_gaussianFilter, dcSamples, GMSKVals, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_GAUSSIAN_FILTER, ::arm_fir_fast_q15(&m_gaussianFilter, dcSamples, GMSKVals, RX_BLOCK_SIZE));
 #else
-        ::arm_fir_fast_q15(&m_gaussianFilter, samples, GMSKVals, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_GAUSSIAN_FILTER, ::arm_fir_fast_q15(&m_gaussianFilter, samples, GMSKVals, RX_BLOCK_SIZE));
 #endif
-        dstarRX.samples(GMSKVals, rssi, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_DSTAR_RX, dstarRX.samples(GMSKVals, rssi, RX_BLOCK_SIZE));
       }
     }
 #endif
@@ -542,16 +549,16 @@ void CIO::process()
     else if (m_modemState == STATE_DMR) {
       if (m_dmrEnable) {
         q15_t DMRVals[RX_BLOCK_SIZE];
-        ::arm_fir_fast_q15(&m_rrc02Filter1, samples, DMRVals, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_RRC02_FILTER, ::arm_fir_fast_q15(&m_rrc02Filter, samples, DMRVals, RX_BLOCK_SIZE));
 
         if (m_duplex) {
           // If the transmitter isn't on, use the DMR idle RX to detect the wakeup CSBKs
           if (m_tx)
-            dmrRX.samples(DMRVals, rssi, control, RX_BLOCK_SIZE);
+            PROFILE(PROFILE_DMR_RX, dmrRX.samples(DMRVals, rssi, control, RX_BLOCK_SIZE));
           else
-            dmrIdleRX.samples(DMRVals, RX_BLOCK_SIZE);
+            PROFILE(PROFILE_DMR_RX, dmrIdleRX.samples(DMRVals, RX_BLOCK_SIZE));
         } else {
-          dmrDMORX.samples(DMRVals, rssi, RX_BLOCK_SIZE);
+          PROFILE(PROFILE_DMR_RX, dmrDMORX.samples(DMRVals, rssi, RX_BLOCK_SIZE));
         }
       }
     }
@@ -561,12 +568,14 @@ void CIO::process()
     else if (m_modemState == STATE_YSF) {
       if (m_ysfEnable) {
         q15_t YSFVals[RX_BLOCK_SIZE];
-#if defined(USE_DCBLOCKER)
-        ::arm_fir_fast_q15(&m_rrc02Filter2, dcSamples, YSFVals, RX_BLOCK_SIZE);
+#if defined(RRC02_SPLIT)
+        PROFILE(PROFILE_RRC02_FILTER, ::arm_fir_fast_q15(&m_rrc02YSFFilter, dcSamples, YSFVals, RX_BLOCK_SIZE));
+#elif defined(USE_DCBLOCKER)
+        PROFILE(PROFILE_RRC02_FILTER, ::arm_fir_fast_q15(&m_rrc02Filter, dcSamples, YSFVals, RX_BLOCK_SIZE));
 #else
-        ::arm_fir_fast_q15(&m_rrc02Filter2, samples, YSFVals, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_RRC02_FILTER, ::arm_fir_fast_q15(&m_rrc02Filter, samples, YSFVals, RX_BLOCK_SIZE));
 #endif
-        ysfRX.samples(YSFVals, rssi, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_YSF_RX, ysfRX.samples(YSFVals, rssi, RX_BLOCK_SIZE));
       }
     }
 #endif
@@ -576,11 +585,11 @@ void CIO::process()
       if (m_p25Enable) {
         q15_t P25Vals[RX_BLOCK_SIZE];
 #if defined(USE_DCBLOCKER)
-        ::arm_fir_fast_q15(&m_boxcar5Filter, dcSamples, P25Vals, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_BOXCAR5_FILTER, ::arm_fir_fast_q15(&m_boxcar5Filter, dcSamples, P25Vals, RX_BLOCK_SIZE));
 #else
-        ::arm_fir_fast_q15(&m_boxcar5Filter, samples, P25Vals, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_BOXCAR5_FILTER, ::arm_fir_fast_q15(&m_boxcar5Filter, samples, P25Vals, RX_BLOCK_SIZE));
 #endif
-        p25RX.samples(P25Vals, rssi, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_P25_RX, p25RX.samples(P25Vals, rssi, RX_BLOCK_SIZE));
       }
     }
 #endif
@@ -591,20 +600,20 @@ void CIO::process()
         q15_t NXDNVals[RX_BLOCK_SIZE];
 #if defined(USE_NXDN_BOXCAR)
 #if defined(USE_DCBLOCKER)
-        ::arm_fir_fast_q15(&m_boxcar10Filter, dcSamples, NXDNVals, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_NXDN_FILTER, ::arm_fir_fast_q15(&m_boxcar10Filter, dcSamples, NXDNVals, RX_BLOCK_SIZE));
 #else
-        ::arm_fir_fast_q15(&m_boxcar10Filter, samples, NXDNVals, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_NXDN_FILTER, ::arm_fir_fast_q15(&m_boxcar10Filter, samples, NXDNVals, RX_BLOCK_SIZE));
 #endif
 #else
         q15_t NXDNValsTmp[RX_BLOCK_SIZE];
 #if defined(USE_DCBLOCKER)
-        ::arm_fir_fast_q15(&m_nxdnFilter, dcSamples, NXDNValsTmp, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_NXDN_FILTER, ::arm_fir_fast_q15(&m_nxdnFilter, dcSamples, NXDNValsTmp, RX_BLOCK_SIZE));
 #else
-        ::arm_fir_fast_q15(&m_nxdnFilter, samples, NXDNValsTmp, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_NXDN_FILTER, ::arm_fir_fast_q15(&m_nxdnFilter, samples, NXDNValsTmp, RX_BLOCK_SIZE));
 #endif
-        ::arm_fir_fast_q15(&m_nxdnISincFilter, NXDNValsTmp, NXDNVals, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_NXDN_ISINC_FILTER, ::arm_fir_fast_q15(&m_nxdnISincFilter, NXDNValsTmp, NXDNVals, RX_BLOCK_SIZE));
 #endif
-        nxdnRX.samples(NXDNVals, rssi, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_NXDN_RX, nxdnRX.samples(NXDNVals, rssi, RX_BLOCK_SIZE));
       }
     }
 #endif
@@ -614,11 +623,11 @@ void CIO::process()
       if (m_m17Enable) {
         q15_t M17Vals[RX_BLOCK_SIZE];
 #if defined(USE_DCBLOCKER)
-        ::arm_fir_fast_q15(&m_rrc05Filter, dcSamples, M17Vals, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_RRC05_FILTER, ::arm_fir_fast_q15(&m_rrc05Filter, dcSamples, M17Vals, RX_BLOCK_SIZE));
 #else
-        ::arm_fir_fast_q15(&m_rrc05Filter, samples, M17Vals, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_RRC05_FILTER, ::arm_fir_fast_q15(&m_rrc05Filter, samples, M17Vals, RX_BLOCK_SIZE));
 #endif
-        m17RX.samples(M17Vals, rssi, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_M17_RX, m17RX.samples(M17Vals, rssi, RX_BLOCK_SIZE));
       }
     }
 #endif
@@ -627,18 +636,18 @@ void CIO::process()
     else if (m_modemState == STATE_FM) {
       bool cos = getCOSInt();
 #if defined(USE_DCBLOCKER)
-      fm.samples(cos, dcSamples, RX_BLOCK_SIZE);
+      PROFILE(PROFILE_FM_RX, fm.samples(cos, dcSamples, RX_BLOCK_SIZE));
 
 #if defined(MODE_AX25)
       if (m_ax25Enable)
-        ax25RX.samples(dcSamples, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_AX25_RX, ax25RX.samples(dcSamples, RX_BLOCK_SIZE));
 #endif
 #else
-      fm.samples(cos, samples, RX_BLOCK_SIZE);
+      PROFILE(PROFILE_FM_RX, fm.samples(cos, samples, RX_BLOCK_SIZE));
 
 #if defined(MODE_AX25)
       if (m_ax25Enable)
-        ax25RX.samples(samples, RX_BLOCK_SIZE);
+        PROFILE(PROFILE_AX25_RX, ax25RX.samples(samples, RX_BLOCK_SIZE));
 #endif
 #endif
     }
@@ -647,18 +656,101 @@ void CIO::process()
 #if defined(MODE_DSTAR)
     else if (m_modemState == STATE_DSTARCAL) {
       q15_t GMSKVals[RX_BLOCK_SIZE];
-      ::arm_fir_fast_q15(&m_gaussianFilter, samples, GMSKVals, RX_BLOCK_SIZE);
+      PROFILE(PROFILE_GAUSSIAN_FILTER, ::arm_fir_fast_q15(&m_gaussianFilter, samples, GMSKVals, RX_BLOCK_SIZE));
 
-      calDStarRX.samples(GMSKVals, RX_BLOCK_SIZE);
+      PROFILE(PROFILE_CAL_RX, calDStarRX.samples(GMSKVals, RX_BLOCK_SIZE));
     }
 #endif
 
     else if (m_modemState == STATE_RSSICAL) {
-      calRSSI.samples(rssi, RX_BLOCK_SIZE);
+      PROFILE(PROFILE_CAL_RX, calRSSI.samples(rssi, RX_BLOCK_SIZE));
     }
   }
 }
 
+// The digital mode receivers while in idle, the samples have already been through the DC blocker,
+// the raw samples are those from before it for DMR
+void CIO::idleSamples(q15_t* samples, q15_t* rawSamples, uint16_t* rssi)
+{
+#if defined(RRC02_SPLIT)
+  q15_t DMRVals[RX_BLOCK_SIZE];
+  if (m_dmrEnable)
+    PROFILE(PROFILE_RRC02_FILTER, ::arm_fir_fast_q15(&m_rrc02Filter, rawSamples, DMRVals, RX_BLOCK_SIZE));
+
+  q15_t YSFVals[RX_BLOCK_SIZE];
+  if (m_ysfEnable)
+    PROFILE(PROFILE_RRC02_FILTER, ::arm_fir_fast_q15(&m_rrc02YSFFilter, samples, YSFVals, RX_BLOCK_SIZE));
+#elif defined(MODE_DMR) || defined(MODE_YSF)
+  // With the same input for both, the RRC 0.2 filter is run once for DMR and YSF
+  q15_t RRC02Vals[RX_BLOCK_SIZE];
+#if defined(MODE_DMR)
+  if (m_dmrEnable || m_ysfEnable)
+    PROFILE(PROFILE_RRC02_FILTER, ::arm_fir_fast_q15(&m_rrc02Filter, rawSamples, RRC02Vals, RX_BLOCK_SIZE));
+#else
+  if (m_ysfEnable)
+    PROFILE(PROFILE_RRC02_FILTER, ::arm_fir_fast_q15(&m_rrc02Filter, samples, RRC02Vals, RX_BLOCK_SIZE));
+#endif
+#if defined(MODE_DMR)
+  q15_t* DMRVals = RRC02Vals;
+#endif
+#if defined(MODE_YSF)
+  q15_t* YSFVals = RRC02Vals;
+#endif
+#endif
+
+#if defined(MODE_DSTAR)
+  if (m_dstarEnable) {
+    q15_t GMSKVals[RX_BLOCK_SIZE];
+    PROFILE(PROFILE_GAUSSIAN_FILTER, ::arm_fir_fast_q15(&m_gaussianFilter, samples, GMSKVals, RX_BLOCK_SIZE));
+    PROFILE(PROFILE_DSTAR_RX, dstarRX.samples(GMSKVals, rssi, RX_BLOCK_SIZE));
+  }
+#endif
+
+#if defined(MODE_P25)
+  if (m_p25Enable) {
+    q15_t P25Vals[RX_BLOCK_SIZE];
+    PROFILE(PROFILE_BOXCAR5_FILTER, ::arm_fir_fast_q15(&m_boxcar5Filter, samples, P25Vals, RX_BLOCK_SIZE));
+    PROFILE(PROFILE_P25_RX, p25RX.samples(P25Vals, rssi, RX_BLOCK_SIZE));
+  }
+#endif
+
+#if defined(MODE_NXDN)
+  if (m_nxdnEnable) {
+    q15_t NXDNVals[RX_BLOCK_SIZE];
+#if defined(USE_NXDN_BOXCAR)
+    PROFILE(PROFILE_NXDN_FILTER, ::arm_fir_fast_q15(&m_boxcar10Filter, samples, NXDNVals, RX_BLOCK_SIZE));
+#else
+    q15_t NXDNValsTmp[RX_BLOCK_SIZE];
+    PROFILE(PROFILE_NXDN_FILTER, ::arm_fir_fast_q15(&m_nxdnFilter, samples, NXDNValsTmp, RX_BLOCK_SIZE));
+    PROFILE(PROFILE_NXDN_ISINC_FILTER, ::arm_fir_fast_q15(&m_nxdnISincFilter, NXDNValsTmp, NXDNVals, RX_BLOCK_SIZE));
+#endif
+    PROFILE(PROFILE_NXDN_RX, nxdnRX.samples(NXDNVals, rssi, RX_BLOCK_SIZE));
+  }
+#endif
+
+#if defined(MODE_DMR)
+  if (m_dmrEnable) {
+    if (m_duplex)
+      PROFILE(PROFILE_DMR_RX, dmrIdleRX.samples(DMRVals, RX_BLOCK_SIZE));
+    else
+      PROFILE(PROFILE_DMR_RX, dmrDMORX.samples(DMRVals, rssi, RX_BLOCK_SIZE));
+  }
+#endif
+
+#if defined(MODE_YSF)
+  if (m_ysfEnable)
+    PROFILE(PROFILE_YSF_RX, ysfRX.samples(YSFVals, rssi, RX_BLOCK_SIZE));
+#endif
+
+#if defined(MODE_M17)
+  if (m_m17Enable) {
+    q15_t RRCVals[RX_BLOCK_SIZE];
+    PROFILE(PROFILE_RRC05_FILTER, ::arm_fir_fast_q15(&m_rrc05Filter, samples, RRCVals, RX_BLOCK_SIZE));
+    PROFILE(PROFILE_M17_RX, m17RX.samples(RRCVals, rssi, RX_BLOCK_SIZE));
+  }
+#endif
+}
+
 void CIO::write(MMDVM_STATE mode, q15_t* samples, uint16_t length, const uint8_t* control)
 {
   if (!m_started)
@@ -667,61 +759,119 @@ void CIO::write(MMDVM_STATE mode, q15_t* samples, uint16_t length, const uint8_t
   if (m_lockout)
     return;
 
+  startTX();
+
+  q15_t txLevel = getTXLevel(mode);
+
+  TSample block[TX_WRITE_BLOCK_SIZE];
+
+  for (uint16_t i = 0U; i < length; i += TX_WRITE_BLOCK_SIZE) {
+    uint16_t n = length - i;
+    if (n > TX_WRITE_BLOCK_SIZE)
+      n = TX_WRITE_BLOCK_SIZE;
+
+    for (uint16_t j = 0U; j < n; j++) {
+      q31_t res1 = samples[i + j] * txLevel;
+      q15_t res2 = q15_t(__SSAT((res1 >> 15), 16));
+      uint16_t res3 = uint16_t(res2 + m_txDCOffset);
+
+      // Detect DAC overflow
+      if (res3 > 4095U)
+        m_dacOverflow++;
+
+      block[j].sample  = res3;
+      block[j].control = control == NULL ? MARK_NONE : control[i + j];
+    }
+
+    m_txBuffer.write(block, n);
+  }
+}
+
+void CIO::startTX()
+{
   // Switch the transmitter on if needed
   if (!m_tx) {
     m_tx = true;
     setPTTInt(m_pttInvert ? false : true);
     DEBUG1("TX ON");
   }
+}
 
-  q15_t txLevel = 0;
+q15_t CIO::getTXLevel(MMDVM_STATE mode) const
+{
   switch (mode) {
     case STATE_DSTAR:
-      txLevel = m_dstarTXLevel;
-      break;
+      return m_dstarTXLevel;
     case STATE_DMR:
-      txLevel = m_dmrTXLevel;
-      break;
+      return m_dmrTXLevel;
     case STATE_YSF:
-      txLevel = m_ysfTXLevel;
-      break;
+      return m_ysfTXLevel;
     case STATE_P25:
-      txLevel = m_p25TXLevel;
-      break;
+      return m_p25TXLevel;
     case STATE_NXDN:
-      txLevel = m_nxdnTXLevel;
-      break;
+      return m_nxdnTXLevel;
     case STATE_M17:
-      txLevel = m_m17TXLevel;
-      break;
+      return m_m17TXLevel;
     case STATE_POCSAG:
-      txLevel = m_pocsagTXLevel;
-      break;
+      return m_pocsagTXLevel;
     case STATE_FM:
-      txLevel = m_fmTXLevel;
-      break;
+      return m_fmTXLevel;
     case STATE_AX25:
-      txLevel = m_ax25TXLevel;
-      break;
+      return m_ax25TXLevel;
     default:
-      txLevel = m_cwIdTXLevel;
-      break;
+      return m_cwIdTXLevel;
   }
+}
+
+// Called from the DMA half and full transfer interrupts. The ADC samples are the block just
+// captured and the DAC block is played out after the one already queued, so the TX markers
+// are held back by two blocks to line them up with the received samples as the per sample
+// interrupt does.
+void CIO::interrupt(const uint16_t* adc, const uint16_t* rssi, uint16_t* dac, uint16_t length)
+{
+  PROFILE_START(isrStart);
+  PROFILE_INTERRUPT(isrStart, length);
+
+  if (length > IO_BLOCK_SIZE)
+    length = IO_BLOCK_SIZE;
+
+  TSample block[IO_BLOCK_SIZE];
+  uint16_t n = m_txBuffer.read(block, length);
+
+  for (uint16_t i = n; i < length; i++) {
+    block[i].sample  = DC_OFFSET;
+    block[i].control = MARK_NONE;
+  }
+
+  uint8_t* control = m_blockControl[m_blockIndex];
+
+  TRXSample rx[IO_BLOCK_SIZE];
 
   for (uint16_t i = 0U; i < length; i++) {
-    q31_t res1 = samples[i] * txLevel;
-    q15_t res2 = q15_t(__SSAT((res1 >> 15), 16));
-    uint16_t res3 = uint16_t(res2 + m_txDCOffset);
+    dac[i] = block[i].sample;
 
-    // Detect DAC overflow
-    if (res3 > 4095U)
-      m_dacOverflow++;
+#if defined(SEND_RSSI_DATA)
+    rx[i] = packRXSample(adc[i], rssi[i], control[i]);
+#else
+    rx[i] = packRXSample(adc[i], 0U, control[i]);
+#endif
 
-    if (control == NULL)
-      m_txBuffer.put({res3, MARK_NONE});
-    else
-      m_txBuffer.put({res3, control[i]});
+    control[i] = block[i].control;
   }
+
+  m_blockIndex ^= 1U;
+
+  // The last TX samples are still to be played out for two more blocks
+  if (n > 0U)
+    m_blockTX = 2U;
+  else if (m_blockTX > 0U)
+    m_blockTX--;
+
+  m_rxBuffer.write(rx, length);
+
+  m_watchdog += length;
+
+  PROFILE_STOP(PROFILE_ISR, isrStart);
 }
 
 uint16_t CIO::getSpace() const
@@ -773,6 +923,18 @@ void CIO::setMode(MMDVM_STATE state)
   }
 #endif
 
+#if defined(USE_ACTIVITY_GATE)
+  // Start with the receivers running when coming back to idle
+  if (state == STATE_IDLE) {
+    m_activity.reset();
+    m_holdSamples.reset();
+    m_holdRSSI.reset();
+#if defined(USE_DCBLOCKER) && defined(MODE_DMR)
+    m_holdRawSamples.reset();
+#endif
+  }
+#endif
+
   m_modemState = state;
 }
 
@@ -820,6 +982,13 @@ void CIO::getOverflow(bool& adcOverflow, bool& dacOverflow)
   m_dacOverflow = 0U;
 }
 
+#if defined(USE_ACTIVITY_GATE)
+void CIO::getActivity(uint32_t& gated, uint32_t& active)
+{
+  m_activity.getCounts(gated, active);
+}
+#endif
+
 bool CIO::hasTXOverflow()
 {
   return m_txBuffer.hasOverflowed();
@@ -830,6 +999,56 @@ bool CIO::hasRXOverflow()
   return m_rxBuffer.hasOverflowed();
 }
 
+void CIO::getBufferStats(TRingStats& rx, TRingStats& tx)
+{
+  m_rxBuffer.getStats(rx);
+  m_txBuffer.getStats(tx);
+}
+
+// The DC that the blocker is taking out, which is mostly the carrier offset, as it would be after the
+// receive filter of a mode
+q15_t CIO::getDCLevel(MMDVM_STATE mode) const
+{
+#if defined(USE_DCBLOCKER)
+  q31_t gain = 0;
+
+  switch (mode) {
+#if defined(MODE_DMR) || defined(MODE_YSF)
+    case STATE_DMR:
+    case STATE_YSF:
+      gain = filterGain(RRC_0_2_FILTER, RRC_0_2_FILTER_LEN);
+      break;
+#endif
+#if defined(MODE_P25)
+    case STATE_P25:
+      gain = filterGain(BOXCAR5_FILTER, BOXCAR5_FILTER_LEN);
+      break;
+#endif
+#if defined(MODE_NXDN)
+    case STATE_NXDN:
+#if defined(USE_NXDN_BOXCAR)
+      gain = filterGain(BOXCAR10_FILTER, BOXCAR10_FILTER_LEN);
+#else
+      gain = q31_t((q63_t(filterGain(NXDN_0_2_FILTER, NXDN_0_2_FILTER_LEN)) * filterGain(NXDN_ISINC_FILTER, NXDN_ISINC_FILTER_LEN)) >> 15);
+#endif
+      break;
+#endif
+#if defined(MODE_M17)
+    case STATE_M17:
+      gain = filterGain(RRC_0_5_FILTER, RRC_0_5_FILTER_LEN);
+      break;
+#endif
+    default:
+      gain = 32768;
+      break;
+  }
+
+  return q15_t(__SSAT(((m_dcMean >> 16) * gain) >> 15, 16));
+#else
+  return 0;
+#endif
+}
+
 void CIO::resetWatchdog()
 {
   m_watchdog = 0U;
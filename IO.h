@@ -22,12 +22,29 @@
 #include "Globals.h"
 
 #include "RingBuffer.h"
+#include "FSKMod.h"
+#include "RXActivity.h"
+
+// DMR takes the samples from before the DC blocker and YSF those from after it, so only without
+// the DC blocker do they share one RRC 0.2 filter, otherwise each has its own
+#if defined(MODE_DMR) && defined(MODE_YSF) && defined(USE_DCBLOCKER)
+#define RRC02_SPLIT
+#endif
 
 struct TSample {
   volatile uint16_t sample;
   volatile uint8_t control;
 };
 
+// A received sample packed into one word, the ADC reading in bits 0-11, the RSSI reading
+// in bits 12-23 and the TX marker in bits 24-31
+typedef uint32_t TRXSample;
+
+inline TRXSample packRXSample(uint16_t sample, uint16_t rssi, uint8_t control)
+{
+  return (TRXSample(sample) & 0x0FFFU) | ((TRXSample(rssi) & 0x0FFFU) << 12) | (TRXSample(control) << 24);
+}
+
 class CIO {
 public:
   CIO();
@@ -38,6 +55,11 @@ public:
 
   void write(MMDVM_STATE mode, q15_t* samples, uint16_t length, const uint8_t* control = NULL);
 
+  // The samples of the symbols last added to a 4FSK modulator, which it writes already scaled
+  // straight into the TX buffer, with the control marker on the middle one
+  template <uint8_t SPS, uint8_t SYMBOLS>
+  void write(MMDVM_STATE mode, const CFSKMod<SPS, SYMBOLS>& mod, uint8_t control = MARK_NONE);
+
   uint16_t getSpace() const;
 
   void setDecode(bool dcd);
@@ -45,14 +67,23 @@ public:
   void setMode(MMDVM_STATE state);
   
   void interrupt();
+  void interrupt(const uint16_t* adc, const uint16_t* rssi, uint16_t* dac, uint16_t length);
 
   void setParameters(bool rxInvert, bool txInvert, bool pttInvert, uint8_t rxLevel, uint8_t cwIdTXLevel, uint8_t dstarTXLevel, uint8_t dmrTXLevel, uint8_t ysfTXLevel, uint8_t p25TXLevel, uint8_t nxdnTXLevel, uint8_t m17TXLevel, uint8_t pocsagTXLevel, uint8_t fmTXLevel, uint8_t ax25TXLevel, int16_t txDCOffset, int16_t rxDCOffset, bool useCOSAsLockout);
 
   void getOverflow(bool& adcOverflow, bool& dacOverflow);
 
+#if defined(USE_ACTIVITY_GATE)
+  void getActivity(uint32_t& gated, uint32_t& active);
+#endif
+
   bool hasTXOverflow();
   bool hasRXOverflow();
 
+  void getBufferStats(TRingStats& rx, TRingStats& tx);
+
+  q15_t getDCLevel(MMDVM_STATE mode) const;
+
   bool hasLockout() const;
 
   void resetWatchdog();
@@ -67,9 +98,17 @@ public:
 private:
   bool                  m_started;
 
-  CRingBuffer<TSample>  m_rxBuffer;
-  CRingBuffer<TSample>  m_txBuffer;
-  CRingBuffer<uint16_t> m_rssiBuffer;
+  CRingBuffer<TRXSample, RX_RINGBUFFER_SIZE> m_rxBuffer;
+  CRingBuffer<TSample, TX_RINGBUFFER_SIZE>   m_txBuffer;
+
+#if defined(USE_ACTIVITY_GATE)
+  CRXActivity                 m_activity;
+  CRingBuffer<q15_t, 256U>    m_holdSamples;         // 10ms of samples kept while the channel is empty
+  CRingBuffer<uint16_t, 256U> m_holdRSSI;
+#if defined(USE_DCBLOCKER) && defined(MODE_DMR)
+  CRingBuffer<q15_t, 256U>    m_holdRawSamples;      // For DMR, from before the DC blocker
+#endif
+#endif
 
 #if defined(USE_DCBLOCKER)
   arm_biquad_casd_df1_inst_q31 m_dcFilter;
@@ -78,39 +117,39 @@ private:
 
 #if defined(MODE_DSTAR)
   arm_fir_instance_q15 m_gaussianFilter;
-  q15_t                m_gaussianState[40U];      // NoTaps + BlockSize - 1, 12 + 20 - 1 plus some spare
+  q15_t                m_gaussianState[12U + RX_BLOCK_SIZE - 1U];   // NoTaps + BlockSize - 1
 #endif
 
-#if defined(MODE_DMR)
-  arm_fir_instance_q15 m_rrc02Filter1;
-  q15_t                m_rrc02State1[70U];         // NoTaps + BlockSize - 1, 42 + 20 - 1 plus some spare
+#if defined(MODE_DMR) || defined(MODE_YSF)
+  arm_fir_instance_q15 m_rrc02Filter;                               // DMR, and YSF unless RRC02_SPLIT
+  q15_t                m_rrc02State[42U + RX_BLOCK_SIZE - 1U];      // NoTaps + BlockSize - 1
 #endif
 
-#if defined(MODE_YSF)
-  arm_fir_instance_q15 m_rrc02Filter2;
-  q15_t                m_rrc02State2[70U];         // NoTaps + BlockSize - 1, 42 + 20 - 1 plus some spare
+#if defined(RRC02_SPLIT)
+  arm_fir_instance_q15 m_rrc02YSFFilter;
+  q15_t                m_rrc02YSFState[42U + RX_BLOCK_SIZE - 1U];   // NoTaps + BlockSize - 1
 #endif
 
 #if defined(MODE_P25)
   arm_fir_instance_q15 m_boxcar5Filter;
-  q15_t                m_boxcar5State[30U];        // NoTaps + BlockSize - 1,  6 + 20 - 1 plus some spare
+  q15_t                m_boxcar5State[6U + RX_BLOCK_SIZE - 1U];     // NoTaps + BlockSize - 1
 #endif
 
 #if defined(MODE_NXDN)
 #if defined(USE_NXDN_BOXCAR)
   arm_fir_instance_q15 m_boxcar10Filter;
-  q15_t                m_boxcar10State[40U];      // NoTaps + BlockSize - 1, 10 + 20 - 1 plus some spare
+  q15_t                m_boxcar10State[10U + RX_BLOCK_SIZE - 1U];   // NoTaps + BlockSize - 1
 #else
   arm_fir_instance_q15 m_nxdnFilter;
   arm_fir_instance_q15 m_nxdnISincFilter;
-  q15_t                m_nxdnState[110U];         // NoTaps + BlockSize - 1, 82 + 20 - 1 plus some spare
-  q15_t                m_nxdnISincState[60U];     // NoTaps + BlockSize - 1, 32 + 20 - 1 plus some spare
+  q15_t                m_nxdnState[82U + RX_BLOCK_SIZE - 1U];       // NoTaps + BlockSize - 1
+  q15_t                m_nxdnISincState[32U + RX_BLOCK_SIZE - 1U];  // NoTaps + BlockSize - 1
 #endif
 #endif
 
 #if defined(MODE_M17)
   arm_fir_instance_q15 m_rrc05Filter;
-  q15_t                m_rrc05State[70U];         // NoTaps + BlockSize - 1, 42 + 20 - 1 plus some spare
+  q15_t                m_rrc05State[42U + RX_BLOCK_SIZE - 1U];      // NoTaps + BlockSize - 1
 #endif
 
   bool                 m_pttInvert;
@@ -129,6 +168,8 @@ private:
   uint16_t             m_rxDCOffset;
   uint16_t             m_txDCOffset;
 
+  q31_t                m_dcMean;
+
   bool                 m_useCOSAsLockout;
 
   uint32_t             m_ledCount;
@@ -141,8 +182,17 @@ private:
 
   volatile uint32_t    m_watchdog;
 
+  uint8_t              m_blockControl[2U][IO_BLOCK_SIZE];
+  uint8_t              m_blockIndex;
+  volatile uint8_t     m_blockTX;
+
   bool                 m_lockout;
 
+  void startTX();
+  q15_t getTXLevel(MMDVM_STATE mode) const;
+
+  void idleSamples(q15_t* samples, q15_t* rawSamples, uint16_t* rssi);
+
   // Hardware specific routines
   void initInt();
   void startInt();
@@ -165,4 +215,39 @@ private:
   void delayInt(unsigned int dly);
 };
 
+template <uint8_t SPS, uint8_t SYMBOLS>
+void CIO::write(MMDVM_STATE mode, const CFSKMod<SPS, SYMBOLS>& mod, uint8_t control)
+{
+  if (!m_started)
+    return;
+
+  if (m_lockout)
+    return;
+
+  const uint16_t length = CFSKMod<SPS, SYMBOLS>::SAMPLES;
+
+  TSample* samples = NULL;
+
+  // Only where the free space wraps around the end of the buffer do the samples go through a copy
+  if (m_txBuffer.getWriteSpan(samples) < length) {
+    q15_t   buffer[length];
+    uint8_t controls[length];
+
+    mod.getSamples(buffer);
+
+    ::memset(controls, MARK_NONE, length);
+    controls[length / 2U] = control;
+
+    write(mode, buffer, length, controls);
+    return;
+  }
+
+  startTX();
+
+  m_dacOverflow += mod.getSamples(samples, getTXLevel(mode), m_txDCOffset, MARK_NONE);
+  samples[length / 2U].control = control;
+
+  m_txBuffer.commit(length);
+}
+
 #endif
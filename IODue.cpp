@@ -187,23 +187,25 @@ void CIO::startInt()
 
 void CIO::interrupt()
 {
+  PROFILE_START(isrStart);
+  PROFILE_INTERRUPT(isrStart, 1U);
+
   if ((ADC->ADC_ISR & ADC_ISR_EOC_Chan) == ADC_ISR_EOC_Chan) {    // Ensure there was an End-of-Conversion and we read the ISR reg
     TSample sample = {DC_OFFSET, MARK_NONE};
 
     m_txBuffer.get(sample);
     DACC->DACC_CDR = sample.sample;
 
-    sample.sample = ADC->ADC_CDR[ADC_CDR_Chan];
-    m_rxBuffer.put(sample);
-
 #if defined(SEND_RSSI_DATA)
-    m_rssiBuffer.put(ADC->ADC_CDR[RSSI_CDR_Chan]);
+    m_rxBuffer.put(packRXSample(ADC->ADC_CDR[ADC_CDR_Chan], ADC->ADC_CDR[RSSI_CDR_Chan], sample.control));
 #else
-    m_rssiBuffer.put(0U);
+    m_rxBuffer.put(packRXSample(ADC->ADC_CDR[ADC_CDR_Chan], 0U, sample.control));
 #endif
 
     m_watchdog++;
   }
+
+  PROFILE_STOP(PROFILE_ISR, isrStart);
 }
 
 bool CIO::getCOSInt()
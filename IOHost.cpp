@@ -0,0 +1,189 @@
+/*
+ *   Copyright (C) 2026 by the MMDVM developers
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "Config.h"
+#include "Globals.h"
+#include "IO.h"
+
+#if defined(HOST_BUILD)
+
+#include "Host.h"
+
+const uint16_t DC_OFFSET = 2048U;
+
+static uint16_t s_adc  = DC_OFFSET;
+static uint16_t s_rssi = 0U;
+static uint16_t s_dac  = DC_OFFSET;
+static bool     s_cos  = false;
+static bool     s_ptt  = false;
+
+// The simulated DMA buffers, two halves of IO_BLOCK_SIZE samples each
+static bool     s_blockIO = false;
+static uint16_t s_adcDMA[2U * IO_BLOCK_SIZE];
+static uint16_t s_rssiDMA[2U * IO_BLOCK_SIZE];
+static uint16_t s_dacDMA[2U * IO_BLOCK_SIZE];
+static uint16_t s_dmaPtr = 0U;
+
+void hostSetADC(uint16_t sample, uint16_t rssi)
+{
+  s_adc  = sample;
+  s_rssi = rssi;
+}
+
+uint16_t hostGetDAC()
+{
+  return s_dac;
+}
+
+void hostTick()
+{
+  if (!s_blockIO) {
+    io.interrupt();
+    return;
+  }
+
+  s_dac = s_dacDMA[s_dmaPtr];
+
+  s_adcDMA[s_dmaPtr]  = s_adc;
+  s_rssiDMA[s_dmaPtr] = s_rssi;
+
+  s_dmaPtr++;
+
+  // Half transfer
+  if (s_dmaPtr == IO_BLOCK_SIZE)
+    io.interrupt(s_adcDMA, s_rssiDMA, s_dacDMA, IO_BLOCK_SIZE);
+
+  // Full transfer
+  if (s_dmaPtr == (2U * IO_BLOCK_SIZE)) {
+    io.interrupt(s_adcDMA + IO_BLOCK_SIZE, s_rssiDMA + IO_BLOCK_SIZE, s_dacDMA + IO_BLOCK_SIZE, IO_BLOCK_SIZE);
+    s_dmaPtr = 0U;
+  }
+}
+
+void hostSetBlockIO(bool on)
+{
+  s_blockIO = on;
+  s_dmaPtr  = 0U;
+
+  for (uint16_t i = 0U; i < (2U * IO_BLOCK_SIZE); i++)
+    s_dacDMA[i] = DC_OFFSET;
+}
+
+void hostSetCOS(bool cos)
+{
+  s_cos = cos;
+}
+
+bool hostGetPTT()
+{
+  return s_ptt;
+}
+
+void CIO::initInt()
+{
+}
+
+void CIO::startInt()
+{
+}
+
+void CIO::interrupt()
+{
+  PROFILE_START(isrStart);
+  PROFILE_INTERRUPT(isrStart, 1U);
+
+  TSample sample = {DC_OFFSET, MARK_NONE};
+
+  m_txBuffer.get(sample);
+  s_dac = sample.sample;
+
+#if defined(SEND_RSSI_DATA)
+  m_rxBuffer.put(packRXSample(s_adc, s_rssi, sample.control));
+#else
+  m_rxBuffer.put(packRXSample(s_adc, 0U, sample.control));
+#endif
+
+  m_watchdog++;
+
+  PROFILE_STOP(PROFILE_ISR, isrStart);
+}
+
+bool CIO::getCOSInt()
+{
+  return s_cos;
+}
+
+void CIO::setLEDInt(bool)
+{
+}
+
+void CIO::setPTTInt(bool on)
+{
+  s_ptt = on;
+}
+
+void CIO::setCOSInt(bool)
+{
+}
+
+void CIO::setDStarInt(bool)
+{
+}
+
+void CIO::setDMRInt(bool)
+{
+}
+
+void CIO::setYSFInt(bool)
+{
+}
+
+void CIO::setP25Int(bool)
+{
+}
+
+void CIO::setNXDNInt(bool)
+{
+}
+
+void CIO::setM17Int(bool)
+{
+}
+
+void CIO::setPOCSAGInt(bool)
+{
+}
+
+void CIO::setFMInt(bool)
+{
+}
+
+void CIO::delayInt(unsigned int)
+{
+}
+
+uint8_t CIO::getCPU() const
+{
+  return 3U;
+}
+
+void CIO::getUDID(uint8_t*)
+{
+}
+
+#endif
@@ -32,6 +32,66 @@ const uint16_t DC_OFFSET = 2048U;
 // Sampling frequency
 #define SAMP_FREQ   24000
 
+#if defined(USE_DMA_IO)
+// TIM2 triggers the ADC and the DAC, and both run circular DMA over two halves of
+// IO_BLOCK_SIZE samples. In dual mode ADC2 (RSSI) is in the top half of each word.
+// The buffers must not be in cached memory should the F7 D-cache ever be enabled.
+#if defined(SEND_RSSI_DATA)
+static volatile uint32_t s_adcDMA[2U * IO_BLOCK_SIZE];
+#else
+static volatile uint16_t s_adcDMA[2U * IO_BLOCK_SIZE];
+#endif
+static uint16_t s_dacDMA[2U * IO_BLOCK_SIZE];
+
+#if defined(STM32F4_NUCLEO) && defined(STM32F4_NUCLEO_ARDUINO_HEADER)
+#define DAC_DMA_STREAM  DMA1_Stream6
+#define DAC_DHR_ADDRESS ((uint32_t)&DAC->DHR12R2)
+#else
+#define DAC_DMA_STREAM  DMA1_Stream5
+#define DAC_DHR_ADDRESS ((uint32_t)&DAC->DHR12R1)
+#endif
+
+// The ADC external trigger numbering differs, TIM2 TRGO is EXTSEL 0110 on the F4 but 1011 on
+// the F7, so don't rely on the F7 library port having changed the F4 value
+#if defined(STM32F7XX)
+#define ADC_TRIGGER_T2_TRGO ((uint32_t)0x0B000000)
+#else
+#define ADC_TRIGGER_T2_TRGO ADC_ExternalTrigConv_T2_TRGO
+#endif
+
+static void dmaBlock(uint16_t offset)
+{
+   uint16_t adc[IO_BLOCK_SIZE];
+   uint16_t rssi[IO_BLOCK_SIZE];
+
+   for (uint16_t i = 0U; i < IO_BLOCK_SIZE; i++) {
+#if defined(SEND_RSSI_DATA)
+      uint32_t value = s_adcDMA[offset + i];
+      adc[i]  = value & 0xFFFFU;
+      rssi[i] = value >> 16;
+#else
+      adc[i]  = s_adcDMA[offset + i];
+      rssi[i] = 0U;
+#endif
+   }
+
+   io.interrupt(adc, rssi, s_dacDMA + offset, IO_BLOCK_SIZE);
+}
+
+extern "C" {
+   void DMA2_Stream0_IRQHandler() {
+      if (DMA_GetITStatus(DMA2_Stream0, DMA_IT_HTIF0) != RESET) {
+         DMA_ClearITPendingBit(DMA2_Stream0, DMA_IT_HTIF0);
+         dmaBlock(0U);
+      }
+
+      if (DMA_GetITStatus(DMA2_Stream0, DMA_IT_TCIF0) != RESET) {
+         DMA_ClearITPendingBit(DMA2_Stream0, DMA_IT_TCIF0);
+         dmaBlock(IO_BLOCK_SIZE);
+      }
+   }
+}
+#else
 extern "C" {
    void TIM2_IRQHandler() {
       if (TIM_GetITStatus(TIM2, TIM_IT_Update) != RESET) {
@@ -40,6 +100,7 @@ extern "C" {
       }
    }
 }
+#endif
 
 void CIO::initInt()
 {
@@ -194,8 +255,10 @@ void CIO::initInt()
 
 void CIO::startInt()
 {
+#if !defined(USE_DMA_IO)
    if ((ADC_GetFlagStatus(ADC1, ADC_FLAG_EOC) != RESET))
       io.interrupt();
+#endif
 
    // Init the ADC
    GPIO_InitTypeDef        GPIO_InitStruct;
@@ -233,7 +296,11 @@ void CIO::startInt()
    ADC_CommonInitStructure.ADC_Mode             = ADC_Mode_Independent;
 #endif
    ADC_CommonInitStructure.ADC_Prescaler        = ADC_Prescaler_Div2;
+#if defined(USE_DMA_IO) && defined(SEND_RSSI_DATA)
+   ADC_CommonInitStructure.ADC_DMAAccessMode    = ADC_DMAAccessMode_2;
+#else
    ADC_CommonInitStructure.ADC_DMAAccessMode    = ADC_DMAAccessMode_Disabled;
+#endif
    ADC_CommonInitStructure.ADC_TwoSamplingDelay = ADC_TwoSamplingDelay_5Cycles;
    ADC_CommonInit(&ADC_CommonInitStructure);
 
@@ -241,8 +308,14 @@ void CIO::startInt()
    ADC_InitStructure.ADC_Resolution           = ADC_Resolution_12b;
    ADC_InitStructure.ADC_ScanConvMode         = DISABLE;
    ADC_InitStructure.ADC_ContinuousConvMode   = DISABLE;
+#if defined(USE_DMA_IO)
+   // Converted on each TIM2 update
+   ADC_InitStructure.ADC_ExternalTrigConvEdge = ADC_ExternalTrigConvEdge_Rising;
+   ADC_InitStructure.ADC_ExternalTrigConv     = ADC_TRIGGER_T2_TRGO;
+#else
    ADC_InitStructure.ADC_ExternalTrigConvEdge = 0;
    ADC_InitStructure.ADC_ExternalTrigConv     = 0;
+#endif
    ADC_InitStructure.ADC_DataAlign            = ADC_DataAlign_Right;
    ADC_InitStructure.ADC_NbrOfConversion      = 1;
 
@@ -255,6 +328,10 @@ void CIO::startInt()
    ADC_Cmd(ADC1, ENABLE);
 
 #if defined(SEND_RSSI_DATA)
+#if defined(USE_DMA_IO)
+   // ADC2 is started by ADC1 in dual mode
+   ADC_InitStructure.ADC_ExternalTrigConvEdge = ADC_ExternalTrigConvEdge_None;
+#endif
    ADC_Init(ADC2, &ADC_InitStructure);
 
    ADC_EOCOnEachRegularChannelCmd(ADC2, ENABLE);
@@ -264,6 +341,43 @@ void CIO::startInt()
    ADC_Cmd(ADC2, ENABLE);
 #endif
 
+#if defined(USE_DMA_IO)
+   // ADC DMA, DMA2 Stream0 Channel0, circular with half and full transfer interrupts
+   RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_DMA2, ENABLE);
+
+   DMA_InitTypeDef DMA_InitStructure;
+   DMA_StructInit(&DMA_InitStructure);
+
+   DMA_InitStructure.DMA_Channel            = DMA_Channel_0;
+#if defined(SEND_RSSI_DATA)
+   DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&ADC->CDR;
+   DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Word;
+   DMA_InitStructure.DMA_MemoryDataSize     = DMA_MemoryDataSize_Word;
+#else
+   DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&ADC1->DR;
+   DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+   DMA_InitStructure.DMA_MemoryDataSize     = DMA_MemoryDataSize_HalfWord;
+#endif
+   DMA_InitStructure.DMA_Memory0BaseAddr    = (uint32_t)s_adcDMA;
+   DMA_InitStructure.DMA_DIR                = DMA_DIR_PeripheralToMemory;
+   DMA_InitStructure.DMA_BufferSize         = 2U * IO_BLOCK_SIZE;
+   DMA_InitStructure.DMA_PeripheralInc      = DMA_PeripheralInc_Disable;
+   DMA_InitStructure.DMA_MemoryInc          = DMA_MemoryInc_Enable;
+   DMA_InitStructure.DMA_Mode               = DMA_Mode_Circular;
+   DMA_InitStructure.DMA_Priority           = DMA_Priority_High;
+   DMA_Init(DMA2_Stream0, &DMA_InitStructure);
+
+   DMA_ITConfig(DMA2_Stream0, DMA_IT_HT | DMA_IT_TC, ENABLE);
+   DMA_Cmd(DMA2_Stream0, ENABLE);
+
+#if defined(SEND_RSSI_DATA)
+   ADC_MultiModeDMARequestAfterLastTransferCmd(ENABLE);
+#else
+   ADC_DMARequestAfterLastTransferCmd(ADC1, ENABLE);
+   ADC_DMACmd(ADC1, ENABLE);
+#endif
+#endif
+
    // Init the DAC
    DAC_InitTypeDef DAC_InitStructure;
 
@@ -282,12 +396,49 @@ void CIO::startInt()
    GPIO_InitStruct.GPIO_PuPd  = GPIO_PuPd_NOPULL;
    GPIO_Init(GPIOA, &GPIO_InitStruct);
 
+#if defined(USE_DMA_IO)
+   DAC_InitStructure.DAC_Trigger = DAC_Trigger_T2_TRGO;
+#else
    DAC_InitStructure.DAC_Trigger = DAC_Trigger_None;
+#endif
    DAC_InitStructure.DAC_WaveGeneration = DAC_WaveGeneration_None;
    DAC_InitStructure.DAC_OutputBuffer = DAC_OutputBuffer_Enable;
    DAC_Init(PIN_TX_CH, &DAC_InitStructure);
    DAC_Cmd(PIN_TX_CH, ENABLE);
 
+#if defined(USE_DMA_IO)
+   // DAC DMA, DMA1 Stream5 (DAC1) or Stream6 (DAC2) Channel7, circular, no interrupts as it is
+   // clocked by the same timer as the ADC
+   for (uint16_t i = 0U; i < (2U * IO_BLOCK_SIZE); i++)
+      s_dacDMA[i] = DC_OFFSET;
+
+   // The first trigger outputs the holding register before the DMA has written to it
+#if defined(STM32F4_NUCLEO) && defined(STM32F4_NUCLEO_ARDUINO_HEADER)
+   DAC_SetChannel2Data(DAC_Align_12b_R, DC_OFFSET);
+#else
+   DAC_SetChannel1Data(DAC_Align_12b_R, DC_OFFSET);
+#endif
+
+   RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_DMA1, ENABLE);
+
+   DMA_StructInit(&DMA_InitStructure);
+   DMA_InitStructure.DMA_Channel            = DMA_Channel_7;
+   DMA_InitStructure.DMA_PeripheralBaseAddr = DAC_DHR_ADDRESS;
+   DMA_InitStructure.DMA_Memory0BaseAddr    = (uint32_t)s_dacDMA;
+   DMA_InitStructure.DMA_DIR                = DMA_DIR_MemoryToPeripheral;
+   DMA_InitStructure.DMA_BufferSize         = 2U * IO_BLOCK_SIZE;
+   DMA_InitStructure.DMA_PeripheralInc      = DMA_PeripheralInc_Disable;
+   DMA_InitStructure.DMA_MemoryInc          = DMA_MemoryInc_Enable;
+   DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+   DMA_InitStructure.DMA_MemoryDataSize     = DMA_MemoryDataSize_HalfWord;
+   DMA_InitStructure.DMA_Mode               = DMA_Mode_Circular;
+   DMA_InitStructure.DMA_Priority           = DMA_Priority_High;
+   DMA_Init(DAC_DMA_STREAM, &DMA_InitStructure);
+
+   DMA_Cmd(DAC_DMA_STREAM, ENABLE);
+   DAC_DMACmd(PIN_TX_CH, ENABLE);
+#endif
+
    // Init the timer
    RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM2, ENABLE);
 
@@ -324,6 +475,16 @@ void CIO::startInt()
    TIM_InternalClockConfig(TIM2);
 #endif
 
+#if defined(USE_DMA_IO)
+   // Trigger the ADC and the DAC on each update, the DMA interrupt does the work
+   TIM_SelectOutputTrigger(TIM2, TIM_TRGOSource_Update);
+
+   // Enable TIM2
+   TIM_Cmd(TIM2, ENABLE);
+
+   NVIC_InitTypeDef nvicStructure;
+   nvicStructure.NVIC_IRQChannel                   = DMA2_Stream0_IRQn;
+#else
    // Enable TIM2
    TIM_Cmd(TIM2, ENABLE);
    // Enable TIM2 interrupt
@@ -331,6 +492,7 @@ void CIO::startInt()
 
    NVIC_InitTypeDef nvicStructure;
    nvicStructure.NVIC_IRQChannel                   = TIM2_IRQn;
+#endif
    nvicStructure.NVIC_IRQChannelPreemptionPriority = 0;
    nvicStructure.NVIC_IRQChannelSubPriority        = 1;
    nvicStructure.NVIC_IRQChannelCmd                = ENABLE;
@@ -342,6 +504,9 @@ void CIO::startInt()
 
 void CIO::interrupt()
 {
+   PROFILE_START(isrStart);
+   PROFILE_INTERRUPT(isrStart, 1U);
+
    TSample sample = {DC_OFFSET, MARK_NONE};
    uint16_t rawRSSI = 0U;
 
@@ -355,11 +520,12 @@ void CIO::interrupt()
 #endif
 
    // Read value from ADC1 and ADC2
+   uint16_t rawSample = 0U;
    if ((ADC_GetFlagStatus(ADC1, ADC_FLAG_EOC) == RESET)) {
       // shouldn't be still in reset at this point so null the sample value?
-      sample.sample  = 0U;
+      rawSample = 0U;
    } else {
-      sample.sample  = ADC_GetConversionValue(ADC1);
+      rawSample = ADC_GetConversionValue(ADC1);
 #if defined(SEND_RSSI_DATA)
       rawRSSI = ADC_GetConversionValue(ADC2);
 #endif
@@ -369,10 +535,11 @@ void CIO::interrupt()
    ADC_ClearFlag(ADC1, ADC_FLAG_EOC);
    ADC_SoftwareStartConv(ADC1);
 
-   m_rxBuffer.put(sample);
-   m_rssiBuffer.put(rawRSSI);
+   m_rxBuffer.put(packRXSample(rawSample, rawRSSI, sample.control));
 
    m_watchdog++;
+
+   PROFILE_STOP(PROFILE_ISR, isrStart);
 }
 
 bool CIO::getCOSInt()
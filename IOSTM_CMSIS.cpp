@@ -369,6 +369,9 @@ void CIO::startInt()
 
 void CIO::interrupt()
 {
+  PROFILE_START(isrStart);
+  PROFILE_INTERRUPT(isrStart, 1U);
+
   TSample sample = {DC_OFFSET, MARK_NONE};
 #if defined(SEND_RSSI_DATA)
   uint16_t rawRSSI = 0U;
@@ -390,15 +393,18 @@ void CIO::interrupt()
     DAC->DHR12R1 = sample.sample;  // Send the value to the DAC
 
     // Read value from ADC1 and ADC2
-    sample.sample  = ADC1->DR;   // read conversion result; EOC is cleared by this read
-    m_rxBuffer.put(sample);
+    uint16_t rawSample = ADC1->DR;   // read conversion result; EOC is cleared by this read
 #if defined(SEND_RSSI_DATA)
     rawRSSI = ADC2->DR;
-    m_rssiBuffer.put(rawRSSI);
+    m_rxBuffer.put(packRXSample(rawSample, rawRSSI, sample.control));
+#else
+    m_rxBuffer.put(packRXSample(rawSample, 0U, sample.control));
 #endif
 
     m_watchdog++;
   }
+
+  PROFILE_STOP(PROFILE_ISR, isrStart);
 }
 
 bool CIO::getCOSInt()
@@ -164,30 +164,28 @@ void CIO::startInt()
 
 void CIO::interrupt()
 {
+  PROFILE_START(isrStart);
+  PROFILE_INTERRUPT(isrStart, 1U);
+
    TSample sample = {DC_OFFSET, MARK_NONE};
 
   m_txBuffer.get(sample);
   *(int16_t *)&(DAC0_DAT0L) = sample.sample;
 
-  if ((ADC0_SC1A & ADC_SC1_COCO) == ADC_SC1_COCO) {
-    sample.sample = ADC0_RA;
-    m_rxBuffer.put(sample);
-  }
-    
+  uint16_t rssi = 0U;
 #if defined(SEND_RSSI_DATA)
-  if ((ADC1_SC1A & ADC_SC1_COCO) == ADC_SC1_COCO) {
-    uint16_t rssi = ADC1_RA;
-    m_rssiBuffer.put(rssi);
-  } else {
-    m_rssiBuffer.put(0U);
-  }
+  if ((ADC1_SC1A & ADC_SC1_COCO) == ADC_SC1_COCO)
+    rssi = ADC1_RA;
 
   ADC1_SC1A  = PIN_RSSI;         				    // Start the next RSSI conversion
-#else
-  m_rssiBuffer.put(0U);
 #endif
 
+  if ((ADC0_SC1A & ADC_SC1_COCO) == ADC_SC1_COCO)
+    m_rxBuffer.put(packRXSample(ADC0_RA, rssi, sample.control));
+
   m_watchdog++;
+
+  PROFILE_STOP(PROFILE_ISR, isrStart);
 }
 
 bool CIO::getCOSInt()
@@ -20,6 +20,7 @@
 #define  M17DEFINES_H
 
 const unsigned int M17_RADIO_SYMBOL_LENGTH = 5U;      // At 24 kHz sample rate
+const unsigned int M17_DEVIATION           = 2400U;   // Of the outer symbols, in Hz
 
 const unsigned int M17_FRAME_LENGTH_BITS    = 384U;
 const unsigned int M17_FRAME_LENGTH_BYTES   = M17_FRAME_LENGTH_BITS / 8U;
@@ -24,44 +24,28 @@
 #include "M17RX.h"
 #include "Utils.h"
 
-const q15_t SCALING_FACTOR = 18750;      // Q15(0.55)
-
 const uint8_t MAX_SYNC_BIT_START_ERRS = 0U;
 const uint8_t MAX_SYNC_BIT_RUN_ERRS   = 2U;
 
 const uint8_t MAX_SYNC_SYMBOL_START_ERRS = 0U;
 const uint8_t MAX_SYNC_SYMBOL_RUN_ERRS   = 1U;
 
-const uint8_t BIT_MASK_TABLE[] = {0x80U, 0x40U, 0x20U, 0x10U, 0x08U, 0x04U, 0x02U, 0x01U};
-
-#define WRITE_BIT1(p,i,b) p[(i)>>3] = (b) ? (p[(i)>>3] | BIT_MASK_TABLE[(i)&7]) : (p[(i)>>3] & ~BIT_MASK_TABLE[(i)&7])
-
-const uint8_t NOAVEPTR = 99U;
-
 const uint16_t NOENDPTR = 9999U;
 
 const unsigned int MAX_SYNC_FRAMES = 3U + 1U;
 
 CM17RX::CM17RX() :
 m_state(M17RXS_NONE),
-m_bitBuffer(),
-m_buffer(),
-m_bitPtr(0U),
-m_dataPtr(0U),
+m_demod(),
+m_symbols(),
 m_startPtr(NOENDPTR),
 m_endPtr(NOENDPTR),
 m_syncPtr(NOENDPTR),
 m_minSyncPtr(NOENDPTR),
 m_maxSyncPtr(NOENDPTR),
-m_maxCorr(0),
 m_lostCount(0U),
 m_countdown(0U),
 m_nextState(M17RXS_NONE),
-m_centre(),
-m_centreVal(0),
-m_threshold(),
-m_thresholdVal(0),
-m_averagePtr(NOAVEPTR),
 m_rssiAccum(0U),
 m_rssiCount(0U)
 {
@@ -69,23 +53,19 @@ m_rssiCount(0U)
 
 void CM17RX::reset()
 {
-  m_state        = M17RXS_NONE;
-  m_dataPtr      = 0U;
-  m_bitPtr       = 0U;
-  m_maxCorr      = 0;
-  m_averagePtr   = NOAVEPTR;
-  m_startPtr     = NOENDPTR;
-  m_endPtr       = NOENDPTR;
-  m_syncPtr      = NOENDPTR;
-  m_minSyncPtr   = NOENDPTR;
-  m_maxSyncPtr   = NOENDPTR;
-  m_centreVal    = 0;
-  m_thresholdVal = 0;
-  m_lostCount    = 0U;
-  m_countdown    = 0U;
-  m_nextState    = M17RXS_NONE;
-  m_rssiAccum    = 0U;
-  m_rssiCount    = 0U;
+  m_state      = M17RXS_NONE;
+  m_startPtr   = NOENDPTR;
+  m_endPtr     = NOENDPTR;
+  m_syncPtr    = NOENDPTR;
+  m_minSyncPtr = NOENDPTR;
+  m_maxSyncPtr = NOENDPTR;
+  m_lostCount  = 0U;
+  m_countdown  = 0U;
+  m_nextState  = M17RXS_NONE;
+  m_rssiAccum  = 0U;
+  m_rssiCount  = 0U;
+
+  m_demod.reset();
 }
 
 void CM17RX::samples(const q15_t* samples, uint16_t* rssi, uint8_t length)
@@ -96,11 +76,7 @@ void CM17RX::samples(const q15_t* samples, uint16_t* rssi, uint8_t length)
     m_rssiAccum += rssi[i];
     m_rssiCount++;
 
-    m_bitBuffer[m_bitPtr] <<= 1;
-    if (sample < 0)
-      m_bitBuffer[m_bitPtr] |= 0x01U;
-
-    m_buffer[m_dataPtr] = sample;
+    m_demod.add(sample);
 
     switch (m_state) {
     case M17RXS_LINK_SETUP:
@@ -111,14 +87,6 @@ void CM17RX::samples(const q15_t* samples, uint16_t* rssi, uint8_t length)
       processNone(sample);
       break;
     }
-
-    m_dataPtr++;
-    if (m_dataPtr >= M17_FRAME_LENGTH_SAMPLES)
-      m_dataPtr = 0U;
-
-    m_bitPtr++;
-    if (m_bitPtr >= M17_RADIO_SYMBOL_LENGTH)
-      m_bitPtr = 0U;
   }
 }
 
@@ -136,7 +104,7 @@ void CM17RX::processNone(q15_t sample)
       io.setDecode(true);
       io.setADCDetection(true);
 
-      m_averagePtr = NOAVEPTR;
+      m_demod.restart();
 
       m_countdown = 5U;
       
@@ -149,13 +117,8 @@ void CM17RX::processNone(q15_t sample)
     m_countdown--;
 
   if (m_countdown == 1U) {
-    m_minSyncPtr = m_syncPtr + M17_FRAME_LENGTH_SAMPLES - 1U;
-    if (m_minSyncPtr >= M17_FRAME_LENGTH_SAMPLES)
-      m_minSyncPtr -= M17_FRAME_LENGTH_SAMPLES;
-
-    m_maxSyncPtr = m_syncPtr + 1U;
-    if (m_maxSyncPtr >= M17_FRAME_LENGTH_SAMPLES)
-      m_maxSyncPtr -= M17_FRAME_LENGTH_SAMPLES;
+    m_minSyncPtr = m_demod.move(m_syncPtr, -1);
+    m_maxSyncPtr = m_demod.move(m_syncPtr, +1);
 
     m_state     = m_nextState;
     m_countdown = 0U;
@@ -167,68 +130,58 @@ void CM17RX::processData(q15_t sample)
 {
   bool eof = false;
 
-  if (m_minSyncPtr < m_maxSyncPtr) {
-    if (m_dataPtr >= m_minSyncPtr && m_dataPtr <= m_maxSyncPtr) {
-      bool ret = correlateSync(M17_STREAM_SYNC_SYMBOLS, M17_STREAM_SYNC_SYMBOLS_VALUES, M17_STREAM_SYNC_BYTES,  MAX_SYNC_SYMBOL_RUN_ERRS, MAX_SYNC_BIT_RUN_ERRS);
-
-      eof = correlateSync(M17_EOF_SYNC_SYMBOLS, M17_EOF_SYNC_SYMBOLS_VALUES, M17_EOF_SYNC_BYTES, MAX_SYNC_SYMBOL_RUN_ERRS, MAX_SYNC_BIT_RUN_ERRS);
+  if (m_demod.inWindow(m_demod.ptr(), m_minSyncPtr, m_maxSyncPtr)) {
+    bool ret = correlateSync(M17_STREAM_SYNC_SYMBOLS, M17_STREAM_SYNC_SYMBOLS_VALUES, M17_STREAM_SYNC_BYTES,  MAX_SYNC_SYMBOL_RUN_ERRS, MAX_SYNC_BIT_RUN_ERRS);
 
-      if (ret) m_state = M17RXS_STREAM;
-    }
-  } else {
-    if (m_dataPtr >= m_minSyncPtr || m_dataPtr <= m_maxSyncPtr) {
-      bool ret = correlateSync(M17_STREAM_SYNC_SYMBOLS, M17_STREAM_SYNC_SYMBOLS_VALUES, M17_STREAM_SYNC_BYTES,  MAX_SYNC_SYMBOL_RUN_ERRS, MAX_SYNC_BIT_RUN_ERRS);
+    eof = correlateSync(M17_EOF_SYNC_SYMBOLS, M17_EOF_SYNC_SYMBOLS_VALUES, M17_EOF_SYNC_BYTES, MAX_SYNC_SYMBOL_RUN_ERRS, MAX_SYNC_BIT_RUN_ERRS);
 
-      eof = correlateSync(M17_EOF_SYNC_SYMBOLS, M17_EOF_SYNC_SYMBOLS_VALUES, M17_EOF_SYNC_BYTES, MAX_SYNC_SYMBOL_RUN_ERRS, MAX_SYNC_BIT_RUN_ERRS);
-
-      if (ret) m_state = M17RXS_STREAM;
-    }
+    if (ret) m_state = M17RXS_STREAM;
   }
 
   if (eof) {
-    DEBUG4("M17RX: eof sync found pos/centre/threshold", m_syncPtr, m_centreVal, m_thresholdVal);
+    DEBUG4("M17RX: eof sync found pos/centre/threshold", m_syncPtr, m_demod.centre(), m_demod.threshold());
 
     io.setDecode(false);
     io.setADCDetection(false);
 
-    serial.writeM17EOT();
+    serial.writeM17EOT(m_demod.offset(M17_DEVIATION));
+
+    m_state     = M17RXS_NONE;
+    m_endPtr    = NOENDPTR;
+    m_countdown = 0U;
+    m_nextState = M17RXS_NONE;
 
-    m_state      = M17RXS_NONE;
-    m_endPtr     = NOENDPTR;
-    m_averagePtr = NOAVEPTR;
-    m_countdown  = 0U;
-    m_nextState  = M17RXS_NONE;
-    m_maxCorr    = 0;
+    m_demod.restart();
+    m_demod.nextSync();
   }
 
-  if (m_dataPtr == m_endPtr) {
-    // Only update the centre and threshold if they are from a good sync
-    if (m_lostCount == MAX_SYNC_FRAMES) {
-      m_minSyncPtr = m_syncPtr + M17_FRAME_LENGTH_SAMPLES - 1U;
-      if (m_minSyncPtr >= M17_FRAME_LENGTH_SAMPLES)
-        m_minSyncPtr -= M17_FRAME_LENGTH_SAMPLES;
+  if (m_demod.ptr() == m_endPtr) {
+    // The whole frame is in the buffer, the oldest sample being the first of the frame
+    m_demod.resync();
+    m_demod.extract(m_startPtr, M17_FRAME_LENGTH_SAMPLES, m_symbols, M17_FRAME_LENGTH_SYMBOLS);
 
-      m_maxSyncPtr = m_syncPtr + 1U;
-      if (m_maxSyncPtr >= M17_FRAME_LENGTH_SAMPLES)
-        m_maxSyncPtr -= M17_FRAME_LENGTH_SAMPLES;
+    // After a good sync, look for the next one from where this one was to where the transmitter's
+    // clock has taken it, and add its levels to the carrier offset
+    if (m_lostCount == MAX_SYNC_FRAMES) {
+      m_demod.syncWindow(m_syncPtr, m_minSyncPtr, m_maxSyncPtr);
+      m_demod.measureOffset(io.getDCLevel(STATE_M17));
     }
 
-    calculateLevels(m_startPtr, M17_FRAME_LENGTH_SYMBOLS);
+    uint8_t frame[M17_FRAME_LENGTH_BYTES + 3U];
+    m_demod.trackLevels(m_symbols, M17_FRAME_LENGTH_SYMBOLS, frame, 8U);
+    DEBUG5("M17RX: pos/neg/centre/threshold", m_demod.posLevel(), m_demod.negLevel(), m_demod.centre(), m_demod.threshold());
 
     switch (m_state) {
       case M17RXS_LINK_SETUP:
-        DEBUG4("M17RX: link setup sync found pos/centre/threshold", m_syncPtr, m_centreVal, m_thresholdVal);
+        DEBUG4("M17RX: link setup sync found pos/centre/threshold", m_syncPtr, m_demod.centre(), m_demod.threshold());
         break;
       case M17RXS_STREAM:
-        DEBUG4("M17RX: stream sync found pos/centre/threshold", m_syncPtr, m_centreVal, m_thresholdVal);
+        DEBUG4("M17RX: stream sync found pos/centre/threshold", m_syncPtr, m_demod.centre(), m_demod.threshold());
         break;
       default:
         break;  
     }
 
-    uint8_t frame[M17_FRAME_LENGTH_BYTES + 3U];
-    samplesToBits(m_startPtr, M17_FRAME_LENGTH_SYMBOLS, frame, 8U, m_centreVal, m_thresholdVal);
-
     // We've not seen a stream sync for too long, signal RXLOST and change to RX_NONE
     m_lostCount--;
     if (m_lostCount == 0U) {
@@ -237,14 +190,15 @@ void CM17RX::processData(q15_t sample)
       io.setDecode(false);
       io.setADCDetection(false);
 
-      serial.writeM17Lost();
+      serial.writeM17Lost(m_demod.offset(M17_DEVIATION));
 
-      m_state      = M17RXS_NONE;
-      m_endPtr     = NOENDPTR;
-      m_averagePtr = NOAVEPTR;
-      m_countdown  = 0U;
-      m_nextState  = M17RXS_NONE;
-      m_maxCorr    = 0;
+      m_state     = M17RXS_NONE;
+      m_endPtr    = NOENDPTR;
+      m_countdown = 0U;
+      m_nextState = M17RXS_NONE;
+
+      m_demod.restart();
+      m_demod.nextSync();
     } else {
       frame[0U] = m_lostCount == (MAX_SYNC_FRAMES - 1U) ? 0x01U : 0x00U;
 
@@ -259,7 +213,7 @@ void CM17RX::processData(q15_t sample)
           break;  
       }
 
-      m_maxCorr   = 0;
+      m_demod.nextSync();
       m_nextState = M17RXS_NONE;
     }
   }
@@ -267,176 +221,23 @@ void CM17RX::processData(q15_t sample)
 
 bool CM17RX::correlateSync(uint8_t syncSymbols, const int8_t* syncSymbolValues, const uint8_t* syncBytes, uint8_t maxSymbolErrs, uint8_t maxBitErrs)
 {
-  if (countBits8(m_bitBuffer[m_bitPtr] ^ syncSymbols) <= maxSymbolErrs) {
-    uint16_t ptr = m_dataPtr + M17_FRAME_LENGTH_SAMPLES - M17_SYNC_LENGTH_SAMPLES + M17_RADIO_SYMBOL_LENGTH;
-    if (ptr >= M17_FRAME_LENGTH_SAMPLES)
-      ptr -= M17_FRAME_LENGTH_SAMPLES;
-
-    q31_t corr = 0;
-    q15_t min =  16000;
-    q15_t max = -16000;
-
-    for (uint8_t i = 0U; i < M17_SYNC_LENGTH_SYMBOLS; i++) {
-      q15_t val = m_buffer[ptr];
-
-      if (val > max)
-        max = val;
-      if (val < min)
-        min = val;
-
-      switch (syncSymbolValues[i]) {
-      case +3:
-        corr -= (val + val + val);
-        break;
-      case +1:
-        corr -= val;
-        break;
-      case -1:
-        corr += val;
-        break;
-      default:  // -3
-        corr += (val + val + val);
-        break;
-      }
-
-      ptr += M17_RADIO_SYMBOL_LENGTH;
-      if (ptr >= M17_FRAME_LENGTH_SAMPLES)
-        ptr -= M17_FRAME_LENGTH_SAMPLES;
-    }
+  if (m_demod.searchErrors(syncSymbols, 0xFFU) > maxSymbolErrs)
+    return false;
 
-    if (corr > m_maxCorr) {
-      if (m_averagePtr == NOAVEPTR) {
-        m_centreVal = (max + min) >> 1;
-
-        q31_t v1 = (max - m_centreVal) * SCALING_FACTOR;
-        m_thresholdVal = q15_t(v1 >> 15);
-      }
+  if (!m_demod.correlateSync(syncSymbolValues, syncBytes, NULL, 0U, maxBitErrs))
+    return false;
 
-      uint16_t startPtr = m_dataPtr + M17_FRAME_LENGTH_SAMPLES - M17_SYNC_LENGTH_SAMPLES + M17_RADIO_SYMBOL_LENGTH;
-      if (startPtr >= M17_FRAME_LENGTH_SAMPLES)
-        startPtr -= M17_FRAME_LENGTH_SAMPLES;
+  m_lostCount = MAX_SYNC_FRAMES;
+  m_syncPtr   = m_demod.ptr();
 
-      uint8_t sync[M17_SYNC_LENGTH_BYTES];
-      samplesToBits(startPtr, M17_SYNC_LENGTH_SYMBOLS, sync, 0U, m_centreVal, m_thresholdVal);
+  m_startPtr = m_demod.syncStart();
 
-      uint8_t errs = 0U;
-      for (uint8_t i = 0U; i < M17_SYNC_LENGTH_BYTES; i++)
-        errs += countBits8(sync[i] ^ syncBytes[i]);
+  // Wait for the last sample of the frame, the one before its first is overwritten
+  m_endPtr = m_startPtr + M17_FRAME_LENGTH_SAMPLES - 1U;
+  if (m_endPtr >= M17_FRAME_LENGTH_SAMPLES)
+    m_endPtr -= M17_FRAME_LENGTH_SAMPLES;
 
-      if (errs <= maxBitErrs) {
-        m_maxCorr   = corr;
-        m_lostCount = MAX_SYNC_FRAMES;
-        m_syncPtr   = m_dataPtr;
-
-        m_startPtr = startPtr;
-
-        m_endPtr = m_dataPtr + M17_FRAME_LENGTH_SAMPLES - M17_SYNC_LENGTH_SAMPLES - 1U;
-        if (m_endPtr >= M17_FRAME_LENGTH_SAMPLES)
-          m_endPtr -= M17_FRAME_LENGTH_SAMPLES;
-
-        return true;
-      }
-    }
-  }
-
-  return false;
-}
-
-void CM17RX::calculateLevels(uint16_t start, uint16_t count)
-{
-  q15_t maxPos = -16000;
-  q15_t minPos =  16000;
-  q15_t maxNeg =  16000;
-  q15_t minNeg = -16000;
-
-  for (uint16_t i = 0U; i < count; i++) {
-    q15_t sample = m_buffer[start];
-
-    if (sample > 0) {
-      if (sample > maxPos)
-        maxPos = sample;
-      if (sample < minPos)
-        minPos = sample;
-    } else {
-      if (sample < maxNeg)
-        maxNeg = sample;
-      if (sample > minNeg)
-        minNeg = sample;
-    }
-
-    start += M17_RADIO_SYMBOL_LENGTH;
-    if (start >= M17_FRAME_LENGTH_SAMPLES)
-      start -= M17_FRAME_LENGTH_SAMPLES;
-  }
-
-  q15_t posThresh = (maxPos + minPos) >> 1;
-  q15_t negThresh = (maxNeg + minNeg) >> 1;
-
-  q15_t centre = (posThresh + negThresh) >> 1;
-
-  q15_t threshold = posThresh - centre;
-
-  DEBUG5("M17RX: pos/neg/centre/threshold", posThresh, negThresh, centre, threshold);
-
-  if (m_averagePtr == NOAVEPTR) {
-    for (uint8_t i = 0U; i < 16U; i++) {
-      m_centre[i] = centre;
-      m_threshold[i] = threshold;
-    }
-
-    m_averagePtr = 0U;
-  } else {
-    m_centre[m_averagePtr] = centre;
-    m_threshold[m_averagePtr] = threshold;
-
-    m_averagePtr++;
-    if (m_averagePtr >= 16U)
-      m_averagePtr = 0U;
-  }
-
-  m_centreVal = 0;
-  m_thresholdVal = 0;
-
-  for (uint8_t i = 0U; i < 16U; i++) {
-    m_centreVal += m_centre[i];
-    m_thresholdVal += m_threshold[i];
-  }
-
-  m_centreVal >>= 4;
-  m_thresholdVal >>= 4;
-}
-
-void CM17RX::samplesToBits(uint16_t start, uint16_t count, uint8_t* buffer, uint16_t offset, q15_t centre, q15_t threshold)
-{
-  for (uint16_t i = 0U; i < count; i++) {
-    q15_t sample = m_buffer[start] - centre;
-
-    if (sample < -threshold) {
-      WRITE_BIT1(buffer, offset, false);
-      offset++;
-      WRITE_BIT1(buffer, offset, true);
-      offset++;
-    } else if (sample < 0) {
-      WRITE_BIT1(buffer, offset, false);
-      offset++;
-      WRITE_BIT1(buffer, offset, false);
-      offset++;
-    } else if (sample < threshold) {
-      WRITE_BIT1(buffer, offset, true);
-      offset++;
-      WRITE_BIT1(buffer, offset, false);
-      offset++;
-    } else {
-      WRITE_BIT1(buffer, offset, true);
-      offset++;
-      WRITE_BIT1(buffer, offset, true);
-      offset++;
-    }
-
-    start += M17_RADIO_SYMBOL_LENGTH;
-    if (start >= M17_FRAME_LENGTH_SAMPLES)
-      start -= M17_FRAME_LENGTH_SAMPLES;
-  }
+  return true;
 }
 
 void CM17RX::writeRSSILinkSetup(uint8_t* data)
@@ -448,18 +249,38 @@ void CM17RX::writeRSSILinkSetup(uint8_t* data)
     data[49U] = (rssi >> 8) & 0xFFU;
     data[50U] = (rssi >> 0) & 0xFFU;
 
-    serial.writeM17LinkSetup(data, M17_FRAME_LENGTH_BYTES + 3U);
+    writeLinkSetup(data, M17_FRAME_LENGTH_BYTES + 3U);
   } else {
-    serial.writeM17LinkSetup(data, M17_FRAME_LENGTH_BYTES + 1U);
+    writeLinkSetup(data, M17_FRAME_LENGTH_BYTES + 1U);
   }
 #else
-  serial.writeM17LinkSetup(data, M17_FRAME_LENGTH_BYTES + 1U);
+  writeLinkSetup(data, M17_FRAME_LENGTH_BYTES + 1U);
 #endif
 
   m_rssiAccum = 0U;
   m_rssiCount = 0U;
 }
 
+// Send the hard bits, or the soft symbols with the same control byte and RSSI if the host wants them
+void CM17RX::writeLinkSetup(const uint8_t* frame, uint8_t length)
+{
+  if (!serial.getSoftSymbols()) {
+    serial.writeM17LinkSetup(frame, length);
+    return;
+  }
+
+  uint8_t data[M17_FRAME_LENGTH_SYMBOLS / 2U + 3U];
+  data[0U] = frame[0U];
+
+  m_demod.samplesToSoft(m_symbols, M17_FRAME_LENGTH_SYMBOLS, data + 1U);
+
+  uint8_t count = M17_FRAME_LENGTH_SYMBOLS / 2U + 1U;
+  for (uint8_t i = M17_FRAME_LENGTH_BYTES + 1U; i < length; i++, count++)
+    data[count] = frame[i];
+
+  serial.writeM17LinkSetupSoft(data, count);
+}
+
 void CM17RX::writeRSSIStream(uint8_t* data)
 {
 #if defined(SEND_RSSI_DATA)
@@ -469,17 +290,37 @@ void CM17RX::writeRSSIStream(uint8_t* data)
     data[49U] = (rssi >> 8) & 0xFFU;
     data[50U] = (rssi >> 0) & 0xFFU;
 
-    serial.writeM17Stream(data, M17_FRAME_LENGTH_BYTES + 3U);
+    writeStream(data, M17_FRAME_LENGTH_BYTES + 3U);
   } else {
-    serial.writeM17Stream(data, M17_FRAME_LENGTH_BYTES + 1U);
+    writeStream(data, M17_FRAME_LENGTH_BYTES + 1U);
   }
 #else
-  serial.writeM17Stream(data, M17_FRAME_LENGTH_BYTES + 1U);
+  writeStream(data, M17_FRAME_LENGTH_BYTES + 1U);
 #endif
 
   m_rssiAccum = 0U;
   m_rssiCount = 0U;
 }
 
+// Send the hard bits, or the soft symbols with the same control byte and RSSI if the host wants them
+void CM17RX::writeStream(const uint8_t* frame, uint8_t length)
+{
+  if (!serial.getSoftSymbols()) {
+    serial.writeM17Stream(frame, length);
+    return;
+  }
+
+  uint8_t data[M17_FRAME_LENGTH_SYMBOLS / 2U + 3U];
+  data[0U] = frame[0U];
+
+  m_demod.samplesToSoft(m_symbols, M17_FRAME_LENGTH_SYMBOLS, data + 1U);
+
+  uint8_t count = M17_FRAME_LENGTH_SYMBOLS / 2U + 1U;
+  for (uint8_t i = M17_FRAME_LENGTH_BYTES + 1U; i < length; i++, count++)
+    data[count] = frame[i];
+
+  serial.writeM17StreamSoft(data, count);
+}
+
 #endif
 
@@ -24,6 +24,10 @@
 #define  M17RX_H
 
 #include "M17Defines.h"
+#include "FSKDemod.h"
+
+// The sync's threshold at Q15(0.57) of its peak, each symbol moving its level by an eighth
+typedef CFSKDemod<uint8_t, M17_FRAME_LENGTH_SAMPLES, M17_RADIO_SYMBOL_LENGTH, M17_SYNC_LENGTH_SYMBOLS, 18750, 3U, false> CM17Demod;
 
 enum M17RX_STATE {
   M17RXS_NONE,
@@ -41,34 +45,26 @@ public:
 
 private:
   M17RX_STATE m_state;
-  uint8_t     m_bitBuffer[M17_RADIO_SYMBOL_LENGTH];
-  q15_t       m_buffer[M17_FRAME_LENGTH_SAMPLES];
-  uint16_t    m_bitPtr;
-  uint16_t    m_dataPtr;
+  CM17Demod   m_demod;
+  q15_t       m_symbols[M17_FRAME_LENGTH_SYMBOLS];
   uint16_t    m_startPtr;
   uint16_t    m_endPtr;
   uint16_t    m_syncPtr;
   uint16_t    m_minSyncPtr;
   uint16_t    m_maxSyncPtr;
-  q31_t       m_maxCorr;
   uint16_t    m_lostCount;
   uint8_t     m_countdown;
   M17RX_STATE m_nextState;
-  q15_t       m_centre[16U];
-  q15_t       m_centreVal;
-  q15_t       m_threshold[16U];
-  q15_t       m_thresholdVal;
-  uint8_t     m_averagePtr;
   uint32_t    m_rssiAccum;
   uint16_t    m_rssiCount;
 
   void processNone(q15_t sample);
   void processData(q15_t sample);
   bool correlateSync(uint8_t syncSymbols, const int8_t* syncSymbolValues, const uint8_t* syncBytes, uint8_t maxSymbolErrs, uint8_t maxBitErrs);
-  void calculateLevels(uint16_t start, uint16_t count);
-  void samplesToBits(uint16_t start, uint16_t count, uint8_t* buffer, uint16_t offset, q15_t centre, q15_t threshold);
   void writeRSSILinkSetup(uint8_t* data);
   void writeRSSIStream(uint8_t* data);
+  void writeLinkSetup(const uint8_t* frame, uint8_t length);
+  void writeStream(const uint8_t* frame, uint8_t length);
 };
 
 #endif
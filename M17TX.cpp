@@ -31,21 +31,18 @@ static q15_t RRC_0_5_FILTER[] = {0, 0, 0, 0, -290, -174, 142, 432, 438, 90, -387
 				  -980, -3326, -4648, -3062, 2527, 11552, 21705, 29724, 32767, 29724, 21705,
 				  11552, 2527, -3062, -4648, -3326, -980, 767, 1225, 658, -155, -561, -387, 90,
 				  438, 432, 142, -174, -290}; // numTaps = 45, L = 5
-const uint16_t RRC_0_5_FILTER_PHASE_LEN = 9U; // phaseLength = numTaps/L
+const uint16_t RRC_0_5_FILTER_LEN = 45U;
 
 const q15_t M17_LEVELA =  1481;
 const q15_t M17_LEVELB =  494;
-const q15_t M17_LEVELC = -494;
-const q15_t M17_LEVELD = -1481;
 
 const uint8_t M17_START_SYNC = 0x77U;
 const uint8_t M17_END_SYNC   = 0xFFU;
 const uint8_t M17_HANG       = 0x00U;
 
 CM17TX::CM17TX() :
-m_buffer(TX_BUFFER_LEN),
-m_modFilter(),
-m_modState(),
+m_buffer(),
+m_mod(),
 m_poBuffer(),
 m_poLen(0U),
 m_poPtr(0U),
@@ -53,12 +50,8 @@ m_txDelay(240U),      // 200ms
 m_txHang(4800U),      // 4s
 m_txCount(0U)
 {
-  ::memset(m_modState, 0x00U, 16U * sizeof(q15_t));
-
-  m_modFilter.L           = M17_RADIO_SYMBOL_LENGTH;
-  m_modFilter.phaseLength = RRC_0_5_FILTER_PHASE_LEN;
-  m_modFilter.pCoeffs     = RRC_0_5_FILTER;
-  m_modFilter.pState      = m_modState;
+  m_mod.setFilter(RRC_0_5_FILTER, RRC_0_5_FILTER_LEN);
+  m_mod.setLevels(M17_LEVELA, M17_LEVELB);
 }
 
 void CM17TX::process()
@@ -69,11 +62,7 @@ void CM17TX::process()
       for (uint16_t i = 0U; i < m_txDelay; i++)
         m_poBuffer[m_poLen++] = M17_START_SYNC;
     } else {
-      for (uint8_t i = 0U; i < M17_FRAME_LENGTH_BYTES; i++) {
-        uint8_t c = 0U;
-        m_buffer.get(c);
-        m_poBuffer[m_poLen++] = c;
-      }
+      m_poLen = m_buffer.read(m_poBuffer, M17_FRAME_LENGTH_BYTES);
     }
 
     m_poPtr = 0U;
@@ -119,53 +108,26 @@ uint8_t CM17TX::writeData(const uint8_t* data, uint8_t length)
   if (length != (M17_FRAME_LENGTH_BYTES + 1U))
     return 4U;
 
-  uint16_t space = m_buffer.getSpace();
-  if (space < M17_FRAME_LENGTH_BYTES)
+  if (!m_buffer.hasSpace(M17_FRAME_LENGTH_BYTES))
     return 5U;
 
-  for (uint8_t i = 0U; i < M17_FRAME_LENGTH_BYTES; i++)
-    m_buffer.put(data[i + 1U]);
+  m_buffer.write(data + 1U, M17_FRAME_LENGTH_BYTES);
 
   return 0U;
 }
 
 void CM17TX::writeByte(uint8_t c)
 {
-  q15_t inBuffer[4U];
-  q15_t outBuffer[M17_RADIO_SYMBOL_LENGTH * 4U];
-
-  const uint8_t MASK = 0xC0U;
-
-  for (uint8_t i = 0U; i < 4U; i++, c <<= 2) {
-    switch (c & MASK) {
-      case 0xC0U:
-        inBuffer[i] = M17_LEVELA;
-        break;
-      case 0x80U:
-        inBuffer[i] = M17_LEVELB;
-        break;
-      case 0x00U:
-        inBuffer[i] = M17_LEVELC;
-        break;
-      default:
-        inBuffer[i] = M17_LEVELD;
-        break;
-    }
-  }
-
-  ::arm_fir_interpolate_q15(&m_modFilter, inBuffer, outBuffer, 4U);
+  m_mod.addByte(c);
 
-  io.write(STATE_M17, outBuffer, M17_RADIO_SYMBOL_LENGTH * 4U);
+  io.write(STATE_M17, m_mod);
 }
 
 void CM17TX::writeSilence()
 {
-  q15_t inBuffer[4U] = {0x00U, 0x00U, 0x00U, 0x00U};
-  q15_t outBuffer[M17_RADIO_SYMBOL_LENGTH * 4U];
+  m_mod.addSilence();
 
-  ::arm_fir_interpolate_q15(&m_modFilter, inBuffer, outBuffer, 4U);
-
-  io.write(STATE_M17, outBuffer, M17_RADIO_SYMBOL_LENGTH * 4U);
+  io.write(STATE_M17, m_mod);
 }
 
 void CM17TX::setTXDelay(uint8_t delay)
@@ -181,6 +143,11 @@ uint8_t CM17TX::getSpace() const
   return m_buffer.getSpace() / M17_FRAME_LENGTH_BYTES;
 }
 
+void CM17TX::getBufferStats(TRingStats& stats)
+{
+  m_buffer.getStats(stats);
+}
+
 void CM17TX::setParams(uint8_t txHang)
 {
   m_txHang = txHang * 1200U;
@@ -23,8 +23,13 @@
 #if !defined(M17TX_H)
 #define  M17TX_H
 
+#include "M17Defines.h"
+#include "FSKMod.h"
 #include "RingBuffer.h"
 
+// The RRC filter spans 9 symbols
+typedef CFSKMod<M17_RADIO_SYMBOL_LENGTH, 9U> CM17Mod;
+
 class CM17TX {
 public:
   CM17TX();
@@ -37,12 +42,13 @@ public:
 
   uint8_t getSpace() const;
 
+  void getBufferStats(TRingStats& stats);
+
   void setParams(uint8_t txHang);
 
 private:
-  CRingBuffer<uint8_t>             m_buffer;
-  arm_fir_interpolate_instance_q15 m_modFilter;
-  q15_t                            m_modState[16U];    // blockSize + phaseLength - 1, 4 + 9 - 1 plus some spare
+  CRingBuffer<uint8_t, TX_BUFFER_LEN> m_buffer;
+  CM17Mod                          m_mod;
   uint8_t                          m_poBuffer[1200U];
   uint16_t                         m_poLen;
   uint16_t                         m_poPtr;
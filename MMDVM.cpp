@@ -18,7 +18,7 @@
  *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
-#if defined(STM32F4XX) || defined(STM32F7XX) || defined(STM32F105xC)
+#if defined(STM32F4XX) || defined(STM32F7XX) || defined(STM32F105xC) || defined(HOST_BUILD)
 
 #include "Config.h"
 #include "Globals.h"
@@ -108,106 +108,120 @@ CCWIdTX cwIdTX;
 CSerialPort serial;
 CIO io;
 
+#if defined(USE_PROFILER)
+CProfiler profiler;
+#endif
+
 void setup()
 {
+#if defined(USE_PROFILER)
+  profiler.start();
+#endif
+
   serial.start();
 }
 
 void loop()
 {
-  serial.process();
-  
-  io.process();
+  PROFILE_LOOP();
+
+  PROFILE(PROFILE_SERIAL, serial.process());
+
+  PROFILE(PROFILE_IO, io.process());
 
   // The following is for transmitting
 #if defined(MODE_DSTAR)
   if (m_dstarEnable && m_modemState == STATE_DSTAR)
-    dstarTX.process();
+    PROFILE(PROFILE_DSTAR_TX, dstarTX.process());
 #endif
 
 #if defined(MODE_DMR)
   if (m_dmrEnable && m_modemState == STATE_DMR) {
     if (m_duplex)
-      dmrTX.process();
+      PROFILE(PROFILE_DMR_TX, dmrTX.process());
     else
-      dmrDMOTX.process();
+      PROFILE(PROFILE_DMR_TX, dmrDMOTX.process());
   }
 #endif
 
 #if defined(MODE_YSF)
   if (m_ysfEnable && m_modemState == STATE_YSF)
-    ysfTX.process();
+    PROFILE(PROFILE_YSF_TX, ysfTX.process());
 #endif
 
 #if defined(MODE_P25)
   if (m_p25Enable && m_modemState == STATE_P25)
-    p25TX.process();
+    PROFILE(PROFILE_P25_TX, p25TX.process());
 #endif
 
 #if defined(MODE_NXDN)
   if (m_nxdnEnable && m_modemState == STATE_NXDN)
-    nxdnTX.process();
+    PROFILE(PROFILE_NXDN_TX, nxdnTX.process());
 #endif
 
 #if defined(MODE_M17)
   if (m_m17Enable && m_modemState == STATE_M17)
-    m17TX.process();
+    PROFILE(PROFILE_M17_TX, m17TX.process());
 #endif
 
 #if defined(MODE_POCSAG)
   if (m_pocsagEnable && (m_modemState == STATE_POCSAG || pocsagTX.busy()))
-    pocsagTX.process();
+    PROFILE(PROFILE_POCSAG_TX, pocsagTX.process());
 #endif
 
 #if defined(MODE_AX25)
   if (m_ax25Enable && (m_modemState == STATE_IDLE || m_modemState == STATE_FM))
-    ax25TX.process();
+    PROFILE(PROFILE_AX25_TX, ax25TX.process());
 #endif
 
 #if defined(MODE_FM)
   if (m_fmEnable && m_modemState == STATE_FM)
-    fm.process();
+    PROFILE(PROFILE_FM_TX, fm.process());
 #endif
 
 #if defined(MODE_DSTAR)
   if (m_modemState == STATE_DSTARCAL)
-    calDStarTX.process();
+    PROFILE(PROFILE_CAL_TX, calDStarTX.process());
 #endif
 
 #if defined(MODE_DMR)
   if (m_modemState == STATE_DMRCAL || m_modemState == STATE_LFCAL || m_modemState == STATE_DMRCAL1K || m_modemState == STATE_DMRDMO1K)
-    calDMR.process();
+    PROFILE(PROFILE_CAL_TX, calDMR.process());
 #endif
 
 #if defined(MODE_FM)
   if (m_modemState == STATE_FMCAL10K || m_modemState == STATE_FMCAL12K || m_modemState == STATE_FMCAL15K || m_modemState == STATE_FMCAL20K || m_modemState == STATE_FMCAL25K || m_modemState == STATE_FMCAL30K)
-    calFM.process();
+    PROFILE(PROFILE_CAL_TX, calFM.process());
 #endif
 
 #if defined(MODE_P25)
   if (m_modemState == STATE_P25CAL1K)
-    calP25.process();
+    PROFILE(PROFILE_CAL_TX, calP25.process());
 #endif
 
 #if defined(MODE_NXDN)
   if (m_modemState == STATE_NXDNCAL1K)
-    calNXDN.process();
+    PROFILE(PROFILE_CAL_TX, calNXDN.process());
 #endif
 
 #if defined(MODE_M17)
   if (m_modemState == STATE_M17CAL)
-    calM17.process();
+    PROFILE(PROFILE_CAL_TX, calM17.process());
 #endif
 
 #if defined(MODE_POCSAG)
   if (m_modemState == STATE_POCSAGCAL)
-    calPOCSAG.process();
+    PROFILE(PROFILE_CAL_TX, calPOCSAG.process());
 #endif
 
   if (m_modemState == STATE_IDLE)
-    cwIdTX.process();
+    PROFILE(PROFILE_CWID_TX, cwIdTX.process());
+
+  // What this pass has for the host goes in one write
+  serial.flush();
 }
 
+#if !defined(HOST_BUILD)
 int main()
 {
   setup();
@@ -215,5 +229,6 @@ int main()
   for (;;)
     loop();
 }
+#endif
 
 #endif
@@ -20,6 +20,7 @@
 #define  NXDNDEFINES_H
 
 const unsigned int NXDN_RADIO_SYMBOL_LENGTH = 10U;      // At 24 kHz sample rate
+const unsigned int NXDN_DEVIATION           = 1050U;   // Of the outer symbols, in Hz
 
 const unsigned int NXDN_FRAME_LENGTH_BITS    = 384U;
 const unsigned int NXDN_FRAME_LENGTH_BYTES   = NXDN_FRAME_LENGTH_BITS / 8U;
@@ -24,6 +24,10 @@
 #define  NXDNRX_H
 
 #include "NXDNDefines.h"
+#include "FSKDemod.h"
+
+// The sync's threshold at Q15(0.57) of its peak, each symbol moving its level by an eighth
+typedef CFSKDemod<uint16_t, NXDN_FRAME_LENGTH_SAMPLES, NXDN_RADIO_SYMBOL_LENGTH, NXDN_FSW_LENGTH_SYMBOLS, 18750, 3U, false> CNXDNDemod;
 
 enum NXDNRX_STATE {
   NXDNRXS_NONE,
@@ -40,32 +44,23 @@ public:
 
 private:
   NXDNRX_STATE m_state;
-  uint16_t     m_bitBuffer[NXDN_RADIO_SYMBOL_LENGTH];
-  q15_t        m_buffer[NXDN_FRAME_LENGTH_SAMPLES];
-  uint16_t     m_bitPtr;
-  uint16_t     m_dataPtr;
+  CNXDNDemod   m_demod;
+  q15_t        m_symbols[NXDN_FRAME_LENGTH_SYMBOLS];
   uint16_t     m_startPtr;
   uint16_t     m_endPtr;
   uint16_t     m_fswPtr;
   uint16_t     m_minFSWPtr;
   uint16_t     m_maxFSWPtr;
-  q31_t        m_maxCorr;
   uint16_t     m_lostCount;
   uint8_t      m_countdown;
-  q15_t        m_centre[16U];
-  q15_t        m_centreVal;
-  q15_t        m_threshold[16U];
-  q15_t        m_thresholdVal;
-  uint8_t      m_averagePtr;
   uint32_t     m_rssiAccum;
   uint16_t     m_rssiCount;
 
   void processNone(q15_t sample);
   void processData(q15_t sample);
   bool correlateFSW();
-  void calculateLevels(uint16_t start, uint16_t count);
-  void samplesToBits(uint16_t start, uint16_t count, uint8_t* buffer, uint16_t offset, q15_t centre, q15_t threshold);
   void writeRSSIData(uint8_t* data);
+  void writeData(const uint8_t* frame, uint8_t length);
 };
 
 #endif
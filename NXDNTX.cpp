@@ -33,7 +33,7 @@ static q15_t RRC_0_2_FILTER[] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 850, 592, 219, -234,
                                  32156, 30367, 27520, 23810, 19484, 14822, 10118, 5651, 1669, -1633, -4121, -5735, -6483, -6442,
                                  -5739, -4544, -3043, -1431, 116, 1447, 2454, 3073, 3286, 3120, 2637, 1927, 1092, 237, -544, -1172,
                                  -1597, -1795, -1769, -1548, -1179, -720, -234, 219, 592, 850}; // numTaps = 90, L = 10
-const uint16_t RRC_0_2_FILTER_PHASE_LEN = 9U; // phaseLength = numTaps/L
+const uint16_t RRC_0_2_FILTER_LEN = 90U;
 
 static q15_t NXDN_SINC_FILTER[] = {572, -1003, -253, 254, 740, 1290, 1902, 2527, 3090, 3517, 3747, 3747, 3517, 3090, 2527, 1902,
                                    1290, 740, 254, -253, -1003, 572};
@@ -41,18 +41,13 @@ const uint16_t NXDN_SINC_FILTER_LEN = 22U;
 
 const q15_t NXDN_LEVELA =  735;
 const q15_t NXDN_LEVELB =  245;
-const q15_t NXDN_LEVELC = -245;
-const q15_t NXDN_LEVELD = -735;
 
 const uint8_t NXDN_PREAMBLE[] = {0x57U, 0x75U, 0xFDU};
 const uint8_t NXDN_SYNC = 0x5FU;
 
 CNXDNTX::CNXDNTX() :
-m_buffer(TX_BUFFER_LEN),
-m_modFilter(),
-m_sincFilter(),
-m_modState(),
-m_sincState(),
+m_buffer(),
+m_mod(),
 m_poBuffer(),
 m_poLen(0U),
 m_poPtr(0U),
@@ -60,17 +55,8 @@ m_txDelay(240U),     // 200ms
 m_txHang(3000U),     // 5s
 m_txCount(0U)
 {
-  ::memset(m_modState, 0x00U, 16U * sizeof(q15_t));
-  ::memset(m_sincState,  0x00U, 70U * sizeof(q15_t));
-
-  m_modFilter.L           = NXDN_RADIO_SYMBOL_LENGTH;
-  m_modFilter.phaseLength = RRC_0_2_FILTER_PHASE_LEN;
-  m_modFilter.pCoeffs     = RRC_0_2_FILTER;
-  m_modFilter.pState      = m_modState;
-
-  m_sincFilter.numTaps = NXDN_SINC_FILTER_LEN;
-  m_sincFilter.pState  = m_sincState;
-  m_sincFilter.pCoeffs = NXDN_SINC_FILTER;
+  m_mod.setFilter(RRC_0_2_FILTER, RRC_0_2_FILTER_LEN, NXDN_SINC_FILTER, NXDN_SINC_FILTER_LEN);
+  m_mod.setLevels(NXDN_LEVELA, NXDN_LEVELB);
 }
 
 void CNXDNTX::process()
@@ -83,11 +69,7 @@ void CNXDNTX::process()
       m_poBuffer[m_poLen++] = NXDN_PREAMBLE[1U];
       m_poBuffer[m_poLen++] = NXDN_PREAMBLE[2U];
     } else {
-      for (uint8_t i = 0U; i < NXDN_FRAME_LENGTH_BYTES; i++) {
-        uint8_t c = 0U;
-        m_buffer.get(c);
-        m_poBuffer[m_poLen++] = c;
-      }
+      m_poLen = m_buffer.read(m_poBuffer, NXDN_FRAME_LENGTH_BYTES);
     }
 
     m_poPtr = 0U;
@@ -131,59 +113,26 @@ uint8_t CNXDNTX::writeData(const uint8_t* data, uint16_t length)
   if (length != (NXDN_FRAME_LENGTH_BYTES + 1U))
     return 4U;
 
-  uint16_t space = m_buffer.getSpace();
-  if (space < NXDN_FRAME_LENGTH_BYTES)
+  if (!m_buffer.hasSpace(NXDN_FRAME_LENGTH_BYTES))
     return 5U;
 
-  for (uint8_t i = 0U; i < NXDN_FRAME_LENGTH_BYTES; i++)
-    m_buffer.put(data[i + 1U]);
+  m_buffer.write(data + 1U, NXDN_FRAME_LENGTH_BYTES);
 
   return 0U;
 }
 
 void CNXDNTX::writeByte(uint8_t c)
 {
-  q15_t inBuffer[4U];
-  q15_t intBuffer[NXDN_RADIO_SYMBOL_LENGTH * 4U];
-  q15_t outBuffer[NXDN_RADIO_SYMBOL_LENGTH * 4U];
-
-  const uint8_t MASK = 0xC0U;
-
-  for (uint8_t i = 0U; i < 4U; i++, c <<= 2) {
-    switch (c & MASK) {
-      case 0xC0U:
-        inBuffer[i] = NXDN_LEVELA;
-        break;
-      case 0x80U:
-        inBuffer[i] = NXDN_LEVELB;
-        break;
-      case 0x00U:
-        inBuffer[i] = NXDN_LEVELC;
-        break;
-      default:
-        inBuffer[i] = NXDN_LEVELD;
-        break;
-    }
-  }
-
-  ::arm_fir_interpolate_q15(&m_modFilter, inBuffer, intBuffer, 4U);
+  m_mod.addByte(c);
 
-  ::arm_fir_fast_q15(&m_sincFilter, intBuffer, outBuffer, NXDN_RADIO_SYMBOL_LENGTH * 4U);
-
-  io.write(STATE_NXDN, outBuffer, NXDN_RADIO_SYMBOL_LENGTH * 4U);
+  io.write(STATE_NXDN, m_mod);
 }
 
 void CNXDNTX::writeSilence()
 {
-  q15_t inBuffer[4U] = {0x00U, 0x00U, 0x00U, 0x00U};
-  q15_t intBuffer[NXDN_RADIO_SYMBOL_LENGTH * 4U];
-  q15_t outBuffer[NXDN_RADIO_SYMBOL_LENGTH * 4U];
-
-  ::arm_fir_interpolate_q15(&m_modFilter, inBuffer, intBuffer, 4U);
-
-  ::arm_fir_fast_q15(&m_sincFilter, intBuffer, outBuffer, NXDN_RADIO_SYMBOL_LENGTH * 4U);
+  m_mod.addSilence();
 
-  io.write(STATE_NXDN, outBuffer, NXDN_RADIO_SYMBOL_LENGTH * 4U);
+  io.write(STATE_NXDN, m_mod);
 }
 
 void CNXDNTX::setTXDelay(uint8_t delay)
@@ -199,6 +148,11 @@ uint8_t CNXDNTX::getSpace() const
   return m_buffer.getSpace() / NXDN_FRAME_LENGTH_BYTES;
 }
 
+void CNXDNTX::getBufferStats(TRingStats& stats)
+{
+  m_buffer.getStats(stats);
+}
+
 void CNXDNTX::setParams(uint8_t txHang)
 {
   m_txHang = txHang * 600U;
@@ -23,8 +23,13 @@
 #if !defined(NXDNTX_H)
 #define  NXDNTX_H
 
+#include "NXDNDefines.h"
+#include "FSKMod.h"
 #include "RingBuffer.h"
 
+// The RRC filter spans 9 symbols and the sinc filter after it another 3
+typedef CFSKMod<NXDN_RADIO_SYMBOL_LENGTH, 12U> CNXDNMod;
+
 class CNXDNTX {
 public:
   CNXDNTX();
@@ -37,14 +42,13 @@ public:
 
   uint8_t getSpace() const;
 
+  void getBufferStats(TRingStats& stats);
+
   void setParams(uint8_t txHang);
 
 private:
-  CRingBuffer<uint8_t>                        m_buffer;
-  arm_fir_interpolate_instance_q15 m_modFilter;
-  arm_fir_instance_q15             m_sincFilter;
-  q15_t                            m_modState[16U];    // blockSize + phaseLength - 1, 4 + 9 - 1 plus some spare
-  q15_t                            m_sincState[70U];   // NoTaps + BlockSize - 1, 22 + 40 - 1 plus some spare
+  CRingBuffer<uint8_t, TX_BUFFER_LEN>         m_buffer;
+  CNXDNMod                         m_mod;
   uint8_t                          m_poBuffer[1200U];
   uint16_t                         m_poLen;
   uint16_t                         m_poPtr;
@@ -25,8 +25,6 @@
 #include "P25RX.h"
 #include "Utils.h"
 
-const q15_t SCALING_FACTOR = 18750;      // Q15(0.57)
-
 const uint8_t CORRELATION_COUNTDOWN = 10U;//5U;
 
 const uint8_t MAX_SYNC_BIT_START_ERRS = 2U;
@@ -34,22 +32,14 @@ const uint8_t MAX_SYNC_BIT_RUN_ERRS   = 4U;
 
 const uint8_t MAX_SYNC_SYMBOLS_ERRS = 2U;
 
-const uint8_t BIT_MASK_TABLE[] = { 0x80U, 0x40U, 0x20U, 0x10U, 0x08U, 0x04U, 0x02U, 0x01U };
-
-#define WRITE_BIT1(p,i,b) p[(i)>>3] = (b) ? (p[(i)>>3] | BIT_MASK_TABLE[(i)&7]) : (p[(i)>>3] & ~BIT_MASK_TABLE[(i)&7])
-
-const uint8_t NOAVEPTR = 99U;
-
 const uint16_t NOENDPTR = 9999U;
 
 const unsigned int MAX_SYNC_FRAMES = 4U + 1U;
 
 CP25RX::CP25RX() :
 m_state(P25RXS_NONE),
-m_bitBuffer(),
-m_buffer(),
-m_bitPtr(0U),
-m_dataPtr(0U),
+m_demod(),
+m_symbols(),
 m_hdrStartPtr(NOENDPTR),
 m_lduStartPtr(NOENDPTR),
 m_lduEndPtr(NOENDPTR),
@@ -57,14 +47,8 @@ m_minSyncPtr(NOENDPTR),
 m_maxSyncPtr(NOENDPTR),
 m_hdrSyncPtr(NOENDPTR),
 m_lduSyncPtr(NOENDPTR),
-m_maxCorr(0),
 m_lostCount(0U),
 m_countdown(0U),
-m_centre(),
-m_centreVal(0),
-m_threshold(),
-m_thresholdVal(0),
-m_averagePtr(NOAVEPTR),
 m_rssiAccum(0U),
 m_rssiCount(0U),
 m_duid(0U)
@@ -74,10 +58,6 @@ m_duid(0U)
 void CP25RX::reset()
 {
   m_state         = P25RXS_NONE;
-  m_dataPtr       = 0U;
-  m_bitPtr        = 0U;
-  m_maxCorr       = 0;
-  m_averagePtr    = NOAVEPTR;
   m_hdrStartPtr   = NOENDPTR;
   m_lduStartPtr   = NOENDPTR;
   m_lduEndPtr     = NOENDPTR;
@@ -85,13 +65,13 @@ void CP25RX::reset()
   m_lduSyncPtr    = NOENDPTR;
   m_minSyncPtr    = NOENDPTR;
   m_maxSyncPtr    = NOENDPTR;
-  m_centreVal     = 0;
-  m_thresholdVal  = 0;
   m_lostCount     = 0U;
   m_countdown     = 0U;
   m_rssiAccum     = 0U;
   m_rssiCount     = 0U;
   m_duid          = 0U;
+
+  m_demod.reset();
 }
 
 void CP25RX::samples(const q15_t* samples, uint16_t* rssi, uint8_t length)
@@ -102,11 +82,7 @@ void CP25RX::samples(const q15_t* samples, uint16_t* rssi, uint8_t length)
     m_rssiAccum += rssi[i];
     m_rssiCount++;
 
-    m_bitBuffer[m_bitPtr] <<= 1;
-    if (sample < 0)
-      m_bitBuffer[m_bitPtr] |= 0x01U;
-
-    m_buffer[m_dataPtr] = sample;
+    m_demod.add(sample);
 
     switch (m_state) {
     case P25RXS_HDR:
@@ -119,16 +95,6 @@ void CP25RX::samples(const q15_t* samples, uint16_t* rssi, uint8_t length)
       processNone(sample);
       break;
     }
-
-    m_dataPtr++;
-    if (m_dataPtr >= P25_LDU_FRAME_LENGTH_SAMPLES) {
-      m_dataPtr = 0U;
-      m_duid = 0U;
-    }
-
-    m_bitPtr++;
-    if (m_bitPtr >= P25_RADIO_SYMBOL_LENGTH)
-      m_bitPtr = 0U;
   }
 }
 
@@ -144,7 +110,7 @@ void CP25RX::processNone(q15_t sample)
       io.setDecode(true);
       io.setADCDetection(true);
 
-      m_averagePtr = NOAVEPTR;
+      m_demod.restart();
 
       m_countdown = CORRELATION_COUNTDOWN;
     }
@@ -165,136 +131,118 @@ void CP25RX::processNone(q15_t sample)
 
       m_state     = P25RXS_HDR;
       m_countdown = 0U;
+
+      // The sync of the LDU after the HDR is only compared with those after this one
+      m_demod.nextSync();
   }
 }
 
 void CP25RX::processHdr(q15_t sample)
 {
-  if (m_minSyncPtr < m_maxSyncPtr) {
-    if (m_dataPtr >= m_minSyncPtr && m_dataPtr <= m_maxSyncPtr)
-      correlateSync();
-  } else {
-    if (m_dataPtr >= m_minSyncPtr || m_dataPtr <= m_maxSyncPtr)
-      correlateSync();
-  }
+  if (m_demod.inWindow(m_demod.ptr(), m_minSyncPtr, m_maxSyncPtr))
+    correlateSync();
 
-  if (m_dataPtr == m_maxSyncPtr) {
-    uint16_t nidStartPtr = m_hdrStartPtr + P25_SYNC_LENGTH_SAMPLES;
-    if (nidStartPtr >= P25_LDU_FRAME_LENGTH_SAMPLES)
-        nidStartPtr -= P25_LDU_FRAME_LENGTH_SAMPLES;
+  if (m_demod.ptr() == m_maxSyncPtr) {
+    // All of the longest header is in the buffer by now
+    m_demod.resync();
+    m_demod.extract(m_hdrStartPtr, P25_HDR_FRAME_LENGTH_SAMPLES, m_symbols, P25_HDR_FRAME_LENGTH_SYMBOLS);
 
     uint8_t nid[2U];
-    samplesToBits(nidStartPtr, (2U * 4U), nid, 0U, m_centreVal, m_thresholdVal);
+    m_demod.samplesToBits(m_symbols + P25_SYNC_LENGTH_SYMBOLS, (2U * 4U), nid, 0U);
     // DEBUG3("P25RX: nid (b0 - b1)", nid[0U], nid[1U]);
 
     m_duid = nid[1U] & 0x0F;
 
     switch (m_duid) {
         case P25_DUID_HDU: {
-                calculateLevels(m_hdrStartPtr, P25_HDR_FRAME_LENGTH_SYMBOLS);
-
-                DEBUG4("P25RX: sync found in Hdr pos/centre/threshold", m_hdrSyncPtr, m_centreVal, m_thresholdVal);
-
                 uint8_t frame[P25_HDR_FRAME_LENGTH_BYTES + 1U];
-                samplesToBits(m_hdrStartPtr, P25_HDR_FRAME_LENGTH_SYMBOLS, frame, 8U, m_centreVal, m_thresholdVal);
+                m_demod.trackLevels(m_symbols, P25_HDR_FRAME_LENGTH_SYMBOLS, frame, 8U);
+                DEBUG5("P25RX: pos/neg/centre/threshold", m_demod.posLevel(), m_demod.negLevel(), m_demod.centre(), m_demod.threshold());
+
+                DEBUG4("P25RX: sync found in Hdr pos/centre/threshold", m_hdrSyncPtr, m_demod.centre(), m_demod.threshold());
 
                 frame[0U] = 0x01U;
-                serial.writeP25Hdr(frame, P25_HDR_FRAME_LENGTH_BYTES + 1U);
+                writeHdr(frame, m_symbols, P25_HDR_FRAME_LENGTH_SYMBOLS);
             }
             break;
 		case P25_DUID_PDU: {
-				calculateLevels(m_hdrSyncPtr, P25_PDU_HDR_FRAME_LENGTH_SYMBOLS);
-
-				DEBUG4("P25RX: sync found in PDU pos/centre/threshold", m_hdrSyncPtr, m_centreVal, m_thresholdVal);
-
 				uint8_t frame[P25_PDU_HDR_FRAME_LENGTH_BYTES + 1U];
-				samplesToBits(m_hdrSyncPtr, P25_PDU_HDR_FRAME_LENGTH_SYMBOLS, frame, 8U, m_centreVal, m_thresholdVal);
+				m_demod.trackLevels(m_symbols + P25_SYNC_LENGTH_SYMBOLS - 1U, P25_PDU_HDR_FRAME_LENGTH_SYMBOLS, frame, 8U);
+				DEBUG5("P25RX: pos/neg/centre/threshold", m_demod.posLevel(), m_demod.negLevel(), m_demod.centre(), m_demod.threshold());
+
+				DEBUG4("P25RX: sync found in PDU pos/centre/threshold", m_hdrSyncPtr, m_demod.centre(), m_demod.threshold());
 
 				frame[0U] = 0x01U;
-				serial.writeP25Hdr(frame, P25_PDU_HDR_FRAME_LENGTH_BYTES + 1U);
+				writeHdr(frame, m_symbols + P25_SYNC_LENGTH_SYMBOLS - 1U, P25_PDU_HDR_FRAME_LENGTH_SYMBOLS);
 			}
 			break;
 		case P25_DUID_TSDU: {
-                calculateLevels(m_hdrStartPtr, P25_TSDU_FRAME_LENGTH_SYMBOLS);
-
-                DEBUG4("P25RX: sync found in TSDU pos/centre/threshold", m_hdrSyncPtr, m_centreVal, m_thresholdVal);
-
                 uint8_t frame[P25_TSDU_FRAME_LENGTH_BYTES + 1U];
-                samplesToBits(m_hdrStartPtr, P25_TSDU_FRAME_LENGTH_SYMBOLS, frame, 8U, m_centreVal, m_thresholdVal);
+                m_demod.trackLevels(m_symbols, P25_TSDU_FRAME_LENGTH_SYMBOLS, frame, 8U);
+                DEBUG5("P25RX: pos/neg/centre/threshold", m_demod.posLevel(), m_demod.negLevel(), m_demod.centre(), m_demod.threshold());
+
+                DEBUG4("P25RX: sync found in TSDU pos/centre/threshold", m_hdrSyncPtr, m_demod.centre(), m_demod.threshold());
 
                 frame[0U] = 0x01U;
-                serial.writeP25Hdr(frame, P25_TSDU_FRAME_LENGTH_BYTES + 1U);
+                writeHdr(frame, m_symbols, P25_TSDU_FRAME_LENGTH_SYMBOLS);
             }
             break;
         case P25_DUID_TDU: {
-                calculateLevels(m_hdrStartPtr, P25_TERM_FRAME_LENGTH_SYMBOLS);
-
-                DEBUG4("P25RX: sync found in TDU pos/centre/threshold", m_hdrSyncPtr, m_centreVal, m_thresholdVal);
-
                 uint8_t frame[P25_TERM_FRAME_LENGTH_BYTES + 1U];
-                samplesToBits(m_hdrStartPtr, P25_TERM_FRAME_LENGTH_SYMBOLS, frame, 8U, m_centreVal, m_thresholdVal);
+                m_demod.trackLevels(m_symbols, P25_TERM_FRAME_LENGTH_SYMBOLS, frame, 8U);
+                DEBUG5("P25RX: pos/neg/centre/threshold", m_demod.posLevel(), m_demod.negLevel(), m_demod.centre(), m_demod.threshold());
+
+                DEBUG4("P25RX: sync found in TDU pos/centre/threshold", m_hdrSyncPtr, m_demod.centre(), m_demod.threshold());
 
                 frame[0U] = 0x01U;
-                serial.writeP25Hdr(frame, P25_TERM_FRAME_LENGTH_BYTES + 1U);
+                writeHdr(frame, m_symbols, P25_TERM_FRAME_LENGTH_SYMBOLS);
             }
             break;
         case P25_DUID_TDULC: {
-                calculateLevels(m_hdrStartPtr, P25_TERMLC_FRAME_LENGTH_SYMBOLS);
-
-                DEBUG4("P25RX: sync found in TDULC pos/centre/threshold", m_hdrSyncPtr, m_centreVal, m_thresholdVal);
-
                 uint8_t frame[P25_TERMLC_FRAME_LENGTH_BYTES + 1U];
-                samplesToBits(m_hdrStartPtr, P25_TERMLC_FRAME_LENGTH_SYMBOLS, frame, 8U, m_centreVal, m_thresholdVal);
+                m_demod.trackLevels(m_symbols, P25_TERMLC_FRAME_LENGTH_SYMBOLS, frame, 8U);
+                DEBUG5("P25RX: pos/neg/centre/threshold", m_demod.posLevel(), m_demod.negLevel(), m_demod.centre(), m_demod.threshold());
+
+                DEBUG4("P25RX: sync found in TDULC pos/centre/threshold", m_hdrSyncPtr, m_demod.centre(), m_demod.threshold());
 
                 frame[0U] = 0x01U;
-                serial.writeP25Hdr(frame, P25_TERMLC_FRAME_LENGTH_BYTES + 1U);
+                writeHdr(frame, m_symbols, P25_TERMLC_FRAME_LENGTH_SYMBOLS);
             }
             break;
         default:
             break;
     }
 
-    m_minSyncPtr = m_lduSyncPtr + P25_LDU_FRAME_LENGTH_SAMPLES - 1U;
-    if (m_minSyncPtr >= P25_LDU_FRAME_LENGTH_SAMPLES)
-      m_minSyncPtr -= P25_LDU_FRAME_LENGTH_SAMPLES;
-
-    m_maxSyncPtr = m_lduSyncPtr + 1U;
-    if (m_maxSyncPtr >= P25_LDU_FRAME_LENGTH_SAMPLES)
-      m_maxSyncPtr -= P25_LDU_FRAME_LENGTH_SAMPLES;
+    m_minSyncPtr = m_demod.move(m_lduSyncPtr, -1);
+    m_maxSyncPtr = m_demod.move(m_lduSyncPtr, +1);
 
-    m_state   = P25RXS_LDU;
-    m_maxCorr = 0;
+    m_state = P25RXS_LDU;
+    m_demod.nextSync();
   }
 }
 
 void CP25RX::processLdu(q15_t sample)
 {
-  if (m_minSyncPtr < m_maxSyncPtr) {
-    if (m_dataPtr >= m_minSyncPtr && m_dataPtr <= m_maxSyncPtr)
-      correlateSync();
-  } else {
-    if (m_dataPtr >= m_minSyncPtr || m_dataPtr <= m_maxSyncPtr)
-      correlateSync();
-  }
+  if (m_demod.inWindow(m_demod.ptr(), m_minSyncPtr, m_maxSyncPtr))
+    correlateSync();
 
-  if (m_dataPtr == m_lduEndPtr) {
-    // Only update the centre and threshold if they are from a good sync
-    if (m_lostCount == MAX_SYNC_FRAMES) {
-      m_minSyncPtr = m_lduSyncPtr + P25_LDU_FRAME_LENGTH_SAMPLES - 1U;
-      if (m_minSyncPtr >= P25_LDU_FRAME_LENGTH_SAMPLES)
-        m_minSyncPtr -= P25_LDU_FRAME_LENGTH_SAMPLES;
+  if (m_demod.ptr() == m_lduEndPtr) {
+    // The whole LDU is in the buffer, the oldest sample being the first of the LDU
+    m_demod.resync();
+    m_demod.extract(m_lduStartPtr, P25_LDU_FRAME_LENGTH_SAMPLES, m_symbols, P25_LDU_FRAME_LENGTH_SYMBOLS);
 
-      m_maxSyncPtr = m_lduSyncPtr + 1U;
-      if (m_maxSyncPtr >= P25_LDU_FRAME_LENGTH_SAMPLES)
-        m_maxSyncPtr -= P25_LDU_FRAME_LENGTH_SAMPLES;
+    // After a good sync, look for the next one from where this one was to where the transmitter's
+    // clock has taken it, and add its levels to the carrier offset
+    if (m_lostCount == MAX_SYNC_FRAMES) {
+      m_demod.syncWindow(m_lduSyncPtr, m_minSyncPtr, m_maxSyncPtr);
+      m_demod.measureOffset(io.getDCLevel(STATE_P25));
     }
 
-    calculateLevels(m_lduStartPtr, P25_LDU_FRAME_LENGTH_SYMBOLS);
-
-    DEBUG4("P25RX: sync found in Ldu pos/centre/threshold", m_lduSyncPtr, m_centreVal, m_thresholdVal);
-
     uint8_t frame[P25_LDU_FRAME_LENGTH_BYTES + 3U];
-    samplesToBits(m_lduStartPtr, P25_LDU_FRAME_LENGTH_SYMBOLS, frame, 8U, m_centreVal, m_thresholdVal);
+    m_demod.trackLevels(m_symbols, P25_LDU_FRAME_LENGTH_SYMBOLS, frame, 8U);
+    DEBUG5("P25RX: pos/neg/centre/threshold", m_demod.posLevel(), m_demod.negLevel(), m_demod.centre(), m_demod.threshold());
+
+    DEBUG4("P25RX: sync found in Ldu pos/centre/threshold", m_lduSyncPtr, m_demod.centre(), m_demod.threshold());
 
     // We've not seen a data sync for too long, signal RXLOST and change to RX_NONE
     m_lostCount--;
@@ -304,218 +252,83 @@ void CP25RX::processLdu(q15_t sample)
       io.setDecode(false);
       io.setADCDetection(false);
 
-      serial.writeP25Lost();
+      serial.writeP25Lost(m_demod.offset(P25_DEVIATION));
+
+      m_state     = P25RXS_NONE;
+      m_lduEndPtr = NOENDPTR;
+      m_countdown = 0U;
+      m_duid      = 0U;
 
-      m_state      = P25RXS_NONE;
-      m_lduEndPtr  = NOENDPTR;
-      m_averagePtr = NOAVEPTR;
-      m_countdown  = 0U;
-      m_maxCorr    = 0;
-      m_duid       = 0U;
+      m_demod.restart();
+      m_demod.nextSync();
 		} else {
       frame[0U] = m_lostCount == (MAX_SYNC_FRAMES - 1U) ? 0x01U : 0x00U;
       writeRSSILdu(frame);
-      m_maxCorr = 0;
+      m_demod.nextSync();
     }
   }
 }
 
 bool CP25RX::correlateSync()
 {
-  if (countBits32((m_bitBuffer[m_bitPtr] & P25_SYNC_SYMBOLS_MASK) ^ P25_SYNC_SYMBOLS) <= MAX_SYNC_SYMBOLS_ERRS) {
-    uint16_t ptr = m_dataPtr + P25_LDU_FRAME_LENGTH_SAMPLES - P25_SYNC_LENGTH_SAMPLES + P25_RADIO_SYMBOL_LENGTH;
-    if (ptr >= P25_LDU_FRAME_LENGTH_SAMPLES)
-      ptr -= P25_LDU_FRAME_LENGTH_SAMPLES;
-
-    q31_t corr = 0;
-    q15_t min =  16000;
-    q15_t max = -16000;
-
-    for (uint8_t i = 0U; i < P25_SYNC_LENGTH_SYMBOLS; i++) {
-      q15_t val = m_buffer[ptr];
-
-      if (val > max)
-        max = val;
-      if (val < min)
-        min = val;
-
-      switch (P25_SYNC_SYMBOLS_VALUES[i]) {
-      case +3:
-        corr -= (val + val + val);
-        break;
-      case +1:
-        corr -= val;
-        break;
-      case -1:
-        corr += val;
-        break;
-      default:  // -3
-        corr += (val + val + val);
-        break;
-      }
-
-      ptr += P25_RADIO_SYMBOL_LENGTH;
-      if (ptr >= P25_LDU_FRAME_LENGTH_SAMPLES)
-        ptr -= P25_LDU_FRAME_LENGTH_SAMPLES;
-    }
-
-    if (corr > m_maxCorr) {
-      if (m_averagePtr == NOAVEPTR) {
-        m_centreVal = (max + min) >> 1;
-
-        q31_t v1 = (max - m_centreVal) * SCALING_FACTOR;
-        m_thresholdVal = q15_t(v1 >> 15);
-      }
+  if (m_demod.searchErrors(P25_SYNC_SYMBOLS, P25_SYNC_SYMBOLS_MASK) > MAX_SYNC_SYMBOLS_ERRS)
+    return false;
 
-      uint16_t startPtr = m_dataPtr + P25_LDU_FRAME_LENGTH_SAMPLES - P25_SYNC_LENGTH_SAMPLES + P25_RADIO_SYMBOL_LENGTH;
-      if (startPtr >= P25_LDU_FRAME_LENGTH_SAMPLES)
-        startPtr -= P25_LDU_FRAME_LENGTH_SAMPLES;
+  uint8_t maxErrs;
+  if (m_state == P25RXS_NONE)
+    maxErrs = MAX_SYNC_BIT_START_ERRS;
+  else
+    maxErrs = MAX_SYNC_BIT_RUN_ERRS;
 
-      uint8_t sync[P25_SYNC_BYTES_LENGTH];
-      samplesToBits(startPtr, P25_SYNC_LENGTH_SYMBOLS, sync, 0U, m_centreVal, m_thresholdVal);
+  if (!m_demod.correlateSync(P25_SYNC_SYMBOLS_VALUES, P25_SYNC_BYTES, NULL, 0U, maxErrs))
+    return false;
 
-      uint8_t maxErrs;
-      if (m_state == P25RXS_NONE)
-        maxErrs = MAX_SYNC_BIT_START_ERRS;
-      else
-        maxErrs = MAX_SYNC_BIT_RUN_ERRS;
+  m_lostCount = MAX_SYNC_FRAMES;
 
-      uint8_t errs = 0U;
-      for (uint8_t i = 0U; i < P25_SYNC_BYTES_LENGTH; i++)
-        errs += countBits8(sync[i] ^ P25_SYNC_BYTES[i]);
+  m_lduSyncPtr = m_demod.ptr();
 
-      if (errs <= maxErrs) {
-        m_maxCorr     = corr;
-        m_lostCount   = MAX_SYNC_FRAMES;
+  // These are the positions of the start and end of an LDU
+  m_lduStartPtr = m_demod.syncStart();
 
-        m_lduSyncPtr  = m_dataPtr;
+  // Wait for the last sample of the LDU, the one before its first is overwritten
+  m_lduEndPtr = m_lduStartPtr + P25_LDU_FRAME_LENGTH_SAMPLES - 1U;
+  if (m_lduEndPtr >= P25_LDU_FRAME_LENGTH_SAMPLES)
+    m_lduEndPtr -= P25_LDU_FRAME_LENGTH_SAMPLES;
 
-        // These are the positions of the start and end of an LDU
-        m_lduStartPtr = startPtr;
+  if (m_state == P25RXS_NONE) {
+    m_hdrSyncPtr = m_lduSyncPtr;
 
-        m_lduEndPtr = m_dataPtr + P25_LDU_FRAME_LENGTH_SAMPLES - P25_SYNC_LENGTH_SAMPLES - 1U;
-        if (m_lduEndPtr >= P25_LDU_FRAME_LENGTH_SAMPLES)
-          m_lduEndPtr -= P25_LDU_FRAME_LENGTH_SAMPLES;
+    // This is the position of the start of a HDR
+    m_hdrStartPtr = m_lduStartPtr;
 
-        if (m_state == P25RXS_NONE) {
-          m_hdrSyncPtr = m_dataPtr;
-
-          // This is the position of the start of a HDR
-          m_hdrStartPtr = startPtr;
-
-          // These are the range of positions for a sync for an LDU following a HDR
-          m_minSyncPtr = m_dataPtr + P25_HDR_FRAME_LENGTH_SAMPLES - 1U;
-          if (m_minSyncPtr >= P25_LDU_FRAME_LENGTH_SAMPLES)
-            m_minSyncPtr -= P25_LDU_FRAME_LENGTH_SAMPLES;
-
-          m_maxSyncPtr = m_dataPtr + P25_HDR_FRAME_LENGTH_SAMPLES + 1U;
-          if (m_maxSyncPtr >= P25_LDU_FRAME_LENGTH_SAMPLES)
-            m_maxSyncPtr -= P25_LDU_FRAME_LENGTH_SAMPLES;
-        }
+    // These are the range of positions for a sync for an LDU following a HDR
+    m_minSyncPtr = m_hdrSyncPtr + P25_HDR_FRAME_LENGTH_SAMPLES - 1U;
+    if (m_minSyncPtr >= P25_LDU_FRAME_LENGTH_SAMPLES)
+      m_minSyncPtr -= P25_LDU_FRAME_LENGTH_SAMPLES;
 
-        return true;
-      }
-    }
+    m_maxSyncPtr = m_hdrSyncPtr + P25_HDR_FRAME_LENGTH_SAMPLES + 1U;
+    if (m_maxSyncPtr >= P25_LDU_FRAME_LENGTH_SAMPLES)
+      m_maxSyncPtr -= P25_LDU_FRAME_LENGTH_SAMPLES;
   }
 
-  return false;
+  return true;
 }
 
-void CP25RX::calculateLevels(uint16_t start, uint16_t count)
+// Send the hard bits, or the soft symbols of the same samples if the host wants them
+void CP25RX::writeHdr(const uint8_t* frame, const q15_t* symbols, uint16_t count)
 {
-  q15_t maxPos = -16000;
-  q15_t minPos =  16000;
-  q15_t maxNeg =  16000;
-  q15_t minNeg = -16000;
-
-  for (uint16_t i = 0U; i < count; i++) {
-    q15_t sample = m_buffer[start];
-
-    if (sample > 0) {
-      if (sample > maxPos)
-        maxPos = sample;
-      if (sample < minPos)
-        minPos = sample;
-    } else {
-      if (sample < maxNeg)
-        maxNeg = sample;
-      if (sample > minNeg)
-        minNeg = sample;
-    }
-
-    start += P25_RADIO_SYMBOL_LENGTH;
-    if (start >= P25_LDU_FRAME_LENGTH_SAMPLES)
-      start -= P25_LDU_FRAME_LENGTH_SAMPLES;
+  if (!serial.getSoftSymbols()) {
+    serial.writeP25Hdr(frame, count / 4U + 1U);
+    return;
   }
 
-  q15_t posThresh = (maxPos + minPos) >> 1;
-  q15_t negThresh = (maxNeg + minNeg) >> 1;
+  // The header is the longest of them
+  uint8_t data[P25_HDR_FRAME_LENGTH_SYMBOLS / 2U + 1U];
+  data[0U] = frame[0U];
 
-  q15_t centre = (posThresh + negThresh) >> 1;
+  m_demod.samplesToSoft(symbols, count, data + 1U);
 
-  q15_t threshold = posThresh - centre;
-
-  DEBUG5("P25RX: pos/neg/centre/threshold", posThresh, negThresh, centre, threshold);
-
-  if (m_averagePtr == NOAVEPTR) {
-    for (uint8_t i = 0U; i < 16U; i++) {
-      m_centre[i]    = centre;
-      m_threshold[i] = threshold;
-    }
-
-    m_averagePtr = 0U;
-  } else {
-    m_centre[m_averagePtr]    = centre;
-    m_threshold[m_averagePtr] = threshold;
-
-    m_averagePtr++;
-    if (m_averagePtr >= 16U)
-      m_averagePtr = 0U;
-  }
-
-  m_centreVal    = 0;
-  m_thresholdVal = 0;
-
-  for (uint8_t i = 0U; i < 16U; i++) {
-    m_centreVal    += m_centre[i];
-    m_thresholdVal += m_threshold[i];
-  }
-
-  m_centreVal    >>= 4;
-  m_thresholdVal >>= 4;
-}
-
-void CP25RX::samplesToBits(uint16_t start, uint16_t count, uint8_t* buffer, uint16_t offset, q15_t centre, q15_t threshold)
-{
-  for (uint16_t i = 0U; i < count; i++) {
-    q15_t sample = m_buffer[start] - centre;
-
-    if (sample < -threshold) {
-      WRITE_BIT1(buffer, offset, false);
-      offset++;
-      WRITE_BIT1(buffer, offset, true);
-      offset++;
-    } else if (sample < 0) {
-      WRITE_BIT1(buffer, offset, false);
-      offset++;
-      WRITE_BIT1(buffer, offset, false);
-      offset++;
-    } else if (sample < threshold) {
-      WRITE_BIT1(buffer, offset, true);
-      offset++;
-      WRITE_BIT1(buffer, offset, false);
-      offset++;
-    } else {
-      WRITE_BIT1(buffer, offset, true);
-      offset++;
-      WRITE_BIT1(buffer, offset, true);
-      offset++;
-    }
-
-    start += P25_RADIO_SYMBOL_LENGTH;
-    if (start >= P25_LDU_FRAME_LENGTH_SAMPLES)
-      start -= P25_LDU_FRAME_LENGTH_SAMPLES;
-  }
+  serial.writeP25HdrSoft(data, count / 2U + 1U);
 }
 
 void CP25RX::writeRSSILdu(uint8_t* ldu)
@@ -527,17 +340,37 @@ void CP25RX::writeRSSILdu(uint8_t* ldu)
     ldu[217U] = (rssi >> 8) & 0xFFU;
     ldu[218U] = (rssi >> 0) & 0xFFU;
 
-    serial.writeP25Ldu(ldu, P25_LDU_FRAME_LENGTH_BYTES + 3U);
+    writeLdu(ldu, P25_LDU_FRAME_LENGTH_BYTES + 3U);
   } else {
-    serial.writeP25Ldu(ldu, P25_LDU_FRAME_LENGTH_BYTES + 1U);
+    writeLdu(ldu, P25_LDU_FRAME_LENGTH_BYTES + 1U);
   }
 #else
-  serial.writeP25Ldu(ldu, P25_LDU_FRAME_LENGTH_BYTES + 1U);
+  writeLdu(ldu, P25_LDU_FRAME_LENGTH_BYTES + 1U);
 #endif
 
   m_rssiAccum = 0U;
   m_rssiCount = 0U;
 }
 
+// Send the hard bits, or the soft symbols with the same control byte and RSSI if the host wants them
+void CP25RX::writeLdu(const uint8_t* frame, uint16_t length)
+{
+  if (!serial.getSoftSymbols()) {
+    serial.writeP25Ldu(frame, length);
+    return;
+  }
+
+  uint8_t data[P25_LDU_FRAME_LENGTH_SYMBOLS / 2U + 3U];
+  data[0U] = frame[0U];
+
+  m_demod.samplesToSoft(m_symbols, P25_LDU_FRAME_LENGTH_SYMBOLS, data + 1U);
+
+  uint16_t count = P25_LDU_FRAME_LENGTH_SYMBOLS / 2U + 1U;
+  for (uint16_t i = P25_LDU_FRAME_LENGTH_BYTES + 1U; i < length; i++, count++)
+    data[count] = frame[i];
+
+  serial.writeP25LduSoft(data, count);
+}
+
 #endif
 
@@ -25,6 +25,10 @@
 #define  P25RX_H
 
 #include "P25Defines.h"
+#include "FSKDemod.h"
+
+// The sync's threshold at Q15(0.57) of its peak, each symbol moving its level by an eighth
+typedef CFSKDemod<uint32_t, P25_LDU_FRAME_LENGTH_SAMPLES, P25_RADIO_SYMBOL_LENGTH, P25_SYNC_LENGTH_SYMBOLS, 18750, 3U, false> CP25Demod;
 
 enum P25RX_STATE {
   P25RXS_NONE,
@@ -42,10 +46,8 @@ public:
 
 private:
   P25RX_STATE m_state;
-  uint32_t    m_bitBuffer[P25_RADIO_SYMBOL_LENGTH];
-  q15_t       m_buffer[P25_LDU_FRAME_LENGTH_SAMPLES];
-  uint16_t    m_bitPtr;
-  uint16_t    m_dataPtr;
+  CP25Demod   m_demod;
+  q15_t       m_symbols[P25_LDU_FRAME_LENGTH_SYMBOLS];
   uint16_t    m_hdrStartPtr;
   uint16_t    m_lduStartPtr;
   uint16_t    m_lduEndPtr;
@@ -53,14 +55,8 @@ private:
   uint16_t    m_maxSyncPtr;
   uint16_t    m_hdrSyncPtr;
   uint16_t    m_lduSyncPtr;
-  q31_t       m_maxCorr;
   uint16_t    m_lostCount;
   uint8_t     m_countdown;
-  q15_t       m_centre[16U];
-  q15_t       m_centreVal;
-  q15_t       m_threshold[16U];
-  q15_t       m_thresholdVal;
-  uint8_t     m_averagePtr;
   uint32_t    m_rssiAccum;
   uint16_t    m_rssiCount;
   uint8_t     m_duid;
@@ -69,9 +65,9 @@ private:
   void processHdr(q15_t sample);
   void processLdu(q15_t sample);
   bool correlateSync();
-  void calculateLevels(uint16_t start, uint16_t count);
-  void samplesToBits(uint16_t start, uint16_t count, uint8_t* buffer, uint16_t offset, q15_t centre, q15_t threshold);
+  void writeHdr(const uint8_t* frame, const q15_t* symbols, uint16_t count);
   void writeRSSILdu(uint8_t* ldu);
+  void writeLdu(const uint8_t* frame, uint16_t length);
 };
 
 #endif
@@ -31,7 +31,7 @@
 static q15_t RC_0_2_FILTER[] = {-897, -1636, -1840, -1278, 0, 1613, 2936, 3310, 2315, 0, -3011, -5627, -6580, -4839,
                                 0, 7482, 16311, 24651, 30607, 32767, 30607, 24651, 16311, 7482, 0, -4839, -6580, -5627,
                                -3011, 0, 2315, 3310, 2936, 1613, 0, -1278, -1840, -1636, -897, 0}; // numTaps = 40, L = 5
-const uint16_t RC_0_2_FILTER_PHASE_LEN = 8U; // phaseLength = numTaps/L
+const uint16_t RC_0_2_FILTER_LEN = 40U;
 
 static q15_t LOWPASS_FILTER[] = {124, -188, -682, 1262, 556, -621, -1912, -911, 2058, 3855, 1234, -4592, -7692, -2799,
                                 8556, 18133, 18133, 8556, -2799, -7692, -4592, 1234, 3855, 2058, -911, -1912, -621,
@@ -40,17 +40,12 @@ const uint16_t LOWPASS_FILTER_LEN = 32U;
 
 const q15_t P25_LEVELA =  1260;
 const q15_t P25_LEVELB =   420;
-const q15_t P25_LEVELC =  -420;
-const q15_t P25_LEVELD = -1260;
 
 const uint8_t P25_START_SYNC = 0x77U;
 
 CP25TX::CP25TX() :
-m_buffer(TX_BUFFER_LEN),
-m_modFilter(),
-m_lpFilter(),
-m_modState(),
-m_lpState(),
+m_buffer(),
+m_mod(),
 m_poBuffer(),
 m_poLen(0U),
 m_poPtr(0U),
@@ -58,17 +53,8 @@ m_txDelay(240U),      // 200ms
 m_txHang(6000U),      // 5s
 m_txCount(0U)
 {
-  ::memset(m_modState, 0x00U, 16U * sizeof(q15_t));
-  ::memset(m_lpState,  0x00U, 60U * sizeof(q15_t));
-
-  m_modFilter.L           = P25_RADIO_SYMBOL_LENGTH;
-  m_modFilter.phaseLength = RC_0_2_FILTER_PHASE_LEN;
-  m_modFilter.pCoeffs     = RC_0_2_FILTER;
-  m_modFilter.pState      = m_modState;
-
-  m_lpFilter.numTaps = LOWPASS_FILTER_LEN;
-  m_lpFilter.pState  = m_lpState;
-  m_lpFilter.pCoeffs = LOWPASS_FILTER;
+  m_mod.setFilter(RC_0_2_FILTER, RC_0_2_FILTER_LEN, LOWPASS_FILTER, LOWPASS_FILTER_LEN);
+  m_mod.setLevels(P25_LEVELA, P25_LEVELB);
 }
 
 void CP25TX::process()
@@ -78,13 +64,9 @@ void CP25TX::process()
       for (uint16_t i = 0U; i < m_txDelay; i++)
         m_poBuffer[m_poLen++] = P25_START_SYNC;
     } else {
-      uint8_t length;
+      uint8_t length = 0U;
       m_buffer.get(length);
-      for (uint8_t i = 0U; i < length; i++) {
-        uint8_t c = 0U;
-        m_buffer.get(c);
-        m_poBuffer[m_poLen++] = c;
-      }
+      m_poLen = m_buffer.read(m_poBuffer, length);
     }
 
     m_poPtr = 0U;
@@ -128,60 +110,27 @@ uint8_t CP25TX::writeData(const uint8_t* data, uint16_t length)
   if (length < (P25_TERM_FRAME_LENGTH_BYTES + 1U))
     return 4U;
 
-  uint16_t space = m_buffer.getSpace();
-  if (space < length)
+  if (!m_buffer.hasSpace(length))
     return 5U;
 
   m_buffer.put(length - 1U);
-  for (uint8_t i = 0U; i < (length - 1U); i++)
-    m_buffer.put(data[i + 1U]);
+  m_buffer.write(data + 1U, length - 1U);
 
   return 0U;
 }
 
 void CP25TX::writeByte(uint8_t c)
 {
-  q15_t inBuffer[4U];
-  q15_t intBuffer[P25_RADIO_SYMBOL_LENGTH * 4U];
-  q15_t outBuffer[P25_RADIO_SYMBOL_LENGTH * 4U];
-
-  const uint8_t MASK = 0xC0U;
-
-  for (uint8_t i = 0U; i < 4U; i++, c <<= 2) {
-    switch (c & MASK) {
-      case 0xC0U:
-        inBuffer[i] = P25_LEVELA;
-        break;
-      case 0x80U:
-        inBuffer[i] = P25_LEVELB;
-        break;
-      case 0x00U:
-        inBuffer[i] = P25_LEVELC;
-        break;
-      default:
-        inBuffer[i] = P25_LEVELD;
-        break;
-    }
-  }
-
-  ::arm_fir_interpolate_q15(&m_modFilter, inBuffer, intBuffer, 4U);
+  m_mod.addByte(c);
 
-  ::arm_fir_fast_q15(&m_lpFilter, intBuffer, outBuffer, P25_RADIO_SYMBOL_LENGTH * 4U);
-
-  io.write(STATE_P25, outBuffer, P25_RADIO_SYMBOL_LENGTH * 4U);
+  io.write(STATE_P25, m_mod);
 }
 
 void CP25TX::writeSilence()
 {
-  q15_t inBuffer[4U] = {0x00U, 0x00U, 0x00U, 0x00U};
-  q15_t intBuffer[P25_RADIO_SYMBOL_LENGTH * 4U];
-  q15_t outBuffer[P25_RADIO_SYMBOL_LENGTH * 4U];
-
-  ::arm_fir_interpolate_q15(&m_modFilter, inBuffer, intBuffer, 4U);
-
-  ::arm_fir_fast_q15(&m_lpFilter, intBuffer, outBuffer, P25_RADIO_SYMBOL_LENGTH * 4U);
+  m_mod.addSilence();
 
-  io.write(STATE_P25, outBuffer, P25_RADIO_SYMBOL_LENGTH * 4U);
+  io.write(STATE_P25, m_mod);
 }
 
 void CP25TX::setTXDelay(uint8_t delay)
@@ -197,6 +146,11 @@ uint8_t CP25TX::getSpace() const
   return m_buffer.getSpace() / P25_LDU_FRAME_LENGTH_BYTES;
 }
 
+void CP25TX::getBufferStats(TRingStats& stats)
+{
+  m_buffer.getStats(stats);
+}
+
 void CP25TX::setParams(uint8_t txHang)
 {
   m_txHang = txHang * 1200U;
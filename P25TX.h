@@ -23,8 +23,13 @@
 #if !defined(P25TX_H)
 #define  P25TX_H
 
+#include "P25Defines.h"
+#include "FSKMod.h"
 #include "RingBuffer.h"
 
+// The RC filter spans 8 symbols and the low pass filter after it another 7
+typedef CFSKMod<P25_RADIO_SYMBOL_LENGTH, 15U> CP25Mod;
+
 class CP25TX {
 public:
   CP25TX();
@@ -37,14 +42,13 @@ public:
 
   uint8_t getSpace() const;
 
+  void getBufferStats(TRingStats& stats);
+
   void setParams(uint8_t txHang);
 
 private:
-  CRingBuffer<uint8_t>                        m_buffer;
-  arm_fir_interpolate_instance_q15 m_modFilter;
-  arm_fir_instance_q15             m_lpFilter;
-  q15_t                            m_modState[16U];    // blockSize + phaseLength - 1, 4 + 9 - 1 plus some spare
-  q15_t                            m_lpState[60U];     // NoTaps + BlockSize - 1, 32 + 20 - 1 plus some spare
+  CRingBuffer<uint8_t, TX_BUFFER_LEN>         m_buffer;
+  CP25Mod                          m_mod;
   uint8_t                          m_poBuffer[1200U];
   uint16_t                         m_poLen;
   uint16_t                         m_poPtr;
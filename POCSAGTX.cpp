@@ -38,7 +38,7 @@ const uint16_t SHAPING_FILTER_LEN = 6U;
 const uint8_t POCSAG_SYNC = 0xAAU;
 
 CPOCSAGTX::CPOCSAGTX() :
-m_buffer(4000U),
+m_buffer(),
 m_modFilter(),
 m_modState(),
 m_poBuffer(),
@@ -63,11 +63,7 @@ void CPOCSAGTX::process()
       for (uint16_t i = 0U; i < m_txDelay; i++)
         m_poBuffer[m_poLen++] = POCSAG_SYNC;
     } else {
-      for (uint8_t i = 0U; i < POCSAG_FRAME_LENGTH_BYTES; i++) {
-        uint8_t c = 0U;
-        m_buffer.get(c);
-        m_poBuffer[m_poLen++] = c;
-      }
+      m_poLen = m_buffer.read(m_poBuffer, POCSAG_FRAME_LENGTH_BYTES);
     }
 
     m_poPtr = 0U;
@@ -104,12 +100,10 @@ uint8_t CPOCSAGTX::writeData(const uint8_t* data, uint16_t length)
   if (length != POCSAG_FRAME_LENGTH_BYTES)
     return 4U;
 
-  uint16_t space = m_buffer.getSpace();
-  if (space < POCSAG_FRAME_LENGTH_BYTES)
+  if (!m_buffer.hasSpace(POCSAG_FRAME_LENGTH_BYTES))
     return 5U;
 
-  for (uint8_t i = 0U; i < POCSAG_FRAME_LENGTH_BYTES; i++)
-    m_buffer.put(data[i]);
+  m_buffer.write(data, POCSAG_FRAME_LENGTH_BYTES);
 
   return 0U;
 }
@@ -151,5 +145,10 @@ uint8_t CPOCSAGTX::getSpace() const
   return m_buffer.getSpace() / POCSAG_FRAME_LENGTH_BYTES;
 }
 
+void CPOCSAGTX::getBufferStats(TRingStats& stats)
+{
+  m_buffer.getStats(stats);
+}
+
 #endif
 
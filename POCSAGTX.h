@@ -39,10 +39,12 @@ public:
 
   uint8_t getSpace() const;
 
+  void getBufferStats(TRingStats& stats);
+
   bool busy();
 
 private:
-  CRingBuffer<uint8_t>            m_buffer;
+  CRingBuffer<uint8_t, 4096U>     m_buffer;
   arm_fir_instance_q15 m_modFilter;
   q15_t                m_modState[170U];     // NoTaps + BlockSize - 1, 6 + 160 - 1 plus some spare
   uint8_t              m_poBuffer[200U];
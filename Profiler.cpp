@@ -0,0 +1,213 @@
+/*
+ *   Copyright (C) 2026 by the MMDVM developers
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "Config.h"
+
+#if defined(USE_PROFILER)
+
+#include "Globals.h"
+#include "Profiler.h"
+
+// The first loop time bin holds everything below 128 cycles, each one after it is an octave wide
+const uint8_t LOOP_FIRST_BIN = 6U;
+
+CProfiler::CProfiler() :
+m_min(),
+m_max(),
+m_count(),
+m_total(),
+m_sampleCycles(0U),
+m_lastInterrupt(0U),
+m_interruptSamples(0U),
+m_lastLoop(0U),
+m_interruptBins(),
+m_loopBins()
+{
+  reset();
+}
+
+void CProfiler::start()
+{
+#if !defined(HOST_BUILD)
+  PROFILER_DEMCR |= 0x01000000U;         // TRCENA
+#if defined(STM32F7XX)
+  PROFILER_DWT_LAR = 0xC5ACCE55U;        // The M7 locks the DWT registers
+#endif
+  PROFILER_DWT_CYCCNT = 0U;
+  PROFILER_DWT_CTRL |= 0x00000001U;      // CYCCNTENA
+#endif
+
+  m_sampleCycles = getClock() / 24000U;
+}
+
+void CProfiler::add(PROFILE_STAGE stage, uint32_t start)
+{
+  uint32_t cycles = CProfiler::cycles() - start;
+
+  if (cycles < m_min[stage])
+    m_min[stage] = cycles;
+  if (cycles > m_max[stage])
+    m_max[stage] = cycles;
+
+  m_total[stage] += cycles;
+  m_count[stage]++;
+}
+
+void CProfiler::interrupt(uint32_t now, uint16_t samples)
+{
+  if (m_interruptSamples > 0U) {
+    uint32_t interval = now - m_lastInterrupt;
+    uint32_t nominal  = m_sampleCycles * m_interruptSamples;
+
+    uint32_t bin = PROFILE_HISTOGRAM_BINS - 1U;
+    if (interval < (2U * nominal))
+      bin = (interval * 8U) / nominal;
+    if (bin >= PROFILE_HISTOGRAM_BINS)
+      bin = PROFILE_HISTOGRAM_BINS - 1U;
+
+    m_interruptBins[bin]++;
+  }
+
+  m_lastInterrupt    = now;
+  m_interruptSamples = samples;
+}
+
+void CProfiler::loop()
+{
+  uint32_t now = cycles();
+
+  if (m_lastLoop != 0U) {
+    uint32_t interval = now - m_lastLoop;
+
+    uint32_t bin = 0U;
+    if (interval >= (2U << LOOP_FIRST_BIN))
+      bin = (31U - __builtin_clz(interval)) - LOOP_FIRST_BIN;
+    if (bin >= PROFILE_HISTOGRAM_BINS)
+      bin = PROFILE_HISTOGRAM_BINS - 1U;
+
+    m_loopBins[bin]++;
+  }
+
+  m_lastLoop = now;
+}
+
+// Each histogram is an id, the width of the first bin in cycles, and the counts. The interrupt
+// bins are all that width, an eighth of the nominal interval, and the last one also holds anything
+// longer. The loop bins double in width.
+uint16_t CProfiler::getHistograms(uint8_t* buffer) const
+{
+  uint32_t clock = getClock();
+
+  buffer[0U] = clock >> 24;
+  buffer[1U] = clock >> 16;
+  buffer[2U] = clock >> 8;
+  buffer[3U] = clock >> 0;
+
+  buffer[4U] = 2U;
+
+  uint16_t length = 5U;
+
+  for (uint8_t i = 0U; i < 2U; i++) {
+    uint32_t width = i == 0U ? (m_sampleCycles * m_interruptSamples) / 8U : (2U << LOOP_FIRST_BIN);
+    const uint32_t* bins = i == 0U ? m_interruptBins : m_loopBins;
+
+    buffer[length++] = i;
+    buffer[length++] = width >> 24;
+    buffer[length++] = width >> 16;
+    buffer[length++] = width >> 8;
+    buffer[length++] = width >> 0;
+
+    for (uint8_t j = 0U; j < PROFILE_HISTOGRAM_BINS; j++) {
+      buffer[length++] = bins[j] >> 24;
+      buffer[length++] = bins[j] >> 16;
+      buffer[length++] = bins[j] >> 8;
+      buffer[length++] = bins[j] >> 0;
+    }
+  }
+
+  return length;
+}
+
+void CProfiler::resetHistograms()
+{
+  for (uint8_t i = 0U; i < PROFILE_HISTOGRAM_BINS; i++) {
+    m_interruptBins[i] = 0U;
+    m_loopBins[i]      = 0U;
+  }
+}
+
+uint32_t CProfiler::getClock()
+{
+#if defined(HOST_BUILD)
+  return 1000000000U;
+#elif defined(__MK20DX256__) || defined(__MK64FX512__) || defined(__MK66FX1M0__)
+  return F_CPU;
+#else
+  return SystemCoreClock;
+#endif
+}
+
+uint16_t CProfiler::getStats(uint8_t* buffer) const
+{
+  uint32_t clock = getClock();
+
+  buffer[0U] = clock >> 24;
+  buffer[1U] = clock >> 16;
+  buffer[2U] = clock >> 8;
+  buffer[3U] = clock >> 0;
+
+  uint16_t length = 5U;
+  uint8_t  stages = 0U;
+
+  for (uint8_t i = 0U; i < PROFILE_STAGES; i++) {
+    if (m_count[i] == 0U)
+      continue;
+
+    uint32_t values[3U];
+    values[0U] = m_min[i];
+    values[1U] = uint32_t(m_total[i] / m_count[i]);
+    values[2U] = m_max[i];
+
+    buffer[length++] = i;
+    for (uint8_t j = 0U; j < 3U; j++) {
+      buffer[length++] = values[j] >> 24;
+      buffer[length++] = values[j] >> 16;
+      buffer[length++] = values[j] >> 8;
+      buffer[length++] = values[j] >> 0;
+    }
+
+    stages++;
+  }
+
+  buffer[4U] = stages;
+
+  return length;
+}
+
+void CProfiler::reset()
+{
+  for (uint8_t i = 0U; i < PROFILE_STAGES; i++) {
+    m_min[i]   = 0xFFFFFFFFU;
+    m_max[i]   = 0U;
+    m_count[i] = 0U;
+    m_total[i] = 0U;
+  }
+}
+
+#endif
+
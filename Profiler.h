@@ -0,0 +1,141 @@
+/*
+ *   Copyright (C) 2026 by the MMDVM developers
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(PROFILER_H)
+#define  PROFILER_H
+
+#include "Config.h"
+
+#if defined(USE_PROFILER)
+
+#if defined(HOST_BUILD)
+#include <chrono>
+#else
+// The DWT cycle counter, present on the Cortex-M3, M4 and M7
+#define  PROFILER_DEMCR       (*(volatile uint32_t*)0xE000EDFCU)
+#define  PROFILER_DWT_CTRL    (*(volatile uint32_t*)0xE0001000U)
+#define  PROFILER_DWT_CYCCNT  (*(volatile uint32_t*)0xE0001004U)
+#define  PROFILER_DWT_LAR     (*(volatile uint32_t*)0xE0001FB0U)
+#endif
+
+// The stage numbers are sent to the host, only add to the end
+enum PROFILE_STAGE {
+  PROFILE_ISR,
+  PROFILE_IO,
+  PROFILE_DC_BLOCKER,
+  PROFILE_ACTIVITY,
+  PROFILE_RRC02_FILTER,
+  PROFILE_GAUSSIAN_FILTER,
+  PROFILE_BOXCAR5_FILTER,
+  PROFILE_NXDN_FILTER,
+  PROFILE_NXDN_ISINC_FILTER,
+  PROFILE_RRC05_FILTER,
+  PROFILE_DSTAR_RX,
+  PROFILE_DMR_RX,
+  PROFILE_YSF_RX,
+  PROFILE_P25_RX,
+  PROFILE_NXDN_RX,
+  PROFILE_M17_RX,
+  PROFILE_FM_RX,
+  PROFILE_AX25_RX,
+  PROFILE_CAL_RX,
+  PROFILE_SERIAL,
+  PROFILE_DSTAR_TX,
+  PROFILE_DMR_TX,
+  PROFILE_YSF_TX,
+  PROFILE_P25_TX,
+  PROFILE_NXDN_TX,
+  PROFILE_M17_TX,
+  PROFILE_POCSAG_TX,
+  PROFILE_FM_TX,
+  PROFILE_AX25_TX,
+  PROFILE_CAL_TX,
+  PROFILE_CWID_TX,
+  PROFILE_DSTAR_HEADER,
+
+  PROFILE_STAGES
+};
+
+const uint8_t PROFILE_HISTOGRAM_BINS = 16U;
+
+// Minimum, average and maximum cycle counts of each stage of the ISR and the main loop.
+// The main loop stages include any time spent in the ISR while they were running.
+class CProfiler {
+public:
+  CProfiler();
+
+  void start();
+
+  void add(PROFILE_STAGE stage, uint32_t start);
+
+  // The clock rate, stage count and one entry for each stage that has run, returns the length
+  uint16_t getStats(uint8_t* buffer) const;
+
+  void reset();
+
+  // The interval between interrupts, in eighths of the nominal interval, and the main loop time in octaves
+  void interrupt(uint32_t now, uint16_t samples);
+  void loop();
+
+  // The clock rate and both histograms, returns the length
+  uint16_t getHistograms(uint8_t* buffer) const;
+
+  void resetHistograms();
+
+  static uint32_t cycles()
+  {
+#if defined(HOST_BUILD)
+    return uint32_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#else
+    return PROFILER_DWT_CYCCNT;
+#endif
+  }
+
+private:
+  uint32_t m_min[PROFILE_STAGES];
+  uint32_t m_max[PROFILE_STAGES];
+  uint32_t m_count[PROFILE_STAGES];
+  uint64_t m_total[PROFILE_STAGES];
+  uint32_t m_sampleCycles;
+  uint32_t m_lastInterrupt;
+  uint16_t m_interruptSamples;
+  uint32_t m_lastLoop;
+  uint32_t m_interruptBins[PROFILE_HISTOGRAM_BINS];
+  uint32_t m_loopBins[PROFILE_HISTOGRAM_BINS];
+
+  static uint32_t getClock();
+};
+
+#define  PROFILE_START(v)        uint32_t v = CProfiler::cycles()
+#define  PROFILE_STOP(s, v)      profiler.add((s), (v))
+#define  PROFILE(s, ...)         do { uint32_t profileStart = CProfiler::cycles(); __VA_ARGS__; profiler.add((s), profileStart); } while (false)
+#define  PROFILE_INTERRUPT(v, n) profiler.interrupt((v), (n))
+#define  PROFILE_LOOP()          profiler.loop()
+
+#else
+
+#define  PROFILE_START(v)
+#define  PROFILE_STOP(s, v)
+#define  PROFILE(s, ...)         do { __VA_ARGS__; } while (false)
+#define  PROFILE_INTERRUPT(v, n)
+#define  PROFILE_LOOP()
+
+#endif
+
+#endif
+
@@ -0,0 +1,123 @@
+/*
+ *   Copyright (C) 2026 by the MMDVM developers
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "Config.h"
+
+#if defined(USE_ACTIVITY_GATE)
+
+#include "Globals.h"
+#include "RXActivity.h"
+
+// The decision is made every 5ms
+const uint16_t WINDOW_SAMPLES = 120U;
+
+// Below an RMS level of 16 the channel is taken as silent
+const q63_t SILENCE_ENERGY = 16 * 16 * WINDOW_SAMPLES;
+
+// The mean square of the first difference is twice the mean square for white noise, and
+// about a fifth of it for any of the digital modes. Above 1.5 times there is no usable
+// signal left in the noise.
+const q63_t NOISE_RATIO_NUM = 3;
+const q63_t NOISE_RATIO_DEN = 2;
+
+// 100ms of empty channel before the demodulators are gated
+const uint8_t EMPTY_WINDOWS = 20U;
+
+CRXActivity::CRXActivity() :
+m_count(0U),
+m_energy(0),
+m_diffEnergy(0),
+m_last(0),
+m_emptyCount(0U),
+m_active(true),
+m_open(true),
+m_gated(0U),
+m_activeCount(0U)
+{
+}
+
+bool CRXActivity::process(const q15_t* samples, uint8_t length, bool hold)
+{
+  for (uint8_t i = 0U; i < length; i++) {
+    q31_t sample = samples[i];
+    q31_t diff   = sample - m_last;
+    m_last = samples[i];
+
+    m_energy     += sample * sample;
+    m_diffEnergy += diff * diff;
+
+    m_count++;
+    if (m_count >= WINDOW_SAMPLES) {
+      bool empty = m_energy < SILENCE_ENERGY || (m_diffEnergy * NOISE_RATIO_DEN) > (m_energy * NOISE_RATIO_NUM);
+
+      if (!empty) {
+        if (!m_active)
+          DEBUG1("RXActivity: channel active");
+        m_emptyCount = 0U;
+        m_active = true;
+      } else if (m_active) {
+        m_emptyCount++;
+        if (m_emptyCount >= EMPTY_WINDOWS) {
+          DEBUG1("RXActivity: channel empty");
+          m_active = false;
+        }
+      }
+
+      m_count      = 0U;
+      m_energy     = 0;
+      m_diffEnergy = 0;
+    }
+  }
+
+  // A receiver with a sync is kept running until it has timed out and reported the loss
+  m_open = m_active || hold;
+
+  if (m_open)
+    m_activeCount += length;
+  else
+    m_gated += length;
+
+  return m_open;
+}
+
+bool CRXActivity::isActive() const
+{
+  return m_open;
+}
+
+void CRXActivity::reset()
+{
+  m_count      = 0U;
+  m_energy     = 0;
+  m_diffEnergy = 0;
+  m_emptyCount = 0U;
+  m_active     = true;
+  m_open       = true;
+}
+
+// The samples passed to and held back from the demodulators since the last call
+void CRXActivity::getCounts(uint32_t& gated, uint32_t& active)
+{
+  gated  = m_gated;
+  active = m_activeCount;
+
+  m_gated       = 0U;
+  m_activeCount = 0U;
+}
+
+#endif
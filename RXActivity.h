@@ -0,0 +1,56 @@
+/*
+ *   Copyright (C) 2026 by the MMDVM developers
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "Config.h"
+
+#if defined(USE_ACTIVITY_GATE)
+
+#if !defined(RXACTIVITY_H)
+#define  RXACTIVITY_H
+
+// Decides whether the idle receive channel is clearly empty, either silent or
+// only discriminator noise, from the energy and the first difference energy
+// of the samples. The digital mode demodulators can then be skipped, except
+// while one of them has a sync and is waiting to time out and report the loss.
+class CRXActivity {
+public:
+  CRXActivity();
+
+  bool process(const q15_t* samples, uint8_t length, bool hold);
+
+  bool isActive() const;
+
+  void reset();
+
+  void getCounts(uint32_t& gated, uint32_t& active);
+
+private:
+  uint16_t m_count;
+  q63_t    m_energy;
+  q63_t    m_diffEnergy;
+  q15_t    m_last;
+  uint8_t  m_emptyCount;
+  bool     m_active;
+  bool     m_open;
+  uint32_t m_gated;
+  uint32_t m_activeCount;
+};
+
+#endif
+
+#endif
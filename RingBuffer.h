@@ -24,6 +24,10 @@
 #include "stm32f4xx.h"
 #elif defined(STM32F7XX)
 #include "stm32f7xx.h"
+#elif defined(HOST_BUILD)
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
 #elif defined(STM32F105xC)
 #include "stm32f1xx.h"
 #include <cstddef>
@@ -38,38 +42,81 @@
 #define  ARM_MATH_CM7
 #elif defined(STM32F4XX) || defined(__MK20DX256__) || defined(__MK64FX512__) || defined(__MK66FX1M0__)
 #define  ARM_MATH_CM4
-#else
+#elif !defined(HOST_BUILD)
 #error "Unknown processor type"
 #endif
 
 #include <arm_math.h>
 
-template <typename TDATATYPE>
+// The barriers that order the data accesses against the index updates, so
+// that one side can run in an interrupt routine and the other in the main loop
+#define RINGBUFFER_ACQUIRE()  __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define RINGBUFFER_RELEASE()  __atomic_thread_fence(__ATOMIC_RELEASE)
+
+// The fill and loss counts of a ring buffer since they were last read
+struct TRingStats {
+  uint16_t length;
+  uint16_t highWater;
+  uint16_t overflows;
+  uint16_t underflows;
+};
+
+// A lock free single producer, single consumer ring buffer. LENGTH must be a
+// power of two, the head and tail run freely and are masked when used, so all
+// LENGTH entries can be filled.
+template <typename TDATATYPE, uint16_t LENGTH = 512U>
 class CRingBuffer {
 public:
-  CRingBuffer(uint16_t length = 370U);
-  
+  CRingBuffer();
+
   uint16_t getSpace() const;
-  
+
   uint16_t getData() const;
 
-  bool put(TDATATYPE item) volatile;
+  // As getSpace() >= length, but a frame that does not fit is counted as an overflow
+  bool hasSpace(uint16_t length);
 
-  bool get(TDATATYPE& item) volatile;
+  bool put(TDATATYPE item);
+
+  bool get(TDATATYPE& item);
 
   TDATATYPE peek() const;
 
+  // Bulk copies, these move as many items as possible and return the number moved
+  uint16_t write(const TDATATYPE* items, uint16_t length);
+
+  uint16_t read(TDATATYPE* items, uint16_t length);
+
+  uint16_t peek(TDATATYPE* items, uint16_t length) const;
+
+  // Direct access to the largest contiguous free or used area, followed by commit() or consume()
+  uint16_t getWriteSpan(TDATATYPE*& items);
+
+  void commit(uint16_t length);
+
+  uint16_t getReadSpan(const TDATATYPE*& items) const;
+
+  void consume(uint16_t length);
+
   bool hasOverflowed();
 
+  // The highest fill, the writes that did not fit and the times that a read found the ring had run dry,
+  // these are then cleared
+  void getStats(TRingStats& stats);
+
   void reset();
 
 private:
-  uint16_t              m_length;
-  TDATATYPE*            m_buffer;
+  static const uint16_t MASK = LENGTH - 1U;
+
+  TDATATYPE             m_buffer[LENGTH];
   volatile uint16_t     m_head;
   volatile uint16_t     m_tail;
-  volatile bool         m_full;
-  bool                  m_overflow;
+  volatile bool         m_overflow;
+  uint16_t              m_highWater;
+  uint16_t              m_overflows;
+  uint16_t              m_underflows;
+  bool                  m_drained;
 };
 
 #include "RingBuffer.impl.h"
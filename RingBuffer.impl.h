@@ -19,84 +19,205 @@
 
 #include "RingBuffer.h"
 
-template <typename TDATATYPE> CRingBuffer<TDATATYPE>::CRingBuffer(uint16_t length) :
-m_length(length),
+template <typename TDATATYPE, uint16_t LENGTH> CRingBuffer<TDATATYPE, LENGTH>::CRingBuffer() :
+m_buffer(),
 m_head(0U),
 m_tail(0U),
-m_full(false),
-m_overflow(false)
+m_overflow(false),
+m_highWater(0U),
+m_overflows(0U),
+m_underflows(0U),
+m_drained(true)
 {
-  m_buffer = new TDATATYPE[length];
+  static_assert(LENGTH > 0U && (LENGTH & (LENGTH - 1U)) == 0U, "The ring buffer length must be a power of two");
 }
 
-template <typename TDATATYPE> uint16_t CRingBuffer<TDATATYPE>::getSpace() const
+template <typename TDATATYPE, uint16_t LENGTH> uint16_t CRingBuffer<TDATATYPE, LENGTH>::getSpace() const
 {
-  uint16_t n = 0U;
-
-  if (m_tail == m_head)
-    n = m_full ? 0U : m_length;
-  else if (m_tail < m_head)
-    n = m_length - m_head + m_tail;
-  else
-    n = m_tail - m_head;
-
-  if (n > m_length)
-    n = 0U;
+  return LENGTH - uint16_t(m_head - m_tail);
+}
 
-  return n;
+template <typename TDATATYPE, uint16_t LENGTH> uint16_t CRingBuffer<TDATATYPE, LENGTH>::getData() const
+{
+  return uint16_t(m_head - m_tail);
 }
 
-template <typename TDATATYPE> uint16_t CRingBuffer<TDATATYPE>::getData() const
+template <typename TDATATYPE, uint16_t LENGTH> bool CRingBuffer<TDATATYPE, LENGTH>::hasSpace(uint16_t length)
 {
-  if (m_tail == m_head)
-    return m_full ? m_length : 0U;
-  else if (m_tail < m_head)
-    return m_head - m_tail;
-  else
-    return m_length - m_tail + m_head;
+  if (getSpace() >= length)
+    return true;
+
+  m_overflows++;
+
+  return false;
 }
 
-template <typename TDATATYPE> bool CRingBuffer<TDATATYPE>::put(TDATATYPE item) volatile
+template <typename TDATATYPE, uint16_t LENGTH> bool CRingBuffer<TDATATYPE, LENGTH>::put(TDATATYPE item)
 {
-  if (m_full) {
+  uint16_t head = m_head;
+  uint16_t tail = m_tail;
+  RINGBUFFER_ACQUIRE();
+
+  uint16_t data = uint16_t(head - tail);
+  if (data >= LENGTH) {
     m_overflow = true;
+    m_overflows++;
     return false;
   }
 
-  m_buffer[m_head] = item;
+  if (data >= m_highWater)
+    m_highWater = data + 1U;
 
-  m_head++;
-  if (m_head >= m_length)
-    m_head = 0U;
+  m_buffer[head & MASK] = item;
 
-  if (m_head == m_tail)
-    m_full = true;
+  RINGBUFFER_RELEASE();
+  m_head = head + 1U;
 
   return true;
 }
 
-template <typename TDATATYPE> TDATATYPE CRingBuffer<TDATATYPE>::peek() const
+template <typename TDATATYPE, uint16_t LENGTH> TDATATYPE CRingBuffer<TDATATYPE, LENGTH>::peek() const
 {
-  return m_buffer[m_tail];
+  return m_buffer[m_tail & MASK];
 }
 
-template <typename TDATATYPE> bool CRingBuffer<TDATATYPE>::get(TDATATYPE& item) volatile
+template <typename TDATATYPE, uint16_t LENGTH> bool CRingBuffer<TDATATYPE, LENGTH>::get(TDATATYPE& item)
 {
-  if (m_head == m_tail && !m_full)
+  uint16_t tail = m_tail;
+  uint16_t head = m_head;
+  RINGBUFFER_ACQUIRE();
+
+  if (head == tail) {
+    if (!m_drained)
+      m_underflows++;
+    m_drained = true;
     return false;
+  }
 
-  item = m_buffer[m_tail];
+  m_drained = false;
 
-  m_full = false;
+  item = m_buffer[tail & MASK];
 
-  m_tail++;
-  if (m_tail >= m_length)
-    m_tail = 0U;
+  RINGBUFFER_RELEASE();
+  m_tail = tail + 1U;
 
   return true;
 }
 
-template <typename TDATATYPE> bool CRingBuffer<TDATATYPE>::hasOverflowed()
+template <typename TDATATYPE, uint16_t LENGTH> uint16_t CRingBuffer<TDATATYPE, LENGTH>::write(const TDATATYPE* items, uint16_t length)
+{
+  uint16_t head = m_head;
+  uint16_t tail = m_tail;
+  RINGBUFFER_ACQUIRE();
+
+  uint16_t space = LENGTH - uint16_t(head - tail);
+  if (length > space) {
+    m_overflow = true;
+    m_overflows++;
+    length = space;
+  }
+
+  uint16_t data = LENGTH - space + length;
+  if (data > m_highWater)
+    m_highWater = data;
+
+  for (uint16_t i = 0U; i < length; i++)
+    m_buffer[(head + i) & MASK] = items[i];
+
+  RINGBUFFER_RELEASE();
+  m_head = head + length;
+
+  return length;
+}
+
+template <typename TDATATYPE, uint16_t LENGTH> uint16_t CRingBuffer<TDATATYPE, LENGTH>::read(TDATATYPE* items, uint16_t length)
+{
+  uint16_t tail = m_tail;
+  uint16_t head = m_head;
+  RINGBUFFER_ACQUIRE();
+
+  uint16_t data = uint16_t(head - tail);
+  if (length > data) {
+    if (!m_drained)
+      m_underflows++;
+    m_drained = true;
+    length = data;
+  } else {
+    m_drained = false;
+  }
+
+  for (uint16_t i = 0U; i < length; i++)
+    items[i] = m_buffer[(tail + i) & MASK];
+
+  RINGBUFFER_RELEASE();
+  m_tail = tail + length;
+
+  return length;
+}
+
+template <typename TDATATYPE, uint16_t LENGTH> uint16_t CRingBuffer<TDATATYPE, LENGTH>::peek(TDATATYPE* items, uint16_t length) const
+{
+  uint16_t tail = m_tail;
+  uint16_t head = m_head;
+  RINGBUFFER_ACQUIRE();
+
+  uint16_t data = uint16_t(head - tail);
+  if (length > data)
+    length = data;
+
+  for (uint16_t i = 0U; i < length; i++)
+    items[i] = m_buffer[(tail + i) & MASK];
+
+  return length;
+}
+
+template <typename TDATATYPE, uint16_t LENGTH> uint16_t CRingBuffer<TDATATYPE, LENGTH>::getWriteSpan(TDATATYPE*& items)
+{
+  uint16_t head = m_head;
+  uint16_t tail = m_tail;
+  RINGBUFFER_ACQUIRE();
+
+  uint16_t space = LENGTH - uint16_t(head - tail);
+  uint16_t end   = LENGTH - (head & MASK);
+
+  items = m_buffer + (head & MASK);
+
+  return space < end ? space : end;
+}
+
+template <typename TDATATYPE, uint16_t LENGTH> void CRingBuffer<TDATATYPE, LENGTH>::commit(uint16_t length)
+{
+  uint16_t head = m_head + length;
+
+  uint16_t data = uint16_t(head - m_tail);
+  if (data > m_highWater)
+    m_highWater = data;
+
+  RINGBUFFER_RELEASE();
+  m_head = head;
+}
+
+template <typename TDATATYPE, uint16_t LENGTH> uint16_t CRingBuffer<TDATATYPE, LENGTH>::getReadSpan(const TDATATYPE*& items) const
+{
+  uint16_t tail = m_tail;
+  uint16_t head = m_head;
+  RINGBUFFER_ACQUIRE();
+
+  uint16_t data = uint16_t(head - tail);
+  uint16_t end  = LENGTH - (tail & MASK);
+
+  items = m_buffer + (tail & MASK);
+
+  return data < end ? data : end;
+}
+
+template <typename TDATATYPE, uint16_t LENGTH> void CRingBuffer<TDATATYPE, LENGTH>::consume(uint16_t length)
+{
+  RINGBUFFER_RELEASE();
+  m_tail = m_tail + length;
+}
+
+template <typename TDATATYPE, uint16_t LENGTH> bool CRingBuffer<TDATATYPE, LENGTH>::hasOverflowed()
 {
   bool overflow = m_overflow;
 
@@ -105,10 +226,22 @@ template <typename TDATATYPE> bool CRingBuffer<TDATATYPE>::hasOverflowed()
   return overflow;
 }
 
-template <typename TDATATYPE> void CRingBuffer<TDATATYPE>::reset()
+template <typename TDATATYPE, uint16_t LENGTH> void CRingBuffer<TDATATYPE, LENGTH>::getStats(TRingStats& stats)
+{
+  stats.length     = LENGTH;
+  stats.highWater  = m_highWater;
+  stats.overflows  = m_overflows;
+  stats.underflows = m_underflows;
+
+  m_highWater  = getData();
+  m_overflows  = 0U;
+  m_underflows = 0U;
+}
+
+template <typename TDATATYPE, uint16_t LENGTH> void CRingBuffer<TDATATYPE, LENGTH>::reset()
 {
-  m_head = 0U;
-  m_tail = 0U;
-  m_full     = false;
+  m_head     = 0U;
+  m_tail     = 0U;
   m_overflow = false;
+  m_drained  = true;
 }
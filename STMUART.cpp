@@ -17,12 +17,37 @@
  *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+#include "Config.h"
+
 #if defined(STM32F4XX) || defined(STM32F7XX)
 
 #include "STMUART.h"
 
+#if defined(STM32F7XX)
+#define USART_RX_ADDRESS(usart) ((uint32_t)&(usart)->RDR)
+#define USART_TX_ADDRESS(usart) ((uint32_t)&(usart)->TDR)
+// The F7 flags are cleared by writing to the interrupt clear register
+#define USART_CLEAR_IDLE(usart) ((usart)->ICR = USART_ICR_IDLECF)
+#define USART_CLEAR_TC(usart)   ((usart)->ICR = USART_ICR_TCCF)
+#else
+#define USART_RX_ADDRESS(usart) ((uint32_t)&(usart)->DR)
+#define USART_TX_ADDRESS(usart) ((uint32_t)&(usart)->DR)
+// IDLE is cleared by reading the status register, done by USART_GetITStatus(), and then the data register
+#define USART_CLEAR_IDLE(usart) USART_ReceiveData(usart)
+#define USART_CLEAR_TC(usart)   USART_ClearITPendingBit(usart, USART_IT_TC)
+#endif
+
 CSTMUART::CSTMUART() :
 m_usart(NULL)
+#if defined(USE_DMA_SERIAL)
+,
+m_rxStream(NULL),
+m_txStream(NULL),
+m_txFlags(0U),
+m_rxHead(0U),
+m_rxTail(0U),
+m_txLength(0U)
+#endif
 {
 
 }
@@ -32,11 +57,144 @@ void CSTMUART::init(USART_TypeDef* usart)
   m_usart = usart;
 }
 
+#if defined(USE_DMA_SERIAL)
+// The UART receives into m_rxDMA with a circular DMA, and the idle line interrupt at the end of
+// each burst from the host marks how far the bytes are ready, so that a frame written in one go
+// is nearly always read whole. A long run with no gap is read once half the buffer has filled.
+// The TX FIFO is sent by DMA a contiguous span at a time, the next being started by the
+// transmission complete interrupt.
+void CSTMUART::initDMA(USART_TypeDef* usart, DMA_Stream_TypeDef* rxStream, uint32_t rxChannel, DMA_Stream_TypeDef* txStream, uint32_t txChannel, uint32_t txFlags)
+{
+  m_rxStream = rxStream;
+  m_txStream = txStream;
+  m_txFlags  = txFlags;
+
+  if (rxStream >= DMA2_Stream0)
+    RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_DMA2, ENABLE);
+  else
+    RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_DMA1, ENABLE);
+
+  DMA_InitTypeDef DMA_InitStructure;
+  DMA_StructInit(&DMA_InitStructure);
+  DMA_InitStructure.DMA_Channel            = rxChannel;
+  DMA_InitStructure.DMA_PeripheralBaseAddr = USART_RX_ADDRESS(usart);
+  DMA_InitStructure.DMA_Memory0BaseAddr    = (uint32_t)m_rxDMA;
+  DMA_InitStructure.DMA_DIR                = DMA_DIR_PeripheralToMemory;
+  DMA_InitStructure.DMA_BufferSize         = BUFFER_SIZE;
+  DMA_InitStructure.DMA_PeripheralInc      = DMA_PeripheralInc_Disable;
+  DMA_InitStructure.DMA_MemoryInc          = DMA_MemoryInc_Enable;
+  DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+  DMA_InitStructure.DMA_MemoryDataSize     = DMA_MemoryDataSize_Byte;
+  DMA_InitStructure.DMA_Mode               = DMA_Mode_Circular;
+  DMA_InitStructure.DMA_Priority           = DMA_Priority_Medium;
+  DMA_Init(rxStream, &DMA_InitStructure);
+  DMA_Cmd(rxStream, ENABLE);
+
+  // The memory address and length are set for each transfer
+  DMA_StructInit(&DMA_InitStructure);
+  DMA_InitStructure.DMA_Channel            = txChannel;
+  DMA_InitStructure.DMA_PeripheralBaseAddr = USART_TX_ADDRESS(usart);
+  DMA_InitStructure.DMA_DIR                = DMA_DIR_MemoryToPeripheral;
+  DMA_InitStructure.DMA_BufferSize         = 1U;
+  DMA_InitStructure.DMA_PeripheralInc      = DMA_PeripheralInc_Disable;
+  DMA_InitStructure.DMA_MemoryInc          = DMA_MemoryInc_Enable;
+  DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+  DMA_InitStructure.DMA_MemoryDataSize     = DMA_MemoryDataSize_Byte;
+  DMA_InitStructure.DMA_Mode               = DMA_Mode_Normal;
+  DMA_InitStructure.DMA_Priority           = DMA_Priority_Medium;
+  DMA_Init(txStream, &DMA_InitStructure);
+
+  USART_DMACmd(usart, USART_DMAReq_Rx | USART_DMAReq_Tx, ENABLE);
+  USART_ITConfig(usart, USART_IT_RXNE, DISABLE);
+  USART_ITConfig(usart, USART_IT_IDLE, ENABLE);
+
+  m_usart = usart;
+}
+
+uint16_t CSTMUART::getDMAPosition() const
+{
+  return (BUFFER_SIZE - DMA_GetCurrDataCounter(m_rxStream)) & BUFFER_MASK;
+}
+
+uint16_t CSTMUART::getReadSpan(const uint8_t*& data)
+{
+  if (m_rxStream == NULL)
+    return 0U;
+
+  uint16_t received = (getDMAPosition() - m_rxTail) & BUFFER_MASK;
+  uint16_t ready    = (m_rxHead - m_rxTail) & BUFFER_MASK;
+
+  // The idle mark is behind the bytes already read
+  if (ready > received)
+    ready = 0U;
+
+  if (received >= (BUFFER_SIZE / 2U))
+    ready = received;
+
+  uint16_t end = BUFFER_SIZE - m_rxTail;
+
+  data = (const uint8_t*)m_rxDMA + m_rxTail;
+
+  return ready < end ? ready : end;
+}
+
+void CSTMUART::consume(uint16_t length)
+{
+  m_rxTail = (m_rxTail + length) & BUFFER_MASK;
+}
+
+void CSTMUART::startTXDMA()
+{
+  const volatile uint8_t* data = NULL;
+  uint16_t length = m_txFifo.getSpan(data);
+  if (length == 0U) {
+    USART_ITConfig(m_usart, USART_IT_TC, DISABLE);
+    return;
+  }
+
+  m_txLength = length;
+
+  // The stream can only be set up again once it reads as disabled
+  DMA_Cmd(m_txStream, DISABLE);
+  while (DMA_GetCmdStatus(m_txStream) != DISABLE)
+    ;
+
+  DMA_ClearFlag(m_txStream, m_txFlags);
+  DMA_MemoryTargetConfig(m_txStream, (uint32_t)data, DMA_Memory_0);
+  DMA_SetCurrDataCounter(m_txStream, length);
+
+  USART_CLEAR_TC(m_usart);
+  DMA_Cmd(m_txStream, ENABLE);
+  USART_ITConfig(m_usart, USART_IT_TC, ENABLE);
+}
+#endif
+
 void CSTMUART::write(const uint8_t * data, uint16_t length)
 {
   if(length == 0U || m_usart == NULL)
     return;
 
+  // Anything that doesn't fit is lost rather than overwriting what is still to be sent
+  uint16_t space = m_txFifo.getSpace();
+  if (length > space)
+    length = space;
+
+  if (length == 0U)
+    return;
+
+#if defined(USE_DMA_SERIAL)
+  if (m_txStream != NULL) {
+    for (uint16_t i = 0U; i < length; i++)
+      m_txFifo.put(data[i]);
+
+    // Otherwise the transmission complete interrupt starts the next transfer
+    if (m_txLength == 0U)
+      startTXDMA();
+
+    return;
+  }
+#endif
+
 
   m_txFifo.put(data[0]);
   USART_ITConfig(m_usart, USART_IT_TXE, ENABLE);//switch TX IRQ is on
@@ -50,6 +208,14 @@ void CSTMUART::write(const uint8_t * data, uint16_t length)
 
 uint8_t CSTMUART::read()
 {
+#if defined(USE_DMA_SERIAL)
+  if (m_rxStream != NULL) {
+    uint8_t c = m_rxDMA[m_rxTail];
+    consume(1U);
+    return c;
+  }
+#endif
+
   return m_rxFifo.get();
 }
 
@@ -58,6 +224,26 @@ void CSTMUART::handleIRQ()
   if(m_usart == NULL)
     return;
 
+#if defined(USE_DMA_SERIAL)
+  if (m_rxStream != NULL) {
+    if (USART_GetITStatus(m_usart, USART_IT_IDLE)) {
+      USART_CLEAR_IDLE(m_usart);
+      m_rxHead = getDMAPosition();
+    }
+
+    if (m_txLength > 0U && USART_GetITStatus(m_usart, USART_IT_TC)) {
+      USART_CLEAR_TC(m_usart);
+
+      m_txFifo.skip(m_txLength);
+      m_txLength = 0U;
+
+      startTXDMA();
+    }
+
+    return;
+  }
+#endif
+
   if (USART_GetITStatus(m_usart, USART_IT_RXNE)) {
     if(!m_rxFifo.isFull())
       m_rxFifo.put((uint8_t) USART_ReceiveData(m_usart));
@@ -82,6 +268,14 @@ void CSTMUART::flush()
   if(m_usart == NULL)
     return;
 
+#if defined(USE_DMA_SERIAL)
+  if (m_txStream != NULL) {
+    while (m_txLength > 0U)
+      ;
+    return;
+  }
+#endif
+
    // wait until the TXE shows the shift register is empty
    while (USART_GetITStatus(m_usart, USART_FLAG_TXE))
       ;
@@ -89,12 +283,17 @@ void CSTMUART::flush()
 
 uint16_t CSTMUART::available()
 {
+#if defined(USE_DMA_SERIAL)
+  if (m_rxStream != NULL)
+    return (getDMAPosition() - m_rxTail) & BUFFER_MASK;
+#endif
+
   return m_rxFifo.isEmpty() ? 0U : 1U;
 }
 
 uint16_t CSTMUART::availableForWrite()
 {
-  return m_txFifo.isFull() ? 0U : 1U;
+  return m_txFifo.getSpace();
 }
 
 #endif
\ No newline at end of file
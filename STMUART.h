@@ -64,6 +64,29 @@ public:
     return ((m_head + 1U) & BUFFER_MASK) == (m_tail & BUFFER_MASK);
   }
 
+  // What can be put without overwriting the bytes not yet sent, including those of a DMA transfer
+  uint16_t getSpace()
+  {
+    return BUFFER_SIZE - 1U - uint16_t(m_head - m_tail);
+  }
+
+  // The bytes from the tail up to the head or the end of the buffer, for a DMA transfer
+  uint16_t getSpan(const volatile uint8_t*& data)
+  {
+    uint16_t tail  = m_tail & BUFFER_MASK;
+    uint16_t count = uint16_t(m_head - m_tail);
+    uint16_t end   = BUFFER_SIZE - tail;
+
+    data = m_buffer + tail;
+
+    return count < end ? count : end;
+  }
+
+  void skip(uint16_t length)
+  {
+    m_tail += length;
+  }
+
 private:
   volatile uint8_t  m_buffer[BUFFER_SIZE];
   volatile uint16_t m_head;
@@ -74,6 +97,12 @@ class CSTMUART {
 public:
   CSTMUART();
   void init(USART_TypeDef* usart);
+#if defined(USE_DMA_SERIAL)
+  // The stream flags are those to clear before each TX transfer
+  void initDMA(USART_TypeDef* usart, DMA_Stream_TypeDef* rxStream, uint32_t rxChannel, DMA_Stream_TypeDef* txStream, uint32_t txChannel, uint32_t txFlags);
+  uint16_t getReadSpan(const uint8_t*& data);
+  void consume(uint16_t length);
+#endif
   void write(const uint8_t * data, uint16_t length);
   uint8_t read();
   void handleIRQ();
@@ -85,6 +114,18 @@ private:
   USART_TypeDef * m_usart;
   CSTMUARTFIFO    m_rxFifo;
   CSTMUARTFIFO    m_txFifo;
+#if defined(USE_DMA_SERIAL)
+  DMA_Stream_TypeDef* m_rxStream;
+  DMA_Stream_TypeDef* m_txStream;
+  uint32_t            m_txFlags;
+  volatile uint8_t    m_rxDMA[BUFFER_SIZE];
+  volatile uint16_t   m_rxHead;
+  uint16_t            m_rxTail;
+  volatile uint16_t   m_txLength;
+
+  uint16_t getDMAPosition() const;
+  void     startTXDMA();
+#endif
 };
 
 #endif
@@ -0,0 +1,160 @@
+/*
+ *   Copyright (C) 2026 by the MMDVM developers
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "Config.h"
+#include "Globals.h"
+
+#include "SerialPort.h"
+
+#if defined(HOST_BUILD)
+
+#include "Host.h"
+
+#include <deque>
+
+const uint8_t HOST_SERIAL_PORTS = 11U;
+
+static std::deque<uint8_t> s_rx[HOST_SERIAL_PORTS];
+static std::deque<uint8_t> s_tx[HOST_SERIAL_PORTS];
+
+// The host port receives as the STM32 does with USE_DMA_SERIAL, into a circular buffer that is
+// read in contiguous spans. The bytes written by the host software go straight into it while
+// there is room, as if the line were infinitely fast, and the rest wait in s_rx until there is.
+const uint16_t HOST_DMA_SIZE = 2048U;
+const uint16_t HOST_DMA_MASK = HOST_DMA_SIZE - 1U;
+
+static uint8_t  s_rxDMA[HOST_DMA_SIZE];
+static uint16_t s_rxHead = 0U;
+static uint16_t s_rxTail = 0U;
+
+static void receiveDMA(const uint8_t* data, uint16_t length)
+{
+  while (length > 0U) {
+    uint16_t head = s_rxHead & HOST_DMA_MASK;
+
+    uint16_t n = HOST_DMA_SIZE - head;
+    if (n > length)
+      n = length;
+
+    ::memcpy(s_rxDMA + head, data, n);
+    s_rxHead += n;
+    data     += n;
+    length   -= n;
+  }
+}
+
+void hostSerialWrite(uint8_t port, const uint8_t* data, uint16_t length)
+{
+  if (port >= HOST_SERIAL_PORTS)
+    return;
+
+  if (port == 1U && s_rx[port].empty()) {
+    uint16_t space = HOST_DMA_SIZE - uint16_t(s_rxHead - s_rxTail);
+
+    uint16_t n = length < space ? length : space;
+    receiveDMA(data, n);
+    data   += n;
+    length -= n;
+  }
+
+  s_rx[port].insert(s_rx[port].end(), data, data + length);
+}
+
+uint16_t hostSerialRead(uint8_t port, uint8_t* data, uint16_t length)
+{
+  if (port >= HOST_SERIAL_PORTS)
+    return 0U;
+
+  uint16_t n = 0U;
+  while (n < length && !s_tx[port].empty()) {
+    data[n++] = s_tx[port].front();
+    s_tx[port].pop_front();
+  }
+
+  return n;
+}
+
+void CSerialPort::beginInt(uint8_t, int)
+{
+}
+
+int CSerialPort::availableForReadInt(uint8_t n)
+{
+  if (n >= HOST_SERIAL_PORTS)
+    return 0;
+
+  return int(s_rx[n].size());
+}
+
+int CSerialPort::availableForWriteInt(uint8_t n)
+{
+  if (n >= HOST_SERIAL_PORTS)
+    return 0;
+
+  return 512;
+}
+
+uint8_t CSerialPort::readInt(uint8_t n)
+{
+  if (n >= HOST_SERIAL_PORTS || s_rx[n].empty())
+    return 0U;
+
+  uint8_t c = s_rx[n].front();
+  s_rx[n].pop_front();
+
+  return c;
+}
+
+void CSerialPort::writeInt(uint8_t n, const uint8_t* data, uint16_t length, bool)
+{
+  if (n >= HOST_SERIAL_PORTS)
+    return;
+
+  s_tx[n].insert(s_tx[n].end(), data, data + length);
+}
+
+uint16_t CSerialPort::readSpanInt(uint8_t n, const uint8_t*& data)
+{
+  if (n != 1U)
+    return 0U;
+
+  // Move the bytes that were waiting for room into the buffer
+  while (!s_rx[n].empty() && uint16_t(s_rxHead - s_rxTail) < HOST_DMA_SIZE) {
+    s_rxDMA[s_rxHead & HOST_DMA_MASK] = s_rx[n].front();
+    s_rx[n].pop_front();
+    s_rxHead++;
+  }
+
+  uint16_t tail  = s_rxTail & HOST_DMA_MASK;
+  uint16_t count = s_rxHead - s_rxTail;
+  uint16_t end   = HOST_DMA_SIZE - tail;
+
+  data = s_rxDMA + tail;
+
+  return count < end ? count : end;
+}
+
+void CSerialPort::consumeInt(uint8_t n, uint16_t length)
+{
+  if (n != 1U)
+    return;
+
+  s_rxTail += length;
+}
+
+#endif
@@ -40,6 +40,10 @@ const uint8_t MMDVM_RSSI_DATA    = 0x09U;
 
 const uint8_t MMDVM_SEND_CWID    = 0x0AU;
 
+const uint8_t MMDVM_GET_STATS    = 0x0BU;
+const uint8_t MMDVM_GET_EXT_STATUS = 0x0CU;
+const uint8_t MMDVM_TX_SPACE     = 0x0DU;
+
 const uint8_t MMDVM_DSTAR_HEADER = 0x10U;
 const uint8_t MMDVM_DSTAR_DATA   = 0x11U;
 const uint8_t MMDVM_DSTAR_LOST   = 0x12U;
@@ -90,6 +94,21 @@ const uint8_t MMDVM_I2C_DATA     = 0x81U;
 const uint8_t MMDVM_TRANSPARENT  = 0x90U;
 const uint8_t MMDVM_QSO_INFO     = 0x91U;
 
+// Soft symbol versions of the received data, the type of each is that of the hard bit frame with
+// the top bit set
+const uint8_t MMDVM_DMR_SOFT1    = 0x98U;
+const uint8_t MMDVM_DMR_SOFT2    = 0x9AU;
+
+const uint8_t MMDVM_YSF_SOFT     = 0xA0U;
+
+const uint8_t MMDVM_P25_HDR_SOFT = 0xB0U;
+const uint8_t MMDVM_P25_LDU_SOFT = 0xB1U;
+
+const uint8_t MMDVM_NXDN_SOFT    = 0xC0U;
+
+const uint8_t MMDVM_M17_LINK_SETUP_SOFT = 0xC5U;
+const uint8_t MMDVM_M17_STREAM_SOFT     = 0xC6U;
+
 const uint8_t MMDVM_DEBUG1       = 0xF1U;
 const uint8_t MMDVM_DEBUG2       = 0xF2U;
 const uint8_t MMDVM_DEBUG3       = 0xF3U;
@@ -131,19 +150,95 @@ const char HARDWARE[] = concat(HW_TYPE, VERSION, TCXO, __TIME__, __DATE__);
 
 const uint8_t PROTOCOL_VERSION   = 2U;
 
+// Setting 0x40 in the first byte of MMDVM_SET_CONFIG asks for the received DMR, YSF, P25, NXDN
+// and M17 frames as soft symbols, so that the host can run soft decision FEC. Each is sent in
+// place of the hard bit frame with the MMDVM_*_SOFT type and the same layout, a control byte,
+// the data and then the RSSI if it is sent, except that the data has four bits per symbol, the
+// first in the high nibble. Each symbol is a two's complement value from -8 to +7 scaled by the
+// centre and threshold that the receiver is tracking, so the nominal levels are -6, -2, +2 and
+// +6. The hard bits follow as the first being set for a value of 0 or more, and the second for a
+// value of +4 or more or -5 or less. Firmware that doesn't know the flag ignores it and carries
+// on sending hard bits, so a host should accept both types.
+//
+// This doubles the data, and the P25 LDU becomes a long frame of 439 bytes. At the most in bytes
+// per second:
+//
+//   mode             hard   soft
+//   DMR duplex       1300   2400
+//   YSF              1260   2460
+//   P25 LDU          1233   2439
+//   NXDN              675   1275
+//   M17              1350   2550
+//
+// which is under 6% of the 46080 bytes per second of a 460800 baud link, and under 23% at 115200.
+
+// Setting 0x04 in the third byte of MMDVM_SET_CONFIG adds the carrier offset of the transmission
+// that has just ended to the MMDVM_YSF_LOST, MMDVM_P25_LOST, MMDVM_NXDN_LOST, MMDVM_M17_LOST and
+// MMDVM_M17_EOT messages, as a signed 16 bit value in Hz, high byte first, with the sign of the
+// discriminator output. Without it they keep their usual three bytes. It is measured from the
+// centre of the symbol levels, and the DC that the blocker took out ahead of them, against their
+// spread, taking the mode's nominal deviation. It is -32768 (0x8000) if fewer than two good syncs
+// were found, as a single one may be in the noise. Against mmdvm_loopback it is within 25 Hz of
+// the offset for YSF, P25, NXDN and M17 from -1000 to +1000 Hz with no noise, and within 45 Hz
+// down to an Eb/N0 of 10 dB.
+
+// MMDVM_TX_SPACE, with a low and a high watermark as its two data bytes, asks the modem to tell
+// the host of the space in its TX buffers, rather than have the host poll MMDVM_GET_STATUS for
+// it. The modem acknowledges it and sends an MMDVM_TX_SPACE of its own, with the ten space bytes
+// of MMDVM_GET_STATUS in the same order and units, D-Star, DMR slot 1 and 2, YSF, P25, NXDN, M17,
+// FM, POCSAG and AX.25. It sends another at the start of each pass of the main loop in which a
+// buffer's space has risen, as the transmitter took a frame, and either reached the low
+// watermark from below it, is at the high watermark or above, or is the most it has been, as the
+// buffer has drained. So the host hears when it may send again, and then of every frame taken as
+// the buffer nears running dry, and watermarks above what a mode's buffer holds can't stall it. Between the reports
+// the modem's space is never less than the host's count, the last report less what it has sent
+// since, bar frames still on the link when the report was made, as with MMDVM_GET_STATUS. Each
+// is 13 bytes in place of a poll and its 20 byte reply. While the reports are on, any frame
+// from the host keeps the watchdog from ending a transmission, as MMDVM_GET_STATUS does, but a
+// host with nothing more to send must still send one within two seconds. A high watermark of
+// zero turns them off, as MMDVM_SET_CONFIG does, so that a host that doesn't know of them never
+// sees them.
+
 // Parameters for batching serial data
 const int      MAX_SERIAL_DATA  = 250;
 const uint16_t MAX_SERIAL_COUNT = 100U;
 
+// The bytes read from the host at a time without SERIAL_SPANS
+const uint16_t SERIAL_READ_BLOCK = 64U;
+
+// The length of a frame from its first bytes, the frame start and then either the length or a
+// zero and the length less 255, or zero if not enough of it has arrived to tell
+static uint16_t getFrameLength(const uint8_t* data, uint16_t length)
+{
+  if (length < 2U)
+    return 0U;
+
+  if (data[1U] != 0U)
+    return data[1U];
+
+  if (length < 3U)
+    return 0U;
+
+  return data[2U] + 255U;
+}
+
 CSerialPort::CSerialPort() :
 m_buffer(),
 m_ptr(0U),
 m_len(0U),
 m_debug(false),
+m_softSymbols(false),
+m_carrierOffset(false),
+m_txSpaceLow(0U),
+m_txSpaceHigh(0U),
+m_txSpace(),
+m_txSpaceEmpty(),
 m_serialData(),
 m_lastSerialAvail(0),
 m_lastSerialAvailCount(0U),
-m_i2CData()
+m_i2CData(),
+m_queue(),
+m_flushQueue(SERIAL_PRIORITIES)
 {
 }
 
@@ -156,7 +251,7 @@ void CSerialPort::sendACK(uint8_t type)
   reply[2U] = MMDVM_ACK;
   reply[3U] = type;
 
-  writeInt(1U, reply, 4);
+  queueFrame(reply, 4);
 }
 
 void CSerialPort::sendNAK(uint8_t type, uint8_t err)
@@ -169,7 +264,7 @@ void CSerialPort::sendNAK(uint8_t type, uint8_t err)
   reply[3U] = type;
   reply[4U] = err;
 
-  writeInt(1U, reply, 5);
+  queueFrame(reply, 5);
 }
 
 void CSerialPort::getStatus()
@@ -210,102 +305,167 @@ void CSerialPort::getStatus()
 
   reply[5U] = 0x00U;
 
+  getTXSpaces(reply + 6U);
+
+  reply[16U] = 0x00U;
+  reply[17U] = 0x00U;
+  reply[18U] = 0x00U;
+  reply[19U] = 0x00U;
+
+  queueFrame(reply, 20);
+}
+
+// The space in each TX buffer, as MMDVM_GET_STATUS and MMDVM_TX_SPACE send them
+void CSerialPort::getTXSpaces(uint8_t* spaces) const
+{
 #if defined(MODE_DSTAR)
   if (m_dstarEnable)
-    reply[6U] = dstarTX.getSpace();
+    spaces[0U] = dstarTX.getSpace();
   else
-    reply[6U] = 0U;
+    spaces[0U] = 0U;
 #else
-  reply[6U] = 0U;
+  spaces[0U] = 0U;
 #endif
 
 #if defined(MODE_DMR)
   if (m_dmrEnable) {
     if (m_duplex) {
-      reply[7U] = dmrTX.getSpace1();
-      reply[8U] = dmrTX.getSpace2();
+      spaces[1U] = dmrTX.getSpace1();
+      spaces[2U] = dmrTX.getSpace2();
     } else {
-      reply[7U] = 10U;
-      reply[8U] = dmrDMOTX.getSpace();
+      spaces[1U] = 10U;
+      spaces[2U] = dmrDMOTX.getSpace();
     }
   } else {
-    reply[7U] = 0U;
-    reply[8U] = 0U;
+    spaces[1U] = 0U;
+    spaces[2U] = 0U;
   }
 #else
-  reply[7U] = 0U;
-  reply[8U] = 0U;
+  spaces[1U] = 0U;
+  spaces[2U] = 0U;
 #endif
 
 #if defined(MODE_YSF)
   if (m_ysfEnable)
-    reply[9U] = ysfTX.getSpace();
+    spaces[3U] = ysfTX.getSpace();
   else
-    reply[9U] = 0U;
+    spaces[3U] = 0U;
 #else
-  reply[9U] = 0U;
+  spaces[3U] = 0U;
 #endif
 
 #if defined(MODE_P25)
   if (m_p25Enable)
-    reply[10U] = p25TX.getSpace();
+    spaces[4U] = p25TX.getSpace();
   else
-    reply[10U] = 0U;
+    spaces[4U] = 0U;
 #else
-  reply[10U] = 0U;
+  spaces[4U] = 0U;
 #endif
 
 #if defined(MODE_NXDN)
   if (m_nxdnEnable)
-    reply[11U] = nxdnTX.getSpace();
+    spaces[5U] = nxdnTX.getSpace();
   else
-    reply[11U] = 0U;
+    spaces[5U] = 0U;
 #else
-  reply[11U] = 0U;
+  spaces[5U] = 0U;
 #endif
 
 #if defined(MODE_M17)
   if (m_m17Enable)
-    reply[12U] = m17TX.getSpace();
+    spaces[6U] = m17TX.getSpace();
   else
-    reply[12U] = 0U;
+    spaces[6U] = 0U;
 #else
-  reply[12U] = 0U;
+  spaces[6U] = 0U;
 #endif
 
 #if defined(MODE_FM)
   if (m_fmEnable)
-    reply[13U] = fm.getSpace();
+    spaces[7U] = fm.getSpace();
   else
-    reply[13U] = 0U;
+    spaces[7U] = 0U;
 #else
-  reply[13U] = 0U;
+  spaces[7U] = 0U;
 #endif
 
 #if defined(MODE_POCSAG)
   if (m_pocsagEnable)
-    reply[14U] = pocsagTX.getSpace();
+    spaces[8U] = pocsagTX.getSpace();
   else
-    reply[14U] = 0U;
+    spaces[8U] = 0U;
 #else
-  reply[14U] = 0U;
+  spaces[8U] = 0U;
 #endif
 
 #if defined(MODE_AX25)
   if (m_ax25Enable)
-    reply[15U] = ax25TX.getSpace();
+    spaces[9U] = ax25TX.getSpace();
   else
-    reply[15U] = 0U;
+    spaces[9U] = 0U;
 #else
-  reply[15U] = 0U;
+  spaces[9U] = 0U;
 #endif
+}
 
-  reply[16U] = 0x00U;
-  reply[17U] = 0x00U;
-  reply[18U] = 0x00U;
-  reply[19U] = 0x00U;
+uint8_t CSerialPort::setTXSpace(const uint8_t* data, uint16_t length)
+{
+  if (length < 2U)
+    return 4U;
+
+  if (data[1U] > 0U && data[0U] > data[1U])
+    return 4U;
+
+  m_txSpaceLow  = data[0U];
+  m_txSpaceHigh = data[1U];
 
-  writeInt(1U, reply, 20);
+  ::memset(m_txSpaceEmpty, 0x00U, TX_SPACES);
+
+  return 0U;
+}
+
+void CSerialPort::sendTXSpace()
+{
+  uint8_t reply[3U + TX_SPACES];
+
+  reply[0U] = MMDVM_FRAME_START;
+  reply[1U] = 3U + TX_SPACES;
+  reply[2U] = MMDVM_TX_SPACE;
+
+  getTXSpaces(reply + 3U);
+
+  for (uint8_t i = 0U; i < TX_SPACES; i++) {
+    m_txSpace[i] = reply[3U + i];
+    if (m_txSpace[i] > m_txSpaceEmpty[i])
+      m_txSpaceEmpty[i] = m_txSpace[i];
+  }
+
+  queueFrame(reply, 3U + TX_SPACES);
+}
+
+// The buffers are emptied by the transmitters in the rest of the main loop, and only a rise in
+// the space is reported, the host knows of the frames that it sends. The most space seen in each
+// buffer is taken as empty, so a buffer that drains is reported even when it holds fewer frames
+// than the watermarks.
+void CSerialPort::checkTXSpace()
+{
+  uint8_t spaces[TX_SPACES];
+  getTXSpaces(spaces);
+
+  bool report = false;
+  for (uint8_t i = 0U; i < TX_SPACES; i++) {
+    if (spaces[i] > m_txSpace[i] && (spaces[i] >= m_txSpaceHigh || spaces[i] >= m_txSpaceEmpty[i] ||
+                                      (spaces[i] >= m_txSpaceLow && m_txSpace[i] < m_txSpaceLow)))
+      report = true;
+
+    m_txSpace[i] = spaces[i];
+    if (spaces[i] > m_txSpaceEmpty[i])
+      m_txSpaceEmpty[i] = spaces[i];
+  }
+
+  if (report)
+    sendTXSpace();
 }
 
 void CSerialPort::getVersion()
@@ -363,9 +523,174 @@ void CSerialPort::getVersion()
 
   reply[1U] = count;
 
-  writeInt(1U, reply, count);
+  queueFrame(reply, count);
+}
+
+static uint16_t addBufferStats(uint8_t* buffer, uint16_t pos, uint8_t id, const TRingStats& stats)
+{
+  buffer[pos++] = id;
+  buffer[pos++] = stats.length >> 8;
+  buffer[pos++] = stats.length >> 0;
+  buffer[pos++] = stats.highWater >> 8;
+  buffer[pos++] = stats.highWater >> 0;
+  buffer[pos++] = stats.overflows >> 8;
+  buffer[pos++] = stats.overflows >> 0;
+  buffer[pos++] = stats.underflows >> 8;
+  buffer[pos++] = stats.underflows >> 0;
+
+  return pos;
+}
+
+// The buffer fill and loss counts since the last request, a buffer id then the length, high water mark,
+// overflows and underflows for each buffer, the last three being the queues of frames to the host, whose
+// overflows are the frames dropped, followed by the interrupt interval and main loop time
+// histograms when the profiler is built in, then the number of idle samples that the activity gate
+// held back from and passed to the digital mode receivers, which are zero without USE_ACTIVITY_GATE
+void CSerialPort::getExtStatus()
+{
+  uint8_t reply[512U];
+
+  reply[0U] = MMDVM_FRAME_START;
+
+  uint8_t* data = reply + 4U;
+
+  uint16_t length = 1U;
+  uint8_t  buffers = 0U;
+
+  TRingStats rx, tx;
+  io.getBufferStats(rx, tx);
+  length = addBufferStats(data, length, 0U, rx);
+  length = addBufferStats(data, length, 1U, tx);
+  buffers += 2U;
+
+  TRingStats stats;
+#if defined(MODE_DSTAR)
+  dstarTX.getBufferStats(stats);
+  length = addBufferStats(data, length, 2U, stats);
+  buffers++;
+#endif
+
+#if defined(MODE_DMR)
+  dmrTX.getBufferStats(0U, stats);
+  length = addBufferStats(data, length, 3U, stats);
+  dmrTX.getBufferStats(1U, stats);
+  length = addBufferStats(data, length, 4U, stats);
+  dmrDMOTX.getBufferStats(stats);
+  length = addBufferStats(data, length, 5U, stats);
+  buffers += 3U;
+#endif
+
+#if defined(MODE_YSF)
+  ysfTX.getBufferStats(stats);
+  length = addBufferStats(data, length, 6U, stats);
+  buffers++;
+#endif
+
+#if defined(MODE_P25)
+  p25TX.getBufferStats(stats);
+  length = addBufferStats(data, length, 7U, stats);
+  buffers++;
+#endif
+
+#if defined(MODE_NXDN)
+  nxdnTX.getBufferStats(stats);
+  length = addBufferStats(data, length, 8U, stats);
+  buffers++;
+#endif
+
+#if defined(MODE_M17)
+  m17TX.getBufferStats(stats);
+  length = addBufferStats(data, length, 9U, stats);
+  buffers++;
+#endif
+
+#if defined(MODE_POCSAG)
+  pocsagTX.getBufferStats(stats);
+  length = addBufferStats(data, length, 10U, stats);
+  buffers++;
+#endif
+
+#if defined(MODE_FM)
+  fm.getBufferStats(stats);
+  length = addBufferStats(data, length, 11U, stats);
+  buffers++;
+#endif
+
+  for (uint8_t i = 0U; i < SERIAL_PRIORITIES; i++) {
+    m_queue[i].getStats(stats);
+    length = addBufferStats(data, length, 12U + i, stats);
+    buffers++;
+  }
+
+  data[0U] = buffers;
+
+#if defined(USE_PROFILER)
+  length += profiler.getHistograms(data + length);
+  profiler.resetHistograms();
+#else
+  // No clock rate and no histograms
+  ::memset(data + length, 0x00U, 5U);
+  length += 5U;
+#endif
+
+  uint32_t gated  = 0U;
+  uint32_t active = 0U;
+#if defined(USE_ACTIVITY_GATE)
+  io.getActivity(gated, active);
+#endif
+  data[length++] = gated >> 24;
+  data[length++] = gated >> 16;
+  data[length++] = gated >> 8;
+  data[length++] = gated >> 0;
+  data[length++] = active >> 24;
+  data[length++] = active >> 16;
+  data[length++] = active >> 8;
+  data[length++] = active >> 0;
+
+  if (length > 252U) {
+    reply[1U] = 0U;
+    reply[2U] = (length + 4U) - 255U;
+    reply[3U] = MMDVM_GET_EXT_STATUS;
+
+    queueFrame(reply, length + 4U);
+  } else {
+    reply[1U] = length + 3U;
+    reply[2U] = MMDVM_GET_EXT_STATUS;
+
+    ::memmove(reply + 3U, reply + 4U, length);
+
+    queueFrame(reply, length + 3U);
+  }
 }
 
+#if defined(USE_PROFILER)
+// The cycle counts since the last request, a stage id then the minimum, average and maximum for each stage
+void CSerialPort::getStats()
+{
+  uint8_t reply[512U];
+
+  reply[0U] = MMDVM_FRAME_START;
+
+  uint16_t length = profiler.getStats(reply + 4U);
+  profiler.reset();
+
+  if (length > 252U) {
+    reply[1U] = 0U;
+    reply[2U] = (length + 4U) - 255U;
+    reply[3U] = MMDVM_GET_STATS;
+
+    queueFrame(reply, length + 4U);
+  } else {
+    reply[1U] = length + 3U;
+    reply[2U] = MMDVM_GET_STATS;
+
+    ::memmove(reply + 3U, reply + 4U, length);
+
+    queueFrame(reply, length + 3U);
+  }
+}
+#endif
+
 uint8_t CSerialPort::setConfig(const uint8_t* data, uint16_t length)
 {
   if (length < 37U)
@@ -382,6 +707,12 @@ uint8_t CSerialPort::setConfig(const uint8_t* data, uint16_t length)
 
   m_debug = (data[0U] & 0x10U) == 0x10U;
 
+  m_softSymbols = (data[0U] & 0x40U) == 0x40U;
+
+  m_carrierOffset = (data[2U] & 0x04U) == 0x04U;
+
+  m_txSpaceHigh = 0U;
+
 #if defined(MODE_DSTAR)
   bool dstarEnable  = (data[1U] & 0x01U) == 0x01U;
 #endif
@@ -905,54 +1236,34 @@ void CSerialPort::start()
 
 void CSerialPort::process()
 {
+#if defined(SERIAL_SPANS)
+  // The frames are parsed where they lie in the receive buffer
+  const uint8_t* data = NULL;
+  uint16_t length;
+  while ((length = readSpanInt(1U, data)) > 0U) {
+    parse(data, length);
+    consumeInt(1U, length);
+  }
+#else
   while (availableForReadInt(1U)) {
-    uint8_t c = readInt(1U);
+    uint8_t data[SERIAL_READ_BLOCK];
 
-    if (m_ptr == 0U) {
-      if (c == MMDVM_FRAME_START) {
-        // Handle the frame start correctly
-        m_buffer[0U] = c;
-        m_ptr = 1U;
-        m_len = 0U;
-      } else {
-        m_ptr = 0U;
-        m_len = 0U;
-      }
-    } else if (m_ptr == 1U) {
-      // Handle the frame length, 1/2
-      m_len = m_buffer[m_ptr] = c;
-      m_ptr = 2U;
-    } else if (m_ptr == 2U) {
-      // Handle the frame length, 2/2
-      m_buffer[m_ptr] = c;
-      m_ptr = 3U;
-
-      if (m_len == 0U)
-        m_len = c + 255U;
-
-      // The full packet has been received, process it
-      if (m_ptr == m_len)
-        processMessage(m_buffer[2U], m_buffer + 3U, m_len - 3U);
-    } else {
-      // Any other bytes are added to the buffer
-      m_buffer[m_ptr] = c;
-      m_ptr++;
-
-      // The full packet has been received, process it
-      if (m_ptr == m_len) {
-        if (m_len > 255U)
-          processMessage(m_buffer[3U], m_buffer + 4U, m_len - 4U);
-        else
-          processMessage(m_buffer[2U], m_buffer + 3U, m_len - 3U);
-      }
-    }
+    uint16_t length = 0U;
+    while (length < SERIAL_READ_BLOCK && availableForReadInt(1U))
+      data[length++] = readInt(1U);
+
+    parse(data, length);
   }
+#endif
 
   if (io.getWatchdog() >= 48000U) {
     m_ptr = 0U;
     m_len = 0U;
   }
 
+  if (m_txSpaceHigh > 0U)
+    checkTXSpace();
+
 #if defined(SERIAL_REPEATER)
   // Write any outgoing serial data
   uint16_t serialSpace = m_serialData.getData();
@@ -961,11 +1272,14 @@ void CSerialPort::process()
     if (avail < serialSpace)
       serialSpace = avail;
 
-    for (uint16_t i = 0U; i < serialSpace; i++) {
-      uint8_t c = 0U;
-      m_serialData.get(c);
-      writeInt(3U, &c, 1U);
-    }
+    // Send the contiguous part of the ring, the remainder goes on the next pass
+    const uint8_t* data = NULL;
+    uint16_t span = m_serialData.getReadSpan(data);
+    if (span > serialSpace)
+      span = serialSpace;
+
+    writeInt(3U, data, span);
+    m_serialData.consume(span);
   }
 
   // Read any incoming serial data, and send out in batches
@@ -994,11 +1308,14 @@ void CSerialPort::process()
     if (avail < i2CSpace)
       i2CSpace = avail;
 
-    for (uint16_t i = 0U; i < i2CSpace; i++) {
-      uint8_t c = 0U;
-      m_i2CData.get(c);
-      writeInt(10U, &c, 1U);
-    }
+    // Send the contiguous part of the ring, the remainder goes on the next pass
+    const uint8_t* data = NULL;
+    uint16_t span = m_i2CData.getReadSpan(data);
+    if (span > i2CSpace)
+      span = i2CSpace;
+
+    writeInt(10U, data, span);
+    m_i2CData.consume(span);
   }
 #endif
 }
@@ -1007,6 +1324,10 @@ void CSerialPort::processMessage(uint8_t type, const uint8_t* buffer, uint16_t l
 {
   uint8_t err = 2U;
 
+  // Without the polls for the status, the host's frames show that it is still there
+  if (m_txSpaceHigh > 0U)
+    io.resetWatchdog();
+
   switch (type) {
     case MMDVM_GET_STATUS:
       getStatus();
@@ -1132,6 +1453,27 @@ void CSerialPort::processMessage(uint8_t type, const uint8_t* buffer, uint16_t l
       }
       break;
 
+    case MMDVM_GET_EXT_STATUS:
+      getExtStatus();
+      break;
+
+    case MMDVM_TX_SPACE:
+      err = setTXSpace(buffer, length);
+      if (err == 0U) {
+        sendACK(type);
+        if (m_txSpaceHigh > 0U)
+          sendTXSpace();
+      } else {
+        sendNAK(type, err);
+      }
+      break;
+
+#if defined(USE_PROFILER)
+    case MMDVM_GET_STATS:
+      getStats();
+      break;
+#endif
+
 #if defined(MODE_DSTAR)
     case MMDVM_DSTAR_HEADER:
       if (m_dstarEnable) {
@@ -1409,16 +1751,14 @@ void CSerialPort::processMessage(uint8_t type, const uint8_t* buffer, uint16_t l
 
 #if defined(SERIAL_REPEATER)
     case MMDVM_SERIAL_DATA: {
-      for (uint16_t i = 0U; i < length; i++)
-        m_serialData.put(buffer[i]);
+      m_serialData.write(buffer, length);
       }
       break;
 #endif
 
 #if defined(I2C_REPEATER)
     case MMDVM_I2C_DATA: {
-      for (uint16_t i = 0U; i < length; i++)
-        m_i2CData.put(buffer[i]);
+      m_i2CData.write(buffer, length);
       }
       break;
 #endif
@@ -1428,9 +1768,82 @@ void CSerialPort::processMessage(uint8_t type, const uint8_t* buffer, uint16_t l
       sendNAK(type, 1U);
       break;
   }
+}
 
-  m_ptr = 0U;
-  m_len = 0U;
+// A frame that has all arrived is handled where it lies, and only one that is split across two
+// reads, or across the end of the receive buffer, is gathered in m_buffer
+void CSerialPort::parse(const uint8_t* data, uint16_t length)
+{
+  while (length > 0U) {
+    if (m_ptr == 0U) {
+      const uint8_t* start = (const uint8_t*)::memchr(data, MMDVM_FRAME_START, length);
+      if (start == NULL)
+        return;
+
+      length -= uint16_t(start - data);
+      data    = start;
+
+      uint16_t frameLength = getFrameLength(data, length);
+      if (frameLength > 0U && frameLength < 3U) {
+        // Not a frame, look for the next start
+        data++;
+        length--;
+        continue;
+      }
+
+      if (frameLength > 0U && frameLength <= length) {
+        dispatch(data, frameLength);
+        data   += frameLength;
+        length -= frameLength;
+        continue;
+      }
+    }
+
+    uint16_t n = gather(data, length);
+    data   += n;
+    length -= n;
+  }
+}
+
+// Adds to the frame in m_buffer and handles it once it is whole, returning the bytes used
+uint16_t CSerialPort::gather(const uint8_t* data, uint16_t length)
+{
+  uint16_t n = 1U;
+
+  if (m_len == 0U) {
+    // A byte at a time until the length is known
+    m_buffer[m_ptr++] = data[0U];
+
+    m_len = getFrameLength(m_buffer, m_ptr);
+    if (m_len > 0U && m_len < 3U) {
+      m_ptr = 0U;
+      m_len = 0U;
+      return n;
+    }
+  } else {
+    n = m_len - m_ptr;
+    if (n > length)
+      n = length;
+
+    ::memcpy(m_buffer + m_ptr, data, n);
+    m_ptr += n;
+  }
+
+  if (m_len > 0U && m_ptr == m_len) {
+    dispatch(m_buffer, m_len);
+    m_ptr = 0U;
+    m_len = 0U;
+  }
+
+  return n;
+}
+
+void CSerialPort::dispatch(const uint8_t* frame, uint16_t length)
+{
+  if (frame[1U] == 0U)
+    processMessage(frame[3U], frame + 4U, length - 4U);
+  else
+    processMessage(frame[2U], frame + 3U, length - 3U);
 }
 
 #if defined(MODE_DSTAR)
@@ -1453,7 +1866,7 @@ void CSerialPort::writeDStarHeader(const uint8_t* header, uint8_t length)
 
   reply[1U] = count;
 
-  writeInt(1U, reply, count);
+  queueFrame(reply, count);
 }
 
 void CSerialPort::writeDStarData(const uint8_t* data, uint8_t length)
@@ -1476,7 +1889,7 @@ void CSerialPort::writeDStarData(const uint8_t* data, uint8_t length)
 
   reply[1U] = count;
 
-  writeInt(1U, reply, count);
+  queueFrame(reply, count);
 }
 
 void CSerialPort::writeDStarLost()
@@ -1493,7 +1906,7 @@ void CSerialPort::writeDStarLost()
   reply[1U] = 3U;
   reply[2U] = MMDVM_DSTAR_LOST;
 
-  writeInt(1U, reply, 3);
+  queueFrame(reply, 3);
 }
 
 void CSerialPort::writeDStarEOT()
@@ -1510,7 +1923,7 @@ void CSerialPort::writeDStarEOT()
   reply[1U] = 3U;
   reply[2U] = MMDVM_DSTAR_EOT;
 
-  writeInt(1U, reply, 3);
+  queueFrame(reply, 3);
 }
 #endif
 
@@ -1535,7 +1948,18 @@ void CSerialPort::writeDMRData(bool slot, const uint8_t* data, uint8_t length)
 
   reply[1U] = count;
 
-  writeInt(1U, reply, count);
+  queueFrame(reply, count);
+}
+
+void CSerialPort::writeDMRSoft(bool slot, const uint8_t* data, uint8_t length)
+{
+  if (m_modemState != STATE_DMR && m_modemState != STATE_IDLE)
+    return;
+
+  if (!m_dmrEnable)
+    return;
+
+  writeFrame(slot ? MMDVM_DMR_SOFT2 : MMDVM_DMR_SOFT1, data, length);
 }
 
 void CSerialPort::writeDMRLost(bool slot)
@@ -1552,7 +1976,7 @@ void CSerialPort::writeDMRLost(bool slot)
   reply[1U] = 3U;
   reply[2U] = slot ? MMDVM_DMR_LOST2 : MMDVM_DMR_LOST1;
 
-  writeInt(1U, reply, 3);
+  queueFrame(reply, 3);
 }
 #endif
 
@@ -1577,10 +2001,10 @@ void CSerialPort::writeYSFData(const uint8_t* data, uint8_t length)
 
   reply[1U] = count;
 
-  writeInt(1U, reply, count);
+  queueFrame(reply, count);
 }
 
-void CSerialPort::writeYSFLost()
+void CSerialPort::writeYSFSoft(const uint8_t* data, uint8_t length)
 {
   if (m_modemState != STATE_YSF && m_modemState != STATE_IDLE)
     return;
@@ -1588,13 +2012,30 @@ void CSerialPort::writeYSFLost()
   if (!m_ysfEnable)
     return;
 
-  uint8_t reply[3U];
+  writeFrame(MMDVM_YSF_SOFT, data, length);
+}
+
+void CSerialPort::writeYSFLost(int16_t offset)
+{
+  if (m_modemState != STATE_YSF && m_modemState != STATE_IDLE)
+    return;
+
+  if (!m_ysfEnable)
+    return;
+
+  uint8_t reply[5U];
 
   reply[0U] = MMDVM_FRAME_START;
   reply[1U] = 3U;
   reply[2U] = MMDVM_YSF_LOST;
 
-  writeInt(1U, reply, 3);
+  if (m_carrierOffset) {
+    reply[1U] = 5U;
+    reply[3U] = (offset >> 8) & 0xFFU;
+    reply[4U] = (offset >> 0) & 0xFFU;
+  }
+
+  queueFrame(reply, reply[1U]);
 }
 #endif
 
@@ -1619,7 +2060,7 @@ void CSerialPort::writeP25Hdr(const uint8_t* data, uint8_t length)
 
   reply[1U] = count;
 
-  writeInt(1U, reply, count);
+  queueFrame(reply, count);
 }
 
 void CSerialPort::writeP25Ldu(const uint8_t* data, uint8_t length)
@@ -1642,10 +2083,10 @@ void CSerialPort::writeP25Ldu(const uint8_t* data, uint8_t length)
 
   reply[1U] = count;
 
-  writeInt(1U, reply, count);
+  queueFrame(reply, count);
 }
 
-void CSerialPort::writeP25Lost()
+void CSerialPort::writeP25HdrSoft(const uint8_t* data, uint8_t length)
 {
   if (m_modemState != STATE_P25 && m_modemState != STATE_IDLE)
     return;
@@ -1653,13 +2094,41 @@ void CSerialPort::writeP25Lost()
   if (!m_p25Enable)
     return;
 
-  uint8_t reply[3U];
+  writeFrame(MMDVM_P25_HDR_SOFT, data, length);
+}
+
+void CSerialPort::writeP25LduSoft(const uint8_t* data, uint16_t length)
+{
+  if (m_modemState != STATE_P25 && m_modemState != STATE_IDLE)
+    return;
+
+  if (!m_p25Enable)
+    return;
+
+  writeFrame(MMDVM_P25_LDU_SOFT, data, length);
+}
+
+void CSerialPort::writeP25Lost(int16_t offset)
+{
+  if (m_modemState != STATE_P25 && m_modemState != STATE_IDLE)
+    return;
+
+  if (!m_p25Enable)
+    return;
+
+  uint8_t reply[5U];
 
   reply[0U] = MMDVM_FRAME_START;
   reply[1U] = 3U;
   reply[2U] = MMDVM_P25_LOST;
 
-  writeInt(1U, reply, 3);
+  if (m_carrierOffset) {
+    reply[1U] = 5U;
+    reply[3U] = (offset >> 8) & 0xFFU;
+    reply[4U] = (offset >> 0) & 0xFFU;
+  }
+
+  queueFrame(reply, reply[1U]);
 }
 #endif
 
@@ -1684,10 +2153,10 @@ void CSerialPort::writeNXDNData(const uint8_t* data, uint8_t length)
 
   reply[1U] = count;
 
-  writeInt(1U, reply, count);
+  queueFrame(reply, count);
 }
 
-void CSerialPort::writeNXDNLost()
+void CSerialPort::writeNXDNSoft(const uint8_t* data, uint8_t length)
 {
   if (m_modemState != STATE_NXDN && m_modemState != STATE_IDLE)
     return;
@@ -1695,13 +2164,30 @@ void CSerialPort::writeNXDNLost()
   if (!m_nxdnEnable)
     return;
 
-  uint8_t reply[3U];
+  writeFrame(MMDVM_NXDN_SOFT, data, length);
+}
+
+void CSerialPort::writeNXDNLost(int16_t offset)
+{
+  if (m_modemState != STATE_NXDN && m_modemState != STATE_IDLE)
+    return;
+
+  if (!m_nxdnEnable)
+    return;
+
+  uint8_t reply[5U];
 
   reply[0U] = MMDVM_FRAME_START;
   reply[1U] = 3U;
   reply[2U] = MMDVM_NXDN_LOST;
 
-  writeInt(1U, reply, 3);
+  if (m_carrierOffset) {
+    reply[1U] = 5U;
+    reply[3U] = (offset >> 8) & 0xFFU;
+    reply[4U] = (offset >> 0) & 0xFFU;
+  }
+
+  queueFrame(reply, reply[1U]);
 }
 #endif
 
@@ -1726,7 +2212,7 @@ void CSerialPort::writeM17LinkSetup(const uint8_t* data, uint8_t length)
 
   reply[1U] = count;
 
-  writeInt(1U, reply, count);
+  queueFrame(reply, count);
 }
 
 void CSerialPort::writeM17Stream(const uint8_t* data, uint8_t length)
@@ -1749,10 +2235,10 @@ void CSerialPort::writeM17Stream(const uint8_t* data, uint8_t length)
 
   reply[1U] = count;
 
-  writeInt(1U, reply, count);
+  queueFrame(reply, count);
 }
 
-void CSerialPort::writeM17EOT()
+void CSerialPort::writeM17LinkSetupSoft(const uint8_t* data, uint8_t length)
 {
   if (m_modemState != STATE_M17 && m_modemState != STATE_IDLE)
     return;
@@ -1760,16 +2246,44 @@ void CSerialPort::writeM17EOT()
   if (!m_m17Enable)
     return;
 
-  uint8_t reply[3U];
+  writeFrame(MMDVM_M17_LINK_SETUP_SOFT, data, length);
+}
+
+void CSerialPort::writeM17StreamSoft(const uint8_t* data, uint8_t length)
+{
+  if (m_modemState != STATE_M17 && m_modemState != STATE_IDLE)
+    return;
+
+  if (!m_m17Enable)
+    return;
+
+  writeFrame(MMDVM_M17_STREAM_SOFT, data, length);
+}
+
+void CSerialPort::writeM17EOT(int16_t offset)
+{
+  if (m_modemState != STATE_M17 && m_modemState != STATE_IDLE)
+    return;
+
+  if (!m_m17Enable)
+    return;
+
+  uint8_t reply[5U];
 
   reply[0U] = MMDVM_FRAME_START;
   reply[1U] = 3U;
   reply[2U] = MMDVM_M17_EOT;
 
-  writeInt(1U, reply, 3);
+  if (m_carrierOffset) {
+    reply[1U] = 5U;
+    reply[3U] = (offset >> 8) & 0xFFU;
+    reply[4U] = (offset >> 0) & 0xFFU;
+  }
+
+  queueFrame(reply, reply[1U]);
 }
 
-void CSerialPort::writeM17Lost()
+void CSerialPort::writeM17Lost(int16_t offset)
 {
   if (m_modemState != STATE_M17 && m_modemState != STATE_IDLE)
     return;
@@ -1777,13 +2291,19 @@ void CSerialPort::writeM17Lost()
   if (!m_m17Enable)
     return;
 
-  uint8_t reply[3U];
+  uint8_t reply[5U];
 
   reply[0U] = MMDVM_FRAME_START;
   reply[1U] = 3U;
   reply[2U] = MMDVM_M17_LOST;
 
-  writeInt(1U, reply, 3);
+  if (m_carrierOffset) {
+    reply[1U] = 5U;
+    reply[3U] = (offset >> 8) & 0xFFU;
+    reply[4U] = (offset >> 0) & 0xFFU;
+  }
+
+  queueFrame(reply, reply[1U]);
 }
 #endif
 
@@ -1808,7 +2328,7 @@ void CSerialPort::writeFMData(const uint8_t* data, uint16_t length)
     for (uint16_t i = 0U; i < length; i++)
       reply[i + 4U] = data[i];
 
-    writeInt(1U, reply, length + 4U);
+    queueFrame(reply, length + 4U);
   } else {
     reply[1U] = length + 3U;
     reply[2U] = MMDVM_FM_DATA;
@@ -1816,7 +2336,7 @@ void CSerialPort::writeFMData(const uint8_t* data, uint16_t length)
     for (uint16_t i = 0U; i < length; i++)
       reply[i + 3U] = data[i];
 
-    writeInt(1U, reply, length + 3U);
+    queueFrame(reply, length + 3U);
   }
 }
 
@@ -1835,7 +2355,7 @@ void CSerialPort::writeFMStatus(uint8_t status)
   reply[2U] = MMDVM_FM_STATUS;
   reply[3U] = status;
 
-  writeInt(1U, reply, 4U);
+  queueFrame(reply, 4U);
 }
 
 void CSerialPort::writeFMEOT()
@@ -1852,7 +2372,7 @@ void CSerialPort::writeFMEOT()
   reply[1U] = 3U;
   reply[2U] = MMDVM_FM_EOT;
 
-  writeInt(1U, reply, 3U);
+  queueFrame(reply, 3U);
 }
 #endif
 
@@ -1877,7 +2397,7 @@ void CSerialPort::writeAX25Data(const uint8_t* data, uint16_t length)
     for (uint16_t i = 0U; i < length; i++)
       reply[i + 4U] = data[i];
 
-    writeInt(1U, reply, length + 4U);
+    queueFrame(reply, length + 4U);
   } else {
     reply[1U] = length + 3U;
     reply[2U] = MMDVM_AX25_DATA;
@@ -1885,7 +2405,7 @@ void CSerialPort::writeAX25Data(const uint8_t* data, uint16_t length)
     for (uint16_t i = 0U; i < length; i++)
       reply[i + 3U] = data[i];
 
-    writeInt(1U, reply, length + 3U);
+    queueFrame(reply, length + 3U);
   }
 }
 #endif
@@ -1905,7 +2425,7 @@ void CSerialPort::writeSerialData(const uint8_t* data, uint8_t length)
 
   reply[1U] = count;
 
-  writeInt(1U, reply, count);
+  queueFrame(reply, count);
 }
 #endif
 
@@ -1924,7 +2444,7 @@ void CSerialPort::writeI2CData(const uint8_t* data, uint8_t length)
 
   reply[1U] = count;
 
-  writeInt(1U, reply, count);
+  queueFrame(reply, count);
 }
 #endif
 
@@ -1945,7 +2465,7 @@ void CSerialPort::writeCalData(const uint8_t* data, uint8_t length)
 
   reply[1U] = count;
 
-  writeInt(1U, reply, count);
+  queueFrame(reply, count);
 }
 
 void CSerialPort::writeRSSIData(const uint8_t* data, uint8_t length)
@@ -1965,7 +2485,124 @@ void CSerialPort::writeRSSIData(const uint8_t* data, uint8_t length)
 
   reply[1U] = count;
 
-  writeInt(1U, reply, count);
+  queueFrame(reply, count);
+}
+
+bool CSerialPort::getSoftSymbols() const
+{
+  return m_softSymbols;
+}
+
+// The header and the data are written separately so that the data needn't be copied
+void CSerialPort::writeFrame(uint8_t type, const uint8_t* data, uint16_t length)
+{
+  uint8_t reply[4U];
+
+  reply[0U] = MMDVM_FRAME_START;
+
+  if (length > 252U) {
+    reply[1U] = 0U;
+    reply[2U] = (length + 4U) - 255U;
+    reply[3U] = type;
+
+    queueFrame(reply, 4U, data, length);
+  } else {
+    reply[1U] = length + 3U;
+    reply[2U] = type;
+
+    queueFrame(reply, 3U, data, length);
+  }
+}
+
+// The priority of a frame to the host, lower first
+static uint8_t getPriority(uint8_t type)
+{
+  switch (type) {
+    case MMDVM_ACK:
+    case MMDVM_NAK:
+    case MMDVM_GET_VERSION:
+    case MMDVM_GET_STATUS:
+    case MMDVM_GET_EXT_STATUS:
+    case MMDVM_GET_STATS:
+    case MMDVM_TX_SPACE:
+    case MMDVM_CAL_DATA:
+    case MMDVM_RSSI_DATA:
+    case MMDVM_SERIAL_DATA:
+      return 1U;
+
+    case MMDVM_DEBUG1:
+    case MMDVM_DEBUG2:
+    case MMDVM_DEBUG3:
+    case MMDVM_DEBUG4:
+    case MMDVM_DEBUG5:
+    case MMDVM_DEBUG_DUMP:
+      return 2U;
+
+    default:
+      return 0U;
+  }
+}
+
+// Copies the frame, and the data after it if it is in two parts, into the queue for its priority
+void CSerialPort::queueFrame(const uint8_t* frame, uint16_t length, const uint8_t* data, uint16_t dataLength)
+{
+  CRingBuffer<uint8_t, SERIAL_QUEUE_LENGTH>& queue = m_queue[getPriority(frame[1U] == 0U ? frame[3U] : frame[2U])];
+
+  if (queue.getSpace() < (length + dataLength))
+    flush();
+
+  // The UART is still too far behind, and writing the frame around the queue would send it out of
+  // order, so it is dropped whole and counted as an overflow of the queue. A frame is never longer
+  // than a queue.
+  if (!queue.hasSpace(length + dataLength))
+    return;
+
+  queue.write(frame, length);
+  if (dataLength > 0U)
+    queue.write(data, dataLength);
+}
+
+void CSerialPort::flush()
+{
+  // Only what the UART has room for is written, the rest waits for the next pass
+  int avail = availableForWriteInt(1U);
+  uint16_t space = avail > 0 ? uint16_t(avail) : 0U;
+
+  // A queue that was left part way through a frame is finished first, so that no frame is split by another
+  if (m_flushQueue < SERIAL_PRIORITIES && !flushQueue(m_flushQueue, space))
+    return;
+
+  for (uint8_t i = 0U; i < SERIAL_PRIORITIES; i++) {
+    if (!flushQueue(i, space)) {
+      m_flushQueue = i;
+      return;
+    }
+  }
+
+  m_flushQueue = SERIAL_PRIORITIES;
+}
+
+// Writes as much of a queue as there is space for, and returns true once it is empty
+bool CSerialPort::flushQueue(uint8_t i, uint16_t& space)
+{
+  const uint8_t* data = NULL;
+  uint16_t length;
+  while (space > 0U && (length = m_queue[i].getReadSpan(data)) > 0U) {
+    if (length > space)
+      length = space;
+
+    writeInt(1U, data, length);
+    m_queue[i].consume(length);
+    space -= length;
+  }
+
+  if (m_queue[i].getData() > 0U)
+    return false;
+
+  // Start again at the front, so that the next pass's frames are one span
+  m_queue[i].reset();
+
+  return true;
 }
 
 void CSerialPort::writeDebug(const char* text)
@@ -1985,7 +2622,7 @@ void CSerialPort::writeDebug(const char* text)
 
   reply[1U] = count;
 
-  writeInt(1U, reply, count, true);
+  queueFrame(reply, count);
 }
 
 void CSerialPort::writeDebug(const char* text, int16_t n1)
@@ -2008,7 +2645,7 @@ void CSerialPort::writeDebug(const char* text, int16_t n1)
 
   reply[1U] = count;
 
-  writeInt(1U, reply, count, true);
+  queueFrame(reply, count);
 }
 
 void CSerialPort::writeDebug(const char* text, int16_t n1, int16_t n2)
@@ -2034,7 +2671,7 @@ void CSerialPort::writeDebug(const char* text, int16_t n1, int16_t n2)
 
   reply[1U] = count;
 
-  writeInt(1U, reply, count, true);
+  queueFrame(reply, count);
 }
 
 void CSerialPort::writeDebug(const char* text, int16_t n1, int16_t n2, int16_t n3)
@@ -2063,7 +2700,7 @@ void CSerialPort::writeDebug(const char* text, int16_t n1, int16_t n2, int16_t n
 
   reply[1U] = count;
 
-  writeInt(1U, reply, count, true);
+  queueFrame(reply, count);
 }
 
 void CSerialPort::writeDebug(const char* text, int16_t n1, int16_t n2, int16_t n3, int16_t n4)
@@ -2095,7 +2732,7 @@ void CSerialPort::writeDebug(const char* text, int16_t n1, int16_t n2, int16_t n
 
   reply[1U] = count;
 
-  writeInt(1U, reply, count, true);
+  queueFrame(reply, count);
 }
 
 void CSerialPort::writeDebugDump(const uint8_t* data, uint16_t length)
@@ -2112,7 +2749,7 @@ void CSerialPort::writeDebugDump(const uint8_t* data, uint16_t length)
     for (uint16_t i = 0U; i < length; i++)
       reply[i + 4U] = data[i];
 
-    writeInt(1U, reply, length + 4U);
+    queueFrame(reply, length + 4U);
   } else {
     reply[1U] = length + 3U;
     reply[2U] = MMDVM_DEBUG_DUMP;
@@ -2120,6 +2757,6 @@ void CSerialPort::writeDebugDump(const uint8_t* data, uint16_t length)
     for (uint16_t i = 0U; i < length; i++)
       reply[i + 3U] = data[i];
 
-    writeInt(1U, reply, length + 3U);
+    queueFrame(reply, length + 3U);
   }
 }
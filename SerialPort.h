@@ -27,6 +27,21 @@
 #define SERIAL_SPEED 115200
 #endif
 
+// The host port is read in contiguous spans of the buffer that the UART receives into by DMA, on
+// the STM32F4 and STM32F7 with USE_DMA_SERIAL and in the host build, which simulates it
+#if (defined(USE_DMA_SERIAL) && (defined(STM32F4XX) || defined(STM32F7XX))) || defined(HOST_BUILD)
+#define SERIAL_SPANS
+#endif
+
+
+// The frames to the host are queued by priority, the radio frames, the replies and reports and
+// the debug text, and sent together once per pass of the main loop, as far as the UART has room.
+// The queues take 3 KB of RAM.
+const uint8_t  SERIAL_PRIORITIES   = 3U;
+const uint16_t SERIAL_QUEUE_LENGTH = 1024U;
+
+// The TX buffer spaces of MMDVM_GET_STATUS and MMDVM_TX_SPACE, D-Star to AX.25
+const uint8_t  TX_SPACES = 10U;
 
 class CSerialPort {
 public:
@@ -36,6 +51,9 @@ public:
 
   void process();
 
+  // Sends the queued frames, the highest priority first
+  void flush();
+
 #if defined(MODE_DSTAR)
   void writeDStarHeader(const uint8_t* header, uint8_t length);
   void writeDStarData(const uint8_t* data, uint8_t length);
@@ -45,30 +63,37 @@ public:
 
 #if defined(MODE_DMR)
   void writeDMRData(bool slot, const uint8_t* data, uint8_t length);
+  void writeDMRSoft(bool slot, const uint8_t* data, uint8_t length);
   void writeDMRLost(bool slot);
 #endif
 
 #if defined(MODE_YSF)
   void writeYSFData(const uint8_t* data, uint8_t length);
-  void writeYSFLost();
+  void writeYSFSoft(const uint8_t* data, uint8_t length);
+  void writeYSFLost(int16_t offset);
 #endif
 
 #if defined(MODE_P25)
   void writeP25Hdr(const uint8_t* data, uint8_t length);
   void writeP25Ldu(const uint8_t* data, uint8_t length);
-  void writeP25Lost();
+  void writeP25HdrSoft(const uint8_t* data, uint8_t length);
+  void writeP25LduSoft(const uint8_t* data, uint16_t length);
+  void writeP25Lost(int16_t offset);
 #endif
 
 #if defined(MODE_NXDN)
   void writeNXDNData(const uint8_t* data, uint8_t length);
-  void writeNXDNLost();
+  void writeNXDNSoft(const uint8_t* data, uint8_t length);
+  void writeNXDNLost(int16_t offset);
 #endif
 
 #if defined(MODE_M17)
   void writeM17LinkSetup(const uint8_t* data, uint8_t length);
   void writeM17Stream(const uint8_t* data, uint8_t length);
-  void writeM17Lost();
-  void writeM17EOT();
+  void writeM17LinkSetupSoft(const uint8_t* data, uint8_t length);
+  void writeM17StreamSoft(const uint8_t* data, uint8_t length);
+  void writeM17Lost(int16_t offset);
+  void writeM17EOT(int16_t offset);
 #endif
 
 #if defined(MODE_AX25)
@@ -99,24 +124,48 @@ public:
   void writeDebug(const char* text, int16_t n1, int16_t n2, int16_t n3, int16_t n4);
   void writeDebugDump(const uint8_t* data, uint16_t length);
 
+  bool getSoftSymbols() const;
+
 private:
   uint8_t   m_buffer[512U];
   uint16_t  m_ptr;
   uint16_t  m_len;
   bool      m_debug;
+  bool      m_softSymbols;
+  bool      m_carrierOffset;
+  uint8_t   m_txSpaceLow;
+  uint8_t   m_txSpaceHigh;
+  uint8_t   m_txSpace[TX_SPACES];
+  uint8_t   m_txSpaceEmpty[TX_SPACES];
   CRingBuffer<uint8_t> m_serialData;
   int       m_lastSerialAvail;
   uint16_t  m_lastSerialAvailCount;
   CRingBuffer<uint8_t> m_i2CData;
+  CRingBuffer<uint8_t, SERIAL_QUEUE_LENGTH> m_queue[SERIAL_PRIORITIES];
+  uint8_t   m_flushQueue;
 
   void    sendACK(uint8_t type);
   void    sendNAK(uint8_t type, uint8_t err);
   void    getStatus();
   void    getVersion();
+  void    getExtStatus();
+#if defined(USE_PROFILER)
+  void    getStats();
+#endif
   uint8_t setConfig(const uint8_t* data, uint16_t length);
+  uint8_t setTXSpace(const uint8_t* data, uint16_t length);
+  void    getTXSpaces(uint8_t* spaces) const;
+  void    sendTXSpace();
+  void    checkTXSpace();
   uint8_t setMode(const uint8_t* data, uint16_t length);
   void    setMode(MMDVM_STATE modemState);
   void    processMessage(uint8_t type, const uint8_t* data, uint16_t length);
+  void    parse(const uint8_t* data, uint16_t length);
+  uint16_t gather(const uint8_t* data, uint16_t length);
+  void    dispatch(const uint8_t* frame, uint16_t length);
+  void    writeFrame(uint8_t type, const uint8_t* data, uint16_t length);
+  void    queueFrame(const uint8_t* frame, uint16_t length, const uint8_t* data = NULL, uint16_t dataLength = 0U);
+  bool    flushQueue(uint8_t i, uint16_t& space);
 
 #if defined(MODE_FM)
   uint8_t setFMParams1(const uint8_t* data, uint16_t length);
@@ -131,6 +180,10 @@ private:
   int     availableForWriteInt(uint8_t n);
   uint8_t readInt(uint8_t n);
   void    writeInt(uint8_t n, const uint8_t* data, uint16_t length, bool flush = false);
+#if defined(SERIAL_SPANS)
+  uint16_t readSpanInt(uint8_t n, const uint8_t*& data);
+  void    consumeInt(uint8_t n, uint16_t length);
+#endif
 };
 
 #endif
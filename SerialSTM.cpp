@@ -103,6 +103,14 @@ void InitUSART1(int speed)
    m_USART1.init(USART1);
 }
 
+#if defined(USE_DMA_SERIAL)
+// USART1 - RX DMA2 Stream2, TX DMA2 Stream7, both Channel4
+void InitUSART1DMA()
+{
+   m_USART1.initDMA(USART1, DMA2_Stream2, DMA_Channel_4, DMA2_Stream7, DMA_Channel_4, DMA_FLAG_TCIF7 | DMA_FLAG_HTIF7 | DMA_FLAG_TEIF7 | DMA_FLAG_DMEIF7 | DMA_FLAG_FEIF7);
+}
+#endif
+
 #endif
 
 /* ************* USART2 ***************** */
@@ -161,6 +169,18 @@ void InitUSART2(int speed)
    m_USART2.init(USART2);
 }
 
+#if defined(USE_DMA_SERIAL) && !defined(DRCC_DVM)
+#if defined(USE_DMA_IO)
+#error "The DAC DMA uses DMA1 Stream5 or Stream6, which USART2 needs for USE_DMA_SERIAL"
+#endif
+
+// USART2 - RX DMA1 Stream5, TX DMA1 Stream6, both Channel4
+void InitUSART2DMA()
+{
+   m_USART2.initDMA(USART2, DMA1_Stream5, DMA_Channel_4, DMA1_Stream6, DMA_Channel_4, DMA_FLAG_TCIF6 | DMA_FLAG_HTIF6 | DMA_FLAG_TEIF6 | DMA_FLAG_DMEIF6 | DMA_FLAG_FEIF6);
+}
+#endif
+
 #endif
 
 /* ************* USART3 ***************** */
@@ -235,6 +255,14 @@ void InitUSART3(int speed)
    m_USART3.init(USART3);
 }
 
+#if defined(USE_DMA_SERIAL)
+// USART3 - RX DMA1 Stream1, TX DMA1 Stream3, both Channel4
+void InitUSART3DMA()
+{
+   m_USART3.initDMA(USART3, DMA1_Stream1, DMA_Channel_4, DMA1_Stream3, DMA_Channel_4, DMA_FLAG_TCIF3 | DMA_FLAG_HTIF3 | DMA_FLAG_TEIF3 | DMA_FLAG_DMEIF3 | DMA_FLAG_FEIF3);
+}
+#endif
+
 #endif
 
 /* ************* UART5 ***************** */
@@ -305,12 +333,24 @@ void CSerialPort::beginInt(uint8_t n, int speed)
       case 1U:
          #if defined(STM32F4_DISCOVERY) || defined(STM32F7_NUCLEO)
          InitUSART3(speed);
+         #if defined(USE_DMA_SERIAL)
+         InitUSART3DMA();
+         #endif
          #elif defined(STM32F4_PI) || defined(STM32F4_F4M) || defined(STM32F722_PI) || defined(STM32F722_F7M) || defined(STM32F722_RPT_HAT) || defined(STM32F4_DVM) || defined(STM32F7_DVM) || defined(STM32F4_EDA_405) || defined(STM32F4_EDA_446)
          InitUSART1(speed);
+         #if defined(USE_DMA_SERIAL)
+         InitUSART1DMA();
+         #endif
          #elif defined(STM32F4_NUCLEO) || defined(STM32F4_RPT_HAT_TGO)
          InitUSART2(speed);
+         #if defined(USE_DMA_SERIAL)
+         InitUSART2DMA();
+         #endif
          #elif defined(DRCC_DVM)
          InitUSART1(speed);
+         #if defined(USE_DMA_SERIAL)
+         InitUSART1DMA();
+         #endif
          #endif
          break;
       case 3U:
@@ -447,5 +487,45 @@ void CSerialPort::writeInt(uint8_t n, const uint8_t* data, uint16_t length, bool
    }
 }
 
+#if defined(USE_DMA_SERIAL)
+// Only the host port is received by DMA
+uint16_t CSerialPort::readSpanInt(uint8_t n, const uint8_t*& data)
+{
+   switch (n) {
+      case 1U:
+         #if defined(STM32F4_DISCOVERY) || defined(STM32F7_NUCLEO)
+         return m_USART3.getReadSpan(data);
+         #elif defined(STM32F4_PI) || defined(STM32F4_F4M) || defined(STM32F722_PI) || defined(STM32F722_F7M) || defined(STM32F722_RPT_HAT) || defined(STM32F4_DVM) || defined(STM32F7_DVM) || defined(STM32F4_EDA_405) || defined(STM32F4_EDA_446)
+         return m_USART1.getReadSpan(data);
+         #elif defined(STM32F4_NUCLEO) || defined(STM32F4_RPT_HAT_TGO)
+         return m_USART2.getReadSpan(data);
+         #elif defined(DRCC_DVM)
+         return m_USART1.getReadSpan(data);
+         #endif
+      default:
+         return 0U;
+   }
+}
+
+void CSerialPort::consumeInt(uint8_t n, uint16_t length)
+{
+   switch (n) {
+      case 1U:
+         #if defined(STM32F4_DISCOVERY) || defined(STM32F7_NUCLEO)
+         m_USART3.consume(length);
+         #elif defined(STM32F4_PI) || defined(STM32F4_F4M) || defined(STM32F722_PI) || defined(STM32F722_F7M) || defined(STM32F722_RPT_HAT) || defined(STM32F4_DVM) || defined(STM32F7_DVM) || defined(STM32F4_EDA_405) || defined(STM32F4_EDA_446)
+         m_USART1.consume(length);
+         #elif defined(STM32F4_NUCLEO) || defined(STM32F4_RPT_HAT_TGO)
+         m_USART2.consume(length);
+         #elif defined(DRCC_DVM)
+         m_USART1.consume(length);
+         #endif
+         break;
+      default:
+         break;
+   }
+}
+#endif
+
 #endif
 
@@ -132,7 +132,8 @@ int CSerialPort::availableForWriteInt(uint8_t n)
 {
   switch (n) {
     case 1U:
-      return !RINGBUFF_FULL(txBuffer1);
+      // USART1TxData() drops a write that doesn't fit, and a full buffer would count as empty
+      return RINGBUFF_SIZE(txBuffer1) - 1U - RINGBUFF_COUNT(txBuffer1);
     default:
       return false;
   }
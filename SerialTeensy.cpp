@@ -199,6 +199,8 @@ int CSerialPort::availableForReadInt(uint8_t n)
 int CSerialPort::availableForWriteInt(uint8_t n)
 {
   switch (n) {
+    case 1U:
+      return TX_FIFO_SIZE - 1U - TXfifolevel();
     case 3U:
       return Serial3.availableForWrite();
     default:
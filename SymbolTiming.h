@@ -0,0 +1,166 @@
+/*
+ *   Copyright (C) 2026 by the MMDVM developers
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(SYMBOLTIMING_H)
+#define  SYMBOLTIMING_H
+
+#include "Config.h"
+
+// The sync only fixes the sampling phase to the nearest sample at the start of a frame, so the
+// symbols after it are taken with a Gardner timing error detector that follows the transmitter's
+// clock through the frame. The error for each symbol is the change from the last symbol times
+// the sample half way between them, which is zero at the right phase. A fraction of it moves the
+// sampling point for the next symbol, and a smaller fraction is added into a rate that follows
+// the difference between the two clocks, so that a steady drift leaves no lag. The rate is kept
+// from frame to frame. Symbols between samples are linearly interpolated, and the offset from the
+// nominal sampling points and the rate are kept in 1/65536 of a sample.
+template <uint16_t LENGTH, uint8_t SPS>
+class CSymbolTiming {
+public:
+  CSymbolTiming() :
+  m_offset(0),
+  m_rate(0)
+  {
+  }
+
+  // Forget the clock difference, for a new transmission
+  void reset()
+  {
+    m_offset = 0;
+    m_rate   = 0;
+  }
+
+  // Go back to the phase given by the sync
+  void resync()
+  {
+    m_offset = 0;
+  }
+
+  // Take count symbols from the buffer, the first at start plus the offset, reading none of the
+  // samples after the first available
+  void extract(const q15_t* buffer, uint16_t start, uint16_t available, q15_t* symbols, uint16_t count, q15_t centre, q15_t threshold)
+  {
+    // The error is scaled by the square of the threshold, so that it doesn't depend on the deviation
+    int32_t scale = (int32_t(threshold) * int32_t(threshold)) >> 12;
+
+    q15_t last = 0;
+    for (uint16_t i = 0U; i < count; i++) {
+      int32_t pos = int32_t(i) * SYMBOL + (m_offset >> 8);
+
+      q15_t value = interpolate(buffer, start, available, pos);
+
+      if (i > 0U && scale > 0) {
+        q15_t mid = interpolate(buffer, start, available, pos - SYMBOL / 2);
+
+        int32_t error = clip(int32_t(value) - int32_t(last)) * clip(int32_t(mid) - int32_t(centre));
+
+        // In proportion to the symbol length, and divided rather than shifted so that it rounds
+        // towards zero either way
+        error /= scale;
+        if (error > MAX_ERROR)
+          error = MAX_ERROR;
+        else if (error < -MAX_ERROR)
+          error = -MAX_ERROR;
+        error *= SPS;
+
+        m_rate -= error / RATE_GAIN;
+        if (m_rate > MAX_RATE)
+          m_rate = MAX_RATE;
+        else if (m_rate < -MAX_RATE)
+          m_rate = -MAX_RATE;
+
+        m_offset += m_rate - error / OFFSET_GAIN;
+      }
+
+      symbols[i] = value;
+      last = value;
+    }
+  }
+
+  // The whole samples that the symbols have moved by, which are taken out of the offset
+  int8_t slip()
+  {
+    int8_t samples = int8_t((m_offset + (m_offset >= 0 ? 32768 : -32768)) / 65536);
+
+    m_offset -= samples * 65536;
+
+    return samples;
+  }
+
+  // A pointer into the buffer moved by a number of samples
+  static uint16_t move(uint16_t ptr, int8_t samples)
+  {
+    int32_t moved = int32_t(ptr) + samples;
+    if (moved < 0)
+      moved += LENGTH;
+    else if (moved >= int32_t(LENGTH))
+      moved -= LENGTH;
+
+    return uint16_t(moved);
+  }
+
+private:
+  // A symbol in 1/256 of a sample, for the interpolation
+  static const int32_t SYMBOL      = SPS * 256;
+  // The largest error, a sixteenth of a symbol when divided by OFFSET_GAIN
+  static const int32_t MAX_ERROR   = 65536;
+  static const int32_t OFFSET_GAIN = 16;
+  static const int32_t RATE_GAIN   = 1024;
+  // 2000 ppm
+  static const int32_t MAX_RATE    = SPS * 65536 / 500;
+
+  int32_t m_offset;
+  int32_t m_rate;
+
+  static int32_t clip(int32_t value)
+  {
+    if (value > 32767)
+      return 32767;
+    else if (value < -32767)
+      return -32767;
+    else
+      return value;
+  }
+
+  static q15_t interpolate(const q15_t* buffer, uint16_t start, uint16_t available, int32_t pos)
+  {
+    if (pos < 0)
+      pos = 0;
+
+    uint16_t n    = uint16_t(pos >> 8);
+    int32_t  frac = pos & 0xFF;
+
+    // Don't read past the newest sample
+    if ((n + 1U) >= available) {
+      n    = available - 1U;
+      frac = 0;
+    }
+
+    uint16_t ptr = start + n;
+    if (ptr >= LENGTH)
+      ptr -= LENGTH;
+
+    uint16_t next = ptr + 1U;
+    if (next >= LENGTH)
+      next -= LENGTH;
+
+    return q15_t(buffer[ptr] + (((int32_t(buffer[next]) - int32_t(buffer[ptr])) * frac) >> 8));
+  }
+};
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ *   Copyright (C) 2026 by the MMDVM developers
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(SYNCSEARCH_H)
+#define  SYNCSEARCH_H
+
+#include "Config.h"
+
+// The sign of each sample is shifted into a register for its phase within the symbol, so that
+// the register for the newest sample holds the last symbols as seen at that sampling phase. The
+// number of symbols that differ from a sync pattern is the cheap test that decides whether the
+// full correlation against the samples is worth running. Only the newest register changes with
+// each sample, so it is the only one tested, and the count is done in registers rather than with
+// the byte table in Utils.cpp.
+template <typename T, uint8_t PHASES>
+class CSyncSearch {
+public:
+  CSyncSearch() :
+  m_bits(),
+  m_phase(0U),
+  m_current(0U)
+  {
+  }
+
+  // Go back to the first phase, the registers keep their contents
+  void reset()
+  {
+    m_phase = 0U;
+  }
+
+  void add(q15_t sample)
+  {
+    m_current = T(m_bits[m_phase] << 1) | (sample < 0 ? 0x01U : 0x00U);
+    m_bits[m_phase] = m_current;
+
+    m_phase++;
+    if (m_phase >= PHASES)
+      m_phase = 0U;
+  }
+
+  // How many of the masked symbols at the newest phase differ from the pattern
+  uint8_t errors(T pattern, T mask) const
+  {
+    return countBits((uint32_t(m_current) & uint32_t(mask)) ^ uint32_t(pattern));
+  }
+
+  static uint8_t countBits(uint32_t bits)
+  {
+#if defined(__POPCNT__)
+    return __builtin_popcount(bits);
+#else
+    bits = bits - ((bits >> 1) & 0x55555555U);
+    bits = (bits & 0x33333333U) + ((bits >> 2) & 0x33333333U);
+    bits = (bits + (bits >> 4)) & 0x0F0F0F0FU;
+    return (bits * 0x01010101U) >> 24;
+#endif
+  }
+
+private:
+  T       m_bits[PHASES];
+  uint8_t m_phase;
+  T       m_current;
+};
+
+#endif
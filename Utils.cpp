@@ -65,4 +65,25 @@ uint8_t countBits64(uint64_t bits)
   return n;
 }
 
+// The sample has had the centre removed, and the threshold is the distance from the centre to
+// the boundary between the inner and outer levels, so the nominal levels come out as -6, -2, +2
+// and +6. The result is rounded down, as samplesToBits() compares with < against zero and the
+// threshold, and is returned as a four bit two's complement value.
+uint8_t softSymbol(int16_t sample, int16_t threshold)
+{
+  if (threshold < 1)
+    threshold = 1;
+
+  int32_t value = int32_t(sample) * 4;
+
+  int32_t soft = value / threshold;
+  if ((soft * threshold) > value)
+    soft--;
 
+  if (soft > 7)
+    soft = 7;
+  else if (soft < -8)
+    soft = -8;
+
+  return uint8_t(soft) & 0x0FU;
+}
@@ -23,6 +23,8 @@
 #include "stm32f4xx.h"
 #elif defined(STM32F7XX)
 #include "stm32f7xx.h"
+#elif defined(HOST_BUILD)
+#include <cstdint>
 #elif defined(STM32F105xC)
 #include "stm32f1xx.h"
 #include <cstddef>
@@ -38,5 +40,7 @@ uint8_t countBits32(uint32_t bits);
 
 uint8_t countBits64(uint64_t bits);
 
+uint8_t softSymbol(int16_t sample, int16_t threshold);
+
 #endif
 
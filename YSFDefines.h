@@ -20,6 +20,7 @@
 #define  YSFDEFINES_H
 
 const unsigned int YSF_RADIO_SYMBOL_LENGTH = 5U;      // At 24 kHz sample rate
+const unsigned int YSF_DEVIATION           = 2700U;   // Of the outer symbols, in Hz
 
 const unsigned int YSF_FRAME_LENGTH_BYTES   = 120U;
 const unsigned int YSF_FRAME_LENGTH_BITS    = YSF_FRAME_LENGTH_BYTES * 8U;
@@ -24,42 +24,26 @@
 #include "YSFRX.h"
 #include "Utils.h"
 
-const q15_t SCALING_FACTOR = 18750;      // Q15(0.55)
-
 const uint8_t MAX_SYNC_BIT_START_ERRS = 2U;
 const uint8_t MAX_SYNC_BIT_RUN_ERRS   = 4U;
 
 const uint8_t MAX_SYNC_SYMBOLS_ERRS = 3U;
 
-const uint8_t BIT_MASK_TABLE[] = {0x80U, 0x40U, 0x20U, 0x10U, 0x08U, 0x04U, 0x02U, 0x01U};
-
-#define WRITE_BIT1(p,i,b) p[(i)>>3] = (b) ? (p[(i)>>3] | BIT_MASK_TABLE[(i)&7]) : (p[(i)>>3] & ~BIT_MASK_TABLE[(i)&7])
-
-const uint8_t NOAVEPTR = 99U;
-
 const uint16_t NOENDPTR = 9999U;
 
 const unsigned int MAX_SYNC_FRAMES = 1U + 1U;
 
 CYSFRX::CYSFRX() :
 m_state(YSFRXS_NONE),
-m_bitBuffer(),
-m_buffer(),
-m_bitPtr(0U),
-m_dataPtr(0U),
+m_demod(),
+m_symbols(),
 m_startPtr(NOENDPTR),
 m_endPtr(NOENDPTR),
 m_syncPtr(NOENDPTR),
 m_minSyncPtr(NOENDPTR),
 m_maxSyncPtr(NOENDPTR),
-m_maxCorr(0),
 m_lostCount(0U),
 m_countdown(0U),
-m_centre(),
-m_centreVal(0),
-m_threshold(),
-m_thresholdVal(0),
-m_averagePtr(NOAVEPTR),
 m_rssiAccum(0U),
 m_rssiCount(0U)
 {
@@ -67,22 +51,18 @@ m_rssiCount(0U)
 
 void CYSFRX::reset()
 {
-  m_state        = YSFRXS_NONE;
-  m_dataPtr      = 0U;
-  m_bitPtr       = 0U;
-  m_maxCorr      = 0;
-  m_averagePtr   = NOAVEPTR;
-  m_startPtr     = NOENDPTR;
-  m_endPtr       = NOENDPTR;
-  m_syncPtr      = NOENDPTR;
-  m_minSyncPtr   = NOENDPTR;
-  m_maxSyncPtr   = NOENDPTR;
-  m_centreVal    = 0;
-  m_thresholdVal = 0;
-  m_lostCount    = 0U;
-  m_countdown    = 0U;
-  m_rssiAccum    = 0U;
-  m_rssiCount    = 0U;
+  m_state      = YSFRXS_NONE;
+  m_startPtr   = NOENDPTR;
+  m_endPtr     = NOENDPTR;
+  m_syncPtr    = NOENDPTR;
+  m_minSyncPtr = NOENDPTR;
+  m_maxSyncPtr = NOENDPTR;
+  m_lostCount  = 0U;
+  m_countdown  = 0U;
+  m_rssiAccum  = 0U;
+  m_rssiCount  = 0U;
+
+  m_demod.reset();
 }
 
 void CYSFRX::samples(const q15_t* samples, uint16_t* rssi, uint8_t length)
@@ -93,11 +73,7 @@ void CYSFRX::samples(const q15_t* samples, uint16_t* rssi, uint8_t length)
     m_rssiAccum += rssi[i];
     m_rssiCount++;
 
-    m_bitBuffer[m_bitPtr] <<= 1;
-    if (sample < 0)
-      m_bitBuffer[m_bitPtr] |= 0x01U;
-
-    m_buffer[m_dataPtr] = sample;
+    m_demod.add(sample);
 
     switch (m_state) {
     case YSFRXS_DATA:
@@ -107,14 +83,6 @@ void CYSFRX::samples(const q15_t* samples, uint16_t* rssi, uint8_t length)
       processNone(sample);
       break;
     }
-
-    m_dataPtr++;
-    if (m_dataPtr >= YSF_FRAME_LENGTH_SAMPLES)
-      m_dataPtr = 0U;
-
-    m_bitPtr++;
-    if (m_bitPtr >= YSF_RADIO_SYMBOL_LENGTH)
-      m_bitPtr = 0U;
   }
 }
 
@@ -130,7 +98,7 @@ void CYSFRX::processNone(q15_t sample)
       io.setDecode(true);
       io.setADCDetection(true);
 
-      m_averagePtr = NOAVEPTR;
+      m_demod.restart();
 
       m_countdown = 5U;
     }
@@ -140,13 +108,8 @@ void CYSFRX::processNone(q15_t sample)
     m_countdown--;
 
   if (m_countdown == 1U) {
-    m_minSyncPtr = m_syncPtr + YSF_FRAME_LENGTH_SAMPLES - 1U;
-    if (m_minSyncPtr >= YSF_FRAME_LENGTH_SAMPLES)
-      m_minSyncPtr -= YSF_FRAME_LENGTH_SAMPLES;
-
-    m_maxSyncPtr = m_syncPtr + 1U;
-    if (m_maxSyncPtr >= YSF_FRAME_LENGTH_SAMPLES)
-      m_maxSyncPtr -= YSF_FRAME_LENGTH_SAMPLES;
+    m_minSyncPtr = m_demod.move(m_syncPtr, -1);
+    m_maxSyncPtr = m_demod.move(m_syncPtr, +1);
 
     m_state      = YSFRXS_DATA;
     m_countdown  = 0U;
@@ -155,32 +118,26 @@ void CYSFRX::processNone(q15_t sample)
 
 void CYSFRX::processData(q15_t sample)
 {
-  if (m_minSyncPtr < m_maxSyncPtr) {
-    if (m_dataPtr >= m_minSyncPtr && m_dataPtr <= m_maxSyncPtr)
-      correlateSync();
-  } else {
-    if (m_dataPtr >= m_minSyncPtr || m_dataPtr <= m_maxSyncPtr)
-      correlateSync();
-  }
+  if (m_demod.inWindow(m_demod.ptr(), m_minSyncPtr, m_maxSyncPtr))
+    correlateSync();
 
-  if (m_dataPtr == m_endPtr) {
-    // Only update the centre and threshold if they are from a good sync
-    if (m_lostCount == MAX_SYNC_FRAMES) {
-      m_minSyncPtr = m_syncPtr + YSF_FRAME_LENGTH_SAMPLES - 1U;
-      if (m_minSyncPtr >= YSF_FRAME_LENGTH_SAMPLES)
-        m_minSyncPtr -= YSF_FRAME_LENGTH_SAMPLES;
+  if (m_demod.ptr() == m_endPtr) {
+    // The whole frame is in the buffer, the oldest sample being the first of the frame
+    m_demod.resync();
+    m_demod.extract(m_startPtr, YSF_FRAME_LENGTH_SAMPLES, m_symbols, YSF_FRAME_LENGTH_SYMBOLS);
 
-      m_maxSyncPtr = m_syncPtr + 1U;
-      if (m_maxSyncPtr >= YSF_FRAME_LENGTH_SAMPLES)
-        m_maxSyncPtr -= YSF_FRAME_LENGTH_SAMPLES;
+    // After a good sync, look for the next one from where this one was to where the transmitter's
+    // clock has taken it, and add its levels to the carrier offset
+    if (m_lostCount == MAX_SYNC_FRAMES) {
+      m_demod.syncWindow(m_syncPtr, m_minSyncPtr, m_maxSyncPtr);
+      m_demod.measureOffset(io.getDCLevel(STATE_YSF));
     }
 
-    calculateLevels(m_startPtr, YSF_FRAME_LENGTH_SYMBOLS);
-
-    DEBUG4("YSFRX: sync found pos/centre/threshold", m_syncPtr, m_centreVal, m_thresholdVal);
-
     uint8_t frame[YSF_FRAME_LENGTH_BYTES + 3U];
-    samplesToBits(m_startPtr, YSF_FRAME_LENGTH_SYMBOLS, frame, 8U, m_centreVal, m_thresholdVal);
+    m_demod.trackLevels(m_symbols, YSF_FRAME_LENGTH_SYMBOLS, frame, 8U);
+    DEBUG5("YSFRX: pos/neg/centre/threshold", m_demod.posLevel(), m_demod.negLevel(), m_demod.centre(), m_demod.threshold());
+
+    DEBUG4("YSFRX: sync found pos/centre/threshold", m_syncPtr, m_demod.centre(), m_demod.threshold());
 
     // We've not seen a data sync for too long, signal RXLOST and change to RX_NONE
     m_lostCount--;
@@ -190,199 +147,47 @@ void CYSFRX::processData(q15_t sample)
       io.setDecode(false);
       io.setADCDetection(false);
 
-      serial.writeYSFLost();
+      serial.writeYSFLost(m_demod.offset(YSF_DEVIATION));
 
-      m_state      = YSFRXS_NONE;
-      m_endPtr     = NOENDPTR;
-      m_averagePtr = NOAVEPTR;
-      m_countdown  = 0U;
-      m_maxCorr    = 0;
+      m_state     = YSFRXS_NONE;
+      m_endPtr    = NOENDPTR;
+      m_countdown = 0U;
+
+      m_demod.restart();
+      m_demod.nextSync();
     } else {
       frame[0U] = m_lostCount == (MAX_SYNC_FRAMES - 1U) ? 0x01U : 0x00U;
       writeRSSIData(frame);
-      m_maxCorr = 0;
+      m_demod.nextSync();
     }
   }
 }
 
 bool CYSFRX::correlateSync()
 {
-  if (countBits32((m_bitBuffer[m_bitPtr] & YSF_SYNC_SYMBOLS_MASK) ^ YSF_SYNC_SYMBOLS) <= MAX_SYNC_SYMBOLS_ERRS) {
-    uint16_t ptr = m_dataPtr + YSF_FRAME_LENGTH_SAMPLES - YSF_SYNC_LENGTH_SAMPLES + YSF_RADIO_SYMBOL_LENGTH;
-    if (ptr >= YSF_FRAME_LENGTH_SAMPLES)
-      ptr -= YSF_FRAME_LENGTH_SAMPLES;
-
-    q31_t corr = 0;
-    q15_t min =  16000;
-    q15_t max = -16000;
-
-    for (uint8_t i = 0U; i < YSF_SYNC_LENGTH_SYMBOLS; i++) {
-      q15_t val = m_buffer[ptr];
-
-      if (val > max)
-        max = val;
-      if (val < min)
-        min = val;
-
-      switch (YSF_SYNC_SYMBOLS_VALUES[i]) {
-      case +3:
-        corr -= (val + val + val);
-        break;
-      case +1:
-        corr -= val;
-        break;
-      case -1:
-        corr += val;
-        break;
-      default:  // -3
-        corr += (val + val + val);
-        break;
-      }
-
-      ptr += YSF_RADIO_SYMBOL_LENGTH;
-      if (ptr >= YSF_FRAME_LENGTH_SAMPLES)
-        ptr -= YSF_FRAME_LENGTH_SAMPLES;
-    }
-
-    if (corr > m_maxCorr) {
-      if (m_averagePtr == NOAVEPTR) {
-        m_centreVal = (max + min) >> 1;
-
-        q31_t v1 = (max - m_centreVal) * SCALING_FACTOR;
-        m_thresholdVal = q15_t(v1 >> 15);
-      }
-
-      uint16_t startPtr = m_dataPtr + YSF_FRAME_LENGTH_SAMPLES - YSF_SYNC_LENGTH_SAMPLES + YSF_RADIO_SYMBOL_LENGTH;
-      if (startPtr >= YSF_FRAME_LENGTH_SAMPLES)
-        startPtr -= YSF_FRAME_LENGTH_SAMPLES;
-
-      uint8_t sync[YSF_SYNC_BYTES_LENGTH];
-      samplesToBits(startPtr, YSF_SYNC_LENGTH_SYMBOLS, sync, 0U, m_centreVal, m_thresholdVal);
-
-      uint8_t maxErrs;
-      if (m_state == YSFRXS_NONE)
-        maxErrs = MAX_SYNC_BIT_START_ERRS;
-      else
-        maxErrs = MAX_SYNC_BIT_RUN_ERRS;
-
-      uint8_t errs = 0U;
-      for (uint8_t i = 0U; i < YSF_SYNC_BYTES_LENGTH; i++)
-        errs += countBits8(sync[i] ^ YSF_SYNC_BYTES[i]);
-
-      if (errs <= maxErrs) {
-        m_maxCorr   = corr;
-        m_lostCount = MAX_SYNC_FRAMES;
-        m_syncPtr   = m_dataPtr;
-
-        m_startPtr = startPtr;
-
-        m_endPtr = m_dataPtr + YSF_FRAME_LENGTH_SAMPLES - YSF_SYNC_LENGTH_SAMPLES - 1U;
-        if (m_endPtr >= YSF_FRAME_LENGTH_SAMPLES)
-          m_endPtr -= YSF_FRAME_LENGTH_SAMPLES;
-
-        return true;
-      }
-    }
-  }
-
-  return false;
-}
-
-void CYSFRX::calculateLevels(uint16_t start, uint16_t count)
-{
-  q15_t maxPos = -16000;
-  q15_t minPos =  16000;
-  q15_t maxNeg =  16000;
-  q15_t minNeg = -16000;
-
-  for (uint16_t i = 0U; i < count; i++) {
-    q15_t sample = m_buffer[start];
-
-    if (sample > 0) {
-      if (sample > maxPos)
-        maxPos = sample;
-      if (sample < minPos)
-        minPos = sample;
-    } else {
-      if (sample < maxNeg)
-        maxNeg = sample;
-      if (sample > minNeg)
-        minNeg = sample;
-    }
-
-    start += YSF_RADIO_SYMBOL_LENGTH;
-    if (start >= YSF_FRAME_LENGTH_SAMPLES)
-      start -= YSF_FRAME_LENGTH_SAMPLES;
-  }
-
-  q15_t posThresh = (maxPos + minPos) >> 1;
-  q15_t negThresh = (maxNeg + minNeg) >> 1;
-
-  q15_t centre = (posThresh + negThresh) >> 1;
-
-  q15_t threshold = posThresh - centre;
-
-  DEBUG5("YSFRX: pos/neg/centre/threshold", posThresh, negThresh, centre, threshold);
-
-  if (m_averagePtr == NOAVEPTR) {
-    for (uint8_t i = 0U; i < 16U; i++) {
-      m_centre[i] = centre;
-      m_threshold[i] = threshold;
-    }
-
-    m_averagePtr = 0U;
-  } else {
-    m_centre[m_averagePtr] = centre;
-    m_threshold[m_averagePtr] = threshold;
+  if (m_demod.searchErrors(YSF_SYNC_SYMBOLS, YSF_SYNC_SYMBOLS_MASK) > MAX_SYNC_SYMBOLS_ERRS)
+    return false;
 
-    m_averagePtr++;
-    if (m_averagePtr >= 16U)
-      m_averagePtr = 0U;
-  }
+  uint8_t maxErrs;
+  if (m_state == YSFRXS_NONE)
+    maxErrs = MAX_SYNC_BIT_START_ERRS;
+  else
+    maxErrs = MAX_SYNC_BIT_RUN_ERRS;
 
-  m_centreVal = 0;
-  m_thresholdVal = 0;
+  if (!m_demod.correlateSync(YSF_SYNC_SYMBOLS_VALUES, YSF_SYNC_BYTES, NULL, 0U, maxErrs))
+    return false;
 
-  for (uint8_t i = 0U; i < 16U; i++) {
-    m_centreVal += m_centre[i];
-    m_thresholdVal += m_threshold[i];
-  }
+  m_lostCount = MAX_SYNC_FRAMES;
+  m_syncPtr   = m_demod.ptr();
 
-  m_centreVal >>= 4;
-  m_thresholdVal >>= 4;
-}
+  m_startPtr = m_demod.syncStart();
 
-void CYSFRX::samplesToBits(uint16_t start, uint16_t count, uint8_t* buffer, uint16_t offset, q15_t centre, q15_t threshold)
-{
-  for (uint16_t i = 0U; i < count; i++) {
-    q15_t sample = m_buffer[start] - centre;
-
-    if (sample < -threshold) {
-      WRITE_BIT1(buffer, offset, false);
-      offset++;
-      WRITE_BIT1(buffer, offset, true);
-      offset++;
-    } else if (sample < 0) {
-      WRITE_BIT1(buffer, offset, false);
-      offset++;
-      WRITE_BIT1(buffer, offset, false);
-      offset++;
-    } else if (sample < threshold) {
-      WRITE_BIT1(buffer, offset, true);
-      offset++;
-      WRITE_BIT1(buffer, offset, false);
-      offset++;
-    } else {
-      WRITE_BIT1(buffer, offset, true);
-      offset++;
-      WRITE_BIT1(buffer, offset, true);
-      offset++;
-    }
+  // Wait for the last sample of the frame, the one before its first is overwritten
+  m_endPtr = m_startPtr + YSF_FRAME_LENGTH_SAMPLES - 1U;
+  if (m_endPtr >= YSF_FRAME_LENGTH_SAMPLES)
+    m_endPtr -= YSF_FRAME_LENGTH_SAMPLES;
 
-    start += YSF_RADIO_SYMBOL_LENGTH;
-    if (start >= YSF_FRAME_LENGTH_SAMPLES)
-      start -= YSF_FRAME_LENGTH_SAMPLES;
-  }
+  return true;
 }
 
 void CYSFRX::writeRSSIData(uint8_t* data)
@@ -394,17 +199,37 @@ void CYSFRX::writeRSSIData(uint8_t* data)
     data[121U] = (rssi >> 8) & 0xFFU;
     data[122U] = (rssi >> 0) & 0xFFU;
 
-    serial.writeYSFData(data, YSF_FRAME_LENGTH_BYTES + 3U);
+    writeData(data, YSF_FRAME_LENGTH_BYTES + 3U);
   } else {
-    serial.writeYSFData(data, YSF_FRAME_LENGTH_BYTES + 1U);
+    writeData(data, YSF_FRAME_LENGTH_BYTES + 1U);
   }
 #else
-  serial.writeYSFData(data, YSF_FRAME_LENGTH_BYTES + 1U);
+  writeData(data, YSF_FRAME_LENGTH_BYTES + 1U);
 #endif
 
   m_rssiAccum = 0U;
   m_rssiCount = 0U;
 }
 
+// Send the hard bits, or the soft symbols with the same control byte and RSSI if the host wants them
+void CYSFRX::writeData(const uint8_t* frame, uint8_t length)
+{
+  if (!serial.getSoftSymbols()) {
+    serial.writeYSFData(frame, length);
+    return;
+  }
+
+  uint8_t data[YSF_FRAME_LENGTH_SYMBOLS / 2U + 3U];
+  data[0U] = frame[0U];
+
+  m_demod.samplesToSoft(m_symbols, YSF_FRAME_LENGTH_SYMBOLS, data + 1U);
+
+  uint8_t count = YSF_FRAME_LENGTH_SYMBOLS / 2U + 1U;
+  for (uint8_t i = YSF_FRAME_LENGTH_BYTES + 1U; i < length; i++, count++)
+    data[count] = frame[i];
+
+  serial.writeYSFSoft(data, count);
+}
+
 #endif
 
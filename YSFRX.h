@@ -24,6 +24,10 @@
 #define  YSFRX_H
 
 #include "YSFDefines.h"
+#include "FSKDemod.h"
+
+// The sync's threshold at Q15(0.57) of its peak, each symbol moving its level by an eighth
+typedef CFSKDemod<uint32_t, YSF_FRAME_LENGTH_SAMPLES, YSF_RADIO_SYMBOL_LENGTH, YSF_SYNC_LENGTH_SYMBOLS, 18750, 3U, false> CYSFDemod;
 
 enum YSFRX_STATE {
   YSFRXS_NONE,
@@ -40,32 +44,23 @@ public:
 
 private:
   YSFRX_STATE m_state;
-  uint32_t    m_bitBuffer[YSF_RADIO_SYMBOL_LENGTH];
-  q15_t       m_buffer[YSF_FRAME_LENGTH_SAMPLES];
-  uint16_t    m_bitPtr;
-  uint16_t    m_dataPtr;
+  CYSFDemod   m_demod;
+  q15_t       m_symbols[YSF_FRAME_LENGTH_SYMBOLS];
   uint16_t    m_startPtr;
   uint16_t    m_endPtr;
   uint16_t    m_syncPtr;
   uint16_t    m_minSyncPtr;
   uint16_t    m_maxSyncPtr;
-  q31_t       m_maxCorr;
   uint16_t    m_lostCount;
   uint8_t     m_countdown;
-  q15_t       m_centre[16U];
-  q15_t       m_centreVal;
-  q15_t       m_threshold[16U];
-  q15_t       m_thresholdVal;
-  uint8_t     m_averagePtr;
   uint32_t    m_rssiAccum;
   uint16_t    m_rssiCount;
 
   void processNone(q15_t sample);
   void processData(q15_t sample);
   bool correlateSync();
-  void calculateLevels(uint16_t start, uint16_t count);
-  void samplesToBits(uint16_t start, uint16_t count, uint8_t* buffer, uint16_t offset, q15_t centre, q15_t threshold);
   void writeRSSIData(uint8_t* data);
+  void writeData(const uint8_t* frame, uint8_t length);
 };
 
 #endif
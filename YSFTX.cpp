@@ -30,40 +30,30 @@
 static q15_t RRC_0_2_FILTER[] = {0, 0, 0, 0, 850, 219, -720, -1548, -1795, -1172, 237, 1927, 3120, 3073, 1447, -1431, -4544, -6442,
                                  -5735, -1633, 5651, 14822, 23810, 30367, 32767, 30367, 23810, 14822, 5651, -1633, -5735, -6442,
                                  -4544, -1431, 1447, 3073, 3120, 1927, 237, -1172, -1795, -1548, -720, 219, 850}; // numTaps = 45, L = 5
-const uint16_t RRC_0_2_FILTER_PHASE_LEN = 9U; // phaseLength = numTaps/L
+const uint16_t RRC_0_2_FILTER_LEN = 45U;
 
 const q15_t YSF_LEVELA_HI =  1893;
 const q15_t YSF_LEVELB_HI =  631;
-const q15_t YSF_LEVELC_HI = -631;
-const q15_t YSF_LEVELD_HI = -1893;
 
 const q15_t YSF_LEVELA_LO =  948;
 const q15_t YSF_LEVELB_LO =  316;
-const q15_t YSF_LEVELC_LO = -316;
-const q15_t YSF_LEVELD_LO = -948;
 
 const uint8_t YSF_START_SYNC = 0x77U;
 const uint8_t YSF_END_SYNC   = 0xFFU;
 const uint8_t YSF_HANG       = 0x00U;
 
 CYSFTX::CYSFTX() :
-m_buffer(TX_BUFFER_LEN),
-m_modFilter(),
-m_modState(),
+m_buffer(),
+m_mod(),
 m_poBuffer(),
 m_poLen(0U),
 m_poPtr(0U),
 m_txDelay(240U),      // 200ms
-m_loDev(false),
 m_txHang(4800U),      // 4s
 m_txCount(0U)
 {
-  ::memset(m_modState, 0x00U, 16U * sizeof(q15_t));
-
-  m_modFilter.L           = YSF_RADIO_SYMBOL_LENGTH;
-  m_modFilter.phaseLength = RRC_0_2_FILTER_PHASE_LEN;
-  m_modFilter.pCoeffs     = RRC_0_2_FILTER;
-  m_modFilter.pState      = m_modState;
+  m_mod.setFilter(RRC_0_2_FILTER, RRC_0_2_FILTER_LEN);
+  m_mod.setLevels(YSF_LEVELA_HI, YSF_LEVELB_HI);
 }
 
 
@@ -75,11 +65,7 @@ void CYSFTX::process()
       for (uint16_t i = 0U; i < m_txDelay; i++)
         m_poBuffer[m_poLen++] = YSF_START_SYNC;
     } else {
-      for (uint8_t i = 0U; i < YSF_FRAME_LENGTH_BYTES; i++) {
-        uint8_t c = 0U;
-        m_buffer.get(c);
-        m_poBuffer[m_poLen++] = c;
-      }
+      m_poLen = m_buffer.read(m_poBuffer, YSF_FRAME_LENGTH_BYTES);
     }
 
     m_poPtr = 0U;
@@ -125,53 +111,26 @@ uint8_t CYSFTX::writeData(const uint8_t* data, uint16_t length)
   if (length != (YSF_FRAME_LENGTH_BYTES + 1U))
     return 4U;
 
-  uint16_t space = m_buffer.getSpace();
-  if (space < YSF_FRAME_LENGTH_BYTES)
+  if (!m_buffer.hasSpace(YSF_FRAME_LENGTH_BYTES))
     return 5U;
 
-  for (uint8_t i = 0U; i < YSF_FRAME_LENGTH_BYTES; i++)
-    m_buffer.put(data[i + 1U]);
+  m_buffer.write(data + 1U, YSF_FRAME_LENGTH_BYTES);
 
   return 0U;
 }
 
 void CYSFTX::writeByte(uint8_t c)
 {
-  q15_t inBuffer[4U];
-  q15_t outBuffer[YSF_RADIO_SYMBOL_LENGTH * 4U];
-
-  const uint8_t MASK = 0xC0U;
-
-  for (uint8_t i = 0U; i < 4U; i++, c <<= 2) {
-    switch (c & MASK) {
-      case 0xC0U:
-        inBuffer[i] = m_loDev ? YSF_LEVELA_LO : YSF_LEVELA_HI;
-        break;
-      case 0x80U:
-        inBuffer[i] = m_loDev ? YSF_LEVELB_LO : YSF_LEVELB_HI;
-        break;
-      case 0x00U:
-        inBuffer[i] = m_loDev ? YSF_LEVELC_LO : YSF_LEVELC_HI;
-        break;
-      default:
-        inBuffer[i] = m_loDev ? YSF_LEVELD_LO : YSF_LEVELD_HI;
-        break;
-    }
-  }
-
-  ::arm_fir_interpolate_q15(&m_modFilter, inBuffer, outBuffer, 4U);
+  m_mod.addByte(c);
 
-  io.write(STATE_YSF, outBuffer, YSF_RADIO_SYMBOL_LENGTH * 4U);
+  io.write(STATE_YSF, m_mod);
 }
 
 void CYSFTX::writeSilence()
 {
-  q15_t inBuffer[4U] = {0x00U, 0x00U, 0x00U, 0x00U};
-  q15_t outBuffer[YSF_RADIO_SYMBOL_LENGTH * 4U];
+  m_mod.addSilence();
 
-  ::arm_fir_interpolate_q15(&m_modFilter, inBuffer, outBuffer, 4U);
-
-  io.write(STATE_YSF, outBuffer, YSF_RADIO_SYMBOL_LENGTH * 4U);
+  io.write(STATE_YSF, m_mod);
 }
 
 void CYSFTX::setTXDelay(uint8_t delay)
@@ -187,9 +146,18 @@ uint8_t CYSFTX::getSpace() const
   return m_buffer.getSpace() / YSF_FRAME_LENGTH_BYTES;
 }
 
+void CYSFTX::getBufferStats(TRingStats& stats)
+{
+  m_buffer.getStats(stats);
+}
+
 void CYSFTX::setParams(bool on, uint8_t txHang)
 {
-  m_loDev  = on;
+  if (on)
+    m_mod.setLevels(YSF_LEVELA_LO, YSF_LEVELB_LO);
+  else
+    m_mod.setLevels(YSF_LEVELA_HI, YSF_LEVELB_HI);
+
   m_txHang = txHang * 1200U;
 }
 
@@ -23,8 +23,13 @@
 #if !defined(YSFTX_H)
 #define  YSFTX_H
 
+#include "YSFDefines.h"
+#include "FSKMod.h"
 #include "RingBuffer.h"
 
+// The RRC filter spans 9 symbols
+typedef CFSKMod<YSF_RADIO_SYMBOL_LENGTH, 9U> CYSFMod;
+
 class CYSFTX {
 public:
   CYSFTX();
@@ -37,17 +42,17 @@ public:
 
   uint8_t getSpace() const;
 
+  void getBufferStats(TRingStats& stats);
+
   void setParams(bool on, uint8_t txHang);
 
 private:
-  CRingBuffer<uint8_t>                        m_buffer;
-  arm_fir_interpolate_instance_q15 m_modFilter;
-  q15_t                            m_modState[16U];    // blockSize + phaseLength - 1, 4 + 9 - 1 plus some spare
+  CRingBuffer<uint8_t, TX_BUFFER_LEN>         m_buffer;
+  CYSFMod                          m_mod;
   uint8_t                          m_poBuffer[1200U];
   uint16_t                         m_poLen;
   uint16_t                         m_poPtr;
   uint16_t                         m_txDelay;
-  bool                             m_loDev;
   uint32_t                         m_txHang;
   uint32_t                         m_txCount;
 
@@ -0,0 +1,68 @@
+#!/bin/sh
+#
+#   Copyright (C) 2026 by the MMDVM developers
+#
+#   This program is free software; you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License as published by
+#   the Free Software Foundation; either version 2 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#   GNU General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program; if not, write to the Free Software
+#   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+# Builds the host firmware at each receiver block size and runs the loopback
+# benchmark at one Eb/N0 point, printing the receive cost per decoded frame
+# and the bit error rate against the latency that the block size adds. Each
+# size is run REPEAT times (default 5) and the lowest cost is kept, as the
+# timings on a busy PC are noisy.
+#
+#   [REPEAT=n] host/BlockSize.sh [sizes] [loopback options]
+#
+# e.g. host/BlockSize.sh "2 8 24 48" -n 100 -e 12:12:1
+
+SIZES=${1:-"2 8 24 48"}
+[ $# -gt 0 ] && shift
+ARGS=${*:-"-n 100 -e 12:12:1"}
+
+JOBS=$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 2)
+
+for n in $SIZES; do
+  make -s -f Makefile.Host -j"$JOBS" RX_BLOCK_SIZE="$n" OBJDIR="obj_host/rx$n" BINDIR="bin/rx$n" || exit 1
+done
+
+printf "%-6s %6s %10s" "mode" "block" "latency"
+printf " %14s %10s %6s\n" "cost/frame" "BER" "FER"
+
+REPEAT=${REPEAT:-5}
+
+for n in $SIZES; do
+  r=1
+  while [ "$r" -le "$REPEAT" ]; do
+    bin/rx"$n"/mmdvm_loopback $ARGS -c "bin/rx$n/loopback.$r.csv" > /dev/null || exit 1
+    r=$((r + 1))
+  done
+
+  # mode,ebn0,sent,decoded,bits,errors,ber,fer,cost_per_frame
+  awk -F, -v n="$n" 'FNR > 1 && $2 != "inf" {
+    if (!($1 in cost)) {
+      order[++count] = $1
+      cost[$1] = $9
+      ber[$1]  = $7
+      fer[$1]  = $8
+    } else if ($9 < cost[$1]) {
+      cost[$1] = $9
+    }
+  }
+  END {
+    for (i = 1; i <= count; i++) {
+      m = order[i]
+      printf "%-6s %6d %8.2fms %14d %10.2e %6.3f\n", m, n, n / 24.0, cost[m], ber[m], fer[m]
+    }
+  }' bin/rx"$n"/loopback.*.csv
+done | sort -s -k1,1
@@ -0,0 +1,52 @@
+/*
+ *   Copyright (C) 2026 by the MMDVM developers
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+// The host build replaces the ADC, DAC, COS input and the UARTs with these
+// simple software registers so that tools can drive the firmware directly.
+
+#if !defined(HOST_H)
+#define  HOST_H
+
+#include <cstdint>
+
+// Load the next ADC conversion, this is what the next hostTick() will read
+void     hostSetADC(uint16_t sample, uint16_t rssi);
+
+// The last value written to the DAC
+uint16_t hostGetDAC();
+
+// Advance the sample clock by one sample, either by calling CIO::interrupt() as the timer
+// interrupt does, or through a simulated circular ADC and DAC DMA with half and full
+// transfer callbacks every IO_BLOCK_SIZE samples, as with USE_DMA_IO
+void     hostTick();
+void     hostSetBlockIO(bool on);
+
+void     hostSetCOS(bool cos);
+bool     hostGetPTT();
+
+// Bytes sent by the host software to the modem
+void     hostSerialWrite(uint8_t port, const uint8_t* data, uint16_t length);
+
+// Bytes sent by the modem to the host software, returns the number copied
+uint16_t hostSerialRead(uint8_t port, uint8_t* data, uint16_t length);
+
+// Firmware entry points from MMDVM.cpp
+void setup();
+void loop();
+
+#endif
@@ -0,0 +1,1129 @@
+/*
+ *   Copyright (C) 2026 by the MMDVM developers
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+// Loops the output of each digital mode transmitter back into the matching
+// receiver through a simple channel model, and prints the bit and frame error
+// rates against Eb/N0 together with the receiver cost per decoded frame.
+//
+//   mmdvm_loopback [-m dstar,dstarhdr,dmr,dmrduplex,dmridle,ysf,p25,nxdn,m17] [-n frames] [-e from:to:step]
+//                  [-f offset_hz] [-p drift_ppm] [-t deemphasis_us] [-a depth_db:rate_hz]
+//                  [-l txlevel] [-L rxlevel] [-s seed] [-c results.csv] [-w low:high] [-b] [-S]
+//                  [-v]
+//
+// Random frames, with the correct syncs, are sent to the modem over the host
+// serial link exactly as MMDVMHost would send them, and the DAC output is
+// recorded. For every point of the sweep that recording is passed through the
+// channel and fed to the ADC with only that mode enabled, and the frames the
+// modem sends back are matched against the ones sent. DMR uses the DMO
+// transmitter and receiver, as a hotspot does, and dmrduplex the two slot
+// repeater transmitter and receiver. That receiver only runs while the
+// transmitter is on, and looks for each burst at the slot marks from it, so
+// the frames are transmitted again for every point with the channel fed to
+// the ADC at the same time, and its cost includes the transmitter. dmridle
+// sends wakeup CSBKs through the repeater transmitter and receives them with
+// the duplex modem idle, as a repeater waits for a mobile to key up.
+//
+// NXDN is received with the boxcar filter when USE_NXDN_BOXCAR is set in
+// Config.h, as it is by default. That doesn't match the modem's own RRC and sinc
+// transmit shaping, and leaves an error floor of about 1.5e-2 with no noise at
+// all, so the NXDN figures are for the RRC receive path only with it commented
+// out. Even then the received pulse only has a clean eye within a fraction of a
+// sample of the right phase, and the symbol timing leaves a floor of about 6e-4.
+//
+// The channel works on the discriminator output: sample clock drift, then an
+// optional fade, then the carrier offset as a DC shift, then white Gaussian
+// noise, then an optional de-emphasis network. The offset is scaled by the
+// level that a long run of the outer symbols gives, measured by sending the
+// frames once more with all of their data bits set, as the transmit filters
+// leave the symbols of random data and their RMS level away from it. The fade swings the signal level
+// down by depth_db and back rate_hz times a second, as a cosine in dB, with the
+// noise left as it is, so the receivers' levels have to follow it within a
+// frame. Eb/N0 is measured without the fade, it is not an RF
+// figure, so the curves are only useful for comparing one build of the
+// receivers against another. With -b the samples are moved by the simulated
+// DMA block I/O instead of the per sample interrupt. With -S the modem is asked
+// for soft symbols, which are turned back into bits with the same thresholds
+// before scoring, so the results must match a run without it. With -w the frames
+// are paced by the MMDVM_TX_SPACE reports with those watermarks, each frame sent
+// being taken off the reported space, and MMDVM_GET_STATUS is only sent once a
+// second to keep the watchdog from ending the transmission, so again the results
+// must match a run without it. If no space is reported for the next frame for five
+// seconds it stops with an error. With -v every frame received with errors is
+// listed, as byte position and sent/received values.
+
+#include "Config.h"
+#include "Globals.h"
+
+#include "DStarDefines.h"
+#include "DMRDefines.h"
+#include "DMRSlotType.h"
+#include "YSFDefines.h"
+#include "P25Defines.h"
+#include "NXDNDefines.h"
+#include "M17Defines.h"
+
+#include "Host.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+const uint32_t SAMPLE_RATE = 24000U;
+
+const int16_t DC_OFFSET = 2048;
+
+const uint8_t  MMDVM_FRAME_START = 0xE0U;
+const uint8_t  MMDVM_GET_STATUS  = 0x01U;
+const uint8_t  MMDVM_SET_CONFIG  = 0x02U;
+const uint8_t  MMDVM_TX_SPACE    = 0x0DU;
+
+const uint8_t  MMDVM_DSTAR_HEADER = 0x10U;
+const uint8_t  MMDVM_DSTAR_DATA   = 0x11U;
+const uint8_t  MMDVM_DSTAR_EOT    = 0x13U;
+const uint8_t  MMDVM_DMR_DATA1    = 0x18U;
+const uint8_t  MMDVM_DMR_DATA2    = 0x1AU;
+const uint8_t  MMDVM_DMR_START    = 0x1DU;
+const uint8_t  MMDVM_YSF_DATA     = 0x20U;
+const uint8_t  MMDVM_P25_HDR      = 0x30U;
+const uint8_t  MMDVM_P25_LDU      = 0x31U;
+const uint8_t  MMDVM_NXDN_DATA    = 0x40U;
+const uint8_t  MMDVM_M17_LINK_SETUP = 0x45U;
+const uint8_t  MMDVM_M17_STREAM     = 0x46U;
+
+// These end a transmission and carry its carrier offset in Hz
+const uint8_t  MMDVM_YSF_LOST     = 0x21U;
+const uint8_t  MMDVM_P25_LOST     = 0x32U;
+const uint8_t  MMDVM_NXDN_LOST    = 0x41U;
+const uint8_t  MMDVM_M17_LOST     = 0x48U;
+const uint8_t  MMDVM_M17_EOT      = 0x49U;
+
+// The soft symbol frames are the hard bit frame types with this bit set
+const uint8_t  MMDVM_SOFT_TYPE    = 0x80U;
+
+const uint8_t  CONTROL_VOICE = 0x20U;
+const uint8_t  CONTROL_DATA  = 0x40U;
+
+// Half a second of channel noise before each transmission, and a second after it so that the
+// receivers have timed out and sent their lost messages, which takes five LDUs for P25
+const uint32_t GUARD_SAMPLES = SAMPLE_RATE / 2U;
+const uint32_t TAIL_SAMPLES  = SAMPLE_RATE;
+
+// MMDVMHost asks for the modem status every 250 ms
+const uint32_t STATUS_SAMPLES = SAMPLE_RATE / 4U;
+
+// With the MMDVM_TX_SPACE reports it is only asked for to keep the watchdog from ending the transmission
+const uint32_t KEEPALIVE_SAMPLES = SAMPLE_RATE;
+
+// A frame that can't be sent for this long means the space is never going to be reported
+const uint32_t STALL_SECONDS = 5U;
+
+// How many scored frames ahead of the last matched frame to look for a match
+const unsigned int MATCH_WINDOW = 16U;
+
+// The most carrier offsets kept from the lost and EOT messages of one run
+const unsigned int MAX_OFFSETS = 64U;
+
+struct FRAME {
+  uint8_t              type;
+  std::vector<uint8_t> data;      // As carried on the serial link after the type byte
+  std::vector<uint8_t> mask;      // The bits that are compared, flags and syncs are skipped
+};
+
+struct STATS {
+  unsigned int sent;
+  unsigned int matched;
+  unsigned int good;
+  unsigned int spurious;
+  uint64_t     bits;
+  uint64_t     errors;
+  int16_t      offset[MAX_OFFSETS];    // Hz
+  unsigned int offsets;
+};
+
+static std::mt19937 s_random;
+
+static void randomBytes(uint8_t* data, unsigned int length)
+{
+  for (unsigned int i = 0U; i < length; i++)
+    data[i] = uint8_t(s_random());
+}
+
+static void addFrame(std::vector<FRAME>& frames, uint8_t type, unsigned int length, bool flag)
+{
+  FRAME frame;
+  frame.type = type;
+
+  frame.data.resize(length + (flag ? 1U : 0U));
+  randomBytes(frame.data.data(), frame.data.size());
+
+  frame.mask.assign(frame.data.size(), 0xFFU);
+
+  if (flag) {
+    frame.data[0U] = 0x00U;
+    frame.mask[0U] = 0x00U;
+  }
+
+  frames.push_back(frame);
+}
+
+static void addSync(FRAME& frame, unsigned int offset, const uint8_t* sync, const uint8_t* mask, unsigned int length)
+{
+  for (unsigned int i = 0U; i < length; i++) {
+    uint8_t m = mask != NULL ? mask[i] : 0xFFU;
+    frame.data[offset + i] = (frame.data[offset + i] & ~m) | (sync[i] & m);
+    frame.mask[offset + i] &= ~m;
+  }
+}
+
+static void addDStarHeader(std::vector<FRAME>& frames)
+{
+  addFrame(frames, MMDVM_DSTAR_HEADER, DSTAR_HEADER_LENGTH_BYTES, false);
+
+  FRAME& header = frames.back();
+  header.data[0U] = header.data[1U] = header.data[2U] = 0x00U;
+
+  uint16_t crc = 0xFFFFU;
+  for (unsigned int i = 0U; i < (DSTAR_HEADER_LENGTH_BYTES - 2U); i++) {
+    crc ^= header.data[i];
+    for (unsigned int j = 0U; j < 8U; j++)
+      crc = (crc & 0x0001U) ? ((crc >> 1) ^ 0x8408U) : (crc >> 1);
+  }
+  crc = ~crc;
+
+  header.data[DSTAR_HEADER_LENGTH_BYTES - 2U] = crc & 0xFFU;
+  header.data[DSTAR_HEADER_LENGTH_BYTES - 1U] = crc >> 8;
+}
+
+static void buildDStar(std::vector<FRAME>& frames, unsigned int count)
+{
+  addDStarHeader(frames);
+
+  for (unsigned int n = 0U; n < count; n++) {
+    addFrame(frames, MMDVM_DSTAR_DATA, DSTAR_DATA_LENGTH_BYTES, false);
+    if ((n % 21U) == 0U)
+      addSync(frames.back(), 9U, DSTAR_DATA_SYNC_BYTES + 9U, NULL, 3U);
+  }
+
+  addFrame(frames, MMDVM_DSTAR_EOT, 0U, false);
+}
+
+// Only the headers are scored, each is followed by a superframe of data and an EOT
+static void buildDStarHeaders(std::vector<FRAME>& frames, unsigned int count)
+{
+  for (unsigned int n = 0U; n < count; n++) {
+    addDStarHeader(frames);
+
+    for (unsigned int i = 0U; i < 21U; i++) {
+      addFrame(frames, MMDVM_DSTAR_DATA, DSTAR_DATA_LENGTH_BYTES, false);
+      frames.back().mask.assign(DSTAR_DATA_LENGTH_BYTES, 0x00U);
+      if (i == 0U)
+        addSync(frames.back(), 9U, DSTAR_DATA_SYNC_BYTES + 9U, NULL, 3U);
+    }
+
+    addFrame(frames, MMDVM_DSTAR_EOT, 0U, false);
+  }
+}
+
+// The nth frame of a voice superframe, with the voice sync in the A frame and embedded signalling
+// in the rest
+static void addDMRVoice(std::vector<FRAME>& frames, uint8_t type, unsigned int n)
+{
+  addFrame(frames, type, DMR_FRAME_LENGTH_BYTES, true);
+
+  FRAME& frame = frames.back();
+  if ((n % 6U) == 0U) {
+    frame.data[0U] = CONTROL_VOICE;
+    addSync(frame, 1U + 13U, DMR_MS_VOICE_SYNC_BYTES, DMR_SYNC_BYTES_MASK, DMR_SYNC_BYTES_LENGTH);
+  } else {
+    frame.data[0U] = n % 6U;
+    for (unsigned int i = 0U; i < DMR_SYNC_BYTES_LENGTH; i++)
+      frame.mask[1U + 13U + i] &= ~DMR_SYNC_BYTES_MASK[i];
+  }
+}
+
+static void buildDMR(std::vector<FRAME>& frames, unsigned int count)
+{
+  for (unsigned int n = 0U; n < count; n++)
+    addDMRVoice(frames, MMDVM_DMR_DATA2, n);
+}
+
+// A superframe in each slot, the frames alternating between them, then the transmitter is stopped
+static void buildDMRDuplex(std::vector<FRAME>& frames, unsigned int count)
+{
+  for (unsigned int n = 0U; n < count; n++)
+    addDMRVoice(frames, (n % 2U) == 0U ? MMDVM_DMR_DATA1 : MMDVM_DMR_DATA2, n / 2U);
+
+  FRAME stop;
+  stop.type = MMDVM_DMR_START;
+  stop.data.assign(1U, 0x00U);
+  stop.mask.assign(1U, 0x00U);
+  frames.push_back(stop);
+}
+
+// Wakeup CSBKs in slot 1 with the MS data sync and colour code 1, for the receiver that looks for
+// them while a duplex modem is idle, then the transmitter is stopped. That receiver's buffer only
+// holds one burst, so it reads the last symbol from the sample a burst before it, which isn't scored
+static void buildDMRIdle(std::vector<FRAME>& frames, unsigned int count)
+{
+  CDMRSlotType slotType;
+
+  for (unsigned int n = 0U; n < count; n++) {
+    addFrame(frames, MMDVM_DMR_DATA1, DMR_FRAME_LENGTH_BYTES, true);
+
+    FRAME& frame = frames.back();
+    frame.data[0U] = CONTROL_DATA | DT_CSBK;
+    addSync(frame, 1U + 13U, DMR_MS_DATA_SYNC_BYTES, DMR_SYNC_BYTES_MASK, DMR_SYNC_BYTES_LENGTH);
+    slotType.encode(1U, DT_CSBK, frame.data.data() + 1U);
+    frame.mask[DMR_FRAME_LENGTH_BYTES] &= 0xFCU;
+  }
+
+  FRAME stop;
+  stop.type = MMDVM_DMR_START;
+  stop.data.assign(1U, 0x00U);
+  stop.mask.assign(1U, 0x00U);
+  frames.push_back(stop);
+}
+
+static void buildYSF(std::vector<FRAME>& frames, unsigned int count)
+{
+  for (unsigned int n = 0U; n < count; n++) {
+    addFrame(frames, MMDVM_YSF_DATA, YSF_FRAME_LENGTH_BYTES, true);
+    addSync(frames.back(), 1U, YSF_SYNC_BYTES, NULL, YSF_SYNC_BYTES_LENGTH);
+  }
+}
+
+static void buildP25(std::vector<FRAME>& frames, unsigned int count)
+{
+  // Only the data unit ID of the NID is looked at by the modem
+  addFrame(frames, MMDVM_P25_HDR, P25_HDR_FRAME_LENGTH_BYTES, true);
+  addSync(frames.back(), 1U, P25_SYNC_BYTES, NULL, P25_SYNC_BYTES_LENGTH);
+  frames.back().data[1U + 7U] = (frames.back().data[1U + 7U] & 0xF0U) | P25_DUID_HDU;
+
+  for (unsigned int n = 0U; n < count; n++) {
+    addFrame(frames, MMDVM_P25_LDU, P25_LDU_FRAME_LENGTH_BYTES, true);
+    addSync(frames.back(), 1U, P25_SYNC_BYTES, NULL, P25_SYNC_BYTES_LENGTH);
+    frames.back().data[1U + 7U] = (frames.back().data[1U + 7U] & 0xF0U) | ((n % 2U) == 0U ? P25_DUID_LDU1 : P25_DUID_LDU2);
+  }
+}
+
+static void buildNXDN(std::vector<FRAME>& frames, unsigned int count)
+{
+  for (unsigned int n = 0U; n < count; n++) {
+    addFrame(frames, MMDVM_NXDN_DATA, NXDN_FRAME_LENGTH_BYTES, true);
+    addSync(frames.back(), 1U, NXDN_FSW_BYTES, NXDN_FSW_BYTES_MASK, NXDN_FSW_BYTES_LENGTH);
+  }
+}
+
+static void buildM17(std::vector<FRAME>& frames, unsigned int count)
+{
+  addFrame(frames, MMDVM_M17_LINK_SETUP, M17_FRAME_LENGTH_BYTES, true);
+  addSync(frames.back(), 1U, M17_LINK_SETUP_SYNC_BYTES, NULL, M17_SYNC_LENGTH_BYTES);
+
+  for (unsigned int n = 0U; n < count; n++) {
+    addFrame(frames, MMDVM_M17_STREAM, M17_FRAME_LENGTH_BYTES, true);
+    addSync(frames.back(), 1U, M17_STREAM_SYNC_BYTES, NULL, M17_SYNC_LENGTH_BYTES);
+  }
+}
+
+static uint8_t dstarSpace() { return dstarTX.getSpace(); }
+static uint8_t dmrSpace()   { return dmrDMOTX.getSpace(); }
+static uint8_t dmrDuplexSpace() { return std::min(dmrTX.getSpace1(), dmrTX.getSpace2()); }
+static uint8_t ysfSpace()   { return ysfTX.getSpace(); }
+static uint8_t p25Space()   { return p25TX.getSpace(); }
+static uint8_t nxdnSpace()  { return nxdnTX.getSpace(); }
+static uint8_t m17Space()   { return m17TX.getSpace(); }
+
+struct MODE_TABLE {
+  const char* name;
+  uint8_t     mask;
+  bool        simplex;
+  uint32_t    bitRate;
+  float       deviation;          // Of the outer symbols, or of the D-Star bits, in Hz
+  uint8_t     minSpace;           // In the units returned by getSpace()
+  uint8_t     spaceIndex;         // Of its space in MMDVM_GET_STATUS and MMDVM_TX_SPACE
+  bool        duplex;             // Receives while it transmits, with the slot timing of its own transmitter
+  void        (*build)(std::vector<FRAME>& frames, unsigned int count);
+  uint8_t     (*space)();
+} MODES[] = {
+  {"dstar", 0x01U, false, 4800U, 1200.0F,            4U, 0U, false, buildDStar, dstarSpace},
+  {"dstarhdr", 0x01U, false, 4800U, 1200.0F,         4U, 0U, false, buildDStarHeaders, dstarSpace},
+  {"dmr",   0x02U, true,  9600U, 1944.0F,            1U, 2U, false, buildDMR,   dmrSpace},
+  {"dmrduplex", 0x02U, false, 9600U, 1944.0F,        1U, 1U, true,  buildDMRDuplex, dmrDuplexSpace},
+  {"dmridle", 0x02U, false, 9600U, 1944.0F,          1U, 1U, false, buildDMRIdle, dmrDuplexSpace},
+  {"ysf",   0x04U, false, 9600U, 2700.0F,            1U, 3U, false, buildYSF,   ysfSpace},
+  {"p25",   0x08U, false, 9600U, 1800.0F,            1U, 4U, false, buildP25,   p25Space},
+  {"nxdn",  0x10U, false, 4800U, 1050.0F,            1U, 5U, false, buildNXDN,  nxdnSpace},
+  {"m17",   0x40U, false, 9600U, 2400.0F,            1U, 6U, false, buildM17,   m17Space}
+};
+
+const unsigned int MODES_LEN = sizeof(MODES) / sizeof(MODE_TABLE);
+
+struct CHANNEL {
+  bool   noise;
+  double ebn0;        // dB
+  double offset;      // Hz
+  double drift;       // ppm
+  double deemphasis;  // us, zero for none
+  double fadeDepth;   // dB
+  double fadeRate;    // Hz, zero for none
+};
+
+#if defined(__i386__) || defined(__x86_64__)
+static const char* TICKS_NAME = "cycles";
+
+static uint64_t ticks()
+{
+  return __rdtsc();
+}
+#else
+static const char* TICKS_NAME = "ns";
+
+static uint64_t ticks()
+{
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+#endif
+
+static void readAll(std::vector<uint8_t>& data)
+{
+  uint8_t buffer[512U];
+  uint16_t n;
+  while ((n = ::hostSerialRead(1U, buffer, sizeof(buffer))) > 0U)
+    data.insert(data.end(), buffer, buffer + n);
+}
+
+static void send(uint8_t type, const uint8_t* data, uint16_t length)
+{
+  uint8_t frame[300U];
+
+  frame[0U] = MMDVM_FRAME_START;
+  frame[1U] = uint8_t(length + 3U);
+  frame[2U] = type;
+  if (length > 0U)
+    ::memcpy(frame + 3U, data, length);
+
+  ::hostSerialWrite(1U, frame, length + 3U);
+}
+
+static void configure(const MODE_TABLE& mode, uint8_t txLevel, uint8_t rxLevel, bool soft)
+{
+  uint8_t data[37U];
+  ::memset(data, 0x00U, sizeof(data));
+
+  data[0U]  = mode.simplex ? 0x80U : 0x00U;
+  data[0U] |= soft ? 0x40U : 0x00U;
+  data[1U]  = mode.mask;
+  data[2U]  = 0x04U;        // Carrier offsets
+  data[3U]  = 10U;          // TX delay
+  data[4U]  = STATE_IDLE;
+  data[5U]  = 128U;         // TX DC offset
+  data[6U]  = 128U;         // RX DC offset
+  data[7U]  = rxLevel;
+  for (uint8_t i = 8U; i < 18U; i++)
+    data[i] = txLevel;
+  data[26U] = 1U;           // DMR colour code
+  data[28U] = 128U;         // AX.25 RX twist
+
+  send(MMDVM_SET_CONFIG, data, sizeof(data));
+
+  for (unsigned int i = 0U; i < 10U; i++)
+    ::loop();
+
+  std::vector<uint8_t> discard;
+  readAll(discard);
+}
+
+// The mode's space from the last MMDVM_TX_SPACE among the frames from the modem
+static bool findSpace(const MODE_TABLE& mode, const std::vector<uint8_t>& data, uint8_t& space)
+{
+  bool found = false;
+
+  size_t pos = 0U;
+  while ((pos + 3U) <= data.size() && data[pos] == MMDVM_FRAME_START) {
+    size_t length = data[pos + 1U];
+    if (length == 0U) {
+      if ((pos + 4U) > data.size())
+        break;
+
+      length = data[pos + 2U] + 255U;
+    }
+
+    if (length < 3U || (pos + length) > data.size())
+      break;
+
+    if (data[pos + 2U] == MMDVM_TX_SPACE && length == 13U) {
+      space = data[pos + 3U + mode.spaceIndex];
+      found = true;
+    }
+
+    pos += length;
+  }
+
+  return found;
+}
+
+// Send the frames to the modem, paced by the space in the TX buffer, and record the DAC output until the transmitter drops.
+// With a high watermark the space is from the MMDVM_TX_SPACE reports, otherwise it is polled for.
+// A duplex mode is given the ADC samples of the channel at the same time, and what the modem sends back is kept.
+static uint64_t transmit(const MODE_TABLE& mode, const std::vector<FRAME>& frames, uint8_t spaceLow, uint8_t spaceHigh, std::vector<int16_t>& signal, double& power, unsigned int& reports, const std::vector<uint16_t>* adc = NULL, std::vector<uint8_t>* output = NULL)
+{
+  size_t next = 0U;
+  uint32_t idle = 0U;
+  uint32_t drained = 0U;
+  uint32_t waiting = 0U;
+  uint32_t on = 0U;
+  double sum = 0.0;
+
+  std::vector<uint8_t> discard;
+
+  reports = 0U;
+
+  // What the host knows of the space, the last report less the frames sent since
+  uint8_t credit = 0U;
+  if (spaceHigh > 0U) {
+    uint8_t watermarks[2U] = {spaceLow, spaceHigh};
+    send(MMDVM_TX_SPACE, watermarks, 2U);
+    ::loop();
+
+    readAll(discard);
+    if (findSpace(mode, discard, credit))
+      reports++;
+  }
+
+  uint8_t empty = mode.space();
+
+  uint64_t start = ticks();
+
+  for (uint32_t n = 0U; n < (600U * SAMPLE_RATE); n++) {
+    if (adc != NULL)
+      ::hostSetADC((GUARD_SAMPLES + n) < adc->size() ? (*adc)[GUARD_SAMPLES + n] : uint16_t(DC_OFFSET), 0U);
+
+    ::hostTick();
+
+    int16_t sample = int16_t(::hostGetDAC()) - DC_OFFSET;
+    signal.push_back(sample);
+
+    bool ptt = ::hostGetPTT();
+    if (ptt) {
+      sum += double(sample) * double(sample);
+      on++;
+    }
+
+    // Poll the status as MMDVMHost does, this also keeps the watchdog from ending the transmission
+    if ((n % (spaceHigh > 0U ? KEEPALIVE_SAMPLES : STATUS_SAMPLES)) == 0U)
+      send(MMDVM_GET_STATUS, NULL, 0U);
+
+    if (((n + 1U) % RX_BLOCK_SIZE) == 0U) {
+      // After an EOT the next transmission waits for the transmitter to drop
+      bool over = next > 0U && frames[next - 1U].type == MMDVM_DSTAR_EOT && ptt;
+
+      // The duplex DMR transmitter is only stopped once the last burst of each slot is out, which
+      // is up to two bursts after it has left the FIFO
+      drained = mode.space() < empty ? 0U : drained + RX_BLOCK_SIZE;
+      if (next < frames.size() && frames[next].type == MMDVM_DMR_START && drained < (SAMPLE_RATE * 2U / 30U))
+        over = true;
+
+      uint8_t space = spaceHigh > 0U ? credit : mode.space();
+      if (next < frames.size() && !over && space >= mode.minSpace) {
+        send(frames[next].type, frames[next].data.empty() ? NULL : &frames[next].data[0U], uint16_t(frames[next].data.size()));
+        next++;
+
+        credit = space - mode.minSpace;
+        waiting = 0U;
+      } else if (next < frames.size()) {
+        waiting += RX_BLOCK_SIZE;
+        if (waiting >= (STALL_SECONDS * SAMPLE_RATE)) {
+          ::fprintf(stderr, "mmdvm_loopback: %s: no TX space for frame %u of %u after %u s\n", mode.name, (unsigned int)next, (unsigned int)frames.size(), STALL_SECONDS);
+          ::exit(1);
+        }
+      }
+
+      ::loop();
+
+      discard.clear();
+      readAll(discard);
+
+      if (spaceHigh > 0U && findSpace(mode, discard, credit))
+        reports++;
+
+      if (output != NULL)
+        output->insert(output->end(), discard.begin(), discard.end());
+    }
+
+    if (next >= frames.size() && !ptt) {
+      if (++idle >= (SAMPLE_RATE / 10U))
+        break;
+    } else {
+      idle = 0U;
+    }
+  }
+
+  uint64_t elapsed = ticks() - start;
+
+  power = on > 0U ? sum / double(on) : 0.0;
+
+  return elapsed;
+}
+
+// The DAC level of a long run of the outer symbols, which is what the deviation of a mode is given
+// for, from the frames sent again with all of their data bits set. The transmit filters leave both
+// the outer symbols of random data and its RMS level some way from it.
+static double outerLevel(const MODE_TABLE& mode, const std::vector<FRAME>& frames)
+{
+  std::vector<FRAME> steady(frames);
+  for (FRAME& frame : steady) {
+    for (size_t i = 0U; i < frame.data.size(); i++)
+      frame.data[i] |= frame.mask[i];
+  }
+
+  std::vector<int16_t> signal;
+  double power;
+  unsigned int reports;
+  transmit(mode, steady, 0U, 0U, signal, power, reports);
+
+  int peak = 0;
+  for (int16_t sample : signal)
+    peak = std::max(peak, std::abs(int(sample)));
+
+  // The longest run on one side of half of the peak is the data of a frame, the preamble swinging
+  // from one side to the other with each symbol
+  size_t start = 0U, length = 0U, runStart = 0U;
+  int side = 0;
+  for (size_t n = 0U; n <= signal.size(); n++) {
+    int next = 0;
+    if (n < signal.size())
+      next = signal[n] > (peak / 2) ? 1 : (signal[n] < -(peak / 2) ? -1 : 0);
+
+    if (next != side) {
+      if (side != 0 && (n - runStart) > length) {
+        start  = runStart;
+        length = n - runStart;
+      }
+
+      runStart = n;
+      side     = next;
+    }
+  }
+
+  double sum = 0.0;
+  for (size_t n = start + length / 4U; n < (start + 3U * length / 4U); n++)
+    sum += std::abs(double(signal[n]));
+
+  return length >= 4U ? sum / double(length / 2U) : 0.0;
+}
+
+static void channel(const MODE_TABLE& mode, const CHANNEL& params, const std::vector<int16_t>& signal, double power, double outer, std::vector<uint16_t>& adc)
+{
+  std::normal_distribution<double> gaussian(0.0, 1.0);
+
+  double sigma = 0.0;
+  if (params.noise) {
+    double ebn0 = ::pow(10.0, params.ebn0 / 10.0);
+    sigma = ::sqrt(power * double(SAMPLE_RATE) / (2.0 * double(mode.bitRate) * ebn0));
+  }
+
+  // Convert the carrier offset to DAC units using the level of the outer symbols
+  double offset = params.offset * outer / double(mode.deviation);
+
+  double alpha = 0.0;
+  if (params.deemphasis > 0.0)
+    alpha = ::exp(-1.0E6 / (double(SAMPLE_RATE) * params.deemphasis));
+
+  double step = 1.0 / (1.0 + params.drift * 1.0E-6);
+
+  double fadeStep = 2.0 * M_PI * params.fadeRate / double(SAMPLE_RATE);
+
+  size_t length = size_t(double(signal.size()) / step) + GUARD_SAMPLES + TAIL_SAMPLES;
+  adc.resize(length);
+
+  double y = 0.0;
+  for (size_t n = 0U; n < length; n++) {
+    double x = 0.0;
+
+    if (n >= GUARD_SAMPLES) {
+      double pos = double(n - GUARD_SAMPLES) * step;
+      size_t i = size_t(pos);
+      if ((i + 1U) < signal.size()) {
+        double frac = pos - double(i);
+        x = double(signal[i]) * (1.0 - frac) + double(signal[i + 1U]) * frac;
+      }
+
+      if (params.fadeRate > 0.0) {
+        double fade = -params.fadeDepth * (1.0 - ::cos(fadeStep * double(n - GUARD_SAMPLES))) / 2.0;
+        x *= ::pow(10.0, fade / 20.0);
+      }
+    }
+
+    x += offset;
+    if (sigma > 0.0)
+      x += sigma * gaussian(s_random);
+
+    y = alpha * y + (1.0 - alpha) * x;
+
+    long value = ::lround(y) + DC_OFFSET;
+    if (value < 0L)
+      value = 0L;
+    if (value > 4095L)
+      value = 4095L;
+
+    adc[n] = uint16_t(value);
+  }
+}
+
+static uint64_t receive(const std::vector<uint16_t>& adc, std::vector<uint8_t>& output)
+{
+  uint64_t start = ticks();
+
+  for (size_t i = 0U; i < adc.size(); i++) {
+    ::hostSetADC(adc[i], 0U);
+    ::hostTick();
+
+    if (((i + 1U) % RX_BLOCK_SIZE) == 0U)
+      ::loop();
+  }
+
+  uint64_t elapsed = ticks() - start;
+
+  readAll(output);
+
+  return elapsed;
+}
+
+static unsigned int countBits(uint8_t bits)
+{
+  unsigned int n = 0U;
+  for (; bits != 0U; bits &= bits - 1U)
+    n++;
+
+  return n;
+}
+
+static unsigned int compare(const FRAME& frame, const uint8_t* data, uint16_t length, unsigned int& bits)
+{
+  unsigned int errors = 0U;
+  bits = 0U;
+
+  for (size_t i = 0U; i < frame.data.size(); i++) {
+    bits += countBits(frame.mask[i]);
+    uint8_t rx = i < length ? data[i] : ~frame.data[i];
+    errors += countBits((rx ^ frame.data[i]) & frame.mask[i]);
+  }
+
+  return errors;
+}
+
+// Each soft symbol becomes the two bits that the modem would have sent, the control byte is kept
+static void harden(const uint8_t* data, uint16_t length, std::vector<uint8_t>& hard)
+{
+  hard.assign(1U + ((length - 1U) * 4U + 7U) / 8U, 0x00U);
+  hard[0U] = data[0U];
+
+  unsigned int n = 8U;
+  for (uint16_t i = 1U; i < length; i++) {
+    for (unsigned int j = 0U; j < 2U; j++, n += 2U) {
+      int soft = (j == 0U ? data[i] >> 4 : data[i]) & 0x0F;
+      if (soft >= 8)
+        soft -= 16;
+
+      uint8_t dibit = (soft >= 0 ? 0x02U : 0x00U) | ((soft >= 4 || soft <= -5) ? 0x01U : 0x00U);
+      hard[n / 8U] |= dibit << (6U - (n % 8U));
+    }
+  }
+}
+
+static void dump(const FRAME& frame, size_t n, const uint8_t* data, uint16_t length, unsigned int errors)
+{
+  ::printf("    frame %zu type 0x%02X, %u errors:", n, frame.type, errors);
+
+  for (size_t i = 0U; i < frame.data.size() && i < length; i++) {
+    if (((data[i] ^ frame.data[i]) & frame.mask[i]) != 0U)
+      ::printf(" [%zu] %02X/%02X", i, frame.data[i], data[i]);
+  }
+
+  ::printf("\n");
+}
+
+// Match the frames sent by the modem against the ones transmitted, in order, allowing for lost frames
+static void score(const std::vector<FRAME>& frames, const std::vector<uint8_t>& output, bool soft, bool verbose, STATS& stats)
+{
+  ::memset(&stats, 0x00U, sizeof(STATS));
+
+  // Frames with nothing to compare, such as the DMR stop, aren't expected back
+  std::vector<bool> compared;
+  size_t last = 0U;
+  for (size_t i = 0U; i < frames.size(); i++) {
+    unsigned int bits;
+    compare(frames[i], NULL, 0U, bits);
+    compared.push_back(bits > 0U);
+    if (bits > 0U) {
+      stats.sent++;
+      last = i + 1U;
+    }
+  }
+
+  size_t next = 0U;
+  size_t i = 0U;
+  while ((i + 2U) < output.size() && output[i] == MMDVM_FRAME_START) {
+    uint16_t length = output[i + 1U];
+    uint16_t offset = 3U;
+    if (length == 0U && (i + 3U) < output.size()) {
+      length = output[i + 2U] + 255U;
+      offset = 4U;
+    }
+
+    if (length < offset || (i + length) > output.size())
+      break;
+
+    uint8_t type = output[i + offset - 1U];
+    const uint8_t* data = &output[i + offset];
+    uint16_t dataLength = length - offset;
+
+    if (type == MMDVM_YSF_LOST || type == MMDVM_P25_LOST || type == MMDVM_NXDN_LOST || type == MMDVM_M17_LOST || type == MMDVM_M17_EOT) {
+      if (dataLength >= 2U) {
+        // -32768 is sent when there weren't enough syncs to measure it
+        int16_t hz = int16_t((data[0U] << 8) | data[1U]);
+        if (hz != -32768 && stats.offsets < MAX_OFFSETS)
+          stats.offset[stats.offsets++] = hz;
+      }
+
+      i += length;
+      continue;
+    }
+
+    std::vector<uint8_t> hard;
+    if (soft && (type & MMDVM_SOFT_TYPE) == MMDVM_SOFT_TYPE && dataLength > 0U) {
+      harden(data, dataLength, hard);
+      type &= ~MMDVM_SOFT_TYPE;
+      data = hard.data();
+      dataLength = uint16_t(hard.size());
+    }
+
+    size_t best = frames.size();
+    unsigned int bestErrors = 0U;
+    unsigned int bestBits = 0U;
+    unsigned int window = 0U;
+    for (size_t j = next; j < frames.size() && window < MATCH_WINDOW; j++) {
+      if (!compared[j])
+        continue;
+
+      window++;
+
+      if (frames[j].type != type)
+        continue;
+
+      unsigned int bits;
+      unsigned int errors = compare(frames[j], data, dataLength, bits);
+      if (best == frames.size() || errors < bestErrors) {
+        best = j;
+        bestErrors = errors;
+        bestBits = bits;
+      }
+    }
+
+    // After a long fade the rest of the transmission is searched for the first close match
+    if (best < frames.size() && bestErrors > (bestBits / 4U)) {
+      for (size_t j = next; j < frames.size(); j++) {
+        if (!compared[j] || frames[j].type != type)
+          continue;
+
+        unsigned int bits;
+        unsigned int errors = compare(frames[j], data, dataLength, bits);
+        if (errors <= (bits / 4U)) {
+          best = j;
+          bestErrors = errors;
+          bestBits = bits;
+          break;
+        }
+      }
+    }
+
+    // Anything worse than one bit in four is assumed to be a frame of noise
+    if (best < frames.size() && bestErrors <= (bestBits / 4U)) {
+      stats.matched++;
+      if (verbose && bestErrors > 0U)
+        dump(frames[best], best, data, dataLength, bestErrors);
+      stats.bits   += bestBits;
+      stats.errors += bestErrors;
+      if (bestErrors == 0U)
+        stats.good++;
+      next = best + 1U;
+    } else if (next < last) {
+      // After the last frame the receivers carry on without a sync until they time out, and
+      // those frames aren't counted
+      bool known = false;
+      for (size_t j = 0U; j < frames.size(); j++)
+        known = known || (compared[j] && frames[j].type == type);
+      if (known)
+        stats.spurious++;
+    }
+
+    i += length;
+  }
+}
+
+static bool parseSweep(const char* text, double& from, double& to, double& step)
+{
+  return ::sscanf(text, "%lf:%lf:%lf", &from, &to, &step) == 3 && step > 0.0 && to >= from;
+}
+
+static bool parseFade(const char* text, double& depth, double& rate)
+{
+  return ::sscanf(text, "%lf:%lf", &depth, &rate) == 2 && depth >= 0.0 && rate > 0.0;
+}
+
+static bool parseWatermarks(const char* text, uint8_t& low, uint8_t& high)
+{
+  unsigned int a, b;
+  if (::sscanf(text, "%u:%u", &a, &b) != 2 || b == 0U || b > 255U || a > b)
+    return false;
+
+  low  = uint8_t(a);
+  high = uint8_t(b);
+
+  return true;
+}
+
+static void usage()
+{
+  ::fprintf(stderr, "Usage: mmdvm_loopback [-m dstar,dstarhdr,dmr,dmrduplex,dmridle,ysf,p25,nxdn,m17] [-n frames] [-e from:to:step] [-f offset_hz] [-p drift_ppm] [-t deemphasis_us] [-a depth_db:rate_hz] [-l txlevel] [-L rxlevel] [-s seed] [-c results.csv] [-w low:high] [-b] [-S] [-v]\n");
+}
+
+int main(int argc, char** argv)
+{
+  std::string modes = "dstar,dmr,dmrduplex,dmridle,ysf,p25,nxdn,m17";
+  unsigned int count = 200U;
+  double from = 0.0;
+  double to   = 16.0;
+  double step = 2.0;
+  uint8_t txLevel = 128U;
+  uint8_t rxLevel = 128U;
+  unsigned int seed = 1U;
+  const char* csvName = NULL;
+  uint8_t spaceLow  = 0U;
+  uint8_t spaceHigh = 0U;
+  bool blockIO = false;
+  bool soft = false;
+  bool verbose = false;
+
+  CHANNEL params;
+  params.noise      = false;
+  params.ebn0       = 0.0;
+  params.offset     = 0.0;
+  params.drift      = 0.0;
+  params.deemphasis = 0.0;
+  params.fadeDepth  = 0.0;
+  params.fadeRate   = 0.0;
+
+  for (int i = 1; i < argc; i++) {
+    if (::strcmp(argv[i], "-m") == 0 && (i + 1) < argc)
+      modes = argv[++i];
+    else if (::strcmp(argv[i], "-n") == 0 && (i + 1) < argc)
+      count = ::atoi(argv[++i]);
+    else if (::strcmp(argv[i], "-e") == 0 && (i + 1) < argc) {
+      if (!parseSweep(argv[++i], from, to, step)) {
+        usage();
+        return 1;
+      }
+    } else if (::strcmp(argv[i], "-f") == 0 && (i + 1) < argc)
+      params.offset = ::atof(argv[++i]);
+    else if (::strcmp(argv[i], "-p") == 0 && (i + 1) < argc)
+      params.drift = ::atof(argv[++i]);
+    else if (::strcmp(argv[i], "-t") == 0 && (i + 1) < argc)
+      params.deemphasis = ::atof(argv[++i]);
+    else if (::strcmp(argv[i], "-a") == 0 && (i + 1) < argc) {
+      if (!parseFade(argv[++i], params.fadeDepth, params.fadeRate)) {
+        usage();
+        return 1;
+      }
+    } else if (::strcmp(argv[i], "-l") == 0 && (i + 1) < argc)
+      txLevel = uint8_t(::atoi(argv[++i]));
+    else if (::strcmp(argv[i], "-L") == 0 && (i + 1) < argc)
+      rxLevel = uint8_t(::atoi(argv[++i]));
+    else if (::strcmp(argv[i], "-s") == 0 && (i + 1) < argc)
+      seed = ::atoi(argv[++i]);
+    else if (::strcmp(argv[i], "-c") == 0 && (i + 1) < argc)
+      csvName = argv[++i];
+    else if (::strcmp(argv[i], "-w") == 0 && (i + 1) < argc) {
+      if (!parseWatermarks(argv[++i], spaceLow, spaceHigh)) {
+        usage();
+        return 1;
+      }
+    } else if (::strcmp(argv[i], "-b") == 0)
+      blockIO = true;
+    else if (::strcmp(argv[i], "-S") == 0)
+      soft = true;
+    else if (::strcmp(argv[i], "-v") == 0)
+      verbose = true;
+    else {
+      usage();
+      return 1;
+    }
+  }
+
+  if (count == 0U) {
+    usage();
+    return 1;
+  }
+
+  std::vector<bool> enabled(MODES_LEN, false);
+  size_t pos = 0U;
+  while (pos <= modes.size()) {
+    size_t end = modes.find(',', pos);
+    if (end == std::string::npos)
+      end = modes.size();
+
+    std::string name = modes.substr(pos, end - pos);
+    bool found = false;
+    for (unsigned int i = 0U; i < MODES_LEN; i++) {
+      if (name == MODES[i].name) {
+        enabled[i] = true;
+        found = true;
+      }
+    }
+
+    if (!found) {
+      ::fprintf(stderr, "mmdvm_loopback: unknown mode \"%s\"\n", name.c_str());
+      return 1;
+    }
+
+    pos = end + 1U;
+  }
+
+  FILE* csv = NULL;
+  if (csvName != NULL) {
+    csv = ::fopen(csvName, "wt");
+    if (csv == NULL) {
+      ::fprintf(stderr, "mmdvm_loopback: cannot create %s\n", csvName);
+      return 1;
+    }
+
+    ::fprintf(csv, "mode,ebn0,sent,decoded,bits,errors,ber,fer,%s_per_frame\n", TICKS_NAME);
+  }
+
+  ::printf("Channel: offset %.0f Hz, drift %.1f ppm, de-emphasis %.0f us", params.offset, params.drift, params.deemphasis);
+  if (params.fadeRate > 0.0)
+    ::printf(", fading %.1f dB at %.1f Hz", params.fadeDepth, params.fadeRate);
+  ::printf("\n");
+
+  ::setup();
+  ::hostSetBlockIO(blockIO);
+
+  for (unsigned int m = 0U; m < MODES_LEN; m++) {
+    if (!enabled[m])
+      continue;
+
+    const MODE_TABLE& mode = MODES[m];
+
+    s_random.seed(seed);
+
+    std::vector<FRAME> frames;
+    mode.build(frames, count);
+
+    // Only needed to scale the carrier offset
+    double outer = 0.0;
+    if (params.offset != 0.0) {
+      configure(mode, txLevel, rxLevel, soft);
+      outer = outerLevel(mode, frames);
+    }
+
+    configure(mode, txLevel, rxLevel, soft);
+
+    std::vector<int16_t> signal;
+    double power;
+    unsigned int reports;
+    uint64_t txTicks = transmit(mode, frames, spaceLow, spaceHigh, signal, power, reports);
+
+    ::printf("\n%s: %u frames, %.2f s on air, TX %.0f %s per frame", mode.name, count, double(signal.size()) / double(SAMPLE_RATE), double(txTicks) / double(frames.size()), TICKS_NAME);
+    if (spaceHigh > 0U)
+      ::printf(", %u space reports", reports);
+    ::printf("\n");
+#if defined(USE_NXDN_BOXCAR)
+    if (::strcmp(mode.name, "nxdn") == 0)
+      ::printf("  USE_NXDN_BOXCAR is set, the receive filter doesn't match the transmitter's\n");
+#endif
+    ::printf("  Eb/N0  decoded        BER      FER  %s/frame  spurious  offset\n", TICKS_NAME);
+
+    // The first point has no noise, then the sweep
+    unsigned int points = (unsigned int)((to - from) / step + 1.5);
+    for (unsigned int p = 0U; p <= points; p++) {
+      CHANNEL point = params;
+      point.noise = p > 0U;
+      point.ebn0  = from + double(p - 1U) * step;
+
+      std::vector<uint16_t> adc;
+      channel(mode, point, signal, power, outer, adc);
+
+      configure(mode, txLevel, rxLevel, soft);
+
+      // A duplex mode receives while it transmits the frames again, so its cost includes the transmitter
+      std::vector<uint8_t> output;
+      uint64_t rxTicks;
+      if (mode.duplex) {
+        std::vector<int16_t> again;
+        double unused;
+        rxTicks = transmit(mode, frames, spaceLow, spaceHigh, again, unused, reports, &adc, &output);
+      } else {
+        rxTicks = receive(adc, output);
+      }
+
+      STATS stats;
+      score(frames, output, soft, verbose, stats);
+
+      double ber = stats.bits > 0U ? double(stats.errors) / double(stats.bits) : 1.0;
+      double fer = stats.sent > 0U ? 1.0 - double(stats.good) / double(stats.sent) : 1.0;
+      double cost = stats.matched > 0U ? double(rxTicks) / double(stats.matched) : 0.0;
+
+      char label[16U];
+      if (point.noise)
+        ::snprintf(label, sizeof(label), "%.1f", point.ebn0);
+      else
+        ::snprintf(label, sizeof(label), "inf");
+
+      // The median of the carrier offsets that the receiver measured, for the modes that report them,
+      // as one from a short run of frames after losing the sync in the noise can be far out
+      char offset[16U];
+      if (stats.offsets > 0U) {
+        std::sort(stats.offset, stats.offset + stats.offsets);
+        ::snprintf(offset, sizeof(offset), "%d", stats.offset[stats.offsets / 2U]);
+      } else {
+        ::snprintf(offset, sizeof(offset), "-");
+      }
+
+      ::printf("  %5s  %4u/%-4u  %9.2e  %7.4f  %12.0f  %8u  %6s\n", label, stats.matched, stats.sent, ber, fer, cost, stats.spurious, offset);
+
+      if (csv != NULL)
+        ::fprintf(csv, "%s,%s,%u,%u,%llu,%llu,%g,%g,%.0f\n", mode.name, label, stats.sent, stats.matched,
+                  (unsigned long long)stats.bits, (unsigned long long)stats.errors, ber, fer, cost);
+    }
+  }
+
+  if (csv != NULL)
+    ::fclose(csv);
+
+  return 0;
+}
@@ -0,0 +1,546 @@
+/*
+ *   Copyright (C) 2026 by the MMDVM developers
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+// Replays a recorded discriminator capture through the firmware, as fast as
+// the PC allows, and saves every frame that the modem sends to the host.
+//
+//   mmdvm_replay [-m dstar,dmr,...] [-r rssi.raw] [-o frames.bin] [-l rxlevel] [-x] [-b] [-d] capture.(raw|wav)
+//
+// A .raw capture holds 16-bit little endian ADC readings (0 - 4095) at 24 kHz,
+// a .wav capture holds 16-bit signed mono PCM at 24 kHz. The optional RSSI
+// track is in the same raw format as the ADC capture. With -b the samples are
+// moved by the simulated DMA block I/O instead of the per sample interrupt.
+// The buffer use of the first pass is read back with MMDVM_GET_EXT_STATUS and
+// printed. When built with "make -f Makefile.Host PROFILER=1" the interrupt and
+// loop histograms and the stage timings, from MMDVM_GET_STATS, are added, and
+// with ACTIVITY=1 the share of the idle time that the activity gate skipped the
+// digital mode receivers for, which is also in the MMDVM_GET_EXT_STATUS reply.
+
+#include "Config.h"
+#include "Globals.h"
+
+#include "Host.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+const uint32_t SAMPLE_RATE = 24000U;
+
+const unsigned int PROFILE_BINS = 16U;
+
+const uint8_t  MMDVM_FRAME_START = 0xE0U;
+const uint8_t  MMDVM_SET_CONFIG  = 0x02U;
+const uint8_t  MMDVM_GET_STATS   = 0x0BU;
+const uint8_t  MMDVM_GET_EXT_STATUS = 0x0CU;
+
+struct MODE_TABLE {
+  const char* name;
+  uint8_t     byte;
+  uint8_t     mask;
+} MODES[] = {
+  {"dstar", 1U, 0x01U},
+  {"dmr",   1U, 0x02U},
+  {"ysf",   1U, 0x04U},
+  {"p25",   1U, 0x08U},
+  {"nxdn",  1U, 0x10U},
+  {"fm",    1U, 0x20U},
+  {"m17",   1U, 0x40U},
+  {"ax25",  2U, 0x02U}
+};
+
+const unsigned int MODES_LEN = sizeof(MODES) / sizeof(MODE_TABLE);
+
+static bool readFile(const char* fileName, std::vector<uint8_t>& data)
+{
+  FILE* fp = ::fopen(fileName, "rb");
+  if (fp == NULL) {
+    ::fprintf(stderr, "mmdvm_replay: cannot open %s\n", fileName);
+    return false;
+  }
+
+  uint8_t buffer[4096U];
+  size_t n;
+  while ((n = ::fread(buffer, 1U, sizeof(buffer), fp)) > 0U)
+    data.insert(data.end(), buffer, buffer + n);
+
+  ::fclose(fp);
+
+  return true;
+}
+
+static uint32_t get32(const uint8_t* p)
+{
+  return uint32_t(p[0U]) | (uint32_t(p[1U]) << 8) | (uint32_t(p[2U]) << 16) | (uint32_t(p[3U]) << 24);
+}
+
+static uint16_t get16(const uint8_t* p)
+{
+  return uint16_t(p[0U]) | (uint16_t(p[1U]) << 8);
+}
+
+static bool loadRaw(const std::vector<uint8_t>& data, std::vector<uint16_t>& samples)
+{
+  for (size_t i = 0U; (i + 1U) < data.size(); i += 2U)
+    samples.push_back(get16(&data[i]) & 0x0FFFU);
+
+  return true;
+}
+
+static bool loadWAV(const std::vector<uint8_t>& data, std::vector<uint16_t>& samples)
+{
+  if (data.size() < 12U || ::memcmp(&data[0U], "RIFF", 4U) != 0 || ::memcmp(&data[8U], "WAVE", 4U) != 0) {
+    ::fprintf(stderr, "mmdvm_replay: not a WAV file\n");
+    return false;
+  }
+
+  bool fmt = false;
+  size_t pos = 12U;
+  while ((pos + 8U) <= data.size()) {
+    uint32_t length = get32(&data[pos + 4U]);
+    const uint8_t* chunk = &data[pos + 8U];
+    if ((pos + 8U + length) > data.size())
+      length = uint32_t(data.size() - pos - 8U);
+
+    if (::memcmp(&data[pos], "fmt ", 4U) == 0 && length >= 16U) {
+      uint16_t format   = get16(chunk + 0U);
+      uint16_t channels = get16(chunk + 2U);
+      uint32_t rate     = get32(chunk + 4U);
+      uint16_t bits     = get16(chunk + 14U);
+
+      if (format != 1U || channels != 1U || bits != 16U) {
+        ::fprintf(stderr, "mmdvm_replay: only 16-bit mono PCM WAV files are supported\n");
+        return false;
+      }
+
+      if (rate != SAMPLE_RATE)
+        ::fprintf(stderr, "mmdvm_replay: warning, the sample rate is %u Hz not %u Hz\n", rate, SAMPLE_RATE);
+
+      fmt = true;
+    } else if (::memcmp(&data[pos], "data", 4U) == 0) {
+      if (!fmt) {
+        ::fprintf(stderr, "mmdvm_replay: the WAV data chunk comes before the format chunk\n");
+        return false;
+      }
+
+      for (uint32_t i = 0U; (i + 1U) < length; i += 2U) {
+        int16_t value = int16_t(get16(chunk + i));
+        samples.push_back(uint16_t((value >> 4) + 2048));
+      }
+
+      return true;
+    }
+
+    pos += 8U + length + (length & 1U);
+  }
+
+  ::fprintf(stderr, "mmdvm_replay: no data found in the WAV file\n");
+  return false;
+}
+
+static void drain(FILE* out, uint32_t* counts)
+{
+  std::vector<uint8_t> data;
+
+  uint8_t buffer[512U];
+  uint16_t n;
+  while ((n = ::hostSerialRead(1U, buffer, sizeof(buffer))) > 0U)
+    data.insert(data.end(), buffer, buffer + n);
+
+  if (data.empty())
+    return;
+
+  if (out != NULL)
+    ::fwrite(&data[0U], 1U, data.size(), out);
+
+  // Each frame is queued whole by CSerialPort::writeInt() so the queue always starts on a frame
+  if (counts != NULL) {
+    size_t i = 0U;
+    while ((i + 2U) < data.size() && data[i] == MMDVM_FRAME_START) {
+      uint16_t length = data[i + 1U];
+      uint8_t type = data[i + 2U];
+      if (length == 0U && (i + 3U) < data.size()) {
+        length = data[i + 2U] + 255U;
+        type = data[i + 3U];
+      }
+
+      if (length < 3U)
+        break;
+
+      counts[type]++;
+      i += length;
+    }
+  }
+}
+
+// The stage timings and the extended status are big endian
+static uint32_t getBE32(const uint8_t* data)
+{
+  return (uint32_t(data[0U]) << 24) | (uint32_t(data[1U]) << 16) | (uint32_t(data[2U]) << 8) | uint32_t(data[3U]);
+}
+
+static uint16_t getBE16(const uint8_t* data)
+{
+  return (uint16_t(data[0U]) << 8) | uint16_t(data[1U]);
+}
+
+// Send a request with no data and return the payload of the reply, if any
+static bool request(uint8_t type, std::vector<uint8_t>& payload)
+{
+  const uint8_t frame[] = {MMDVM_FRAME_START, 3U, type};
+  ::hostSerialWrite(1U, frame, sizeof(frame));
+
+  ::loop();
+
+  std::vector<uint8_t> data;
+  uint8_t buffer[512U];
+  uint16_t n;
+  while ((n = ::hostSerialRead(1U, buffer, sizeof(buffer))) > 0U)
+    data.insert(data.end(), buffer, buffer + n);
+
+  // Find the reply amongst anything else that the modem has sent
+  size_t i = 0U;
+  while ((i + 3U) < data.size() && data[i] == MMDVM_FRAME_START) {
+    uint16_t length = data[i + 1U];
+    uint16_t offset = 3U;
+    if (length == 0U) {
+      length = data[i + 2U] + 255U;
+      offset = 4U;
+    }
+
+    if (length < offset || (i + length) > data.size())
+      break;
+
+    if (data[i + offset - 1U] == type) {
+      payload.assign(data.begin() + i + offset, data.begin() + i + length);
+      return true;
+    }
+
+    i += length;
+  }
+
+  return false;
+}
+
+const char* BUFFERS[] = {
+  "rx", "tx", "dstar", "dmr 1", "dmr 2", "dmr dmo", "ysf", "p25", "nxdn", "m17", "pocsag", "fm",
+  "q radio", "q reply", "q debug"
+};
+
+const unsigned int BUFFERS_LEN = sizeof(BUFFERS) / sizeof(const char*);
+
+// Ask the modem for its buffer use, and the interrupt and loop histograms, which also clears them
+static void status(bool print)
+{
+  std::vector<uint8_t> payload;
+  if (!request(MMDVM_GET_EXT_STATUS, payload) || payload.empty()) {
+    if (print)
+      ::printf("No extended status was returned\n");
+    return;
+  }
+
+  if (!print)
+    return;
+
+  size_t pos = 1U;
+
+  ::printf("Buffers:\n");
+  ::printf("  %-8s %6s %10s %10s %10s\n", "buffer", "length", "high water", "overflows", "underflows");
+  for (unsigned int i = 0U; i < payload[0U] && (pos + 9U) <= payload.size(); i++, pos += 9U) {
+    const uint8_t* p = &payload[pos];
+    const char* name = p[0U] < BUFFERS_LEN ? BUFFERS[p[0U]] : "?";
+    ::printf("  %-8s %6u %10u %10u %10u\n", name, getBE16(p + 1U), getBE16(p + 3U), getBE16(p + 5U), getBE16(p + 7U));
+  }
+
+  if ((pos + 5U) > payload.size())
+    return;
+
+  double clock = double(getBE32(&payload[pos]));
+  unsigned int histograms = payload[pos + 4U];
+  pos += 5U;
+
+  for (unsigned int i = 0U; i < histograms && (pos + 5U + PROFILE_BINS * 4U) <= payload.size(); i++) {
+    const uint8_t* p = &payload[pos];
+    double width = double(getBE32(p + 1U));
+
+    ::printf("%s histogram:\n", p[0U] == 0U ? "Interrupt interval" : "Main loop time");
+    ::printf("  %10s %10s\n", "from us", "count");
+    for (unsigned int j = 0U; j < PROFILE_BINS; j++) {
+      uint32_t count = getBE32(p + 5U + j * 4U);
+      if (count == 0U)
+        continue;
+
+      // The interrupt bins are all the same width, the loop bins double after the first one
+      double from = p[0U] == 0U ? width * j : (j == 0U ? 0.0 : width * double(1U << (j - 1U)));
+      ::printf("  %10.2f %10u\n", 1E6 * from / clock, count);
+    }
+
+    pos += 5U + PROFILE_BINS * 4U;
+  }
+
+  if ((pos + 8U) > payload.size())
+    return;
+
+  uint32_t gated  = getBE32(&payload[pos + 0U]);
+  uint32_t active = getBE32(&payload[pos + 4U]);
+  if ((gated + active) > 0U)
+    ::printf("Idle receivers gated for %.1f%% of the time\n", 100.0 * double(gated) / double(gated + active));
+}
+
+#if defined(USE_PROFILER)
+const char* STAGES[] = {
+  "isr", "io", "dc blocker", "activity", "rrc 0.2", "gaussian", "boxcar 5", "nxdn", "nxdn isinc", "rrc 0.5",
+  "dstar rx", "dmr rx", "ysf rx", "p25 rx", "nxdn rx", "m17 rx", "fm rx", "ax25 rx", "cal rx",
+  "serial", "dstar tx", "dmr tx", "ysf tx", "p25 tx", "nxdn tx", "m17 tx", "pocsag tx", "fm tx", "ax25 tx", "cal tx", "cwid tx",
+  "dstar header"
+};
+
+const unsigned int STAGES_LEN = sizeof(STAGES) / sizeof(const char*);
+
+// Ask the modem for its stage timings, which also clears them, and print them if wanted
+static void stats(bool print)
+{
+  std::vector<uint8_t> payload;
+  if (!request(MMDVM_GET_STATS, payload) || payload.size() < 5U) {
+    if (print)
+      ::printf("No stage timings were returned\n");
+    return;
+  }
+
+  if (!print)
+    return;
+
+  double clock = double(getBE32(&payload[0U]));
+
+  ::printf("Stage timings in microseconds:\n");
+  ::printf("  %-12s %10s %10s %10s\n", "stage", "min", "avg", "max");
+  for (unsigned int i = 0U; i < payload[4U] && (5U + (i + 1U) * 13U) <= payload.size(); i++) {
+    const uint8_t* entry = &payload[5U + i * 13U];
+    const char* name = entry[0U] < STAGES_LEN ? STAGES[entry[0U]] : "?";
+    ::printf("  %-12s %10.2f %10.2f %10.2f\n", name, 1E6 * getBE32(entry + 1U) / clock, 1E6 * getBE32(entry + 5U) / clock, 1E6 * getBE32(entry + 9U) / clock);
+  }
+}
+#endif
+
+static void configure(uint8_t mode1, uint8_t mode2, uint8_t rxLevel, bool simplex, bool debug)
+{
+  uint8_t frame[40U];
+  ::memset(frame, 0x00U, sizeof(frame));
+
+  frame[0U] = MMDVM_FRAME_START;
+  frame[1U] = 40U;
+  frame[2U] = MMDVM_SET_CONFIG;
+
+  uint8_t* data = frame + 3U;
+  data[0U]  = (debug ? 0x10U : 0x00U) | (simplex ? 0x80U : 0x00U);
+  data[1U]  = mode1;
+  data[2U]  = mode2;
+  data[3U]  = 10U;          // TX delay
+  data[4U]  = 0U;           // STATE_IDLE
+  data[5U]  = 128U;         // TX DC offset
+  data[6U]  = 128U;         // RX DC offset
+  data[7U]  = rxLevel;
+  for (uint8_t i = 8U; i < 18U; i++)
+    data[i] = 128U;         // TX levels
+  data[26U] = 1U;           // DMR colour code
+  data[28U] = 128U;         // AX.25 RX twist
+
+  ::hostSerialWrite(1U, frame, sizeof(frame));
+
+  for (unsigned int i = 0U; i < 10U; i++)
+    ::loop();
+
+  drain(NULL, NULL);
+}
+
+static double run(const std::vector<uint16_t>& samples, const std::vector<uint16_t>& rssi, FILE* out, uint32_t* counts)
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  for (size_t i = 0U; i < samples.size(); i++) {
+    ::hostSetADC(samples[i], i < rssi.size() ? rssi[i] : 0U);
+    ::hostTick();
+
+    if (((i + 1U) % RX_BLOCK_SIZE) == 0U) {
+      ::loop();
+      drain(out, counts);
+    }
+  }
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  return elapsed.count();
+}
+
+static void usage()
+{
+  ::fprintf(stderr, "Usage: mmdvm_replay [-m dstar,dmr,ysf,p25,nxdn,m17,fm,ax25] [-r rssi.raw] [-o frames.bin] [-l rxlevel] [-x] [-b] [-d] capture.(raw|wav)\n");
+}
+
+int main(int argc, char** argv)
+{
+  std::string modes = "dstar,dmr,ysf,p25,nxdn,m17";
+  const char* rssiName = NULL;
+  const char* outName  = NULL;
+  const char* inName   = NULL;
+  uint8_t rxLevel = 128U;
+  bool simplex = false;
+  bool blockIO = false;
+  bool debug   = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (::strcmp(argv[i], "-m") == 0 && (i + 1) < argc)
+      modes = argv[++i];
+    else if (::strcmp(argv[i], "-r") == 0 && (i + 1) < argc)
+      rssiName = argv[++i];
+    else if (::strcmp(argv[i], "-o") == 0 && (i + 1) < argc)
+      outName = argv[++i];
+    else if (::strcmp(argv[i], "-l") == 0 && (i + 1) < argc)
+      rxLevel = uint8_t(::atoi(argv[++i]));
+    else if (::strcmp(argv[i], "-x") == 0)
+      simplex = true;
+    else if (::strcmp(argv[i], "-b") == 0)
+      blockIO = true;
+    else if (::strcmp(argv[i], "-d") == 0)
+      debug = true;
+    else if (argv[i][0] != '-' && inName == NULL)
+      inName = argv[i];
+    else {
+      usage();
+      return 1;
+    }
+  }
+
+  if (inName == NULL) {
+    usage();
+    return 1;
+  }
+
+  std::vector<bool> enabled(MODES_LEN, false);
+  size_t pos = 0U;
+  while (pos <= modes.size()) {
+    size_t end = modes.find(',', pos);
+    if (end == std::string::npos)
+      end = modes.size();
+
+    std::string name = modes.substr(pos, end - pos);
+    bool found = false;
+    for (unsigned int i = 0U; i < MODES_LEN; i++) {
+      if (name == MODES[i].name) {
+        enabled[i] = true;
+        found = true;
+      }
+    }
+
+    if (!found) {
+      ::fprintf(stderr, "mmdvm_replay: unknown mode \"%s\"\n", name.c_str());
+      return 1;
+    }
+
+    pos = end + 1U;
+  }
+
+  std::vector<uint8_t> data;
+  if (!readFile(inName, data))
+    return 1;
+
+  std::vector<uint16_t> samples;
+  std::string inStr = inName;
+  bool wav = inStr.size() > 4U && (inStr.substr(inStr.size() - 4U) == ".wav" || inStr.substr(inStr.size() - 4U) == ".WAV");
+  if (!(wav ? loadWAV(data, samples) : loadRaw(data, samples)))
+    return 1;
+
+  std::vector<uint16_t> rssi;
+  if (rssiName != NULL) {
+    std::vector<uint8_t> rssiData;
+    if (!readFile(rssiName, rssiData))
+      return 1;
+    loadRaw(rssiData, rssi);
+  }
+
+  FILE* out = NULL;
+  if (outName != NULL) {
+    out = ::fopen(outName, "wb");
+    if (out == NULL) {
+      ::fprintf(stderr, "mmdvm_replay: cannot create %s\n", outName);
+      return 1;
+    }
+  }
+
+  double duration = double(samples.size()) / double(SAMPLE_RATE);
+  ::printf("%s: %zu samples, %.2f seconds\n", inName, samples.size(), duration);
+
+  ::setup();
+  ::hostSetBlockIO(blockIO);
+
+  // The first pass has every requested mode enabled, as a hotspot would in idle, and produces the frames
+  uint8_t mode1 = 0x00U;
+  uint8_t mode2 = 0x00U;
+  for (unsigned int i = 0U; i < MODES_LEN; i++) {
+    if (enabled[i]) {
+      if (MODES[i].byte == 1U)
+        mode1 |= MODES[i].mask;
+      else
+        mode2 |= MODES[i].mask;
+    }
+  }
+
+  uint32_t counts[256U];
+  ::memset(counts, 0x00U, sizeof(counts));
+
+  configure(mode1, mode2, rxLevel, simplex, debug);
+  status(false);
+#if defined(USE_PROFILER)
+  stats(false);
+#endif
+  double elapsed = run(samples, rssi, out, counts);
+  ::printf("%-8s %10.1f x real time\n", "all", duration / elapsed);
+
+  status(true);
+#if defined(USE_PROFILER)
+  stats(true);
+#endif
+
+  if (out != NULL)
+    ::fclose(out);
+
+  // Then each mode on its own, to show what each demodulator adds to the idle scan
+  for (unsigned int i = 0U; i < MODES_LEN; i++) {
+    if (!enabled[i])
+      continue;
+
+    configure(MODES[i].byte == 1U ? MODES[i].mask : 0x00U, MODES[i].byte == 2U ? MODES[i].mask : 0x00U, rxLevel, simplex, false);
+    elapsed = run(samples, rssi, NULL, NULL);
+    ::printf("%-8s %10.1f x real time\n", MODES[i].name, duration / elapsed);
+  }
+
+  configure(0x00U, 0x00U, rxLevel, simplex, false);
+  elapsed = run(samples, rssi, NULL, NULL);
+  ::printf("%-8s %10.1f x real time\n", "none", duration / elapsed);
+
+  ::printf("Frames sent to the host:\n");
+  for (unsigned int i = 0U; i < 256U; i++) {
+    if (counts[i] > 0U)
+      ::printf("  0x%02X: %u\n", i, counts[i]);
+  }
+
+  return 0;
+}
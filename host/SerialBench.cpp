@@ -0,0 +1,209 @@
+/*
+ *   Copyright (C) 2026 by the MMDVM developers
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+// Times the parsing of the frames from the host by CSerialPort::process(),
+// through the simulated DMA receive buffer of SerialHost.cpp.
+//
+//   mmdvm_serialbench [-n frames] [-c chunk] [-s seed]
+//
+// The traffic is frames of random length, a quarter of them long frames of
+// more than 255 bytes, with a few bytes of noise between some of them. The
+// frames have types that the modem doesn't know, so each is answered with a
+// NAK naming its type, and these are checked against the frames sent. The
+// traffic is written chunk bytes at a time, or in random chunks of up to 512
+// bytes with -c 0, with process() run after each, so that frames are split
+// across reads and across the end of the receive buffer.
+
+#include "Config.h"
+#include "Globals.h"
+
+#include "Host.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// The fastest of this many runs is reported
+const unsigned int RUNS = 5U;
+
+const uint8_t FRAME_START = 0xE0U;
+const uint8_t NAK         = 0x7FU;
+
+// Types that the modem doesn't use
+const uint8_t FIRST_TYPE  = 0xD0U;
+const uint8_t TYPES       = 16U;
+
+static void makeTraffic(std::mt19937& rng, unsigned int frames, std::vector<uint8_t>& traffic, std::vector<uint8_t>& types)
+{
+  std::uniform_int_distribution<int> byte(0, 255);
+
+  for (unsigned int i = 0U; i < frames; i++) {
+    // Noise between frames, but never a frame start
+    unsigned int noise = (byte(rng) < 32) ? (byte(rng) & 0x07U) : 0U;
+    for (unsigned int j = 0U; j < noise; j++) {
+      uint8_t c = uint8_t(byte(rng));
+      traffic.push_back(c == FRAME_START ? 0x00U : c);
+    }
+
+    uint8_t type = FIRST_TYPE + (i % TYPES);
+    types.push_back(type);
+
+    traffic.push_back(FRAME_START);
+
+    unsigned int length;
+    if (byte(rng) < 64) {
+      length = 256U + (byte(rng) + byte(rng)) % 255U;
+      traffic.push_back(0U);
+      traffic.push_back(uint8_t(length - 255U));
+      traffic.push_back(type);
+      length -= 4U;
+    } else {
+      length = 3U + byte(rng) % 253U;
+      traffic.push_back(uint8_t(length));
+      traffic.push_back(type);
+      length -= 3U;
+    }
+
+    for (unsigned int j = 0U; j < length; j++)
+      traffic.push_back(uint8_t(byte(rng)));
+  }
+}
+
+// Reads the replies so far, and checks that they are the NAKs for the next frames
+static bool readReplies(const std::vector<uint8_t>& types, unsigned int& naks, std::vector<uint8_t>& pending)
+{
+  uint8_t buffer[1024U];
+  uint16_t n;
+  while ((n = ::hostSerialRead(1U, buffer, sizeof(buffer))) > 0U)
+    pending.insert(pending.end(), buffer, buffer + n);
+
+  size_t ptr = 0U;
+  while ((pending.size() - ptr) >= 5U) {
+    const uint8_t* reply = pending.data() + ptr;
+    if (reply[0U] != FRAME_START || reply[1U] != 5U || reply[2U] != NAK) {
+      ::fprintf(stderr, "mmdvm_serialbench: unexpected reply %02X %02X %02X\n", reply[0U], reply[1U], reply[2U]);
+      return false;
+    }
+
+    if (naks >= types.size() || reply[3U] != types[naks]) {
+      ::fprintf(stderr, "mmdvm_serialbench: NAK %u is for type %02X\n", naks, reply[3U]);
+      return false;
+    }
+
+    naks++;
+    ptr += 5U;
+  }
+
+  pending.erase(pending.begin(), pending.begin() + ptr);
+
+  return true;
+}
+
+static void usage()
+{
+  ::fprintf(stderr, "Usage: mmdvm_serialbench [-n frames] [-c chunk] [-s seed]\n");
+}
+
+int main(int argc, char** argv)
+{
+  unsigned int frames = 20000U;
+  unsigned int chunk  = 0U;
+  unsigned int seed   = 1U;
+
+  for (int i = 1; i < argc; i++) {
+    if (::strcmp(argv[i], "-n") == 0 && (i + 1) < argc) {
+      frames = ::atoi(argv[++i]);
+    } else if (::strcmp(argv[i], "-c") == 0 && (i + 1) < argc) {
+      chunk = ::atoi(argv[++i]);
+    } else if (::strcmp(argv[i], "-s") == 0 && (i + 1) < argc) {
+      seed = ::atoi(argv[++i]);
+    } else {
+      usage();
+      return 1;
+    }
+  }
+
+  if (frames == 0U || chunk > 512U) {
+    usage();
+    return 1;
+  }
+
+  std::mt19937 rng(seed);
+
+  std::vector<uint8_t> traffic;
+  std::vector<uint8_t> types;
+  makeTraffic(rng, frames, traffic, types);
+
+  std::vector<uint16_t> chunks;
+  std::uniform_int_distribution<int> size(1, 512);
+  for (size_t total = 0U; total < traffic.size(); ) {
+    uint16_t n = chunk > 0U ? chunk : size(rng);
+    if (n > (traffic.size() - total))
+      n = traffic.size() - total;
+
+    chunks.push_back(n);
+    total += n;
+  }
+
+  ::setup();
+  serial.flush();
+
+  uint8_t buffer[1024U];
+  while (::hostSerialRead(1U, buffer, sizeof(buffer)) > 0U)
+    ;
+
+  double best = 0.0;
+
+  for (unsigned int i = 0U; i < RUNS; i++) {
+    unsigned int naks = 0U;
+    std::vector<uint8_t> pending;
+    double elapsed = 0.0;
+
+    const uint8_t* data = traffic.data();
+    for (size_t j = 0U; j < chunks.size(); j++) {
+      ::hostSerialWrite(1U, data, chunks[j]);
+      data += chunks[j];
+
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      serial.process();
+      serial.flush();
+      elapsed += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      if (!readReplies(types, naks, pending))
+        return 1;
+    }
+
+    if (naks != frames) {
+      ::fprintf(stderr, "mmdvm_serialbench: %u NAKs for %u frames\n", naks, frames);
+      return 1;
+    }
+
+    if (i == 0U || elapsed < best)
+      best = elapsed;
+  }
+
+  double nsPerByte = 1E9 * best / double(traffic.size());
+
+  ::printf("%u frames, %zu bytes in %zu writes, best of %u\n", frames, traffic.size(), chunks.size(), RUNS);
+  ::printf("  %.2f ns per byte, %.1f MB/s\n", nsPerByte, 1E3 / nsPerByte);
+
+  return 0;
+}
@@ -0,0 +1,219 @@
+/*
+ *   Copyright (C) 2026 by the MMDVM developers
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+// Times the sync pre-filter that each digital receiver runs on every sample,
+// the CSyncSearch used by the receivers against the per phase registers and
+// the byte table bit counts of Utils.cpp that they used before it.
+//
+//   mmdvm_syncbench [-n samples] [-s seed]
+//
+// Both run over the same random samples with the sync patterns and error
+// limits that each receiver uses while it is searching, and they must find
+// the same candidates for the full correlation.
+
+#include "Config.h"
+#include "Globals.h"
+
+#include "DStarDefines.h"
+#include "DMRDefines.h"
+#include "YSFDefines.h"
+#include "P25Defines.h"
+#include "NXDNDefines.h"
+#include "M17Defines.h"
+
+#include "SyncSearch.h"
+#include "Utils.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// The fastest of this many runs is reported
+const unsigned int RUNS = 5U;
+
+struct PATTERN {
+  uint32_t pattern;
+  uint32_t mask;
+  uint8_t  maxErrs;
+};
+
+static uint8_t tableBits(uint8_t bits)
+{
+  return countBits8(bits);
+}
+
+static uint8_t tableBits(uint16_t bits)
+{
+  return countBits32(bits);
+}
+
+static uint8_t tableBits(uint32_t bits)
+{
+  return countBits32(bits);
+}
+
+static uint8_t tableBits(uint64_t bits)
+{
+  return countBits64(bits);
+}
+
+// As the receivers did it
+template <typename T, uint8_t PHASES>
+static unsigned int searchTable(const std::vector<q15_t>& samples, const PATTERN* patterns, unsigned int count)
+{
+  T bitBuffer[PHASES];
+  ::memset(bitBuffer, 0x00U, sizeof(bitBuffer));
+  uint16_t bitPtr = 0U;
+
+  unsigned int candidates = 0U;
+  for (size_t i = 0U; i < samples.size(); i++) {
+    bitBuffer[bitPtr] <<= 1;
+    if (samples[i] < 0)
+      bitBuffer[bitPtr] |= 0x01U;
+
+    for (unsigned int j = 0U; j < count; j++) {
+      if (tableBits(T((bitBuffer[bitPtr] & patterns[j].mask) ^ patterns[j].pattern)) <= patterns[j].maxErrs)
+        candidates++;
+    }
+
+    bitPtr++;
+    if (bitPtr >= PHASES)
+      bitPtr = 0U;
+  }
+
+  return candidates;
+}
+
+template <typename T, uint8_t PHASES>
+static unsigned int searchRegister(const std::vector<q15_t>& samples, const PATTERN* patterns, unsigned int count)
+{
+  CSyncSearch<T, PHASES> search;
+
+  unsigned int candidates = 0U;
+  for (size_t i = 0U; i < samples.size(); i++) {
+    search.add(samples[i]);
+
+    for (unsigned int j = 0U; j < count; j++) {
+      if (search.errors(T(patterns[j].pattern), T(patterns[j].mask)) <= patterns[j].maxErrs)
+        candidates++;
+    }
+  }
+
+  return candidates;
+}
+
+typedef unsigned int (*SEARCH)(const std::vector<q15_t>& samples, const PATTERN* patterns, unsigned int count);
+
+static double timeSearch(SEARCH search, const std::vector<q15_t>& samples, const PATTERN* patterns, unsigned int count, unsigned int& candidates)
+{
+  double best = 0.0;
+
+  for (unsigned int i = 0U; i < RUNS; i++) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    candidates = search(samples, patterns, count);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (i == 0U || elapsed.count() < best)
+      best = elapsed.count();
+  }
+
+  return 1E9 * best / double(samples.size());
+}
+
+// The patterns each receiver tests on every sample while it has no sync
+const PATTERN DSTAR_PATTERNS[] = {{DSTAR_FRAME_SYNC_DATA, DSTAR_FRAME_SYNC_MASK, 2U}, {DSTAR_DATA_SYNC_DATA, DSTAR_DATA_SYNC_MASK, 0U}};
+const PATTERN DMR_PATTERNS[]   = {{DMR_MS_DATA_SYNC_SYMBOLS, DMR_SYNC_SYMBOLS_MASK, 2U}};
+const PATTERN YSF_PATTERNS[]   = {{YSF_SYNC_SYMBOLS, YSF_SYNC_SYMBOLS_MASK, 3U}};
+const PATTERN P25_PATTERNS[]   = {{P25_SYNC_SYMBOLS, P25_SYNC_SYMBOLS_MASK, 2U}};
+const PATTERN NXDN_PATTERNS[]  = {{NXDN_FSW_SYMBOLS, NXDN_FSW_SYMBOLS_MASK, 2U}};
+const PATTERN M17_PATTERNS[]   = {{M17_LINK_SETUP_SYNC_SYMBOLS, 0xFFU, 0U}, {M17_STREAM_SYNC_SYMBOLS, 0xFFU, 0U}};
+
+struct MODE {
+  const char*    name;
+  const PATTERN* patterns;
+  unsigned int   count;
+  SEARCH         table;
+  SEARCH         swar;
+};
+
+const MODE MODES[] = {
+  {"dstar", DSTAR_PATTERNS, 2U, searchTable<uint64_t, DSTAR_RADIO_SYMBOL_LENGTH>, searchRegister<uint32_t, DSTAR_RADIO_SYMBOL_LENGTH>},
+  {"dmr",   DMR_PATTERNS,   1U, searchTable<uint32_t, DMR_RADIO_SYMBOL_LENGTH>,   searchRegister<uint32_t, DMR_RADIO_SYMBOL_LENGTH>},
+  {"ysf",   YSF_PATTERNS,   1U, searchTable<uint32_t, YSF_RADIO_SYMBOL_LENGTH>,   searchRegister<uint32_t, YSF_RADIO_SYMBOL_LENGTH>},
+  {"p25",   P25_PATTERNS,   1U, searchTable<uint32_t, P25_RADIO_SYMBOL_LENGTH>,   searchRegister<uint32_t, P25_RADIO_SYMBOL_LENGTH>},
+  {"nxdn",  NXDN_PATTERNS,  1U, searchTable<uint16_t, NXDN_RADIO_SYMBOL_LENGTH>,  searchRegister<uint16_t, NXDN_RADIO_SYMBOL_LENGTH>},
+  {"m17",   M17_PATTERNS,   2U, searchTable<uint8_t, M17_RADIO_SYMBOL_LENGTH>,    searchRegister<uint8_t, M17_RADIO_SYMBOL_LENGTH>}
+};
+
+const unsigned int MODES_LEN = sizeof(MODES) / sizeof(MODE);
+
+static void usage()
+{
+  ::fprintf(stderr, "Usage: mmdvm_syncbench [-n samples] [-s seed]\n");
+}
+
+int main(int argc, char** argv)
+{
+  unsigned int count = 2400000U;
+  unsigned int seed  = 1U;
+
+  for (int i = 1; i < argc; i++) {
+    if (::strcmp(argv[i], "-n") == 0 && (i + 1) < argc)
+      count = ::atoi(argv[++i]);
+    else if (::strcmp(argv[i], "-s") == 0 && (i + 1) < argc)
+      seed = ::atoi(argv[++i]);
+    else {
+      usage();
+      return 1;
+    }
+  }
+
+  if (count == 0U) {
+    usage();
+    return 1;
+  }
+
+  std::mt19937 random(seed);
+  std::vector<q15_t> samples(count);
+  for (unsigned int i = 0U; i < count; i++)
+    samples[i] = q15_t(random());
+
+  ::printf("%u samples, ns per sample, best of %u\n", count, RUNS);
+  ::printf("  mode     table     swar  speedup  candidates\n");
+
+  bool ok = true;
+  for (unsigned int i = 0U; i < MODES_LEN; i++) {
+    const MODE& mode = MODES[i];
+
+    unsigned int tableCandidates, swarCandidates;
+    double table = timeSearch(mode.table, samples, mode.patterns, mode.count, tableCandidates);
+    double swar  = timeSearch(mode.swar,  samples, mode.patterns, mode.count, swarCandidates);
+
+    ::printf("  %-5s  %7.2f  %7.2f  %6.2fx  %10u\n", mode.name, table, swar, table / swar, swarCandidates);
+
+    if (tableCandidates != swarCandidates) {
+      ::fprintf(stderr, "mmdvm_syncbench: %s found %u candidates, not %u\n", mode.name, swarCandidates, tableCandidates);
+      ok = false;
+    }
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+/*
+ *   Copyright (C) 2026 by the MMDVM developers
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "arm_math.h"
+
+#include <cmath>
+
+void arm_fir_fast_q15(const arm_fir_instance_q15* S, const q15_t* pSrc, q15_t* pDst, uint32_t blockSize)
+{
+  q15_t* pState  = S->pState;
+  q15_t* pCoeffs = S->pCoeffs;
+  uint16_t numTaps = S->numTaps;
+
+  ::memcpy(pState + numTaps - 1U, pSrc, blockSize * sizeof(q15_t));
+
+  for (uint32_t n = 0U; n < blockSize; n++) {
+    // The Cortex-M version accumulates with SMLAD into 32 bits, wrapping on overflow
+    uint32_t acc = 0U;
+    for (uint16_t k = 0U; k < numTaps; k++)
+      acc += uint32_t(q31_t(pState[n + k]) * q31_t(pCoeffs[k]));
+
+    pDst[n] = q15_t(__SSAT(q31_t(acc) >> 15, 16));
+  }
+
+  ::memmove(pState, pState + blockSize, (numTaps - 1U) * sizeof(q15_t));
+}
+
+void arm_fir_f32(const arm_fir_instance_f32* S, const float32_t* pSrc, float32_t* pDst, uint32_t blockSize)
+{
+  float32_t* pState  = S->pState;
+  float32_t* pCoeffs = S->pCoeffs;
+  uint16_t numTaps = S->numTaps;
+
+  ::memcpy(pState + numTaps - 1U, pSrc, blockSize * sizeof(float32_t));
+
+  for (uint32_t n = 0U; n < blockSize; n++) {
+    float32_t acc = 0.0F;
+    for (uint16_t k = 0U; k < numTaps; k++)
+      acc += pState[n + k] * pCoeffs[k];
+
+    pDst[n] = acc;
+  }
+
+  ::memmove(pState, pState + blockSize, (numTaps - 1U) * sizeof(float32_t));
+}
+
+void arm_fir_interpolate_q15(const arm_fir_interpolate_instance_q15* S, const q15_t* pSrc, q15_t* pDst, uint32_t blockSize)
+{
+  q15_t* pState  = S->pState;
+  q15_t* pCoeffs = S->pCoeffs;
+  uint8_t  L        = S->L;
+  uint16_t phaseLen = S->phaseLength;
+
+  ::memcpy(pState + phaseLen - 1U, pSrc, blockSize * sizeof(q15_t));
+
+  for (uint32_t n = 0U; n < blockSize; n++) {
+    for (uint8_t j = 1U; j <= L; j++) {
+      q63_t sum = 0;
+      for (uint16_t k = 0U; k < phaseLen; k++)
+        sum += q63_t(pState[n + k]) * pCoeffs[(L - j) + k * L];
+
+      *pDst++ = q15_t(__SSAT(q31_t(sum >> 15), 16));
+    }
+  }
+
+  ::memmove(pState, pState + blockSize, (phaseLen - 1U) * sizeof(q15_t));
+}
+
+void arm_biquad_cascade_df1_q31(const arm_biquad_casd_df1_inst_q31* S, const q31_t* pSrc, q31_t* pDst, uint32_t blockSize)
+{
+  q31_t* pState  = S->pState;
+  q31_t* pCoeffs = S->pCoeffs;
+  uint32_t shift = 31U - S->postShift;
+
+  const q31_t* pIn = pSrc;
+
+  for (uint32_t stage = 0U; stage < S->numStages; stage++) {
+    q31_t b0 = pCoeffs[0U];
+    q31_t b1 = pCoeffs[1U];
+    q31_t b2 = pCoeffs[2U];
+    q31_t a1 = pCoeffs[3U];
+    q31_t a2 = pCoeffs[4U];
+    pCoeffs += 5U;
+
+    q31_t xn1 = pState[0U];
+    q31_t xn2 = pState[1U];
+    q31_t yn1 = pState[2U];
+    q31_t yn2 = pState[3U];
+
+    for (uint32_t n = 0U; n < blockSize; n++) {
+      q31_t xn = pIn[n];
+
+      q63_t acc = q63_t(b0) * xn;
+      acc += q63_t(b1) * xn1;
+      acc += q63_t(b2) * xn2;
+      acc += q63_t(a1) * yn1;
+      acc += q63_t(a2) * yn2;
+
+      q31_t yn = q31_t(acc >> shift);
+
+      xn2 = xn1;
+      xn1 = xn;
+      yn2 = yn1;
+      yn1 = yn;
+
+      pDst[n] = yn;
+    }
+
+    pState[0U] = xn1;
+    pState[1U] = xn2;
+    pState[2U] = yn1;
+    pState[3U] = yn2;
+    pState += 4U;
+
+    pIn = pDst;
+  }
+}
+
+void arm_q15_to_q31(const q15_t* pSrc, q31_t* pDst, uint32_t blockSize)
+{
+  for (uint32_t i = 0U; i < blockSize; i++)
+    pDst[i] = q31_t(uint32_t(q31_t(pSrc[i])) << 16);
+}
+
+q31_t arm_sin_q31(q31_t x)
+{
+  // The input range of 0 to 1.0 maps to an angle of 0 to 2*pi
+  double angle = 2.0 * M_PI * double(x) / 2147483648.0;
+  double value = std::sin(angle) * 2147483648.0;
+
+  if (value >= 2147483647.0)
+    return 2147483647;
+  else if (value <= -2147483648.0)
+    return q31_t(-2147483647 - 1);
+  else
+    return q31_t(value);
+}